@@ -122,7 +122,7 @@ set(INCLUDE_DIRS include
     lib/FileSystem
     lib/tcpip lib/ftp lib/TNFSlib lib/telnet lib/fnjson
     lib/webdav lib/http lib/sam lib/task
-    lib/modem-sniffer lib/printer-emulator
+    lib/modem-sniffer lib/modem lib/printer-emulator
     lib/network-protocol
     lib/fuji lib/bus lib/device lib/media
     lib/encrypt lib/base64
@@ -167,6 +167,7 @@ set(SOURCES src/main.cpp
     lib/hardware/fnUARTUnix.cpp lib/hardware/fnUARTWindows.cpp
     lib/hardware/fnSystem.h lib/hardware/fnSystem.cpp lib/hardware/fnSystemNet.cpp
     lib/FileSystem/fnDirCache.h lib/FileSystem/fnDirCache.cpp
+    lib/FileSystem/fnDirListCache.h lib/FileSystem/fnDirListCache.cpp
     lib/FileSystem/fnFileCache.h lib/FileSystem/fnFileCache.cpp
     lib/FileSystem/fnFS.h lib/FileSystem/fnFS.cpp
     lib/FileSystem/fnFsSPIFFS.h lib/FileSystem/fnFsSPIFFS.cpp
@@ -180,6 +181,8 @@ set(SOURCES src/main.cpp
     lib/FileSystem/fnFileTNFS.h lib/FileSystem/fnFileTNFS.cpp
     lib/FileSystem/fnFileSMB.h lib/FileSystem/fnFileSMB.cpp
     lib/FileSystem/fnFileMem.h lib/FileSystem/fnFileMem.cpp
+    lib/FileSystem/fnFileHTTPRange.h lib/FileSystem/fnFileHTTPRange.cpp
+    lib/FileSystem/fnFileFTPRange.h lib/FileSystem/fnFileFTPRange.cpp
     lib/FileSystem/fnio.h lib/FileSystem/fnio.cpp
     lib/tcpip/fnDNS.h lib/tcpip/fnDNS.cpp
     lib/tcpip/fnUDP.h lib/tcpip/fnUDP.cpp
@@ -188,9 +191,11 @@ set(SOURCES src/main.cpp
     lib/ftp/fnFTP.h lib/ftp/fnFTP.cpp
     lib/TNFSlib/tnfslibMountInfo.h lib/TNFSlib/tnfslibMountInfo.cpp
     lib/TNFSlib/tnfslib.h lib/TNFSlib/tnfslib.cpp
+    lib/TNFSlib/tnfslibBlockCache.h lib/TNFSlib/tnfslibBlockCache.cpp
     lib/TNFSlib/tnfslib_udp.h lib/TNFSlib/tnfslib_udp_testing.cpp
     lib/telnet/libtelnet.h lib/telnet/libtelnet.c
     lib/fnjson/fnjson.h lib/fnjson/fnjson.cpp
+    lib/fnjson/fnjsonstream.h lib/fnjson/fnjsonstream.cpp
     components_pc/mongoose/mongoose.h components_pc/mongoose/mongoose.c
     lib/webdav/WebDAV.h lib/webdav/WebDAV.cpp
     lib/webdav/IndexParser.h lib/webdav/IndexParser.cpp
@@ -249,6 +254,8 @@ set(SOURCES src/main.cpp
     lib/device/udpstream.h
     lib/device/siocpm.h
     lib/modem-sniffer/modem-sniffer.h lib/modem-sniffer/modem-sniffer.cpp
+    lib/modem/modemCore.h lib/modem/modemCore.cpp
+    lib/modem/modemCommand.h lib/modem/modemCommand.cpp
     lib/media/media.h
     lib/encoding/base64.h lib/encoding/base64.cpp
     lib/encoding/hash.h lib/encoding/hash.cpp
@@ -283,6 +290,7 @@ if(FUJINET_TARGET STREQUAL "ATARI")
     lib/device/sio/clock.h lib/device/sio/clock.cpp
     lib/device/sio/siocpm.h lib/device/sio/siocpm.cpp
     lib/device/sio/pclink.h lib/device/sio/pclink.cpp
+    lib/device/sio/pclinkDir.h lib/device/sio/pclinkDir.cpp
     lib/device/sio/modem.h lib/device/sio/modem.cpp
 
     )
@@ -330,6 +338,7 @@ if(FUJINET_TARGET STREQUAL "APPLE")
     lib/media/apple/mediaTypeDSK.h lib/media/apple/mediaTypeDSK.cpp
     lib/media/apple/mediaTypePO.h lib/media/apple/mediaTypePO.cpp
     lib/media/apple/mediaTypeWOZ.h lib/media/apple/mediaTypeWOZ.cpp
+    lib/media/trackCache.h lib/media/trackCache.cpp
 
     lib/device/iwm/disk.h lib/device/iwm/disk.cpp
     lib/device/iwm/disk2.h lib/device/iwm/disk2.cpp
@@ -547,3 +556,56 @@ set_property(
 set_property(
     DIRECTORY APPEND PROPERTY ADDITIONAL_CLEAN_FILES "${CMAKE_BINARY_DIR}/include"
 )
+
+# Host tests and benchmarks (test_pc directory)
+# To build and run
+#   cmake .. -DFUJINET_TARGET=ATARI -DFUJINET_BUILD_TESTS=ON
+#   cmake --build . && ctest
+# Benchmarks are built but not run by ctest, e.g. ./bench_tnfs_read
+option(FUJINET_BUILD_TESTS "Build host tests and benchmarks" OFF)
+if(FUJINET_BUILD_TESTS)
+    enable_testing()
+
+    # firmware without main(), shared by all test programs
+    set(TEST_LIB_SOURCES ${SOURCES})
+    list(REMOVE_ITEM TEST_LIB_SOURCES src/main.cpp)
+    add_library(fujinet_testlib STATIC ${TEST_LIB_SOURCES})
+    add_dependencies(fujinet_testlib build_version)
+    target_include_directories(fujinet_testlib PUBLIC ${INCLUDE_DIRS} ${MBEDTLS_INCLUDE_DIR} "${CMAKE_BINARY_DIR}/include" test_pc)
+    target_link_libraries(fujinet_testlib PUBLIC ${CRYPTO_LIBS} pthread expat cjson cjson_utils smb2 ssh)
+    if(UNIX AND NOT APPLE)
+        target_link_libraries(fujinet_testlib PUBLIC dl)
+    endif()
+    if(CMAKE_SYSTEM_NAME STREQUAL "Windows")
+        target_link_libraries(fujinet_testlib PUBLIC crypt32 ws2_32 bcrypt)
+    endif()
+
+    set(TEST_PROGRAMS
+        test_atr_writeback
+        test_modem_core
+        test_ftp
+        test_http_range
+        test_dirlist_cache
+        test_dns
+        test_pdf_printer
+        test_pclink_dir
+        test_smb_readahead
+    )
+    set(BENCH_PROGRAMS
+        bench_tnfs_read
+        bench_runcpm
+        bench_http_stream
+        bench_fnjson_stream
+        bench_dircache
+        bench_netsio
+        bench_ca_store
+        bench_http_pool
+    )
+    foreach(prog ${TEST_PROGRAMS} ${BENCH_PROGRAMS})
+        add_executable(${prog} test_pc/${prog}.cpp)
+        target_link_libraries(${prog} fujinet_testlib)
+    endforeach()
+    foreach(prog ${TEST_PROGRAMS})
+        add_test(NAME ${prog} COMMAND ${prog})
+    endforeach()
+endif()
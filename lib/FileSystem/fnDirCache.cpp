@@ -1,118 +1,147 @@
-
 #include "fnDirCache.h"
 
 #include <cstring>
+#include <cctype>
 #include <algorithm>
 #include "compat_string.h"
 
 #include "utils.h"
 
+// Max number of entries, positions are uint16_t and FNFS_INVALID_DIRPOS is reserved
+#define DIRCACHE_MAX_ENTRIES (FNFS_INVALID_DIRPOS - 1)
 
-bool _fsdir_sort_name_ascend(const fsdir_entry* left, const fsdir_entry* right)
-{
-    if (left->isDir == right->isDir)
-        return strcasecmp(left->filename, right->filename) < 0;
-    else
-        return left->isDir;
-}
-
-bool _fsdir_sort_name_descend(const fsdir_entry* left, const fsdir_entry* right)
-{
-    if (left->isDir == right->isDir)
-        return strcasecmp(left->filename, right->filename) > 0;
-    else
-        return left->isDir;
-}
-
-bool _fsdir_sort_time_ascend(const fsdir_entry* left, const fsdir_entry* right)
-{
-    if (left->isDir == right->isDir)
-        return left->modified_time > right->modified_time;
-    else
-        return left->isDir;
-}
 
-bool _fsdir_sort_time_descend(const fsdir_entry* left, const fsdir_entry* right)
+// Pack first 8 lowercase characters big endian, so keys compare like strcasecmp() does
+static uint64_t _sort_key(const char *name)
 {
-    if (left->isDir == right->isDir)
-        return left->modified_time < right->modified_time;
-    else
-        return left->isDir;
+    uint64_t key = 0;
+    int i = 0;
+    for (; i < 8 && name[i] != '\0'; i++)
+        key = (key << 8) | (uint8_t)tolower((unsigned char)name[i]);
+    for (; i < 8; i++)
+        key <<= 8;
+    return key;
 }
 
-typedef bool (*sort_fn_t)(const fsdir_entry* left, const fsdir_entry* right);
-
 
 void DirCache::clear()
 {
-    _entries_filtered.clear();
-    _entries_filtered.shrink_to_fit();
-    _entries.clear();
-    _entries.shrink_to_fit();
+    _filtered.clear();
+    _filtered.shrink_to_fit();
+    _records.clear();
+    _records.shrink_to_fit();
+    _names.clear();
+    _names.shrink_to_fit();
     _current = 0;
+    _filter_valid = false;
 }
 
-fsdir_entry &DirCache::new_entry()
+bool DirCache::add_entry(const char *filename, bool isDir, uint32_t size, time_t modified_time)
 {
-    _entries.push_back(fsdir_entry());
-    return _entries.back();
+    if (_records.size() >= DIRCACHE_MAX_ENTRIES)
+        return false;
+
+    size_t len = strnlen(filename, MAX_PATHLEN - 1);
+
+    Record rec;
+    rec.sort_key = _sort_key(filename);
+    rec.modified_time = modified_time;
+    rec.name = _names.size();
+    rec.size = size;
+    rec.isDir = isDir;
+
+    _names.insert(_names.end(), filename, filename + len);
+    _names.push_back('\0');
+    _records.push_back(rec);
+    _filter_valid = false;
+    return true;
 }
 
 void DirCache::apply_filter(const char *pattern, uint16_t diropts)
 {
-	char realpat[MAX_PATHLEN];
-	//char *thepat = nullptr;
     bool have_pattern = pattern != nullptr && pattern[0] != '\0';
-	bool filter_dirs = have_pattern && pattern[strlen(pattern)-1] == '/';
-	if (filter_dirs) {
-		strlcpy (realpat, pattern, sizeof (realpat));
-		realpat[strlen(realpat)-1] = '\0';
-	}
-	//thepat = filter_dirs ? realpat : (char *)pattern;
+    bool filter_dirs = have_pattern && pattern[strlen(pattern)-1] == '/';
+
+    // rewind read cursor
+    _current = 0;
 
-    _entries_filtered.clear();
-    _entries_filtered.shrink_to_fit();
+    // Same listing, same filter, nothing to do
+    if (_filter_valid && _filter_diropts == diropts && _filter_pattern == (have_pattern ? pattern : ""))
+        return;
+
+    // keep capacity, directory is likely to be filtered again
+    _filtered.clear();
 
     // Filter directory entries
-    for (unsigned i=0; i<_entries.size(); ++i)
+    for (unsigned i=0; i<_records.size(); ++i)
     {
-        fsdir_entry& entry = _entries[i];
+        const Record &rec = _records[i];
         // Skip this entry if we have a search filter and it doesn't match it
-        if (have_pattern && (
-            !entry.isDir || (entry.isDir && filter_dirs)
-            ) && util_wildcard_match(entry.filename, pattern) == false)
+        if (have_pattern && (!rec.isDir || filter_dirs) && util_wildcard_match(_name(rec), pattern) == false)
             continue;
-        _entries_filtered.push_back(&entry);
+        _filtered.push_back(i);
     }
 
-    // Choose the appropriate sorting function
-    sort_fn_t sortfn;
+    // Sort directory entries, directories first
+    const Record *records = _records.data();
+    const char *names = _names.data();
     if (diropts & DIR_OPTION_FILEDATE)
     {
-        sortfn = (diropts & DIR_OPTION_DESCENDING) ? _fsdir_sort_time_descend : _fsdir_sort_time_ascend;
+        bool descend = diropts & DIR_OPTION_DESCENDING;
+        std::sort(_filtered.begin(), _filtered.end(), [records, descend](uint16_t l, uint16_t r) {
+            const Record &left = records[l], &right = records[r];
+            if (left.isDir != right.isDir)
+                return left.isDir;
+            return descend ? left.modified_time < right.modified_time : left.modified_time > right.modified_time;
+        });
     }
     else
     {
-        sortfn = (diropts & DIR_OPTION_DESCENDING) ? _fsdir_sort_name_descend : _fsdir_sort_name_ascend;
+        bool descend = diropts & DIR_OPTION_DESCENDING;
+        std::sort(_filtered.begin(), _filtered.end(), [records, names, descend](uint16_t l, uint16_t r) {
+            const Record &left = records[l], &right = records[r];
+            if (left.isDir != right.isDir)
+                return left.isDir;
+            int cmp;
+            if (left.sort_key != right.sort_key)
+                cmp = left.sort_key < right.sort_key ? -1 : 1;
+            else
+                cmp = strcasecmp(names + left.name, names + right.name);
+            return descend ? cmp > 0 : cmp < 0;
+        });
     }
 
-    // Sort directory entries
-    std::sort(_entries_filtered.begin(), _entries_filtered.end(), sortfn);
-    // rewind read cursor
+    _filter_pattern = have_pattern ? pattern : "";
+    _filter_diropts = diropts;
+    _filter_valid = true;
+}
+
+void DirCache::apply_listing_order()
+{
     _current = 0;
+    _filtered.resize(_records.size());
+    for (unsigned i=0; i<_records.size(); ++i)
+        _filtered[i] = i;
+    // different from any filter
+    _filter_valid = false;
 }
 
 fsdir_entry *DirCache::read()
 {
-    if(_current < _entries_filtered.size())
-        return _entries_filtered[_current++];
-    else
+    if(_current >= _filtered.size())
         return nullptr;
+
+    const Record &rec = _records[_filtered[_current++]];
+    strlcpy(_direntry.filename, _name(rec), sizeof(_direntry.filename));
+    _direntry.isDir = rec.isDir;
+    _direntry.size = rec.size;
+    _direntry.modified_time = rec.modified_time;
+    return &_direntry;
 }
 
 uint16_t DirCache::tell()
 {
-    if(_entries_filtered.empty())
+    if(_filtered.empty())
         return FNFS_INVALID_DIRPOS;
     else
         return _current;
@@ -120,7 +149,7 @@ uint16_t DirCache::tell()
 
 bool DirCache::seek(uint16_t pos)
 {
-    if(pos <= _entries_filtered.size())
+    if(pos <= _filtered.size())
     {
         _current = pos;
         return true;
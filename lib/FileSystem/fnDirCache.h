@@ -2,6 +2,8 @@
 #define FN_DIRCACHE_H
 
 #include <vector>
+#include <string>
+#include <stdint.h>
 
 #ifdef ESP_PLATFORM
 #include "../../include/PSRAMAllocator.h"
@@ -9,31 +11,58 @@
 
 #include "fnFS.h"
 
+/*
+ * Directory listing cache
+ * File names are stored in one string arena, entry metadata in fixed size
+ * records. Filtering and sorting works on 16-bit record indices, fsdir_entry
+ * is only filled for the entry being read.
+ */
 class DirCache
 {
 private:
+    struct Record
+    {
+        uint64_t sort_key;      // first 8 case folded characters of name, for quick compare
+        time_t modified_time;
+        uint32_t name;          // offset of name in _names
+        uint32_t size;
+        bool isDir;
+    };
+
 #ifdef ESP_PLATFORM
-    std::vector<fsdir_entry,PSRAMAllocator<fsdir_entry>> _entries;
-    std::vector<fsdir_entry *,PSRAMAllocator<fsdir_entry *>> _entries_filtered;
+    std::vector<char,PSRAMAllocator<char>> _names;
+    std::vector<Record,PSRAMAllocator<Record>> _records;
+    std::vector<uint16_t,PSRAMAllocator<uint16_t>> _filtered;
 #else
-    std::vector<fsdir_entry> _entries;
-    std::vector<fsdir_entry *> _entries_filtered;
+    std::vector<char> _names;
+    std::vector<Record> _records;
+    std::vector<uint16_t> _filtered;
 #endif
     uint16_t _current = 0;
 
-public:
-    // DirCache();
-    // ~DirCache();
+    // last applied filter, to skip filtering and sorting when nothing changed
+    bool _filter_valid = false;
+    std::string _filter_pattern;
+    uint16_t _filter_diropts = 0;
+
+    // entry returned by read()
+    fsdir_entry _direntry;
 
+    const char *_name(const Record &rec) const { return _names.data() + rec.name; }
+
+public:
     void clear();
-    fsdir_entry &new_entry();
+    bool add_entry(const char *filename, bool isDir, uint32_t size, time_t modified_time);
     void apply_filter(const char *pattern, uint16_t diropts);
+    // Read entries in the order they were added, without filtering
+    void apply_listing_order();
 
-    bool empty() {return _entries.empty();}
+    bool empty() {return _records.empty();}
+    size_t size() {return _records.size();}
 
     fsdir_entry *read();
     uint16_t tell();
     bool seek(uint16_t pos);
 };
 
-#endif // FN_DIRCACHE_H
\ No newline at end of file
+#endif // FN_DIRCACHE_H
@@ -0,0 +1,428 @@
+#include "fnDirListCache.h"
+
+#include <cstring>
+#include <vector>
+
+#include "compat_string.h"
+
+#include "../../include/debug.h"
+
+#include "fnSystem.h"
+#include "fnFsSD.h"
+
+
+// Persisted listing file format version
+#define DIRLIST_FILE_MAGIC   "FNDL"
+#define DIRLIST_FILE_VERSION 1
+
+// Wall clock before this is considered as not set (no NTP yet)
+#define DIRLIST_MIN_VALID_TIME 1600000000
+
+DirListCache fnDirListCache;
+
+
+static uint32_t _fnv1a(const char *str)
+{
+    uint32_t hash = 0x811c9dc5;
+    for (const unsigned char *p = (const unsigned char *)str; *p != '\0'; p++)
+    {
+        hash ^= *p;
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+static std::string _hex(uint32_t value)
+{
+    char buf[9];
+    snprintf(buf, sizeof(buf), "%08X", (unsigned)value);
+    return std::string(buf);
+}
+
+// Directory part of path, without trailing slash, "/" for root
+static std::string _parent_path(const std::string &path)
+{
+    std::string p = path;
+    while (p.size() > 1 && p.back() == '/')
+        p.pop_back();
+    size_t pos = p.rfind('/');
+    if (pos == std::string::npos || pos == 0)
+        return "/";
+    return p.substr(0, pos);
+}
+
+// Path without trailing slash so "/dir" and "/dir/" match
+static std::string _normalize_path(const char *path)
+{
+    std::string p = (path == nullptr || path[0] == '\0') ? "/" : path;
+    if (p[0] != '/')
+        p.insert(0, 1, '/');
+    while (p.size() > 1 && p.back() == '/')
+        p.pop_back();
+    return p;
+}
+
+// Server name of host slot string, i.e. "server" of "smb://user@server:445/share"
+static std::string _server_name(const std::string &host)
+{
+    size_t start = host.find("://");
+    start = (start == std::string::npos) ? 0 : start + 3;
+    std::string server = host.substr(start, host.find('/', start) - start);
+    size_t at = server.rfind('@');
+    if (at != std::string::npos)
+        server.erase(0, at + 1);
+    return server.substr(0, server.find(':'));
+}
+
+// Persisted file name: <host hash>-<path hash>-<pattern and options hash>
+// so all listings of host or path can be found by name prefix
+std::string DirListCache::_make_key(const char *host, const char *path, const char *pattern, uint16_t diropts)
+{
+    char opts[8];
+    snprintf(opts, sizeof(opts), "%u", diropts);
+    return _hex(_fnv1a(host)) + '-' + _hex(_fnv1a(_normalize_path(path).c_str())) + '-' +
+        _hex(_fnv1a((std::string(pattern == nullptr ? "" : pattern) + '\t' + opts).c_str()));
+}
+
+std::string DirListCache::_persist_path(const std::string &key)
+{
+    return std::string(DIRLIST_CACHE_DIRECTORY) + '/' + key + ".dir";
+}
+
+std::list<DirListCache::Listing>::iterator DirListCache::_find(const std::string &key)
+{
+    auto it = _listings.begin();
+    while (it != _listings.end() && it->key != key)
+        ++it;
+    return it;
+}
+
+bool DirListCache::_fresh(const Listing &listing)
+{
+    if (listing.fetched_ms_valid)
+        return (fnSystem.millis() - listing.fetched_ms) < _ttl * 1000UL;
+
+    time_t now = time(nullptr);
+    return now > DIRLIST_MIN_VALID_TIME && listing.fetched > DIRLIST_MIN_VALID_TIME &&
+           now - listing.fetched < (time_t)_ttl;
+}
+
+DirListCacheStats DirListCache::get_stats()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+bool DirListCache::lookup(const char *host, const char *path, const char *pattern, uint16_t diropts, FileSystem *fs, DirCache &out)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stats.lookups++;
+    std::string key = _make_key(host, path, pattern, diropts);
+
+    auto it = _find(key);
+
+    if (it == _listings.end())
+    {
+        // Not in memory, try SD
+        Listing listing;
+        if (!_persist || !_load(key, listing))
+        {
+            _stats.misses++;
+            return false;
+        }
+        listing.host = host;
+        listing.path = _normalize_path(path);
+        if (_listings.size() >= DIRLIST_CACHE_MAX_LISTINGS)
+            _listings.pop_back();
+        _listings.push_front(std::move(listing));
+        it = _listings.begin();
+    }
+    else if (it != _listings.begin())
+    {
+        // Mark as most recently used
+        _listings.splice(_listings.begin(), _listings, it);
+        it = _listings.begin();
+    }
+
+    if (!_fresh(*it))
+    {
+        // Too old, still good if directory didn't change since. Ask the
+        // server without holding the lock, the listing may go meanwhile.
+        time_t mtime = 0;
+        if (it->dir_mtime != 0 && fs != nullptr)
+        {
+            lock.unlock();
+            mtime = fs->dir_mtime(path);
+            lock.lock();
+            it = _find(key);
+            if (it == _listings.end())
+            {
+                _stats.misses++;
+                return false;
+            }
+        }
+        if (mtime == 0 || mtime != it->dir_mtime)
+        {
+            Debug_printf("DirListCache: listing of \"%s\" expired\n", path);
+            if (_persist)
+                _remove_persisted(it->key);
+            _listings.erase(it);
+            _stats.misses++;
+            return false;
+        }
+        it->fetched_ms = fnSystem.millis();
+        it->fetched_ms_valid = true;
+        _stats.revalidated++;
+    }
+
+    _stats.hits++;
+    _stats.saved_ms += it->list_ms;
+    Debug_printf("DirListCache: hit \"%s\", %u of %u lookups hit, %llu ms saved\n",
+        path, (unsigned)_stats.hits, (unsigned)_stats.lookups, (unsigned long long)_stats.saved_ms);
+
+    out = it->entries;
+    out.apply_listing_order();
+    return true;
+}
+
+void DirListCache::store(const char *host, const char *path, const char *pattern, uint16_t diropts, const DirCache &listing, time_t dir_mtime, uint32_t list_ms)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::string key = _make_key(host, path, pattern, diropts);
+
+    for (auto it = _listings.begin(); it != _listings.end(); ++it)
+    {
+        if (it->key == key)
+        {
+            _listings.erase(it);
+            break;
+        }
+    }
+    if (_listings.size() >= DIRLIST_CACHE_MAX_LISTINGS)
+        _listings.pop_back();
+
+    Listing l;
+    l.host = host;
+    l.path = _normalize_path(path);
+    l.key = key;
+    l.entries = listing;
+    l.dir_mtime = dir_mtime;
+    l.fetched = time(nullptr);
+    l.fetched_ms = fnSystem.millis();
+    l.fetched_ms_valid = true;
+    l.list_ms = list_ms;
+    _listings.push_front(std::move(l));
+
+    if (_persist)
+        _save(_listings.front());
+}
+
+void DirListCache::invalidate(const char *host, const char *path)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::string p = _normalize_path(path);
+    std::string parent = _parent_path(p);
+    std::string subtree = (p == "/") ? p : p + '/';
+
+    for (auto it = _listings.begin(); it != _listings.end();)
+    {
+        if (it->host == host && (it->path == p || it->path == parent || it->path.compare(0, subtree.size(), subtree) == 0))
+        {
+            _stats.invalidations++;
+            it = _listings.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    if (_persist)
+    {
+        // persisted listings of path and parent, subdirectories expire by TTL/mtime
+        std::string host_hash = _hex(_fnv1a(host));
+        _remove_persisted(host_hash + '-' + _hex(_fnv1a(p.c_str())) + "-*");
+        _remove_persisted(host_hash + '-' + _hex(_fnv1a(parent.c_str())) + "-*");
+    }
+}
+
+void DirListCache::invalidate_host(const char *host)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto it = _listings.begin(); it != _listings.end();)
+    {
+        if (it->host == host)
+        {
+            _stats.invalidations++;
+            it = _listings.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    if (_persist)
+        _remove_persisted(_hex(_fnv1a(host)) + "-*");
+}
+
+void DirListCache::invalidate_server(const char *server)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    bool dropped = false;
+    for (auto it = _listings.begin(); it != _listings.end();)
+    {
+        if (strcasecmp(_server_name(it->host).c_str(), server) == 0)
+        {
+            _stats.invalidations++;
+            dropped = true;
+            it = _listings.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    if (dropped)
+        Debug_printf("DirListCache: dropped listings of server \"%s\"\n", server);
+
+    // persisted names only have a hash of the whole host string, can't select by server
+    if (_persist)
+        _remove_persisted("*");
+}
+
+/*
+ Persisted listing:
+   magic[4] version[1] dir_mtime[8] fetched[8] list_ms[4] count[4]
+   count * { isDir[1] size[4] modified_time[8] name_len[2] name[name_len] }
+*/
+void DirListCache::_save(const Listing &listing)
+{
+    if (!fnSDFAT.running())
+        return;
+
+    fnSDFAT.create_path(DIRLIST_CACHE_DIRECTORY);
+    std::string file_path = _persist_path(listing.key);
+    FILE *f = fnSDFAT.file_open(file_path.c_str(), "wb");
+    if (f == nullptr)
+        return;
+
+    DirCache entries = listing.entries;
+    entries.apply_listing_order();
+
+    uint8_t version = DIRLIST_FILE_VERSION;
+    int64_t dir_mtime = listing.dir_mtime;
+    int64_t fetched = listing.fetched;
+    uint32_t list_ms = listing.list_ms;
+    uint32_t count = entries.size();
+    bool ok = fwrite(DIRLIST_FILE_MAGIC, 4, 1, f) == 1 &&
+              fwrite(&version, sizeof(version), 1, f) == 1 &&
+              fwrite(&dir_mtime, sizeof(dir_mtime), 1, f) == 1 &&
+              fwrite(&fetched, sizeof(fetched), 1, f) == 1 &&
+              fwrite(&list_ms, sizeof(list_ms), 1, f) == 1 &&
+              fwrite(&count, sizeof(count), 1, f) == 1;
+
+    fsdir_entry *de;
+    while (ok && (de = entries.read()) != nullptr)
+    {
+        uint8_t is_dir = de->isDir ? 1 : 0;
+        uint32_t size = de->size;
+        int64_t mtime = de->modified_time;
+        uint16_t name_len = strlen(de->filename);
+        ok = fwrite(&is_dir, sizeof(is_dir), 1, f) == 1 &&
+             fwrite(&size, sizeof(size), 1, f) == 1 &&
+             fwrite(&mtime, sizeof(mtime), 1, f) == 1 &&
+             fwrite(&name_len, sizeof(name_len), 1, f) == 1 &&
+             fwrite(de->filename, 1, name_len, f) == name_len;
+    }
+    fclose(f);
+
+    if (!ok)
+    {
+        Debug_printf("DirListCache: failed to write \"%s\"\n", file_path.c_str());
+        fnSDFAT.remove(file_path.c_str());
+    }
+}
+
+bool DirListCache::_load(const std::string &key, Listing &listing)
+{
+    if (!fnSDFAT.running())
+        return false;
+
+    std::string file_path = _persist_path(key);
+    FILE *f = fnSDFAT.file_open(file_path.c_str(), "rb");
+    if (f == nullptr)
+        return false;
+
+    char magic[4];
+    uint8_t version = 0;
+    int64_t dir_mtime, fetched;
+    uint32_t list_ms, count;
+    bool ok = fread(magic, 4, 1, f) == 1 && memcmp(magic, DIRLIST_FILE_MAGIC, 4) == 0 &&
+              fread(&version, sizeof(version), 1, f) == 1 && version == DIRLIST_FILE_VERSION &&
+              fread(&dir_mtime, sizeof(dir_mtime), 1, f) == 1 &&
+              fread(&fetched, sizeof(fetched), 1, f) == 1 &&
+              fread(&list_ms, sizeof(list_ms), 1, f) == 1 &&
+              fread(&count, sizeof(count), 1, f) == 1 &&
+              count <= DIRLIST_CACHE_MAX_ENTRIES;
+
+    listing.entries.clear();
+    char name[MAX_PATHLEN];
+    for (uint32_t i = 0; ok && i < count; i++)
+    {
+        uint8_t is_dir;
+        uint32_t size;
+        int64_t mtime;
+        uint16_t name_len;
+        ok = fread(&is_dir, sizeof(is_dir), 1, f) == 1 &&
+             fread(&size, sizeof(size), 1, f) == 1 &&
+             fread(&mtime, sizeof(mtime), 1, f) == 1 &&
+             fread(&name_len, sizeof(name_len), 1, f) == 1 &&
+             name_len < sizeof(name) &&
+             fread(name, 1, name_len, f) == name_len;
+        if (ok)
+        {
+            name[name_len] = '\0';
+            ok = listing.entries.add_entry(name, is_dir != 0, size, (time_t)mtime);
+        }
+    }
+    fclose(f);
+
+    if (!ok)
+    {
+        Debug_printf("DirListCache: invalid persisted listing \"%s\"\n", file_path.c_str());
+        fnSDFAT.remove(file_path.c_str());
+        listing.entries.clear();
+        return false;
+    }
+
+    listing.key = key;
+    listing.dir_mtime = (time_t)dir_mtime;
+    listing.fetched = (time_t)fetched;
+    listing.fetched_ms = 0;
+    listing.fetched_ms_valid = false;
+    listing.list_ms = list_ms;
+    return true;
+}
+
+// Remove persisted listings, key may end with '*' to remove all matching files
+void DirListCache::_remove_persisted(const std::string &key)
+{
+    if (!fnSDFAT.running())
+        return;
+
+    if (key.back() != '*')
+    {
+        fnSDFAT.remove(_persist_path(key).c_str());
+        return;
+    }
+
+    std::vector<std::string> names;
+    if (fnSDFAT.dir_open(DIRLIST_CACHE_DIRECTORY, (key + ".dir").c_str(), 0))
+    {
+        fsdir_entry *de;
+        while ((de = fnSDFAT.dir_read()) != nullptr)
+        {
+            if (!de->isDir)
+                names.push_back(de->filename);
+        }
+        fnSDFAT.dir_close();
+    }
+    for (const std::string &name : names)
+        fnSDFAT.remove((std::string(DIRLIST_CACHE_DIRECTORY) + '/' + name).c_str());
+}
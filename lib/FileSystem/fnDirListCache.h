@@ -0,0 +1,112 @@
+#ifndef FN_DIRLISTCACHE_H
+#define FN_DIRLISTCACHE_H
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+#include <time.h>
+
+#include "fnFS.h"
+#include "fnDirCache.h"
+
+// Listings younger than this (seconds) are used without asking the server,
+// older ones only if the directory mtime shows no change
+#define DIRLIST_CACHE_TTL 30
+
+#ifdef ESP_PLATFORM
+#define DIRLIST_CACHE_MAX_LISTINGS 8
+#define DIRLIST_CACHE_MAX_ENTRIES 1024
+#else
+#define DIRLIST_CACHE_MAX_LISTINGS 32
+#define DIRLIST_CACHE_MAX_ENTRIES 8192
+#endif
+
+// Keep copy of cached listings on SD card so they survive reboot
+// Off by default, every listed directory costs an SD card write
+#ifndef DIRLIST_CACHE_PERSIST
+#define DIRLIST_CACHE_PERSIST 0
+#endif
+
+// Directory on SD card used for persisted listings
+#define DIRLIST_CACHE_DIRECTORY "/FujiNet/dircache"
+
+struct DirListCacheStats
+{
+    uint32_t lookups = 0;
+    uint32_t hits = 0;          // includes revalidated listings
+    uint32_t revalidated = 0;   // listings older than TTL confirmed by directory mtime
+    uint32_t misses = 0;
+    uint32_t invalidations = 0;
+    uint64_t saved_ms = 0;      // sum of listing times of the served listings
+};
+
+/*
+ * Cache of remote directory listings shared by all host slots
+ * Listings are kept as returned by the file system (filtered and sorted)
+ * and keyed by host, path, pattern and sort options. Listings older than
+ * the TTL are only reused if the directory modification time didn't
+ * change, for file systems which can tell it.
+ */
+class DirListCache
+{
+private:
+    struct Listing
+    {
+        std::string host;
+        std::string path;
+        std::string key;        // host, path, pattern and options
+        DirCache entries;
+        time_t dir_mtime;       // 0 if unknown
+        time_t fetched;         // wall clock time, for persisted listings
+        uint64_t fetched_ms;    // fnSystem.millis() when listed
+        bool fetched_ms_valid;  // false for listings loaded from SD
+        uint32_t list_ms;       // time it took to list the directory
+    };
+
+    std::list<Listing> _listings; // most recently used first
+    DirListCacheStats _stats;
+    bool _persist = DIRLIST_CACHE_PERSIST;
+    uint32_t _ttl = DIRLIST_CACHE_TTL;
+    // stats are read by the web server task
+    std::mutex _mutex;
+
+    static std::string _make_key(const char *host, const char *path, const char *pattern, uint16_t diropts);
+    static std::string _persist_path(const std::string &key);
+
+    std::list<Listing>::iterator _find(const std::string &key);
+    bool _fresh(const Listing &listing);
+    void _save(const Listing &listing);
+    bool _load(const std::string &key, Listing &listing);
+    void _remove_persisted(const std::string &key);
+
+public:
+    /**
+     * @brief Find listing in cache, revalidate it if needed
+     * @param fs file system the host is using, to get directory mtime
+     * @param out receives the listing, ready to read
+     * @return true on cache hit
+     */
+    bool lookup(const char *host, const char *path, const char *pattern, uint16_t diropts, FileSystem *fs, DirCache &out);
+
+    /**
+     * @brief Store listing read from file system
+     * @param list_ms time it took to get the listing
+     */
+    void store(const char *host, const char *path, const char *pattern, uint16_t diropts, const DirCache &listing, time_t dir_mtime, uint32_t list_ms);
+
+    // Drop listings of given path and its parent directory, and everything below path
+    void invalidate(const char *host, const char *path);
+    // Drop all listings of host
+    void invalidate_host(const char *host);
+    // Drop all listings of hosts on given server, for changes made outside of host slots
+    void invalidate_server(const char *server);
+
+    void set_persistent(bool persist) { _persist = persist; };
+    void set_ttl(uint32_t seconds) { _ttl = seconds; };
+    DirListCacheStats get_stats();
+};
+
+extern DirListCache fnDirListCache;
+
+#endif // FN_DIRLISTCACHE_H
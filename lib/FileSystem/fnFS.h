@@ -114,6 +114,8 @@ public:
     virtual bool mkdir(const char* path) = 0;
     virtual bool rmdir(const char* path) = 0;
     virtual bool dir_exists(const char* path) = 0;
+    // Returns modification time of directory or 0 if unknown, used to revalidate cached listings
+    virtual time_t dir_mtime(const char* path) { return 0; };
 
     // By default, a directory should be sorted and special/hidden items should be filtered out
     virtual bool dir_open(const char *path, const char *pattern, uint16_t diroptions) = 0;
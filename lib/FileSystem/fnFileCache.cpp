@@ -90,7 +90,43 @@ static std::string get_file_path(const std::string &name)
     return std::string(FILE_CACHE_DIRECTORY) + '/' + name;
 }
 
-FileHandler *FileCache::open(const char *host, const char *path, const char *mode)
+/**
+ * @brief Write info file next to SD cache file, version is added when the cache file is complete
+ */
+static void write_info(fc_handle *fc, bool complete)
+{
+    FileHandler *fh = fnSDFAT.filehandler_open((get_file_path(fc->name) + ".TXT").c_str(), "wb+");
+    if (fh == nullptr)
+        return;
+    std::string info("Host: "+ fc->host +"\r\nFile: "+ fc->path+ "\r\nCache: "+ fc->name +"\r\n");
+    if (complete && !fc->version.empty())
+        info += "Version: " + fc->version + "\r\n";
+    fh->write(info.c_str(), 1, info.size());
+    fh->close();
+}
+
+/**
+ * @brief Get version recorded in info file of SD cache file, empty if none
+ */
+static std::string read_version(const std::string &cache_path)
+{
+    FileHandler *fh = fnSDFAT.filehandler_open((cache_path + ".TXT").c_str(), "rb");
+    if (fh == nullptr)
+        return std::string();
+    char buf[512];
+    size_t len = fh->read(buf, 1, sizeof(buf) - 1);
+    fh->close();
+    buf[len] = '\0';
+
+    const char *p = strstr(buf, "\r\nVersion: ");
+    if (p == nullptr)
+        return std::string();
+    p += 11;
+    const char *end = strstr(p, "\r\n");
+    return std::string(p, end == nullptr ? strlen(p) : end - p);
+}
+
+FileHandler *FileCache::open(const char *host, const char *path, const char *mode, const char *version)
 {
     FileHandler *fh = nullptr;
 
@@ -99,17 +135,28 @@ FileHandler *FileCache::open(const char *host, const char *path, const char *mod
 
     std::string cache_path(get_file_path(encode_host_path(host, path)));
 
-    // test file age, do not use old/expired
-    struct timeval now;
+    if (version != nullptr)
+    {
+        // remote file is known to be unchanged, age doesn't matter
+        if (read_version(cache_path) == version)
+            fh = fnSDFAT.filehandler_open(cache_path.c_str(), mode);
+        else
+            Debug_printf("SD cache file is out of date: %s\n", cache_path.c_str());
+    }
+    else
+    {
+        // test file age, do not use old/expired
+        struct timeval now;
 #ifdef ESP_PLATFORM
-    gettimeofday(&now, nullptr);
+        gettimeofday(&now, nullptr);
 #else
-	compat_gettimeofday(&now, nullptr);
+        compat_gettimeofday(&now, nullptr);
 #endif
-    if (now.tv_sec - fnSDFAT.mtime(cache_path.c_str()) < CACHE_FILE_MAX_AGE)
-    {
-        // open SD file
-        fh = fnSDFAT.filehandler_open(cache_path.c_str(), mode);
+        if (now.tv_sec - fnSDFAT.mtime(cache_path.c_str()) < CACHE_FILE_MAX_AGE)
+        {
+            // open SD file
+            fh = fnSDFAT.filehandler_open(cache_path.c_str(), mode);
+        }
     }
 
     if (fh != nullptr)
@@ -121,7 +168,7 @@ FileHandler *FileCache::open(const char *host, const char *path, const char *mod
     return fh;
 }
 
-fc_handle *FileCache::create(const char *host, const char *path, int threshold, int max_size)
+fc_handle *FileCache::create(const char *host, const char *path, int threshold, int max_size, const char *version)
 {
     fc_handle *fc;
 
@@ -149,6 +196,8 @@ fc_handle *FileCache::create(const char *host, const char *path, int threshold,
     fc->host = std::string(host);
     fc->path = std::string(path);
     fc->name = encode_host_path(host, path);
+    if (version != nullptr)
+        fc->version = std::string(version);
 
     return fc;
 }
@@ -206,11 +255,8 @@ size_t FileCache::write(fc_handle *fc, const void *data, size_t len)
         fc->fh->close();
         fc->fh = fh_sd;
         fc->persistent = true;
-        // Write some info into file (optional, not used by anything)
-        fh_sd = fnSDFAT.filehandler_open((get_file_path(fc->name) + ".TXT").c_str(), "wb+");
-        std::string info("Host: "+ fc->host +"\r\nFile: "+ fc->path+ "\r\nCache: "+ fc->name +"\r\n");
-        fh_sd->write(info.c_str(), 1, info.size());
-        fh_sd->close();
+        // Write some info into file, version follows once the file is complete
+        write_info(fc, false);
         //Debug_println("Changed to SD");
     }
     return result;
@@ -229,6 +275,8 @@ FileHandler *FileCache::reopen(fc_handle *fc, const char *mode)
         // reopen SD cache file
         fc->fh->flush();
         fc->fh->close();
+        if (!fc->version.empty())
+            write_info(fc, true);
         fh = fnSDFAT.filehandler_open(get_file_path(fc->name).c_str(), mode);
     }
     else
@@ -17,6 +17,7 @@ typedef struct fc_handle
     std::string host;
     std::string path;
     std::string name;
+    std::string version;
 } fc_handle;
 
 
@@ -29,9 +30,11 @@ public:
     * @param host name from host slot
     * @param path file path from device slot
     * @param mode open mode
+    * @param version remote file version (e.g. size and modification time), if given the cache
+    * file is used only when it was completed from the same version, regardless of its age
     * @return pointer to file handler to use or nullptr on error
     */
-    static FileHandler *open(const char *host, const char *path, const char *mode);
+    static FileHandler *open(const char *host, const char *path, const char *mode, const char *version=nullptr);
 
    /**
     * @brief Create new empty cache file, ready for writes, file is created in memory
@@ -39,9 +42,10 @@ public:
     * @param path file path from device slot
     * @param threshold size threshold when in memory file is changed to SD file, < 0 to use default threshold, 0 to start on SD
     * @param max_size maximum file size, < 0 for unlimited
+    * @param version remote file version, recorded when the cache file is complete (see open)
     * @return pointer to fc_handle structure or nullptr on error
     */
-    static fc_handle *create(const char *host, const char *path, int threshold=-1, int max_size=-1);
+    static fc_handle *create(const char *host, const char *path, int threshold=-1, int max_size=-1, const char *version=nullptr);
 
    /** 
     * @brief Write data to cache file
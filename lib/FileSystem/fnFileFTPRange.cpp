@@ -0,0 +1,298 @@
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fnFileFTPRange.h"
+#include "../../include/debug.h"
+
+#include "fnSystem.h"
+
+
+FileHandlerFTPRange::FileHandlerFTPRange(std::shared_ptr<fnFTP> ftp, const std::string &path, long int filesize)
+    : _ftp(ftp), _path(path), _filesize(filesize), _position(0), _slots_used(0), _use_counter(0), _data(nullptr)
+{
+    Debug_println("new FileHandlerFTPRange");
+}
+
+
+FileHandlerFTPRange::~FileHandlerFTPRange()
+{
+    Debug_println("delete FileHandlerFTPRange");
+    if (_ftp != nullptr)
+        close(false);
+}
+
+
+FileHandlerFTPRange *FileHandlerFTPRange::open(std::shared_ptr<fnFTP> ftp, const std::string &path, long int filesize)
+{
+    if (ftp == nullptr || filesize <= 0)
+        return nullptr;
+
+    FileHandlerFTPRange *fh = new FileHandlerFTPRange(ftp, path, filesize);
+#ifdef ESP_PLATFORM
+    fh->_data = (uint8_t *)heap_caps_malloc(FTP_RANGE_CACHE_BLOCKS * FTP_RANGE_BLOCK_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#else
+    fh->_data = (uint8_t *)malloc(FTP_RANGE_CACHE_BLOCKS * FTP_RANGE_BLOCK_SIZE);
+#endif
+    if (fh->_data == nullptr)
+    {
+        Debug_println("FileHandlerFTPRange::open - failed to allocate block cache");
+        delete fh;
+        return nullptr;
+    }
+
+    // Fetch last block, it needs REST which not every server supports
+    if (fh->_get_block((filesize - 1) / FTP_RANGE_BLOCK_SIZE) < 0)
+    {
+        Debug_println("FileHandlerFTPRange::open - server can't restart transfers");
+        delete fh;
+        return nullptr;
+    }
+
+    Debug_printf("FileHandlerFTPRange::open - fetching on demand, file size %ld\n", filesize);
+    return fh;
+}
+
+
+int FileHandlerFTPRange::close(bool destroy)
+{
+    Debug_println("FileHandlerFTPRange::close");
+    if (_ftp != nullptr)
+    {
+        // log out unless the file system still uses the connection
+        if (_ftp.use_count() == 1)
+            _ftp->logout();
+        _ftp.reset();
+    }
+    free(_data);
+    _data = nullptr;
+    _block_map.clear();
+    _slots_used = 0;
+    if (destroy) delete this;
+    return 0;
+}
+
+
+int FileHandlerFTPRange::seek(long int off, int whence)
+{
+    long int new_pos;
+    switch (whence)
+    {
+        case SEEK_SET:
+            new_pos = off;
+            break;
+        case SEEK_END:
+            new_pos = _filesize + off;
+            break;
+        case SEEK_CUR:
+            new_pos = _position + off;
+            break;
+        default:
+            Debug_printf("FileHandlerFTPRange::seek - called with invalid whence value: %d\n", whence);
+            errno = EINVAL;
+            return -1;
+    }
+
+    if (new_pos < 0)
+    {
+        Debug_printf("FileHandlerFTPRange::seek - invalid new position: %ld\n", new_pos);
+        errno = EINVAL;
+        return -1;
+    }
+
+    // nothing is fetched here, blocks are requested on read
+    _position = new_pos;
+    return 0;
+}
+
+
+long int FileHandlerFTPRange::tell()
+{
+    return _position;
+}
+
+
+int FileHandlerFTPRange::eof()
+{
+    return _position >= _filesize;
+}
+
+
+size_t FileHandlerFTPRange::read(void *ptr, size_t size, size_t count)
+{
+    if (_ftp == nullptr || size == 0)
+        return 0;
+
+    size_t requested = size * count;
+    if (_position >= _filesize)
+        return 0;
+    if ((long int)requested > _filesize - _position)
+        requested = _filesize - _position;
+
+    uint8_t *dest = (uint8_t *)ptr;
+    size_t copied = 0;
+    while (copied < requested)
+    {
+        uint32_t block = _position / FTP_RANGE_BLOCK_SIZE;
+        uint32_t offset = _position % FTP_RANGE_BLOCK_SIZE;
+        int slot = _get_block(block);
+        if (slot < 0)
+        {
+            errno = EIO;
+            break;
+        }
+        if (_slots[slot].length <= offset)
+            break; // short block, file is smaller than announced
+        size_t n = _slots[slot].length - offset;
+        if (n > requested - copied)
+            n = requested - copied;
+        memcpy(dest + copied, _data + slot * FTP_RANGE_BLOCK_SIZE + offset, n);
+        copied += n;
+        _position += n;
+    }
+
+    return copied / size;
+}
+
+
+size_t FileHandlerFTPRange::write(const void *ptr, size_t size, size_t count)
+{
+    Debug_println("FileHandlerFTPRange::write - not supported");
+    errno = EROFS;
+    return 0;
+}
+
+
+int FileHandlerFTPRange::flush()
+{
+    return 0;
+}
+
+
+// Return slot with requested block, fetch it (and following blocks) if not cached, -1 on error
+int FileHandlerFTPRange::_get_block(uint32_t block)
+{
+    auto it = _block_map.find(block);
+    if (it == _block_map.end())
+    {
+        // read-ahead: request following blocks which are not cached yet
+        uint32_t last_block = (_filesize - 1) / FTP_RANGE_BLOCK_SIZE;
+        uint32_t count = 1;
+        while (count < FTP_RANGE_READAHEAD && block + count <= last_block
+               && _block_map.find(block + count) == _block_map.end())
+            count++;
+
+        if (!_fetch_blocks(block, count))
+            return -1;
+
+        it = _block_map.find(block);
+        if (it == _block_map.end())
+            return -1;
+    }
+    _slots[it->second].last_use = ++_use_counter;
+    return it->second;
+}
+
+
+// Return free slot for block, least recently used block is evicted if there is no free slot
+int FileHandlerFTPRange::_alloc_slot(uint32_t block)
+{
+    int slot;
+    if (_slots_used < FTP_RANGE_CACHE_BLOCKS)
+    {
+        slot = _slots_used++;
+    }
+    else
+    {
+        slot = 0;
+        for (int i = 1; i < FTP_RANGE_CACHE_BLOCKS; i++)
+        {
+            if (_slots[i].last_use < _slots[slot].last_use)
+                slot = i;
+        }
+        auto it = _block_map.find(_slots[slot].block);
+        if (it != _block_map.end() && it->second == slot)
+            _block_map.erase(it);
+    }
+    _slots[slot].block = block;
+    _slots[slot].length = 0;
+    _slots[slot].last_use = ++_use_counter;
+    _block_map[block] = slot;
+    return slot;
+}
+
+
+// Fetch count consecutive blocks starting at first with single transfer
+bool FileHandlerFTPRange::_fetch_blocks(uint32_t first, uint32_t count)
+{
+    long int range_start = (long int)first * FTP_RANGE_BLOCK_SIZE;
+    long int range_end = range_start + (long int)count * FTP_RANGE_BLOCK_SIZE - 1;
+    if (range_end >= _filesize)
+        range_end = _filesize - 1;
+
+    Debug_printf("FileHandlerFTPRange::_fetch_blocks - %ld-%ld\n", range_start, range_end);
+
+    if (_ftp->keep_alive() || _ftp->open_file(_path, false, range_start))
+    {
+        Debug_printf("FileHandlerFTPRange::_fetch_blocks - RETR failed\n");
+        return false;
+    }
+
+    bool result = true;
+    for (uint32_t b = first; b < first + count; b++)
+    {
+        long int block_start = (long int)b * FTP_RANGE_BLOCK_SIZE;
+        int len = (block_start + FTP_RANGE_BLOCK_SIZE - 1 > range_end) ? range_end - block_start + 1 : FTP_RANGE_BLOCK_SIZE;
+        int slot = _alloc_slot(b);
+        int got = _read_data(_data + slot * FTP_RANGE_BLOCK_SIZE, len);
+        if (got < len)
+        {
+            Debug_printf("FileHandlerFTPRange::_fetch_blocks - short read, expected %d bytes, got %d bytes\n", len, got);
+            // keep what was received only if the block is complete
+            _block_map.erase(b);
+            _slots[slot].last_use = 0;
+            result = (b != first);
+            break;
+        }
+        _slots[slot].length = got;
+    }
+
+    // rest of the file isn't needed now
+    if (_ftp->abort_file())
+        _ftp->reconnect();
+    return result;
+}
+
+
+// Read len bytes from data connection, return number of bytes read
+int FileHandlerFTPRange::_read_data(uint8_t *dest, int len)
+{
+    int tmout_counter = 1 + FTP_TIMEOUT / FTP_RANGE_POLL;
+    int total = 0;
+    while (total < len)
+    {
+        int available = _ftp->data_available();
+        if (available < 0)
+            break;
+        if (available == 0)
+        {
+            if (!_ftp->data_connected())
+                break;
+            if (--tmout_counter == 0)
+            {
+                Debug_println("FileHandlerFTPRange::_read_data - Timeout");
+                break;
+            }
+            fnSystem.delay(FTP_RANGE_POLL); // wait
+            continue;
+        }
+        int to_read = (available > len - total) ? len - total : available;
+        if (_ftp->read_file(dest + total, to_read))
+            break;
+        total += to_read;
+        tmout_counter = 1 + FTP_TIMEOUT / FTP_RANGE_POLL; // reset timeout counter
+    }
+    return total;
+}
@@ -0,0 +1,87 @@
+#ifndef FN_FILEFTPRANGE_H
+#define FN_FILEFTPRANGE_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "fnFTP.h"
+#include "fnFile.h"
+
+// read-only files of at least this size are fetched on demand, smaller are downloaded whole, 0 to always download
+#ifndef FTP_RANGE_MIN_SIZE
+#define FTP_RANGE_MIN_SIZE      262144
+#endif
+// size of blocks fetched from server
+#define FTP_RANGE_BLOCK_SIZE    4096
+// number of blocks transferred at once when a block is missing
+#define FTP_RANGE_READAHEAD     4
+// ms between checks for data, a transfer is started for every missing block so don't wait long
+#define FTP_RANGE_POLL          5
+// max number of blocks kept in memory
+#ifdef ESP_PLATFORM
+#define FTP_RANGE_CACHE_BLOCKS  32
+#else
+#define FTP_RANGE_CACHE_BLOCKS  256
+#endif
+
+/*
+ * FileHandlerFTPRange - read-only remote file fetched on demand,
+ * missing blocks are transferred with REST + RETR and the transfer is
+ * aborted once they arrived. The control connection is shared with
+ * the file system which opened the file.
+ */
+class FileHandlerFTPRange : public FileHandler
+{
+protected:
+    struct BlockSlot
+    {
+        uint32_t block;     // block number in file
+        uint32_t length;    // valid bytes, less than block size for last block
+        uint32_t last_use;  // for LRU replacement
+    };
+
+    std::shared_ptr<fnFTP> _ftp;
+    std::string _path;
+    long int _filesize;
+    long int _position;
+
+    // sparse map of cached blocks: block number -> slot
+    std::map<uint32_t, int> _block_map;
+    BlockSlot _slots[FTP_RANGE_CACHE_BLOCKS];
+    int _slots_used;
+    uint32_t _use_counter;
+    uint8_t *_data;
+
+    FileHandlerFTPRange(std::shared_ptr<fnFTP> ftp, const std::string &path, long int filesize);
+
+    int _get_block(uint32_t block);
+    int _alloc_slot(uint32_t block);
+    bool _fetch_blocks(uint32_t first, uint32_t count);
+    int _read_data(uint8_t *dest, int len);
+
+public:
+    virtual ~FileHandlerFTPRange() override;
+
+    /**
+     * @brief Open file for reading on demand
+     * @param ftp logged in FTP client
+     * @param path file path on server
+     * @param filesize file size reported by server
+     * @return new file handler or nullptr if server can't restart transfers
+     * (caller should fallback to full download)
+     */
+    static FileHandlerFTPRange *open(std::shared_ptr<fnFTP> ftp, const std::string &path, long int filesize);
+
+    virtual int close(bool destroy=true) override;
+    virtual int seek(long int off, int whence) override;
+    virtual long int tell() override;
+    virtual size_t read(void *ptr, size_t size, size_t count) override;
+    virtual size_t write(const void *ptr, size_t size, size_t count) override;
+    virtual int flush() override;
+    virtual int eof() override;
+};
+
+#endif // FN_FILEFTPRANGE_H
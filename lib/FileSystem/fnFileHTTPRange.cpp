@@ -0,0 +1,446 @@
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fnFileHTTPRange.h"
+#include "../../include/debug.h"
+
+#include "fnSystem.h"
+#include "string_utils.h"
+
+// http timeout in ms
+#define HTTP_RANGE_TIMEOUT 20000
+// ms between checks while discarding the end of a response, usually it is already there
+#define HTTP_RANGE_DRAIN_POLL 5
+
+// response headers used by the file handler
+#define HTTP_RANGE_HEADERS {"Accept-Ranges", "Content-Length", "Content-Range"}
+
+
+// Discard rest of the response, the client must be idle before next request
+// If the server stops sending, the connection is closed and the next request opens a new one
+static void _drain_response(HTTP_CLIENT_CLASS *http)
+{
+    uint8_t scratch[64];
+    int tmout_counter = 1 + HTTP_RANGE_TIMEOUT / HTTP_RANGE_DRAIN_POLL;
+    while (!http->is_transaction_done())
+    {
+        int available = http->available();
+        if (available < 0)
+            break;
+        if (available == 0)
+        {
+            if (--tmout_counter == 0)
+            {
+                Debug_println("FileHandlerHTTPRange - Timeout discarding response, closing connection");
+                http->close();
+                http->create_empty_stored_headers(HTTP_RANGE_HEADERS);
+                return;
+            }
+            fnSystem.delay(HTTP_RANGE_DRAIN_POLL); // wait
+            continue;
+        }
+        http->read(scratch, available > (int)sizeof(scratch) ? sizeof(scratch) : available);
+        tmout_counter = 1 + HTTP_RANGE_TIMEOUT / HTTP_RANGE_DRAIN_POLL; // reset timeout counter
+    }
+}
+
+
+FileHandlerHTTPRange::FileHandlerHTTPRange(HTTP_CLIENT_CLASS *http, const std::string &url, long int filesize)
+    : _http(http), _url(url), _filesize(filesize), _position(0), _ranges(true), _streaming(false), _stream_pos(0),
+      _slots_used(0), _use_counter(0), _data(nullptr)
+{
+    Debug_println("new FileHandlerHTTPRange");
+}
+
+
+FileHandlerHTTPRange::~FileHandlerHTTPRange()
+{
+    Debug_println("delete FileHandlerHTTPRange");
+    if (_http != nullptr)
+        close(false);
+}
+
+
+FileHandlerHTTPRange *FileHandlerHTTPRange::open(const std::string &url)
+{
+    HTTP_CLIENT_CLASS *http = new HTTP_CLIENT_CLASS();
+    if (http == nullptr)
+    {
+        Debug_println("FileHandlerHTTPRange::open - failed to create HTTP client");
+        return nullptr;
+    }
+    if (!http->begin(url))
+    {
+        Debug_println("FileHandlerHTTPRange::open - failed to start HTTP client");
+        delete http;
+        return nullptr;
+    }
+
+    // Ask for file size and byte range support
+    http->create_empty_stored_headers(HTTP_RANGE_HEADERS);
+    int status = http->HEAD();
+    _drain_response(http);
+
+    std::string accept_ranges = http->get_header("Accept-Ranges");
+    std::string content_length = http->get_header("Content-Length");
+    mstr::toLower(accept_ranges);
+    long int filesize = content_length.empty() ? -1 : atol(content_length.c_str());
+
+    if (status != 200 || accept_ranges.find("bytes") == std::string::npos || filesize < 0)
+    {
+        Debug_printf("FileHandlerHTTPRange::open - no byte ranges (status %d, Accept-Ranges \"%s\", Content-Length \"%s\")\n",
+            status, accept_ranges.c_str(), content_length.c_str());
+        delete http;
+        return nullptr;
+    }
+
+    FileHandlerHTTPRange *fh = new FileHandlerHTTPRange(http, url, filesize);
+#ifdef ESP_PLATFORM
+    fh->_data = (uint8_t *)heap_caps_malloc(HTTP_RANGE_CACHE_BLOCKS * HTTP_RANGE_BLOCK_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#else
+    fh->_data = (uint8_t *)malloc(HTTP_RANGE_CACHE_BLOCKS * HTTP_RANGE_BLOCK_SIZE);
+#endif
+    if (fh->_data == nullptr)
+    {
+        Debug_println("FileHandlerHTTPRange::open - failed to allocate block cache");
+        delete fh;
+        return nullptr;
+    }
+
+    Debug_printf("FileHandlerHTTPRange::open - using byte ranges, file size %ld\n", filesize);
+    return fh;
+}
+
+
+int FileHandlerHTTPRange::close(bool destroy)
+{
+    Debug_println("FileHandlerHTTPRange::close");
+    if (_http != nullptr)
+    {
+        delete _http;
+        _http = nullptr;
+    }
+    free(_data);
+    _data = nullptr;
+    _block_map.clear();
+    _slots_used = 0;
+    if (destroy) delete this;
+    return 0;
+}
+
+
+int FileHandlerHTTPRange::seek(long int off, int whence)
+{
+    long int new_pos;
+    switch (whence)
+    {
+        case SEEK_SET:
+            new_pos = off;
+            break;
+        case SEEK_END:
+            new_pos = _filesize + off;
+            break;
+        case SEEK_CUR:
+            new_pos = _position + off;
+            break;
+        default:
+            Debug_printf("FileHandlerHTTPRange::seek - called with invalid whence value: %d\n", whence);
+            errno = EINVAL;
+            return -1;
+    }
+
+    if (new_pos < 0)
+    {
+        Debug_printf("FileHandlerHTTPRange::seek - invalid new position: %ld\n", new_pos);
+        errno = EINVAL;
+        return -1;
+    }
+
+    // nothing is fetched here, blocks are requested on read
+    _position = new_pos;
+    return 0;
+}
+
+
+long int FileHandlerHTTPRange::tell()
+{
+    return _position;
+}
+
+
+int FileHandlerHTTPRange::eof()
+{
+    return _position >= _filesize;
+}
+
+
+size_t FileHandlerHTTPRange::read(void *ptr, size_t size, size_t count)
+{
+    if (_http == nullptr || size == 0)
+        return 0;
+
+    size_t requested = size * count;
+    if (_position >= _filesize)
+        return 0;
+    if ((long int)requested > _filesize - _position)
+        requested = _filesize - _position;
+
+    uint8_t *dest = (uint8_t *)ptr;
+    size_t copied = 0;
+    while (copied < requested)
+    {
+        uint32_t block = _position / HTTP_RANGE_BLOCK_SIZE;
+        uint32_t offset = _position % HTTP_RANGE_BLOCK_SIZE;
+        int slot = _get_block(block);
+        if (slot < 0)
+        {
+            errno = EIO;
+            break;
+        }
+        if (_slots[slot].length <= offset)
+            break; // short block, server sent less than announced
+        size_t n = _slots[slot].length - offset;
+        if (n > requested - copied)
+            n = requested - copied;
+        memcpy(dest + copied, _data + slot * HTTP_RANGE_BLOCK_SIZE + offset, n);
+        copied += n;
+        _position += n;
+    }
+
+    return copied / size;
+}
+
+
+size_t FileHandlerHTTPRange::write(const void *ptr, size_t size, size_t count)
+{
+    Debug_println("FileHandlerHTTPRange::write - not supported");
+    errno = EROFS;
+    return 0;
+}
+
+
+int FileHandlerHTTPRange::flush()
+{
+    return 0;
+}
+
+
+// Return slot with requested block, fetch it (and following blocks) if not cached, -1 on error
+int FileHandlerHTTPRange::_get_block(uint32_t block)
+{
+    auto it = _block_map.find(block);
+    if (it == _block_map.end())
+    {
+        // read-ahead: request following blocks which are not cached yet
+        uint32_t last_block = (_filesize - 1) / HTTP_RANGE_BLOCK_SIZE;
+        uint32_t count = 1;
+        while (count < HTTP_RANGE_READAHEAD && block + count <= last_block
+               && _block_map.find(block + count) == _block_map.end())
+            count++;
+
+        if (!_fetch_blocks(block, count))
+            return -1;
+
+        it = _block_map.find(block);
+        if (it == _block_map.end())
+            return -1;
+    }
+    _slots[it->second].last_use = ++_use_counter;
+    return it->second;
+}
+
+
+// Return free slot for block, least recently used block is evicted if there is no free slot
+int FileHandlerHTTPRange::_alloc_slot(uint32_t block)
+{
+    int slot;
+    if (_slots_used < HTTP_RANGE_CACHE_BLOCKS)
+    {
+        slot = _slots_used++;
+    }
+    else
+    {
+        slot = 0;
+        for (int i = 1; i < HTTP_RANGE_CACHE_BLOCKS; i++)
+        {
+            if (_slots[i].last_use < _slots[slot].last_use)
+                slot = i;
+        }
+        auto it = _block_map.find(_slots[slot].block);
+        if (it != _block_map.end() && it->second == slot)
+            _block_map.erase(it);
+    }
+    _slots[slot].block = block;
+    _slots[slot].length = 0;
+    _slots[slot].last_use = ++_use_counter;
+    _block_map[block] = slot;
+    return slot;
+}
+
+
+// Fetch count consecutive blocks starting at first with single Range request
+bool FileHandlerHTTPRange::_fetch_blocks(uint32_t first, uint32_t count)
+{
+    if (!_ranges)
+        return _stream_blocks(first, count);
+
+    long int range_start = (long int)first * HTTP_RANGE_BLOCK_SIZE;
+    long int range_end = range_start + (long int)count * HTTP_RANGE_BLOCK_SIZE - 1;
+    if (range_end >= _filesize)
+        range_end = _filesize - 1;
+
+    char range[48];
+    snprintf(range, sizeof(range), "bytes=%ld-%ld", range_start, range_end);
+    Debug_printf("FileHandlerHTTPRange::_fetch_blocks - Range: %s\n", range);
+
+    _http->set_header("Range", range);
+    int status = _http->GET();
+    if (status == 200)
+    {
+        // Accept-Ranges was advertised but the whole file is coming, read it from the start
+        Debug_println("FileHandlerHTTPRange::_fetch_blocks - server ignored Range, reading file sequentially");
+        _ranges = false;
+        _streaming = true;
+        _stream_pos = 0;
+        return _stream_blocks(first, count);
+    }
+    if (status != 206)
+    {
+        // server ignored or rejected the range, don't download whole file here
+        Debug_printf("FileHandlerHTTPRange::_fetch_blocks - unexpected status %d\n", status);
+        _drain_response(_http);
+        return false;
+    }
+
+    // Content-Range: bytes <start>-<end>/<size>
+    std::string content_range = _http->get_header("Content-Range");
+    if (!content_range.empty())
+    {
+        size_t pos = content_range.find_first_of("0123456789");
+        if (pos == std::string::npos || atol(content_range.c_str() + pos) != range_start)
+        {
+            Debug_printf("FileHandlerHTTPRange::_fetch_blocks - unexpected Content-Range \"%s\"\n", content_range.c_str());
+            _drain_response(_http);
+            return false;
+        }
+    }
+
+    bool result = true;
+    for (uint32_t b = first; b < first + count; b++)
+    {
+        long int block_start = (long int)b * HTTP_RANGE_BLOCK_SIZE;
+        int len = (block_start + HTTP_RANGE_BLOCK_SIZE - 1 > range_end) ? range_end - block_start + 1 : HTTP_RANGE_BLOCK_SIZE;
+        int slot = _alloc_slot(b);
+        int got = _read_body(_data + slot * HTTP_RANGE_BLOCK_SIZE, len);
+        if (got < len)
+        {
+            Debug_printf("FileHandlerHTTPRange::_fetch_blocks - short read, expected %d bytes, got %d bytes\n", len, got);
+            // keep what was received only if the block is complete
+            _block_map.erase(b);
+            _slots[slot].last_use = 0;
+            result = (b != first);
+            break;
+        }
+        _slots[slot].length = got;
+    }
+
+    _drain_response(_http);
+    return result;
+}
+
+
+// Get count blocks starting at first out of a whole file response, server doesn't do ranges
+// Blocks passed on the way are cached too, a response behind first is started over
+bool FileHandlerHTTPRange::_stream_blocks(uint32_t first, uint32_t count)
+{
+    long int range_start = (long int)first * HTTP_RANGE_BLOCK_SIZE;
+    long int range_end = range_start + (long int)count * HTTP_RANGE_BLOCK_SIZE;
+    if (range_end > _filesize)
+        range_end = _filesize;
+
+    if (_streaming && _stream_pos > range_start)
+    {
+        // rest of the current response isn't wanted, drop the connection
+        _http->close();
+        _http->create_empty_stored_headers(HTTP_RANGE_HEADERS);
+        _streaming = false;
+    }
+    if (!_streaming)
+    {
+        Debug_println("FileHandlerHTTPRange::_stream_blocks - reading file from the start");
+        _http->set_header("Range", "bytes=0-");
+        int status = _http->GET();
+        if (status != 200 && status != 206)
+        {
+            Debug_printf("FileHandlerHTTPRange::_stream_blocks - unexpected status %d\n", status);
+            _drain_response(_http);
+            return false;
+        }
+        _streaming = true;
+        _stream_pos = 0;
+    }
+
+    while (_stream_pos < range_end)
+    {
+        uint32_t b = _stream_pos / HTTP_RANGE_BLOCK_SIZE;
+        int len = (_filesize - _stream_pos < HTTP_RANGE_BLOCK_SIZE) ? _filesize - _stream_pos : HTTP_RANGE_BLOCK_SIZE;
+        auto it = _block_map.find(b);
+        int slot = (it != _block_map.end()) ? it->second : _alloc_slot(b);
+        int got = _read_body(_data + slot * HTTP_RANGE_BLOCK_SIZE, len);
+        if (got < len)
+        {
+            Debug_printf("FileHandlerHTTPRange::_stream_blocks - short read, expected %d bytes, got %d bytes\n", len, got);
+            _block_map.erase(b);
+            _slots[slot].last_use = 0;
+            _http->close();
+            _http->create_empty_stored_headers(HTTP_RANGE_HEADERS);
+            _streaming = false;
+            return b > first;
+        }
+        _slots[slot].length = got;
+        _stream_pos += got;
+    }
+
+    if (_stream_pos >= _filesize)
+    {
+        _drain_response(_http);
+        _streaming = false;
+    }
+    return true;
+}
+
+
+// Read len bytes of response body, return number of bytes read
+int FileHandlerHTTPRange::_read_body(uint8_t *dest, int len)
+{
+    int tmout_counter = 1 + HTTP_RANGE_TIMEOUT / 50;
+    int total = 0;
+    while (total < len)
+    {
+        int available = _http->available();
+        if (available < 0)
+            break;
+        if (available == 0)
+        {
+            if (_http->is_transaction_done())
+                break;
+            if (--tmout_counter == 0)
+            {
+                Debug_println("FileHandlerHTTPRange::_read_body - Timeout");
+                break;
+            }
+            fnSystem.delay(50); // wait
+            continue;
+        }
+        int to_read = (available > len - total) ? len - total : available;
+        int from_read = _http->read(dest + total, to_read);
+        if (from_read <= 0)
+            break;
+        total += from_read;
+        tmout_counter = 1 + HTTP_RANGE_TIMEOUT / 50; // reset timeout counter
+    }
+    return total;
+}
@@ -0,0 +1,93 @@
+#ifndef FN_FILEHTTPRANGE_H
+#define FN_FILEHTTPRANGE_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <map>
+#include <string>
+
+#ifdef ESP_PLATFORM
+#include "fnHttpClient.h"
+#define HTTP_CLIENT_CLASS fnHttpClient
+#else
+#include "mgHttpClient.h"
+#define HTTP_CLIENT_CLASS mgHttpClient
+#endif
+
+#include "fnFile.h"
+
+// size of blocks fetched from server
+#define HTTP_RANGE_BLOCK_SIZE   4096
+// number of blocks requested at once when a block is missing
+#define HTTP_RANGE_READAHEAD    4
+// max number of blocks kept in memory
+#ifdef ESP_PLATFORM
+#define HTTP_RANGE_CACHE_BLOCKS 32
+#else
+#define HTTP_RANGE_CACHE_BLOCKS 256
+#endif
+
+/*
+ * FileHandlerHTTPRange - read-only remote file fetched on demand
+ * using HTTP Range requests, only blocks which are read are downloaded.
+ * One HTTP client is kept for the lifetime of the handler so the
+ * connection can be re-used between requests.
+ * If the server sends the whole file in reply to a Range request, the
+ * response is read sequentially and started over for reads behind it.
+ */
+class FileHandlerHTTPRange : public FileHandler
+{
+protected:
+    struct BlockSlot
+    {
+        uint32_t block;     // block number in file
+        uint32_t length;    // valid bytes, less than block size for last block
+        uint32_t last_use;  // for LRU replacement
+    };
+
+    HTTP_CLIENT_CLASS *_http;
+    std::string _url;
+    long int _filesize;
+    long int _position;
+
+    // server answered a Range request with the whole file, it is read front to back instead
+    bool _ranges;
+    bool _streaming;        // a whole file response is being read
+    long int _stream_pos;   // file offset of its next byte
+
+    // sparse map of cached blocks: block number -> slot
+    std::map<uint32_t, int> _block_map;
+    BlockSlot _slots[HTTP_RANGE_CACHE_BLOCKS];
+    int _slots_used;
+    uint32_t _use_counter;
+    uint8_t *_data;
+
+    FileHandlerHTTPRange(HTTP_CLIENT_CLASS *http, const std::string &url, long int filesize);
+
+    int _get_block(uint32_t block);
+    int _alloc_slot(uint32_t block);
+    bool _fetch_blocks(uint32_t first, uint32_t count);
+    bool _stream_blocks(uint32_t first, uint32_t count);
+    int _read_body(uint8_t *dest, int len);
+
+public:
+    virtual ~FileHandlerHTTPRange() override;
+
+    /**
+     * @brief Check if server supports byte ranges for given URL
+     * @param url file URL
+     * @return new file handler or nullptr if server doesn't advertise
+     * Accept-Ranges or file size is unknown (caller should fallback to full download)
+     */
+    static FileHandlerHTTPRange *open(const std::string &url);
+
+    virtual int close(bool destroy=true) override;
+    virtual int seek(long int off, int whence) override;
+    virtual long int tell() override;
+    virtual size_t read(void *ptr, size_t size, size_t count) override;
+    virtual size_t write(const void *ptr, size_t size, size_t count) override;
+    virtual int flush() override;
+    virtual int eof() override;
+};
+
+#endif // FN_FILEHTTPRANGE_H
@@ -1,18 +1,42 @@
 
 #include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#else
+#include <sys/poll.h>
+#include <sys/select.h>
+#endif
 
 #include "fnFileSMB.h"
+#include "fnSystem.h"
 #include "../../include/debug.h"
 
 
+// Whole blocks are requested, keep them within what the server accepts
 FileHandlerSMB::FileHandlerSMB(struct smb2_context *smb, struct smb2fh *handle)
+    : FileHandlerSMB(std::min<uint32_t>(smb2_get_max_read_size(smb), SMB_READAHEAD_BLOCK_MAX),
+                     std::min<uint32_t>(smb2_get_max_write_size(smb), SMB_WRITE_BUFFER_MAX))
 {
-    Debug_println("new FileHandlerSMB");
     _smb = smb;
     _handle = handle;
 };
 
 
+FileHandlerSMB::FileHandlerSMB(uint32_t block_size, uint32_t write_size)
+{
+    Debug_println("new FileHandlerSMB");
+    _smb = nullptr;
+    _handle = nullptr;
+    _block_size = block_size > 0 ? block_size : 4096;
+    _wbuf_size = write_size;
+}
+
+
 FileHandlerSMB::~FileHandlerSMB()
 {
     Debug_println("delete FileHandlerSMB");
@@ -24,12 +48,19 @@ int FileHandlerSMB::close(bool destroy)
 {
     Debug_println("FileHandlerSMB::close");
     int result = 0;
-    if (_handle != nullptr) 
+    if (_handle != nullptr)
     {
-        result = smb2_close(_smb, _handle);
+        result = _flush_writes();
+        // Reads still on the way free their blocks when they arrive
+        _window_clear();
+        int rc = smb2_close(_smb, _handle);
+        if (result == 0)
+            result = rc;
         _handle = nullptr;
         _smb = nullptr;
     }
+    free(_wbuf);
+    _wbuf = nullptr;
     if (destroy) delete this;
     return result;
 }
@@ -38,13 +69,43 @@ int FileHandlerSMB::close(bool destroy)
 int FileHandlerSMB::seek(long int off, int whence)
 {
     Debug_println("FileHandlerSMB::seek");
+    // Position is kept here, read-ahead moves the libsmb2 file offset
     uint64_t new_pos;
-    if (smb2_lseek(_smb, _handle, off, whence, &new_pos) < 0)
+    switch (whence)
     {
-        Debug_printf("%s\n", smb2_get_error(_smb));
+    case SEEK_SET:
+        new_pos = off;
+        break;
+    case SEEK_CUR:
+        new_pos = _position + off;
+        break;
+    case SEEK_END:
+        // File size on the server must include writes past its end
+        if (_flush_writes() < 0)
+            return -1;
+        if (smb2_lseek(_smb, _handle, off, SEEK_END, &new_pos) < 0)
+        {
+            Debug_printf("%s\n", smb2_get_error(_smb));
+            return -1;
+        }
+        break;
+    default:
+        errno = EINVAL;
         return -1;
     }
-    Debug_printf("new pos is %llu\n", new_pos);
+    if ((int64_t)new_pos < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (new_pos != _position)
+    {
+        // Read-ahead starts over with one block
+        _window_size = 1;
+        _window_next = UINT64_MAX;
+    }
+    _position = new_pos;
+    Debug_printf("new pos is %llu\n", (unsigned long long)new_pos);
     return 0;
 }
 
@@ -52,13 +113,7 @@ int FileHandlerSMB::seek(long int off, int whence)
 long int FileHandlerSMB::tell()
 {
     Debug_println("FileHandlerSMB::tell");
-    uint64_t pos;
-    if (smb2_lseek(_smb, _handle, 0, SEEK_CUR, &pos) < 0)
-    {
-        Debug_printf("%s\n", smb2_get_error(_smb));
-        return -1;
-    }
-    return (long)pos;
+    return (long)_position;
 }
 
 
@@ -66,47 +121,342 @@ size_t FileHandlerSMB::read(void *ptr, size_t size, size_t count)
 {
     Debug_println("FileHandlerSMB::read");
 
+    if (_handle == nullptr || size == 0)
+        return 0;
+
+    uint8_t *dest = (uint8_t *)ptr;
     size_t bytes_remaining = size * count;
     size_t bytes_read = 0;
-    int result;
     while (bytes_remaining > 0)
     {
-        result = smb2_read(_smb, _handle, (uint8_t *)ptr, (uint32_t)bytes_remaining);
-        if (result < 0)
+        ReadBlock *b = _window_get(_position);
+        if (b == nullptr)
         {
-            if (errno == EAGAIN)
-                continue;
-            else
+            errno = EIO;
+            break;
+        }
+
+        size_t n;
+        uint32_t offset = (uint32_t)(_position - b->offset);
+        if (offset < b->length)
+        {
+            n = std::min<size_t>(b->length - offset, bytes_remaining);
+            memcpy(dest + bytes_read, b->data + offset, n);
+        }
+        else
+        {
+            // Short block, end of file unless the server sent less than asked for
+            int result = smb2_pread(_smb, _handle, dest + bytes_read,
+                                    (uint32_t)std::min<size_t>(_block_size - offset, bytes_remaining), _position);
+            if (result < 0)
             {
                 Debug_printf("%s\n", smb2_get_error(_smb));
                 break;
             }
+            if (result == 0)
+                break; // EOF
+            n = result;
         }
-        else if (result == 0)
+        bytes_read += n;
+        bytes_remaining -= n;
+        _position += n;
+    }
+
+    return bytes_read / size;
+}
+
+
+size_t FileHandlerSMB::write(const void *ptr, size_t size, size_t count)
+{
+    Debug_println("FileHandlerSMB::write");
+
+    if (_handle == nullptr || size == 0)
+        return 0;
+
+    const uint8_t *src = (const uint8_t *)ptr;
+    size_t len = size * count;
+
+    // Blocks read ahead must see the new data
+    _window_patch(_position, src, len);
+
+    // Send what's collected unless this write carries on from it
+    if (_wbuf_len > 0 && (_position != _wbuf_offset + _wbuf_len || _wbuf_len + len > _wbuf_size))
+    {
+        if (_flush_writes() < 0)
+            return 0;
+    }
+
+    if (_wbuf == nullptr && len < _wbuf_size)
+        _wbuf = (uint8_t *)malloc(_wbuf_size);
+
+    size_t bytes_written;
+    if (_wbuf == nullptr || len >= _wbuf_size)
+    {
+        int result = _write_through(src, len, _position);
+        bytes_written = result < 0 ? 0 : result;
+    }
+    else
+    {
+        if (_wbuf_len == 0)
+            _wbuf_offset = _position;
+        memcpy(_wbuf + _wbuf_len, src, len);
+        _wbuf_len += len;
+        bytes_written = len;
+    }
+    _position += bytes_written;
+
+    return bytes_written / size;
+}
+
+
+int FileHandlerSMB::flush()
+{
+    Debug_println("FileHandlerSMB::flush");
+    int result;
+    if (_flush_writes() < 0)
+        return -1;
+    if ((result = smb2_fsync(_smb, _handle)) != 0)
+    {
+        Debug_printf("%s\n", smb2_get_error(_smb));
+        return -1;
+    }
+    return 0;
+}
+
+
+void FileHandlerSMB::_read_cb(struct smb2_context *smb2, int status, void *command_data, void *private_data)
+{
+    ReadBlock *b = (ReadBlock *)private_data;
+    if (b->owner == nullptr)
+    {
+        // nobody is waiting for this one any more
+        free(b);
+        return;
+    }
+    b->length = status > 0 ? status : 0;
+    b->state = status < 0 ? BLOCK_FAILED : BLOCK_READY;
+}
+
+
+FileHandlerSMB::ReadBlock *FileHandlerSMB::_block_alloc()
+{
+#ifdef ESP_PLATFORM
+    ReadBlock *b = (ReadBlock *)heap_caps_malloc(sizeof(ReadBlock) + _block_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#else
+    ReadBlock *b = (ReadBlock *)malloc(sizeof(ReadBlock) + _block_size);
+#endif
+    if (b != nullptr)
+    {
+        b->owner = this;
+        b->offset = 0;
+        b->length = 0;
+        b->state = BLOCK_EMPTY;
+        b->data = (uint8_t *)(b + 1);
+    }
+    return b;
+}
+
+
+// Drop block i, if its read is outstanding the callback frees it
+void FileHandlerSMB::_block_release(int i)
+{
+    ReadBlock *b = _blocks[i];
+    if (b == nullptr)
+        return;
+    if (b->state == BLOCK_PENDING)
+        b->owner = nullptr;
+    else
+        free(b);
+    _blocks[i] = nullptr;
+}
+
+
+// Ask for the block at offset into slot i without waiting for it
+bool FileHandlerSMB::_block_request(int i, uint64_t offset)
+{
+    if (_blocks[i] != nullptr && _blocks[i]->state == BLOCK_PENDING)
+        _block_release(i);
+    if (_blocks[i] == nullptr && (_blocks[i] = _block_alloc()) == nullptr)
+        return false;
+
+    ReadBlock *b = _blocks[i];
+    b->offset = offset;
+    b->length = 0;
+    b->state = BLOCK_PENDING;
+    if (_pread_async(b) < 0)
+    {
+        Debug_printf("%s\n", smb2_get_error(_smb));
+        b->state = BLOCK_FAILED;
+        return false;
+    }
+    return true;
+}
+
+
+// Ask for block b, _read_cb() is called when it arrives
+int FileHandlerSMB::_pread_async(ReadBlock *b)
+{
+    return smb2_pread_async(_smb, _handle, b->data, _block_size, b->offset, _read_cb, b);
+}
+
+
+// Wait up to timeout_ms for the connection and service it, 1 if it was, 0 if idle, -1 on error
+int FileHandlerSMB::_service(int timeout_ms)
+{
+    t_socket fd = smb2_get_fd(_smb);
+    int events = smb2_which_events(_smb);
+    fd_set readfds, writefds;
+    FD_ZERO(&readfds);
+    FD_ZERO(&writefds);
+    if (events & POLLIN)
+        FD_SET(fd, &readfds);
+    if (events & POLLOUT)
+        FD_SET(fd, &writefds);
+    struct timeval timeout_tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+
+    if (select((int)fd + 1, &readfds, &writefds, nullptr, &timeout_tv) < 0)
+    {
+        Debug_printf("FileHandlerSMB: select failed, errno %d\n", errno);
+        return -1;
+    }
+    int revents = (FD_ISSET(fd, &readfds) ? POLLIN : 0) | (FD_ISSET(fd, &writefds) ? POLLOUT : 0);
+    if (revents == 0)
+        return 0;
+    if (smb2_service(_smb, revents) < 0)
+    {
+        Debug_printf("%s\n", smb2_get_error(_smb));
+        return -1;
+    }
+    return 1;
+}
+
+
+// Service the connection until block b has arrived, false if it can't be read
+bool FileHandlerSMB::_block_wait(ReadBlock *b)
+{
+    uint64_t ms_update = fnSystem.millis();
+    while (b->state == BLOCK_PENDING)
+    {
+        int result = _service(100);
+        if (result < 0)
+            return false;
+        if (result > 0)
+            ms_update = fnSystem.millis();
+        else if (fnSystem.millis() - ms_update > SMB_READ_TIMEOUT)
         {
-            break; // EOF
+            Debug_println("FileHandlerSMB: timed out waiting for read");
+            return false;
         }
-        else
+    }
+    return b->state == BLOCK_READY;
+}
+
+
+// Return the block holding pos, starting a new window there if pos isn't in the current one.
+// The window doubles when reading moves on to the next block, a miss elsewhere fetches one block.
+FileHandlerSMB::ReadBlock *FileHandlerSMB::_window_get(uint64_t pos)
+{
+    uint64_t base = pos - pos % _block_size;
+
+    int found = -1;
+    uint64_t next = base;
+    bool at_eof = false;
+    for (int i = 0; i < SMB_READAHEAD_BLOCKS; i++)
+    {
+        ReadBlock *b = _blocks[i];
+        if (b == nullptr || b->state == BLOCK_EMPTY || b->state == BLOCK_FAILED)
+            continue;
+        if (b->offset == base)
+            found = i;
+        next = std::max(next, b->offset + _block_size);
+        if (b->state == BLOCK_READY && b->length < _block_size)
+            at_eof = true;
+    }
+
+    if (base == _window_next)
+        _window_size = std::min(_window_size * 2, SMB_READAHEAD_BLOCKS);
+    else if (found < 0)
+        _window_size = 1;
+    _window_next = base + _block_size;
+    uint64_t end = base + (uint64_t)_window_size * _block_size;
+
+    // Reads are sent after the writes so they see them
+    if (_flush_writes() < 0)
+        return nullptr;
+
+    if (found < 0)
+    {
+        // Not read ahead, start over from here
+        for (int i = 0; i < SMB_READAHEAD_BLOCKS; i++)
         {
-            bytes_read += result;
-            bytes_remaining -= result;
+            if (i >= _window_size)
+                _block_release(i);
+            else if (!_block_request(i, base + (uint64_t)i * _block_size) && i == 0)
+                return nullptr;
+        }
+        found = 0;
+    }
+    else if (!at_eof)
+    {
+        // Slide the window, blocks behind pos are requested again past its end
+        for (int i = 0; i < SMB_READAHEAD_BLOCKS && next < end; i++)
+        {
+            ReadBlock *b = _blocks[i];
+            if (b == nullptr || b->state == BLOCK_EMPTY || b->state == BLOCK_FAILED || b->offset < base)
+            {
+                _block_request(i, next);
+                next += _block_size;
+            }
         }
     }
 
-    return (size_t)(size * count == bytes_read ? count : bytes_read / size);
+    ReadBlock *b = _blocks[found];
+    if (!_block_wait(b))
+    {
+        _block_release(found);
+        return nullptr;
+    }
+    return b;
 }
 
 
-size_t FileHandlerSMB::write(const void *ptr, size_t size, size_t count)
+// Copy data being written at offset into blocks already read, drop blocks it would make stale
+void FileHandlerSMB::_window_patch(uint64_t offset, const uint8_t *data, size_t len)
 {
-    Debug_println("FileHandlerSMB::write");
+    for (int i = 0; i < SMB_READAHEAD_BLOCKS; i++)
+    {
+        ReadBlock *b = _blocks[i];
+        if (b == nullptr || b->state == BLOCK_EMPTY || b->state == BLOCK_FAILED)
+            continue;
 
-    size_t bytes_remaining = size * count;
+        uint64_t start = std::max(offset, b->offset);
+        uint64_t end = std::min<uint64_t>(offset + len, b->offset + _block_size);
+        if (start >= end)
+            continue;
+
+        if (b->state == BLOCK_PENDING || end > b->offset + b->length)
+            _block_release(i);
+        else
+            memcpy(b->data + (start - b->offset), data + (start - offset), end - start);
+    }
+}
+
+
+void FileHandlerSMB::_window_clear()
+{
+    for (int i = 0; i < SMB_READAHEAD_BLOCKS; i++)
+        _block_release(i);
+}
+
+
+// Write len bytes at offset right away, returns bytes written or -1
+int FileHandlerSMB::_write_through(const uint8_t *data, size_t len, uint64_t offset)
+{
     size_t bytes_written = 0;
     int result;
-    while (bytes_remaining > 0)
+    while (bytes_written < len)
     {
-        result = smb2_write(_smb, _handle, (uint8_t *)ptr, (uint32_t)bytes_remaining);
+        result = smb2_pwrite(_smb, _handle, (uint8_t *)data + bytes_written, (uint32_t)(len - bytes_written), offset + bytes_written);
         if (result < 0)
         {
             if (errno == EAGAIN)
@@ -114,28 +464,23 @@ size_t FileHandlerSMB::write(const void *ptr, size_t size, size_t count)
             else
             {
                 Debug_printf("%s\n", smb2_get_error(_smb));
-                break;
+                return bytes_written > 0 ? (int)bytes_written : -1;
             }
         }
-        else
-        {
-            bytes_written += result;
-            bytes_remaining -= result;
-        }
+        bytes_written += result;
     }
-
-    return (size_t)(size * count == bytes_written ? count : bytes_written / size);
+    return (int)bytes_written;
 }
 
 
-int FileHandlerSMB::flush()
+// Send the collected writes, -1 if they didn't all make it
+int FileHandlerSMB::_flush_writes()
 {
-    Debug_println("FileHandlerSMB::flush");
-    int result;
-    if ((result = smb2_fsync(_smb, _handle)) != 0)
-    {
-        Debug_printf("%s\n", smb2_get_error(_smb));
-        return -1;
-    }
-    return 0;
+    if (_wbuf_len == 0)
+        return 0;
+
+    int result = _write_through(_wbuf, _wbuf_len, _wbuf_offset);
+    bool ok = result == (int)_wbuf_len;
+    _wbuf_len = 0;
+    return ok ? 0 : -1;
 }
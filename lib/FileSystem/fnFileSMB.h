@@ -7,12 +7,82 @@
 
 #include "fnFile.h"
 
+// largest read-ahead block, the server's max read size is used if smaller
+// most blocks in the read-ahead window, it grows to this while reads are sequential
+// largest run of consecutive writes sent as one request
+#ifdef ESP_PLATFORM
+#define SMB_READAHEAD_BLOCK_MAX 8192
+#define SMB_READAHEAD_BLOCKS    4
+#define SMB_WRITE_BUFFER_MAX    4096
+#else
+#define SMB_READAHEAD_BLOCK_MAX 65536
+#define SMB_READAHEAD_BLOCKS    4
+#define SMB_WRITE_BUFFER_MAX    65536
+#endif
+// ms without an answer before an outstanding read is given up
+#define SMB_READ_TIMEOUT        20000
 
+/*
+ * FileHandlerSMB - file on an SMB share
+ * Reads are served from a window of consecutive blocks which are requested
+ * ahead of the read position, so sector sized reads don't each wait for a
+ * round trip. The window starts with one block and doubles each time reading
+ * carries on into the next block, a seek or a read elsewhere starts it over.
+ * Consecutive writes are collected and sent as one request before the next
+ * read, flush() or close().
+ */
 class FileHandlerSMB : public FileHandler
 {
 protected:
+    enum block_state
+    {
+        BLOCK_EMPTY,
+        BLOCK_PENDING,
+        BLOCK_READY,
+        BLOCK_FAILED
+    };
+
+    // Read-ahead block, data follows the struct in the same allocation.
+    // A block still pending when the handler lets go of it is freed by the read callback.
+    struct ReadBlock
+    {
+        FileHandlerSMB *owner;
+        uint64_t offset;
+        uint32_t length;    // valid bytes, less than block size at the end of file
+        block_state state;
+        uint8_t *data;
+    };
+
     struct smb2_context *_smb;
     struct smb2fh *_handle;
+    uint64_t _position = 0;
+
+    ReadBlock *_blocks[SMB_READAHEAD_BLOCKS] = {};
+    uint32_t _block_size = 0;
+    int _window_size = 1;               // blocks requested from the read position on
+    uint64_t _window_next = UINT64_MAX; // block a sequential read moves on to
+
+    uint8_t *_wbuf = nullptr;
+    uint32_t _wbuf_size = 0;
+    uint32_t _wbuf_len = 0;
+    uint64_t _wbuf_offset = 0;
+
+    // Without a connection, for a stand-in share replacing the two calls below
+    FileHandlerSMB(uint32_t block_size, uint32_t write_size);
+    virtual int _pread_async(ReadBlock *b);
+    virtual int _service(int timeout_ms);
+
+    static void _read_cb(struct smb2_context *smb2, int status, void *command_data, void *private_data);
+    ReadBlock *_block_alloc();
+    void _block_release(int i);
+    bool _block_request(int i, uint64_t offset);
+    bool _block_wait(ReadBlock *b);
+    ReadBlock *_window_get(uint64_t pos);
+    void _window_patch(uint64_t offset, const uint8_t *data, size_t len);
+    void _window_clear();
+    int _write_through(const uint8_t *data, size_t len, uint64_t offset);
+    int _flush_writes();
+
 public:
     FileHandlerSMB(struct smb2_context *smb, struct smb2fh *handle);
     virtual ~FileHandlerSMB() override;
@@ -7,13 +7,15 @@
 
 #include "fnSystem.h"
 #include "fnFileCache.h"
+#include "fnFileFTPRange.h"
 
 #define COPY_BLK_SIZE 4096
+// times an interrupted download is resumed where it stopped
+#define FTP_RESUME_RETRIES 3
 
 FileSystemFTP::FileSystemFTP()
 {
     Debug_printf("FileSystemFTP::ctor\n");
-    _ftp = nullptr;
     _url = nullptr;
     // invalidate _last_dir
     _last_dir[0] = '\0';
@@ -25,10 +27,10 @@ FileSystemFTP::~FileSystemFTP()
     if (_started)
     {
         _dircache.clear();
-        _ftp->logout();
+        // files fetched on demand may still use the connection
+        if (_ftp.use_count() == 1)
+            _ftp->logout();
     }
-    if (_ftp != nullptr)
-        delete _ftp;
 }
 
 bool FileSystemFTP::start(const char *url, const char *user, const char *password)
@@ -41,15 +43,7 @@ bool FileSystemFTP::start(const char *url, const char *user, const char *passwor
     if(url == nullptr || url[0] == '\0')
         return false;
 
-    if (_ftp != nullptr)
-        delete _ftp;
-
-    _ftp = new fnFTP();
-    if (_ftp == nullptr)
-    {
-        Debug_printf("FileSystemFTP::start() - failed to create FTP client\n");
-        return false;
-    }
+    _ftp = std::make_shared<fnFTP>();
 
     _url = PeoplesUrlParser::parseURL(url);
     if (!_url->isValidUrl())
@@ -103,101 +97,154 @@ FILE  *FileSystemFTP::file_open(const char *path, const char *mode)
 #ifndef FNIO_IS_STDIO
 FileHandler *FileSystemFTP::filehandler_open(const char *path, const char *mode)
 {
-    FileHandler *fh = cache_file(path, mode);
+    // Server may have dropped the control connection since last use
+    if (_ftp->keep_alive())
+    {
+        Debug_println("FileSystemFTP::filehandler_open - not logged in");
+        return nullptr;
+    }
+
+    // Size and modification time tell if SD cache file is still current
+    long filesize = -1;
+    string mtime;
+    if (_ftp->get_size(path, filesize))
+        filesize = -1;
+    string version;
+    if (!_ftp->get_mtime(path, mtime))
+        version = mtime + ' ' + std::to_string(filesize);
+
+    // Prefer cache file from previous full download, if any
+    FileHandler *fh = FileCache::open(_url->mRawUrl.c_str(), path, mode, version.empty() ? nullptr : version.c_str());
+    if (fh != nullptr)
+        return fh;
+
+    // Large read-only files are fetched on demand if the server can restart transfers,
+    // otherwise whole file is downloaded into cache file
+    if (FTP_RANGE_MIN_SIZE > 0 && filesize >= FTP_RANGE_MIN_SIZE && mode[0] == 'r' && strchr(mode, '+') == nullptr)
+    {
+        fh = FileHandlerFTPRange::open(_ftp, path, filesize);
+        if (fh != nullptr)
+            return fh;
+    }
+
+    fh = cache_file(path, mode, filesize, version.empty() ? nullptr : version.c_str());
     return fh;
 }
 
 // Read file from FTP path and write it to cache file
+// Interrupted transfer is resumed with REST where it stopped
 // Return FileHandler* on success (memory or SD file), nullptr on error
-FileHandler *FileSystemFTP::cache_file(const char *path, const char *mode)
+FileHandler *FileSystemFTP::cache_file(const char *path, const char *mode, long filesize, const char *version)
 {
     // Try SD cache first
-    FileHandler *fh = FileCache::open(_url->mRawUrl.c_str(), path, mode);
+    FileHandler *fh = FileCache::open(_url->mRawUrl.c_str(), path, mode, version);
     if (fh != nullptr)
         return fh; // cache hit, done
 
     // Create new cache file (starts in memory)
-    fc_handle *fc = FileCache::create(_url->mRawUrl.c_str(), path);
+    fc_handle *fc = FileCache::create(_url->mRawUrl.c_str(), path, -1, -1, version);
     if (fc == nullptr)
         return nullptr;
 
-    // Open FTP file
-    Debug_println("Initiating file RETR");
-    if (_ftp->open_file(path, false))
-    {
-        Debug_println("FileSystemFTP::cache_file - RETR failed");
-        return nullptr;
-    }
-
-    // Retrieve FTP data
-    int tmout_counter = 1 + FTP_TIMEOUT / 50;
-    bool cancel = false;
-    int available;
-
     // Allocate copy buffer
     // uint8_t *buf = (uint8_t *)heap_caps_malloc(COPY_BLK_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     uint8_t *buf = (uint8_t *)malloc(COPY_BLK_SIZE);
     if (buf == nullptr)
     {
         Debug_println("FileSystemFTP::cache_file - failed to allocate buffer");
+        FileCache::remove(fc);
         return nullptr;
     }
 
-    Debug_println("Retrieving file data");
+    bool cancel = false;
+    int resumes = FTP_RESUME_RETRIES;
     while ( !cancel )
     {
-        available = _ftp->data_available();
-        if (!_ftp->data_connected()) // done
+        // Open FTP file
+        if (fc->size == 0)
+            Debug_println("Initiating file RETR");
+        else
+            Debug_printf("Resuming file RETR at %d\n", fc->size);
+        if (_ftp->keep_alive() || _ftp->open_file(path, false, fc->size))
+        {
+            Debug_println("FileSystemFTP::cache_file - RETR failed");
+            cancel = true;
             break;
+        }
 
-        if (available == 0)
+        // Retrieve FTP data
+        int tmout_counter = 1 + FTP_TIMEOUT / 50;
+        bool interrupted = false;
+        int available;
+
+        Debug_println("Retrieving file data");
+        while ( !cancel && !interrupted )
         {
-            if (--tmout_counter == 0)
-            {
-                // no data & no control message
-                Debug_println("FileSystemFTP::cache_file - Timeout");
-                cancel = true;
+            available = _ftp->data_available();
+            if (!_ftp->data_connected()) // done
                 break;
-            }
-            fnSystem.delay(50); // wait for more data or control message
-        }
-        else if (available > 0)
-        {
-            Debug_printf("data available: %d\n", available);
-            while (available > 0)
+
+            if (available == 0)
             {
-                // Read FTP data
-                int to_read = available > sizeof(buf) ? sizeof(buf) : available;
-                if (_ftp->read_file(buf, to_read))
+                if (--tmout_counter == 0)
                 {
-                    Debug_println("FileSystemFTP::cache_file - FTP read failed");
-                    cancel = true;
+                    // no data & no control message
+                    Debug_println("FileSystemFTP::cache_file - Timeout");
+                    interrupted = true;
                     break;
                 }
-                // Write cache file
-                if (FileCache::write(fc, buf, to_read) < to_read)
+                fnSystem.delay(50); // wait for more data or control message
+            }
+            else if (available > 0)
+            {
+                Debug_printf("data available: %d\n", available);
+                while (available > 0)
                 {
-                    Debug_printf("FileSystemFTP::cache_file - Cache write failed\n");
-                    cancel = true;
-                    break;
+                    // Read FTP data
+                    int to_read = available > COPY_BLK_SIZE ? COPY_BLK_SIZE : available;
+                    if (_ftp->read_file(buf, to_read))
+                    {
+                        Debug_println("FileSystemFTP::cache_file - FTP read failed");
+                        interrupted = true;
+                        break;
+                    }
+                    // Write cache file
+                    if (FileCache::write(fc, buf, to_read) < to_read)
+                    {
+                        Debug_printf("FileSystemFTP::cache_file - Cache write failed\n");
+                        cancel = true;
+                        break;
+                    }
+                    // Next chunk
+                    available = _ftp->data_available();
                 }
-                // Next chunk
-                available = _ftp->data_available();
+                tmout_counter = 1 + FTP_TIMEOUT / 50; // reset timeout counter
+            }
+            else if (available < 0)
+            {
+                Debug_println("FileSystemFTP::cache_file - something went wrong");
+                cancel = true;
             }
-            tmout_counter = 1 + FTP_TIMEOUT / 50; // reset timeout counter
         }
-        else if (available < 0)
+
+        // Close FTP client
+        _ftp->close();
+
+        // Complete when all announced bytes are here, or server said so if size is unknown
+        if (filesize >= 0 ? fc->size >= filesize : (!interrupted && _ftp->status() / 100 == 2))
+            break;
+        if (!cancel && resumes-- == 0)
         {
-            Debug_println("FileSystemFTP::cache_file - something went wrong");
+            Debug_println("FileSystemFTP::cache_file - too many interruptions");
             cancel = true;
         }
+        // Stop what's left of the transfer, control connection is ready for next command
+        if (_ftp->abort_file())
+            _ftp->reconnect();
     }
     // Release copy buffer
     free(buf);
 
-    // Close FTP client
-    _ftp->close();
-
     if (cancel)
     {
         Debug_println("Cancelled");
@@ -243,7 +290,7 @@ bool FileSystemFTP::dir_open(const char  *path, const char *pattern, uint16_t di
 
         // List FTP directory
         bool res;
-        res = _ftp->open_directory(path, "");
+        res = _ftp->keep_alive() || _ftp->open_directory(path, "");
 
         if (res)
         {
@@ -258,7 +305,6 @@ bool FileSystemFTP::dir_open(const char  *path, const char *pattern, uint16_t di
         string filename;
         long filesz;
         bool is_dir;
-        fsdir_entry *fs_de;
 
         // get first directory entry
         res = _ftp->read_directory(filename, filesz, is_dir);
@@ -269,13 +315,7 @@ bool FileSystemFTP::dir_open(const char  *path, const char *pattern, uint16_t di
                 continue;
 
             // new dir entry
-            fs_de = &_dircache.new_entry();
-
-            // set entry members
-            strlcpy(fs_de->filename, filename.c_str(), sizeof(fs_de->filename));
-            fs_de->isDir = is_dir;
-            fs_de->size = (uint32_t)filesz;
-            fs_de->modified_time = 0; // TODO
+            _dircache.add_entry(filename.c_str(), is_dir, (uint32_t)filesz, 0); // TODO modified time
 
             // get next
             res = _ftp->read_directory(filename, filesz, is_dir);
@@ -17,8 +17,8 @@ private:
     // parsed FTP URL
     std::unique_ptr<PeoplesUrlParser> _url;
 
-    // FTP client
-    fnFTP *_ftp;
+    // FTP client, shared with files fetched on demand
+    std::shared_ptr<fnFTP> _ftp;
 
     // directory cache
     char _last_dir[MAX_PATHLEN];
@@ -56,7 +56,7 @@ public:
     bool dir_seek(uint16_t pos) override;
 
 #ifndef FNIO_IS_STDIO
-    FileHandler *cache_file(const char *path, const char *mode);
+    FileHandler *cache_file(const char *path, const char *mode, long filesize=-1, const char *version=nullptr);
 #endif
 
 };
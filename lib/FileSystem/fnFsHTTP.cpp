@@ -12,6 +12,7 @@
 
 #include "fnSystem.h"
 #include "fnFileCache.h"
+#include "fnFileHTTPRange.h"
 #include "string_utils.h"
 
 // http timeout in ms
@@ -105,18 +106,40 @@ FILE  *FileSystemHTTP::file_open(const char *path, const char *mode)
 #ifndef FNIO_IS_STDIO
 FileHandler *FileSystemHTTP::filehandler_open(const char *path, const char *mode)
 {
-    FileHandler *fh = cache_file(path, mode);
+    // Prefer cache file from previous full download, if any
+    FileHandler *fh = FileCache::open(_url->mRawUrl.c_str(), path, mode);
+    if (fh != nullptr)
+        return fh;
+
+    // Read-only files are fetched on demand if the server supports byte ranges,
+    // otherwise whole file is downloaded into cache file
+    if (mode[0] == 'r' && strchr(mode, '+') == nullptr)
+    {
+        fh = FileHandlerHTTPRange::open(file_url(path));
+        if (fh != nullptr)
+            return fh;
+    }
+
+    fh = cache_file(path, mode);
     return fh;
 }
 
-// Read file from HTTP path and write it to cache file
+// url + '/' + path
+std::string FileSystemHTTP::file_url(const char *path)
+{
+    std::string url_str = _url->url;
+    std::string path_str = mstr::urlEncode(path);
+    if (url_str.back() != '/') url_str.push_back('/');
+    if (path_str.front() == '/') path_str.erase(0, 1);
+    url_str += path_str;
+    return url_str;
+}
+
+// Read file from HTTP path and write it to cache file, the caller has checked the SD cache
 // Return FileHandler* on success (memory or SD file), nullptr on error
 FileHandler *FileSystemHTTP::cache_file(const char *path, const char *mode)
 {
-    // Try SD cache first
-    FileHandler *fh = FileCache::open(_url->mRawUrl.c_str(), path, mode);
-    if (fh != nullptr)
-        return fh; // cache hit, done
+    FileHandler *fh = nullptr;
 
     HEAP_DEBUG();
 
@@ -132,17 +155,13 @@ FileHandler *FileSystemHTTP::cache_file(const char *path, const char *mode)
     if (_http == nullptr)
     {
         Debug_println("FileSystemHTTP::cache_file() - failed to create HTTP client\n");
+        FileCache::remove(fc);
         return nullptr;
     }
-    // url + '/' + path
-    std::string url_str = _url->url;
-    std::string path_str = mstr::urlEncode(path);
-    if (url_str.back() != '/') url_str.push_back('/');
-    if (path_str.front() == '/') path_str.erase(0, 1);
-    url_str += path_str;
-    if (!_http->begin(url_str))
+    if (!_http->begin(file_url(path)))
     {
         Debug_println("FileSystemHTTP::cache_file - failed to start HTTP client");
+        FileCache::remove(fc);
         return nullptr;
 	}
 
@@ -151,6 +170,7 @@ FileHandler *FileSystemHTTP::cache_file(const char *path, const char *mode)
     if (_http->GET() > 399)
     {
         Debug_println("FileSystemHTTP::cache_file - GET failed");
+        FileCache::remove(fc);
         return nullptr;
     }
 
@@ -168,6 +188,7 @@ FileHandler *FileSystemHTTP::cache_file(const char *path, const char *mode)
     if (buf == nullptr)
     {
         Debug_println("FileSystemHTTP::cache_file - failed to allocate buffer");
+        FileCache::remove(fc);
         return nullptr;
     }
 
@@ -417,7 +438,8 @@ bool FileSystemHTTP::dir_open(const char  *path, const char *pattern, uint16_t d
         _parser.end_parser();
 
         // Parsed entries to dircache
-        fsdir_entry *fs_de;
+        fsdir_entry de;
+        fsdir_entry *fs_de = &de;
 #ifdef ESP_PLATFORM
         std::vector<IndexParser::IndexEntry,PSRAMAllocator<IndexParser::IndexEntry>>::iterator dirEntryCursor = _parser.rewind();
 #else
@@ -427,7 +449,7 @@ bool FileSystemHTTP::dir_open(const char  *path, const char *pattern, uint16_t d
         while (dirEntryCursor != _parser.entries.end())
         {
             // new dir entry
-            fs_de = &_dircache.new_entry();
+            memset(fs_de, 0, sizeof(fsdir_entry));
 
             // Set entry members
 
@@ -500,6 +522,7 @@ bool FileSystemHTTP::dir_open(const char  *path, const char *pattern, uint16_t d
             {
                 Debug_printf(" add entry: \"%s\"\t%lu\n", fs_de->filename, fs_de->size);
             }
+            _dircache.add_entry(fs_de->filename, fs_de->isDir, fs_de->size, fs_de->modified_time);
 
             dirEntryCursor++;
         }
@@ -69,6 +69,7 @@ public:
 #ifndef FNIO_IS_STDIO
     FileHandler *cache_file(const char *path, const char *mode);
 #endif
+    std::string file_url(const char *path);
 
 };
 
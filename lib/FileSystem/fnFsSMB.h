@@ -43,6 +43,7 @@ public:
     bool mkdir(const char* path) override { return true; };
     bool rmdir(const char* path) override { return true; };
     bool dir_exists(const char* path) override { return true; };
+    time_t dir_mtime(const char* path) override;
 
     bool dir_open(const char *path, const char *pattern, uint16_t diropts) override;
     fsdir_entry *dir_read() override;
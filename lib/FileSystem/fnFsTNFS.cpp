@@ -169,6 +169,14 @@ bool FileSystemTNFS::rename(const char* pathFrom, const char* pathTo)
     return result == TNFS_RESULT_SUCCESS;
 }
 
+time_t FileSystemTNFS::dir_mtime(const char* path)
+{
+    tnfsStat tstat;
+    if(!_started || TNFS_RESULT_SUCCESS != tnfs_stat(&_mountinfo, &tstat, path) || !tstat.isDir)
+        return 0;
+    return tstat.m_time;
+}
+
 FILE * FileSystemTNFS::file_open(const char* path, const char* mode)
 {
 #ifdef ESP_PLATFORM
@@ -14,6 +14,7 @@
 #include "fnUDP.h"
 #include "fnTcpClient.h"
 #include "tnfslib_udp.h"
+#include "tnfslibBlockCache.h"
 
 #include "utils.h"
 
@@ -50,6 +51,7 @@ bool _tnfs_send(fnUDP *udp, tnfsMountInfo *m_info, tnfsPacket &pkt, uint16_t pay
 int _tnfs_recv(fnUDP *udp, tnfsMountInfo *m_info, tnfsPacket &pkt);
 bool _tnfs_tcp_send(tnfsMountInfo *m_info, tnfsPacket &pkt, uint16_t payload_size);
 int _tnfs_tcp_recv(tnfsMountInfo *m_info, tnfsPacket &pkt);
+int _tnfs_tcp_recv_read_response(tnfsMountInfo *m_info, tnfsPacket &pkt);
 _tnfs_send_recv_result _tnfs_send_recv(fnUDP &udp, tnfsMountInfo *m_info, tnfsPacket &req_pkt, uint16_t payload_size, tnfsPacket &res_pkt);
 _tnfs_recv_result _tnfs_recv_and_validate(fnUDP &udp, tnfsMountInfo *m_info, tnfsPacket &req_pkt, uint16_t payload_size, tnfsPacket &res_pkt);
 uint8_t _tnfs_session_recovery(tnfsMountInfo *m_info, uint8_t command);
@@ -193,6 +195,27 @@ int tnfs_open(tnfsMountInfo *m_info, const char *filepath, uint16_t open_mode, u
         }
     }
 
+    // Read-only handles get a larger cache that can be filled with pipelined READ requests (TCP only)
+    pFileInf->readahead = (open_mode & TNFS_OPENMODE_WRITE) == 0 && m_info->readahead_window > 1
+                          && m_info->protocol == TNFS_PROTOCOL_TCP && !m_info->readahead_disabled;
+    if (pFileInf->readahead)
+    {
+        uint8_t window = m_info->readahead_window > TNFS_READAHEAD_MAX_WINDOW ? TNFS_READAHEAD_MAX_WINDOW : m_info->readahead_window;
+        pFileInf->cache_size = window * TNFS_FILE_CACHE_SIZE;
+        pFileInf->cache = (uint8_t *)malloc(pFileInf->cache_size);
+    }
+    if (pFileInf->cache == nullptr)
+    {
+        pFileInf->readahead = false;
+        pFileInf->cache_size = TNFS_FILE_CACHE_SIZE;
+        pFileInf->cache = (uint8_t *)malloc(pFileInf->cache_size);
+    }
+    if (pFileInf->cache == nullptr)
+    {
+        m_info->delete_filehandleinfo(pFileInf);
+        return TNFS_RESULT_OUT_OF_MEMORY;
+    }
+
     // Done with STAT - now try to actually open the file
     tnfsPacket packet;
     packet.command = TNFS_CMD_OPEN;
@@ -234,6 +257,13 @@ int tnfs_open(tnfsMountInfo *m_info, const char *filepath, uint16_t open_mode, u
                 else if (open_mode & TNFS_OPENMODE_WRITE_TRUNCATE)
                     pFileInf->file_size = 0;
             }
+            // Read-only handles on existing files can share blocks with other handles and mounts
+            if (file_exists && (open_mode & TNFS_OPENMODE_WRITE) == 0 && tnfs_block_cache.enabled())
+            {
+                pFileInf->block_mount_key = tnfsBlockCache::mount_key(m_info);
+                pFileInf->block_path_key = tnfsBlockCache::path_key(pFileInf->block_mount_key, pFileInf->filename);
+                pFileInf->block_file_key = tnfsBlockCache::file_key(pFileInf->block_path_key, tstat.m_time);
+            }
             Debug_printf("File opened, handle ID: %hd, size: %lu, pos: %lu\r\n", *file_handle, pFileInf->file_size, pFileInf->file_position);
         }
         result = packet.payload[0];
@@ -361,11 +391,205 @@ int _tnfs_read_from_cache(tnfsFileHandleInfo *pFHI, uint8_t *dest, uint16_t dest
         return 0;
 }
 
+/*
+ Moves the server's file position to an absolute offset without touching the
+ client's cached position. Used to recover after a pipelined read went wrong.
+ Returns: 0: success; -1: failed to deliver/receive packet; other: TNFS error result code
+*/
+int _tnfs_resync_position(tnfsMountInfo *m_info, tnfsFileHandleInfo *pFHI, uint32_t position)
+{
+    tnfsPacket packet;
+    packet.command = TNFS_CMD_LSEEK;
+    packet.payload[0] = pFHI->handle_id;
+    packet.payload[1] = SEEK_SET;
+    TNFS_UINT32_TO_LOHI_BYTEPTR(position, packet.payload + 2);
+
+    if (!_tnfs_transaction(m_info, packet, 6))
+        return -1;
+
+    if (packet.payload[0] == TNFS_RESULT_SUCCESS)
+        pFHI->file_position = position;
+    return packet.payload[0];
+}
+
+/*
+ Fills the cache with up to readahead_window READ requests in flight at once.
+
+ TNFS READ carries no file offset: the server hands out data in the order it
+ processes requests, and nothing in a response tells which part of the file it
+ holds. That order is only known over TCP, where requests reach the server and
+ responses come back in the order they were sent. Over UDP either may be
+ reordered independently, so UDP mounts keep using stop-and-wait.
+
+ Every response must carry the next expected sequence number. On anything else
+ (missing, out of order, unexpected result) we keep the data received before
+ it, skip the responses still in flight, move the server back to the matching
+ position with an absolute LSEEK and disable read-ahead for the mount.
+
+ Returns: 0: success; other: TNFS error result code;
+ -1: nothing was cached, the caller should fill the cache with stop-and-wait
+*/
+int _tnfs_fill_cache_pipelined(tnfsMountInfo *m_info, tnfsFileHandleInfo *pFHI)
+{
+    if (!pFHI->readahead || m_info->readahead_disabled || m_info->protocol != TNFS_PROTOCOL_TCP)
+        return -1;
+
+    // Don't request more than what's left in the file
+    uint32_t bytes_wanted = pFHI->file_size > pFHI->file_position ? pFHI->file_size - pFHI->file_position : 0;
+    if (bytes_wanted > pFHI->cache_size)
+        bytes_wanted = pFHI->cache_size;
+    int count = (bytes_wanted + TNFS_FILE_CACHE_SIZE - 1) / TNFS_FILE_CACHE_SIZE;
+    if (count < 2)
+        return -1;
+
+    std::lock_guard<std::recursive_mutex> lock(m_info->transaction_mutex);
+
+    fnUDP udp;
+
+    tnfsPacket packet;
+    packet.session_idl = TNFS_LOBYTE_FROM_UINT16(m_info->session);
+    packet.session_idh = TNFS_HIBYTE_FROM_UINT16(m_info->session);
+    packet.command = TNFS_CMD_READ;
+    packet.payload[0] = pFHI->handle_id;
+    packet.payload[1] = TNFS_LOBYTE_FROM_UINT16(TNFS_FILE_CACHE_SIZE);
+    packet.payload[2] = TNFS_HIBYTE_FROM_UINT16(TNFS_FILE_CACHE_SIZE);
+
+    #ifdef VERBOSE_TNFS
+    Debug_printf("_tnfs_fill_cache_pipelined fh=%d, file_position=%lu, requests=%d\r\n", pFHI->handle_id, pFHI->file_position, count);
+    #endif
+
+    // Send all the requests back-to-back
+    uint8_t first_seq = m_info->current_sequence_num;
+    int sent = 0;
+    for (; sent < count; sent++)
+    {
+        packet.sequence_num = m_info->current_sequence_num++;
+#ifdef DEBUG
+        _tnfs_debug_packet(packet, 3);
+#endif
+        if (!_tnfs_send(&udp, m_info, packet, 3))
+        {
+            Debug_println("_tnfs_fill_cache_pipelined failed to send request");
+            break;
+        }
+    }
+
+    // Collect responses in order for as long as they keep arriving within the timeout
+    bool misbehaved = sent < count;
+    bool at_eof = false;
+    int received = 0; // Responses accepted
+    int consumed = 0; // Responses taken off the stream
+    uint32_t total = 0;
+    uint64_t ms_start = fnSystem.millis();
+    while (received < sent && !misbehaved && (fnSystem.millis() - ms_start) < (uint64_t)m_info->timeout_ms)
+    {
+        if (SYSTEM_BUS.getShuttingDown())
+        {
+            Debug_println("TNFS Breakout due to Shutdown");
+            break;
+        }
+
+        int l = _tnfs_tcp_recv_read_response(m_info, packet);
+        if (l < 0)
+        {
+            if (!m_info->tcp_client.connected())
+                break;
+#ifdef ESP_PLATFORM
+            fnSystem.yield();
+#else
+            fnSystem.delay_microseconds(1000);
+#endif
+            continue;
+        }
+#ifdef DEBUG
+        _tnfs_debug_packet(packet, l, true);
+#endif
+        consumed++;
+
+        uint8_t expected_seq = first_seq + received;
+        if (l < TNFS_HEADER_SIZE + 1 || packet.command != TNFS_CMD_READ || packet.sequence_num != expected_seq)
+        {
+            Debug_printf("_tnfs_fill_cache_pipelined unexpected response, seq: %x, expected: %x\r\n", packet.sequence_num, expected_seq);
+            misbehaved = true;
+            break;
+        }
+        received++;
+
+        uint8_t result = packet.payload[0];
+        if (result == TNFS_RESULT_SUCCESS)
+        {
+            uint16_t bytes_read = TNFS_UINT16_FROM_LOHI_BYTEPTR(packet.payload + 1);
+            // Nothing may follow a short read, it marks the end of the file
+            if (bytes_read > TNFS_FILE_CACHE_SIZE || l < TNFS_HEADER_SIZE + 3 + bytes_read || (at_eof && bytes_read > 0))
+            {
+                misbehaved = true;
+                break;
+            }
+            memcpy(pFHI->cache + total, packet.payload + 3, bytes_read);
+            total += bytes_read;
+            if (bytes_read < TNFS_FILE_CACHE_SIZE)
+                at_eof = true;
+        }
+        else if (result == TNFS_RESULT_END_OF_FILE)
+        {
+            at_eof = true;
+        }
+        else
+        {
+            misbehaved = true;
+            break;
+        }
+        ms_start = fnSystem.millis();
+    }
+
+    if (misbehaved || received < sent)
+    {
+        Debug_printf("_tnfs_fill_cache_pipelined: %d of %d responses received in order, falling back to stop-and-wait\r\n",
+                     received, count);
+        m_info->readahead_disabled = true;
+
+        // Responses still on their way would be taken for replies to the next transaction
+        ms_start = fnSystem.millis();
+        while (consumed < sent && m_info->tcp_client.connected() && (fnSystem.millis() - ms_start) < (uint64_t)m_info->timeout_ms)
+        {
+            if (_tnfs_tcp_recv_read_response(m_info, packet) >= 0)
+                consumed++;
+            else
+#ifdef ESP_PLATFORM
+                fnSystem.yield();
+#else
+                fnSystem.delay_microseconds(1000);
+#endif
+        }
+        if (consumed < sent)
+            m_info->tcp_client.stop();
+
+        int result = _tnfs_resync_position(m_info, pFHI, pFHI->cache_start + total);
+        if (result != TNFS_RESULT_SUCCESS)
+        {
+            Debug_printf("_tnfs_fill_cache_pipelined failed to restore file position (%d)\r\n", result);
+            return result == -1 ? TNFS_RESULT_IO_ERROR : result;
+        }
+    }
+    else
+    {
+        pFHI->file_position = pFHI->cache_start + total;
+    }
+
+    pFHI->cache_available = total;
+
+    #ifdef VERBOSE_TNFS
+    Debug_printf("_tnfs_fill_cache_pipelined got %lu bytes\r\n", total);
+    #endif
+
+    return total > 0 ? 0 : -1;
+}
+
 /*
  Executes as many READ calls as needed to populate our internal cache
  Returns: 0: success; -1: failed to deliver/receive packet; other: TNFS error result code
 */
-int _tnfs_fill_cache(tnfsMountInfo *m_info, tnfsFileHandleInfo *pFHI)
+int _tnfs_fill_cache_from_server(tnfsMountInfo *m_info, tnfsFileHandleInfo *pFHI)
 {
     // Note that when we're filling the cache, we're dealing with the "real" file position,
     // not the cached_position we also keep track of on behalf of the client
@@ -379,8 +603,15 @@ int _tnfs_fill_cache(tnfsMountInfo *m_info, tnfsFileHandleInfo *pFHI)
     pFHI->cache_available = 0;
     pFHI->cache_start = pFHI->file_position;
 
+    // Use pipelined READ requests if the handle and server allow it
+    int pipelined = _tnfs_fill_cache_pipelined(m_info, pFHI);
+    if (pipelined != -1)
+        return pipelined;
+
     // How many bytes until we finish loading the cache
-    uint32_t bytes_remaining_to_load = sizeof(pFHI->cache);
+    // (stop-and-wait only fills one packet's worth, same as before read-ahead existed)
+    uint32_t bytes_to_load = TNFS_FILE_CACHE_SIZE;
+    uint32_t bytes_remaining_to_load = bytes_to_load;
 
     // Keep making TNFS READ calls as long as we still have bytes to read
     while (bytes_remaining_to_load > 0)
@@ -407,7 +638,7 @@ int _tnfs_fill_cache(tnfsMountInfo *m_info, tnfsFileHandleInfo *pFHI)
                 // Copy the actual number of bytes returned to us into our cache
                 // (offset by how many bytes we've already put in the cache)
                 uint16_t bytes_read = TNFS_UINT16_FROM_LOHI_BYTEPTR(packet.payload + 1);
-                memcpy(pFHI->cache + (sizeof(pFHI->cache) - bytes_remaining_to_load),
+                memcpy(pFHI->cache + (bytes_to_load - bytes_remaining_to_load),
                        packet.payload + 3, bytes_read);
 
                 // Keep track of our file position
@@ -450,12 +681,12 @@ int _tnfs_fill_cache(tnfsMountInfo *m_info, tnfsFileHandleInfo *pFHI)
 #ifdef ESP_PLATFORM
     if (error == 0)
     {
-        pFHI->cache_available = sizeof(pFHI->cache) - bytes_remaining_to_load;
+        pFHI->cache_available = bytes_to_load - bytes_remaining_to_load;
 #else
 // TODO review EOF handling
     if (error == 0 || error == TNFS_RESULT_END_OF_FILE)
     {
-        pFHI->cache_available = sizeof(pFHI->cache) - bytes_remaining_to_load;
+        pFHI->cache_available = bytes_to_load - bytes_remaining_to_load;
         if (pFHI->cache_available > 0) error = 0; // neutralize EOF
 #endif
 #ifdef DEBUG
@@ -466,6 +697,90 @@ int _tnfs_fill_cache(tnfsMountInfo *m_info, tnfsFileHandleInfo *pFHI)
     return error;
 }
 
+/*
+ Fills our internal cache from the shared block cache, starting with the block
+ holding the client's current position. The server's file position isn't touched.
+ Returns: 0: success; -1: the block at the current position isn't cached
+*/
+int _tnfs_fill_cache_from_blocks(tnfsFileHandleInfo *pFHI)
+{
+    uint32_t first_block = pFHI->cached_pos / TNFS_BLOCK_SIZE;
+    uint32_t filled = 0;
+
+    while (filled + TNFS_BLOCK_SIZE <= pFHI->cache_size)
+    {
+        // Only the first block is a real lookup, the rest is opportunistic
+        int len = tnfs_block_cache.get(pFHI->block_file_key, first_block + filled / TNFS_BLOCK_SIZE,
+                                       pFHI->cache + filled, filled > 0);
+        if (len < 0)
+            break;
+        filled += len;
+        if (len < TNFS_BLOCK_SIZE)
+            break; // Last block of the file
+    }
+
+    uint32_t start = first_block * TNFS_BLOCK_SIZE;
+    if (start + filled <= pFHI->cached_pos)
+        return -1;
+
+    pFHI->cache_start = start;
+    pFHI->cache_available = filled;
+    #ifdef VERBOSE_TNFS
+    Debug_printf("_tnfs_fill_cache_from_blocks got %lu bytes at %lu\r\n", filled, start);
+    #endif
+    return 0;
+}
+
+/*
+ Offers the whole blocks in our internal cache to the shared block cache
+*/
+void _tnfs_store_cache_blocks(tnfsFileHandleInfo *pFHI)
+{
+    if (pFHI->cache_start % TNFS_BLOCK_SIZE != 0)
+        return;
+
+    for (uint32_t offset = 0; offset < pFHI->cache_available; offset += TNFS_BLOCK_SIZE)
+    {
+        uint32_t len = pFHI->cache_available - offset;
+        if (len > TNFS_BLOCK_SIZE)
+            len = TNFS_BLOCK_SIZE;
+        // A partial block is only complete if it's the end of the file
+        if (len < TNFS_BLOCK_SIZE && pFHI->cache_start + offset + len < pFHI->file_size)
+            break;
+        tnfs_block_cache.put(pFHI->block_mount_key, pFHI->block_path_key, pFHI->block_file_key,
+                             (pFHI->cache_start + offset) / TNFS_BLOCK_SIZE, pFHI->cache + offset, len);
+    }
+}
+
+/*
+ Populates our internal cache at the client's current position, using the shared
+ block cache if the handle has access to it and the server otherwise
+ Returns: 0: success; -1: failed to deliver/receive packet; other: TNFS error result code
+*/
+int _tnfs_fill_cache(tnfsMountInfo *m_info, tnfsFileHandleInfo *pFHI)
+{
+    if (pFHI->block_file_key == 0)
+        return _tnfs_fill_cache_from_server(m_info, pFHI);
+
+    if (_tnfs_fill_cache_from_blocks(pFHI) == 0)
+        return 0;
+
+    // Fetch whole blocks so they can be shared: start the server at the block boundary
+    uint32_t block_start = pFHI->cached_pos - pFHI->cached_pos % TNFS_BLOCK_SIZE;
+    if (pFHI->file_position != block_start)
+    {
+        pFHI->cache_available = 0;
+        int result = _tnfs_resync_position(m_info, pFHI, block_start);
+        if (result != TNFS_RESULT_SUCCESS)
+            return result;
+    }
+
+    int result = _tnfs_fill_cache_from_server(m_info, pFHI);
+    if (result == 0)
+        _tnfs_store_cache_blocks(pFHI);
+    return result;
+}
+
 /*
  Reads from an open file.
  Max bufflen is TNFS_PAYLOAD_SIZE - 3; any larger size will return an error
@@ -539,6 +854,9 @@ int tnfs_write(tnfsMountInfo *m_info, int16_t file_handle, uint8_t *buffer, uint
     if (pFileInf == nullptr)
         return TNFS_RESULT_BAD_FILE_DESCRIPTOR;
 
+    // Any copy of this file in the shared block cache is now stale
+    tnfs_block_cache.invalidate_path(tnfsBlockCache::path_key(tnfsBlockCache::mount_key(m_info), pFileInf->filename));
+
     // For now, invalidate our cache and seek to the current position in the file before writing
     pFileInf->cache_available = 0;
     if(pFileInf->cached_pos != pFileInf->file_position)
@@ -574,6 +892,19 @@ int tnfs_write(tnfsMountInfo *m_info, int16_t file_handle, uint8_t *buffer, uint
     return -1;
 }
 
+/*
+  Calculate where a seek is supposed to end up from the client's point of view
+*/
+int64_t _tnfs_seek_destination(tnfsFileHandleInfo *pFHI, int32_t position, uint8_t type)
+{
+    if (type == SEEK_SET)
+        return position;
+    else if (type == SEEK_CUR)
+        return (int64_t)pFHI->cached_pos + position;
+    else
+        return (int64_t)pFHI->file_size + position;
+}
+
 /*
   Try to seek within our internal cache
   Return 0 on success, -1 on failure
@@ -584,13 +915,7 @@ int _tnfs_cache_seek(tnfsFileHandleInfo *pFHI, int32_t position, uint8_t type)
         return -1;
 
     // Calculate where we're supposed to end up to see if it's within the cached region
-    uint32_t destination_pos;
-    if (type == SEEK_SET)
-        destination_pos = position;
-    else if (type == SEEK_CUR)
-        destination_pos = pFHI->cached_pos + position;
-    else
-        destination_pos = pFHI->file_size + position;
+    uint32_t destination_pos = _tnfs_seek_destination(pFHI, position, type);
 
     uint32_t cache_end = pFHI->cache_start + pFHI->cache_available;
 #ifdef TNFS_DEBUG
@@ -645,6 +970,19 @@ int tnfs_lseek(tnfsMountInfo *m_info, int16_t file_handle, int32_t position, uin
     // Cache seek failed - invalidate the internal cache
     pFileInf->cache_available = 0;
 
+    // Handles using the shared block cache seek lazily: the server is only
+    // repositioned by the next cache fill if the data isn't in the block cache
+    if (skip_cache == false && pFileInf->block_file_key != 0)
+    {
+        int64_t destination_pos = _tnfs_seek_destination(pFileInf, position, type);
+        if (destination_pos < 0 || destination_pos > UINT32_MAX)
+            return TNFS_RESULT_INVALID_ARGUMENT;
+        pFileInf->cached_pos = destination_pos;
+        if(new_position != nullptr)
+            *new_position = pFileInf->cached_pos;
+        return 0;
+    }
+
     // Go ahead and execute a new TNFS SEEK request
     tnfsPacket packet;
     packet.command = TNFS_CMD_LSEEK;
@@ -1073,6 +1411,8 @@ int tnfs_unlink(tnfsMountInfo *m_info, const char *filepath)
 
     Debug_printf("TNFS unlink file: \"%s\"\r\n", (char *)packet.payload);
 
+    tnfs_block_cache.invalidate_path(tnfsBlockCache::path_key(tnfsBlockCache::mount_key(m_info), (char *)packet.payload));
+
     if (_tnfs_transaction(m_info, packet, len + 1))
     {
         return packet.payload[0];
@@ -1098,6 +1438,9 @@ int tnfs_rename(tnfsMountInfo *m_info, const char *old_filepath, const char *new
 
     Debug_printf("TNFS rename file: \"%s\" -> \"%s\"\r\n", (char *)packet.payload, (char *)(packet.payload + l1));
 
+    // Renaming a directory changes the path of everything below it, so drop the whole mount
+    tnfs_block_cache.invalidate_mount(tnfsBlockCache::mount_key(m_info));
+
     if (_tnfs_transaction(m_info, packet, l1 + l2))
     {
         return packet.payload[0];
@@ -1352,6 +1695,76 @@ int _tnfs_tcp_recv(tnfsMountInfo *m_info, tnfsPacket &pkt)
     return tcp->read(pkt.rawData, sizeof(pkt.rawData));
 }
 
+/*
+    Read exactly len bytes from the TCP stream, waiting at most timeout_ms for
+    the data to arrive. Returns false on timeout or connection failure.
+*/
+bool _tnfs_tcp_read_exact(tnfsMountInfo *m_info, uint8_t *buf, int len)
+{
+    fnTcpClient *tcp = &m_info->tcp_client;
+    uint64_t ms_start = fnSystem.millis();
+    int got = 0;
+    while (got < len)
+    {
+        if (!tcp->connected())
+            return false;
+        int l = tcp->available() ? tcp->read(buf + got, len - got) : -1;
+        if (l > 0)
+        {
+            got += l;
+            continue;
+        }
+        if ((fnSystem.millis() - ms_start) >= (uint64_t)m_info->timeout_ms)
+            return false;
+#ifdef ESP_PLATFORM
+        fnSystem.yield();
+#else
+        fnSystem.delay_microseconds(1000);
+#endif
+    }
+    return true;
+}
+
+/*
+    Receive exactly one READ response from the TCP stream.
+    With several READ requests in flight the stream may hold more than one
+    response, so the length is taken from the response header instead of
+    reading whatever happens to be available.
+    Return the number of received bytes or -1 if no response is available.
+*/
+int _tnfs_tcp_recv_read_response(tnfsMountInfo *m_info, tnfsPacket &pkt)
+{
+    fnTcpClient *tcp = &m_info->tcp_client;
+    if (!tcp->connected() || !tcp->available())
+        return -1;
+
+    // Header and result code
+    int len = TNFS_HEADER_SIZE + 1;
+    bool ok = _tnfs_tcp_read_exact(m_info, pkt.rawData, len);
+
+    // Successful reads carry a length and data, TRY_AGAIN carries a backoff delay
+    if (ok && (pkt.payload[0] == TNFS_RESULT_SUCCESS || pkt.payload[0] == TNFS_RESULT_TRY_AGAIN))
+    {
+        ok = _tnfs_tcp_read_exact(m_info, pkt.rawData + len, 2);
+        len += 2;
+    }
+    if (ok && pkt.payload[0] == TNFS_RESULT_SUCCESS)
+    {
+        uint16_t datalen = TNFS_UINT16_FROM_LOHI_BYTEPTR(pkt.payload + 1);
+        ok = datalen <= TNFS_MAX_READWRITE_PAYLOAD && _tnfs_tcp_read_exact(m_info, pkt.rawData + len, datalen);
+        len += datalen;
+    }
+
+    if (!ok)
+    {
+        // We lost track of where responses start in the stream
+        Debug_println("_tnfs_tcp_recv_read_response: incomplete response, dropping connection");
+        tcp->stop();
+        return -1;
+    }
+    return len;
+}
+
 #ifndef TNFS_UDP_SIMULATE_POOR_CONNECTION
 int _tnfs_udp_recv(fnUDP *udp, tnfsMountInfo *m_info, tnfsPacket &pkt)
 {
@@ -0,0 +1,315 @@
+
+#include "tnfslibBlockCache.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef ESP_PLATFORM
+#include <esp_heap_caps.h>
+#endif
+
+#include "../../include/debug.h"
+
+#include "fnSystem.h"
+
+
+#define FNV64_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV64_PRIME 0x100000001b3ULL
+
+tnfsBlockCache tnfs_block_cache;
+
+static uint64_t _fnv1a(uint64_t hash, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= p[i];
+        hash *= FNV64_PRIME;
+    }
+    return hash;
+}
+
+// 0 is reserved to mean "not cacheable"
+static uint64_t _nonzero(uint64_t key)
+{
+    return key == 0 ? 1 : key;
+}
+
+uint64_t tnfsBlockCache::mount_key(const tnfsMountInfo *m_info)
+{
+    uint64_t hash = FNV64_OFFSET_BASIS;
+    if (m_info->hostname[0] != '\0')
+        hash = _fnv1a(hash, m_info->hostname, strlen(m_info->hostname));
+    else
+        hash = _fnv1a(hash, &m_info->host_ip, sizeof(m_info->host_ip));
+    hash = _fnv1a(hash, &m_info->port, sizeof(m_info->port));
+    hash = _fnv1a(hash, m_info->mountpath, strlen(m_info->mountpath) + 1);
+    return _nonzero(hash);
+}
+
+uint64_t tnfsBlockCache::path_key(uint64_t mount_key, const char *filepath)
+{
+    return _nonzero(_fnv1a(mount_key, filepath, strlen(filepath) + 1));
+}
+
+uint64_t tnfsBlockCache::file_key(uint64_t path_key, uint32_t mtime)
+{
+    return _nonzero(_fnv1a(path_key, &mtime, sizeof(mtime)));
+}
+
+// Allocate the arena and index for the current budget
+// Must be called with _mutex held
+bool tnfsBlockCache::_init()
+{
+    if (_initialized)
+        return _slots > 0;
+    _initialized = true;
+
+#ifdef ESP_PLATFORM
+    // Don't compete for internal RAM with everything else
+    if (fnSystem.get_psram_size() == 0)
+    {
+        Debug_println("TNFS block cache disabled - no PSRAM");
+        return false;
+    }
+#endif
+
+    _slots = _budget / TNFS_BLOCK_SIZE;
+    if (_slots == 0)
+        return false;
+
+    _bucket_count = 1;
+    while (_bucket_count < _slots)
+        _bucket_count <<= 1;
+
+#ifdef ESP_PLATFORM
+    _data = (uint8_t *)heap_caps_malloc(_slots * TNFS_BLOCK_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    _entries = (Entry *)heap_caps_malloc(_slots * sizeof(Entry), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    _buckets = (int32_t *)heap_caps_malloc(_bucket_count * sizeof(int32_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#else
+    _data = (uint8_t *)malloc(_slots * TNFS_BLOCK_SIZE);
+    _entries = (Entry *)malloc(_slots * sizeof(Entry));
+    _buckets = (int32_t *)malloc(_bucket_count * sizeof(int32_t));
+#endif
+    if (_data == nullptr || _entries == nullptr || _buckets == nullptr)
+    {
+        Debug_printf("TNFS block cache failed to allocate %lu bytes\r\n", (unsigned long)_budget);
+        _release();
+        _initialized = true; // Don't keep trying
+        return false;
+    }
+
+    for (uint32_t i = 0; i < _bucket_count; i++)
+        _buckets[i] = -1;
+
+    // Chain all slots into the free list
+    for (uint32_t i = 0; i < _slots; i++)
+        _entries[i].lru_next = (i + 1 < _slots) ? i + 1 : -1;
+    _free = 0;
+    _lru_head = _lru_tail = -1;
+
+    _stats.blocks_total = _slots;
+    _stats.blocks_used = 0;
+
+    Debug_printf("TNFS block cache: %lu blocks of %d bytes\r\n", (unsigned long)_slots, TNFS_BLOCK_SIZE);
+    return true;
+}
+
+// Must be called with _mutex held
+void tnfsBlockCache::_release()
+{
+    free(_data);
+    free(_entries);
+    free(_buckets);
+    _data = nullptr;
+    _entries = nullptr;
+    _buckets = nullptr;
+    _slots = 0;
+    _bucket_count = 0;
+    _lru_head = _lru_tail = _free = -1;
+    _stats.blocks_used = 0;
+    _stats.blocks_total = 0;
+    _initialized = false;
+}
+
+void tnfsBlockCache::set_budget(uint32_t bytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _release();
+    _budget = bytes;
+}
+
+bool tnfsBlockCache::enabled()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _init();
+}
+
+uint32_t tnfsBlockCache::_bucket(uint64_t file_key, uint32_t block)
+{
+    uint64_t hash = (file_key ^ block) * FNV64_PRIME;
+    return (uint32_t)(hash ^ (hash >> 32)) & (_bucket_count - 1);
+}
+
+int32_t tnfsBlockCache::_find(uint64_t file_key, uint32_t block)
+{
+    for (int32_t i = _buckets[_bucket(file_key, block)]; i >= 0; i = _entries[i].hash_next)
+    {
+        if (_entries[i].file_key == file_key && _entries[i].block == block)
+            return i;
+    }
+    return -1;
+}
+
+void tnfsBlockCache::_lru_unlink(int32_t slot)
+{
+    Entry &e = _entries[slot];
+    if (e.lru_prev >= 0)
+        _entries[e.lru_prev].lru_next = e.lru_next;
+    else
+        _lru_head = e.lru_next;
+    if (e.lru_next >= 0)
+        _entries[e.lru_next].lru_prev = e.lru_prev;
+    else
+        _lru_tail = e.lru_prev;
+}
+
+void tnfsBlockCache::_lru_push_front(int32_t slot)
+{
+    Entry &e = _entries[slot];
+    e.lru_prev = -1;
+    e.lru_next = _lru_head;
+    if (_lru_head >= 0)
+        _entries[_lru_head].lru_prev = slot;
+    _lru_head = slot;
+    if (_lru_tail < 0)
+        _lru_tail = slot;
+}
+
+// Take an entry out of the index and LRU list and return it to the free list
+void tnfsBlockCache::_remove(int32_t slot)
+{
+    Entry &e = _entries[slot];
+
+    int32_t *link = &_buckets[_bucket(e.file_key, e.block)];
+    while (*link >= 0 && *link != slot)
+        link = &_entries[*link].hash_next;
+    if (*link == slot)
+        *link = e.hash_next;
+
+    _lru_unlink(slot);
+
+    e.lru_next = _free;
+    _free = slot;
+    _stats.blocks_used--;
+}
+
+int tnfsBlockCache::get(uint64_t file_key, uint32_t block, uint8_t *dest, bool speculative)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_init())
+        return -1;
+
+    int32_t slot = _find(file_key, block);
+    if (slot < 0)
+    {
+        if (!speculative)
+            _stats.misses++;
+        return -1;
+    }
+    _stats.hits++;
+
+    // Mark as most recently used
+    _lru_unlink(slot);
+    _lru_push_front(slot);
+
+    memcpy(dest, _data + slot * TNFS_BLOCK_SIZE, _entries[slot].length);
+    return _entries[slot].length;
+}
+
+void tnfsBlockCache::put(uint64_t mount_key, uint64_t path_key, uint64_t file_key, uint32_t block, const uint8_t *src, uint16_t length)
+{
+    if (length > TNFS_BLOCK_SIZE)
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_init())
+        return;
+
+    int32_t slot = _find(file_key, block);
+    if (slot >= 0)
+    {
+        // Already have it - just refresh the data
+        _lru_unlink(slot);
+    }
+    else
+    {
+        if (_free < 0)
+        {
+            // Evict the least recently used block
+            _remove(_lru_tail);
+            _stats.evictions++;
+        }
+        slot = _free;
+        _free = _entries[slot].lru_next;
+
+        Entry &e = _entries[slot];
+        e.file_key = file_key;
+        e.path_key = path_key;
+        e.mount_key = mount_key;
+        e.block = block;
+
+        uint32_t b = _bucket(file_key, block);
+        e.hash_next = _buckets[b];
+        _buckets[b] = slot;
+
+        _stats.blocks_used++;
+        _stats.insertions++;
+    }
+
+    _entries[slot].length = length;
+    memcpy(_data + slot * TNFS_BLOCK_SIZE, src, length);
+    _lru_push_front(slot);
+}
+
+void tnfsBlockCache::invalidate_path(uint64_t path_key)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_slots == 0)
+        return;
+
+    for (int32_t i = _lru_head; i >= 0;)
+    {
+        int32_t next = _entries[i].lru_next;
+        if (_entries[i].path_key == path_key)
+        {
+            _remove(i);
+            _stats.invalidations++;
+        }
+        i = next;
+    }
+}
+
+void tnfsBlockCache::invalidate_mount(uint64_t mount_key)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_slots == 0)
+        return;
+
+    for (int32_t i = _lru_head; i >= 0;)
+    {
+        int32_t next = _entries[i].lru_next;
+        if (_entries[i].mount_key == mount_key)
+        {
+            _remove(i);
+            _stats.invalidations++;
+        }
+        i = next;
+    }
+}
+
+tnfsBlockCacheStats tnfsBlockCache::get_stats()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
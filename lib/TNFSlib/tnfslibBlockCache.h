@@ -0,0 +1,111 @@
+#ifndef _TNFSLIB_BLOCKCACHE_H
+#define _TNFSLIB_BLOCKCACHE_H
+
+#include <cstdint>
+#include <mutex>
+
+#include "tnfslibMountInfo.h"
+
+
+#define TNFS_BLOCK_SIZE TNFS_FILE_CACHE_SIZE // Blocks are aligned to multiples of this size in the file
+
+// Memory budget for the shared block cache. On ESP32 the cache is only enabled when PSRAM is present.
+#ifndef TNFS_BLOCK_CACHE_BUDGET
+#ifdef ESP_PLATFORM
+#define TNFS_BLOCK_CACHE_BUDGET (256 * 1024)
+#else
+#define TNFS_BLOCK_CACHE_BUDGET (4 * 1024 * 1024)
+#endif
+#endif
+
+struct tnfsBlockCacheStats
+{
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    uint32_t insertions = 0;
+    uint32_t evictions = 0;
+    uint32_t invalidations = 0; // Number of blocks dropped because of writes, unlinks or renames
+    uint32_t blocks_used = 0;
+    uint32_t blocks_total = 0;
+};
+
+/*
+ Process-wide cache of file blocks shared by all TNFS mounts and file handles.
+
+ Blocks are identified by a key derived from (host, port, mount path, file path, mtime)
+ and the block index within the file, so re-opening an image or opening it from
+ another device slot re-uses what was already fetched. Keys are 64-bit hashes to keep
+ the per-block bookkeeping small; the path is hashed without mtime as well so that
+ writes, unlinks and renames can invalidate every version of a file.
+
+ Block data lives in one arena (PSRAM on ESP32), least recently used blocks are
+ evicted when the arena is full.
+*/
+class tnfsBlockCache
+{
+private:
+    struct Entry
+    {
+        uint64_t file_key;
+        uint64_t path_key;
+        uint64_t mount_key;
+        uint32_t block;
+        uint16_t length;
+        int32_t lru_prev;
+        int32_t lru_next;
+        int32_t hash_next;
+    };
+
+    std::mutex _mutex;
+
+    uint32_t _budget = TNFS_BLOCK_CACHE_BUDGET;
+    bool _initialized = false;
+
+    uint8_t *_data = nullptr;
+    Entry *_entries = nullptr;
+    int32_t *_buckets = nullptr;
+    uint32_t _slots = 0;
+    uint32_t _bucket_count = 0;
+
+    int32_t _lru_head = -1; // Most recently used
+    int32_t _lru_tail = -1; // Least recently used
+    int32_t _free = -1;
+
+    tnfsBlockCacheStats _stats;
+
+    bool _init();
+    void _release();
+
+    uint32_t _bucket(uint64_t file_key, uint32_t block);
+    int32_t _find(uint64_t file_key, uint32_t block);
+    void _lru_unlink(int32_t slot);
+    void _lru_push_front(int32_t slot);
+    void _remove(int32_t slot);
+
+public:
+    ~tnfsBlockCache() { _release(); };
+
+    // Changes the memory budget, dropping anything cached. 0 disables the cache.
+    void set_budget(uint32_t bytes);
+    uint32_t get_budget() { return _budget; };
+    bool enabled();
+
+    // Copies a cached block to dest (which must hold TNFS_BLOCK_SIZE bytes)
+    // Returns the number of bytes copied or -1 if the block isn't cached
+    // Misses on speculative (read-ahead) lookups aren't counted
+    int get(uint64_t file_key, uint32_t block, uint8_t *dest, bool speculative = false);
+    void put(uint64_t mount_key, uint64_t path_key, uint64_t file_key, uint32_t block, const uint8_t *src, uint16_t length);
+
+    void invalidate_path(uint64_t path_key);
+    void invalidate_mount(uint64_t mount_key);
+
+    tnfsBlockCacheStats get_stats();
+
+    static uint64_t mount_key(const tnfsMountInfo *m_info);
+    static uint64_t path_key(uint64_t mount_key, const char *filepath);
+    static uint64_t file_key(uint64_t path_key, uint32_t mtime);
+};
+
+extern tnfsBlockCache tnfs_block_cache;
+
+#endif // _TNFSLIB_BLOCKCACHE_H
@@ -2,6 +2,7 @@
 #define _TNFSLIB_MOUNTINFO_H
 
 #include <cstdint>
+#include <cstdlib>
 #include <mutex>
 
 #include "fnDNS.h"
@@ -18,6 +19,14 @@
 
 #define TNFS_FILE_CACHE_SIZE 512 // 4 * 128 fits in a single packet when TNFS_MAX_READWRITE_PAYLOAD is 512
 
+// Number of READ requests kept in flight when filling the cache of a read-only file handle
+// on a TCP mount (UDP may reorder requests, so it always uses stop-and-wait). Each request fetches TNFS_FILE_CACHE_SIZE bytes, so the handle's cache grows to
+// TNFS_READAHEAD_WINDOW * TNFS_FILE_CACHE_SIZE bytes. 1 disables read-ahead (stop-and-wait).
+#ifndef TNFS_READAHEAD_WINDOW
+#define TNFS_READAHEAD_WINDOW 4
+#endif
+#define TNFS_READAHEAD_MAX_WINDOW 16
+
 #define TNFS_INVALID_HANDLE -1
 #define TNFS_INVALID_SESSION 0 // We're assuming a '0' is never a valid session ID
 
@@ -51,9 +60,18 @@ struct tnfsFileHandleInfo
     uint32_t cache_available = 0; // Number of valid bytes in the cache
 
     bool cache_modified = false; // Notes if we've written to the cache
+    bool readahead = false; // Cache may be filled with pipelined READ requests (read-only handles)
 
-    uint8_t cache[TNFS_FILE_CACHE_SIZE];
+    // Keys into the shared block cache (tnfslibBlockCache.h), 0 if the handle doesn't use it
+    uint64_t block_mount_key = 0;
+    uint64_t block_path_key = 0;
+    uint64_t block_file_key = 0;
+
+    uint32_t cache_size = 0; // Size of the cache buffer
+    uint8_t *cache = nullptr;
     char filename[TNFS_MAX_FILELEN];
+
+    ~tnfsFileHandleInfo() { free(cache); };
 };
 
 // A place to store each directory entry we cache from a response to TNFS_READDIRX
@@ -115,6 +133,8 @@ public:
     uint8_t max_retries = TNFS_RETRIES;
     int timeout_ms = TNFS_TIMEOUT;
     uint8_t current_sequence_num = 0; // Updated with each transaction to the server
+    uint8_t readahead_window = TNFS_READAHEAD_WINDOW; // Max READ requests in flight per file handle
+    bool readahead_disabled = false; // Set if the server misbehaved during a pipelined read
 
     int16_t dir_handle = TNFS_INVALID_HANDLE; // Stored from server's response to TNFS_OPENDIR
     uint16_t dir_entries = 0; // Stored from server's response to TNFS_OPENDIRX
@@ -182,6 +182,12 @@ void BeckerPort::listen_for_connection()
 		return;
 	}
 
+    // Local address to listen on
+    if (_host[0] == '\0' || !strcmp(_host, "*"))
+        _ip = IPADDR_ANY;
+    else if (!resolve_host())
+        return;
+
     Debug_printf("Setting up BeckerPort: listening on %s:%d\n", _host, _port);
 
     // Create listening socket
@@ -210,23 +216,6 @@ void BeckerPort::listen_for_connection()
         return;
     }
 
-    // Local address to listen on
-    if (_host[0] == '\0' || !strcmp(_host, "*"))
-    {
-        _ip = IPADDR_ANY;
-    }
-    else
-    {
-        _ip = get_ip4_addr_by_name(_host);
-        if (_ip == IPADDR_NONE)
-        {
-            Debug_println("BeckerPort: failed to resolve host name");
-            closesocket(_listen_fd);
-            _listen_fd = -1;
-            suspend(BECKER_SUSPEND_MS);
-            return;
-        }
-    }
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
@@ -284,6 +273,12 @@ void BeckerPort::make_connection()
 		return;
 	}
 
+    // Remote address
+    if (_host[0] == '\0')
+        _ip = IPADDR_LOOPBACK;
+    else if (!resolve_host())
+        return;
+
     Debug_printf("Setting up BeckerPort: connecting to %s:%d\n", _host, _port);
 
     // Create connection socket
@@ -317,21 +312,6 @@ void BeckerPort::make_connection()
         return;
     }
 
-    // Remote address
-    if (_host[0] == '\0')
-    {
-        _ip = IPADDR_LOOPBACK;
-    }
-    else
-    {
-        _ip = get_ip4_addr_by_name(_host);
-        if (_ip == IPADDR_NONE)
-        {
-            Debug_println("BeckerPort: failed to resolve host name");
-            suspend(BECKER_SUSPEND_MS);
-            return;
-        }
-    }
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
@@ -434,6 +414,27 @@ void BeckerPort::suspend(int short_ms, int long_ms, int threshold)
     setState(BeckerSuspended::getInstance());
 }
 
+// Set _ip from _host without blocking the bus. False if the port is suspended,
+// briefly while the name is being resolved or for longer if it can't be
+bool BeckerPort::resolve_host()
+{
+    switch (get_ip4_addr_by_name_async(_host, &_ip))
+    {
+    case DNS_RESOLVED:
+        return true;
+    case DNS_PENDING:
+        // not an error, come back soon
+        _suspend_time = fnSystem.millis();
+        _suspend_period = BECKER_DNS_POLL_MS;
+        setState(BeckerSuspended::getInstance());
+        return false;
+    default:
+        Debug_println("BeckerPort: failed to resolve host name");
+        suspend(BECKER_SUSPEND_MS);
+        return false;
+    }
+}
+
 void BeckerPort::suspend_on_disconnect()
 {
     if (_listening && _listen_fd >=0)
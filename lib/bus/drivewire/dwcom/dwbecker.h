@@ -11,6 +11,7 @@
 #define BECKER_IOWAIT_MS        500
 #define BECKER_CONNECT_TMOUT    2000
 #define BECKER_SUSPEND_MS       5000
+#define BECKER_DNS_POLL_MS      100
 
 class BeckerPort;
 
@@ -113,6 +114,7 @@ protected:
 	bool accept_connection();
 
 	void suspend(int short_ms, int long_ms=0, int threshold=0);
+	bool resolve_host();
 	void suspend_on_disconnect();
 	bool resume();
 	bool suspend_period_expired();
@@ -568,6 +568,7 @@ bool IRAM_ATTR iwmBus::serviceDiskII()
       if (iwm_motor_state() == iwm_enable_state_t::on)
       {
         current_disk2 = diskii_xface.iwm_active_drive();
+        IWM_ACTIVE_DISK2->update_track();
         IWM_ACTIVE_DISK2->change_track(0); // copy current track in for this drive
         diskii_xface.start(diskii_xface.iwm_active_drive() - 1,
                            IWM_ACTIVE_DISK2->readonly); // start it up
@@ -586,11 +587,15 @@ bool IRAM_ATTR iwmBus::serviceDiskII()
     {
       current_disk2 = diskii_xface.iwm_active_drive();
       if (IWM_ACTIVE_DISK2->device_active) {
+        IWM_ACTIVE_DISK2->update_track();
         IWM_ACTIVE_DISK2->change_track(0); // copy current track in for this drive
         diskii_xface.start(diskii_xface.iwm_active_drive() - 1,
                            IWM_ACTIVE_DISK2->readonly); // start it up
       }
     }
+    // the ISR only switches between tracks in memory, read them here
+    if (diskii_xface.iwm_active_drive())
+      IWM_ACTIVE_DISK2->update_track();
     diskii_xface.d2_enable_seen |= diskii_xface.iwm_active_drive();
 #ifdef DEBUG
     new_track = IWM_ACTIVE_DISK2->get_track_pos();
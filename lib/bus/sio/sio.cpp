@@ -51,6 +51,7 @@ void virtualDevice::bus_to_computer(uint8_t *buf, uint16_t len, bool err)
     Debug_print("\n");
 #endif
 
+#ifdef ESP_PLATFORM
     // Write ERROR or COMPLETE status
     if (err == true)
         sio_error();
@@ -58,7 +59,6 @@ void virtualDevice::bus_to_computer(uint8_t *buf, uint16_t len, bool err)
         sio_complete();
 
     // Write data frame
-#ifdef ESP_PLATFORM
     UARTManager *uart = sio_get_bus().uart;
     uart->write(buf, len);
     // Write checksum
@@ -66,9 +66,15 @@ void virtualDevice::bus_to_computer(uint8_t *buf, uint16_t len, bool err)
 
     uart->flush();
 #else
-    fnSioCom.write(buf, len);
-    // Write checksum
-    fnSioCom.write(sio_checksum(buf, len));
+    // Write ERROR or COMPLETE status, data frame and checksum in one go,
+    // NetSIO sends them as single message
+    uint8_t status = err ? 'E' : 'C';
+    uint8_t ck = sio_checksum(buf, len);
+    SioIoVec frame[] = {{&status, 1}, {buf, len}, {&ck, 1}};
+
+    fnSystem.delay_microseconds(DELAY_T5);
+    fnSioCom.writev(frame, 3);
+    Debug_println(err ? "ERROR!" : "COMPLETE!");
 
     fnSioCom.flush();
 #endif
@@ -521,6 +527,10 @@ void systemBus::service()
         if (_netDev[i] != nullptr)
             _netDev[i]->sio_poll_interrupt();
     }
+
+    // Write cached disk sectors once the drives went quiet
+    for (int i = 0; i < MAX_DISK_DEVICES; i++)
+        _fujiDev->get_disks(i)->disk_dev.flush_idle();
 #ifndef ESP_PLATFORM
     // loop until all SIO "events" are processed
     //   true  = SIO port needs handling
@@ -662,6 +672,13 @@ virtualDevice *systemBus::deviceById(int device_id)
 // Give devices an opportunity to clean up before a reboot
 void systemBus::shutdown()
 {
+    // Write cached disk sectors while network file systems still accept requests
+    if (_fujiDev != nullptr)
+    {
+        for (int i = 0; i < MAX_DISK_DEVICES; i++)
+            _fujiDev->get_disks(i)->disk_dev.flush();
+    }
+
     shuttingDown = true;
 
     for (auto devicep : _daisyChain)
@@ -121,6 +121,12 @@ ssize_t SioCom::write(const char *str)
     return _sioPort->write((const uint8_t *)str, strlen(str));
 };
 
+// write several buffers at once
+ssize_t SioCom::writev(const SioIoVec *iov, int iovcnt)
+{
+    return _sioPort->writev(iov, iovcnt);
+}
+
 // print utility functions
 
 size_t SioCom::_print_number(unsigned long n, uint8_t base)
@@ -64,6 +64,8 @@ public:
     ssize_t write(const uint8_t *buffer, size_t size);
     // write C-string
     ssize_t write(const char *str);
+    // write several buffers at once
+    ssize_t writev(const SioIoVec *iov, int iovcnt);
 
     // print utility functions
     size_t print(const char *str);
@@ -85,7 +85,23 @@ void NetSioPort::begin(int baud)
     // Connect to hub
     //
 
+    // Resolve the hub name without blocking the bus
+    dns_status dns = get_ip4_addr_by_name_async(_host, &_ip);
+    if (dns == DNS_PENDING)
+    {
+        suspend(NETSIO_DNS_POLL_MS);
+        return;
+    }
+
     suspend_ms = _errcount < 5 ? 1000 : 5000;
+    if (dns == DNS_FAILED)
+    {
+        Debug_println("Failed to resolve NetSIO host name");
+        _errcount++;
+        suspend(suspend_ms);
+		return;
+    }
+
     Debug_printf("Setting up NetSIO (%s:%d)\n", _host, _port);
     _fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
 
@@ -98,15 +114,6 @@ void NetSioPort::begin(int baud)
 		return;
 	}
     
-    _ip = get_ip4_addr_by_name(_host);
-    if (_ip == IPADDR_NONE)
-    {
-        Debug_println("Failed to resolve NetSIO host name");
-        _errcount++;
-        suspend(suspend_ms);
-		return;
-    }
-
     // Set remote IP address (no real connection is created for UDP socket)
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
@@ -828,6 +835,54 @@ ssize_t NetSioPort::write(const uint8_t *buffer, size_t size)
     return txbytes;
 }
 
+/* Gather buffers into data block messages, typically the whole response to the
+   computer (status, data frame, checksum) fits into one message and one credit
+*/
+ssize_t NetSioPort::writev(const SioIoVec *iov, int iovcnt)
+{
+    int txbytes = 0;
+    size_t to_send = 0;
+    uint8_t txbuf[513];
+
+    if (!_initialized)
+        return 0;
+
+    // pending sync request is answered with the first byte written
+    if (_sync_request_num >= 0)
+        return SioPort::writev(iov, iovcnt);
+
+    auto send_block = [&]() -> bool {
+        if (!wait_for_credit(1))
+            return false;
+        txbuf[0] = NETSIO_DATA_BLOCK;
+        ssize_t result = write_sock(txbuf, to_send+1);
+        if (result <= 0)
+            return false;
+        txbytes += result-1;
+        to_send = 0;
+        return true;
+    };
+
+    for (int i = 0; i < iovcnt; i++)
+    {
+        size_t pos = 0;
+        while (pos < iov[i].size)
+        {
+            if (to_send == sizeof(txbuf)-1 && !send_block())
+                return txbytes;
+            size_t n = iov[i].size - pos;
+            if (n > sizeof(txbuf)-1 - to_send)
+                n = sizeof(txbuf)-1 - to_send;
+            memcpy(txbuf+1+to_send, iov[i].buffer+pos, n);
+            to_send += n;
+            pos += n;
+        }
+    }
+    if (to_send > 0)
+        send_block();
+    return txbytes;
+}
+
 // specific to NetSioPort
 void NetSioPort::set_host(const char *host, int port)
 {
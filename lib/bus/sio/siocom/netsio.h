@@ -5,6 +5,9 @@
 #include "sioport.h"
 #include "fnDNS.h"
 
+// Milliseconds between checks for the hub name to be resolved
+#define NETSIO_DNS_POLL_MS 100
+
 class NetSioPort : public SioPort
 {
 private:
@@ -87,6 +90,8 @@ public:
     virtual ssize_t write(uint8_t b) override;
     // write buffer
     virtual ssize_t write(const uint8_t *buffer, size_t size) override;
+    // write buffers as one data block message
+    virtual ssize_t writev(const SioIoVec *iov, int iovcnt) override;
 
     // specific to NetSioPort
     void set_host(const char *host, int port);
@@ -4,6 +4,21 @@
 
 #include "sioport.h"
 
+// Default is to write buffers one after the other
+ssize_t SioPort::writev(const SioIoVec *iov, int iovcnt)
+{
+    ssize_t txbytes = 0;
+    for (int i = 0; i < iovcnt; i++)
+    {
+        ssize_t result = write(iov[i].buffer, iov[i].size);
+        if (result > 0)
+            txbytes += result;
+        if (result < (ssize_t)iov[i].size)
+            break;
+    }
+    return txbytes;
+}
+
 #endif // BUILD_ATARI
 
 #endif // !ESP_PLATFORM
\ No newline at end of file
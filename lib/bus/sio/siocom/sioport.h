@@ -6,6 +6,13 @@
 
 # define SIOPORT_DEFAULT_BAUD   19200
 
+// Part of data written by SioPort::writev()
+struct SioIoVec
+{
+    const uint8_t *buffer;
+    size_t size;
+};
+
 /*
  * Abstraction of SIO port
  * provides interface to basic functionality and signals
@@ -37,6 +44,8 @@ public:
 
     virtual ssize_t write(uint8_t b) = 0; // write single byte
     virtual ssize_t write(const uint8_t *buffer, size_t size) = 0; // write buffer
+    // write several buffers, port may send them together (e.g. status, data frame and checksum)
+    virtual ssize_t writev(const SioIoVec *iov, int iovcnt);
 };
 
 #endif // SIOPORT_H
@@ -134,6 +134,8 @@ public:
     void store_general_status_wait_enabled(bool status_wait_enabled);
     void store_general_encrypt_passphrase(bool encrypt_passphrase);
     bool get_general_encrypt_passphrase();
+    bool get_general_disk_writeback() { return _general.disk_writeback; }
+    void store_general_disk_writeback(bool disk_writeback);
 
     const char * get_network_sntpserver() { return _network.sntpserver; };
 
@@ -460,6 +462,7 @@ private:
         bool fnconfig_spifs = true;
         bool status_wait_enabled = true;
         bool encrypt_passphrase = false;
+        bool disk_writeback = false;
 #ifdef BUILD_ADAM
         bool printer_enabled = false; // Not by default.
 #else
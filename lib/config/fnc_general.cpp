@@ -72,6 +72,15 @@ void fnConfig::store_general_status_wait_enabled(bool status_wait_enabled)
     _dirty = true;
 }
 
+void fnConfig::store_general_disk_writeback(bool disk_writeback)
+{
+    if (_general.disk_writeback == disk_writeback)
+        return;
+
+    _general.disk_writeback = disk_writeback;
+    _dirty = true;
+}
+
 void fnConfig::store_general_encrypt_passphrase(bool encrypt_passphrase)
 {
     if (_general.encrypt_passphrase == encrypt_passphrase)
@@ -241,6 +250,10 @@ void fnConfig::_read_section_general(std::stringstream &ss)
             {
                 _general.encrypt_passphrase = util_string_value_is_true(value);
             }
+            else if (strcasecmp(name.c_str(), "disk_writeback") == 0)
+            {
+                _general.disk_writeback = util_string_value_is_true(value);
+            }
         }
     }
 }
@@ -46,6 +46,7 @@ void fnConfig::save()
     ss << "status_wait_enabled=" << _general.status_wait_enabled << LINETERM;
     ss << "printer_enabled=" << _general.printer_enabled << LINETERM;
     ss << "encrypt_passphrase=" << _general.encrypt_passphrase << LINETERM;
+    ss << "disk_writeback=" << _general.disk_writeback << LINETERM;
 
     // ss << LINETERM;
 
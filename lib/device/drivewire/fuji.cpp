@@ -1617,6 +1617,37 @@ void drivewireFuji::hash_clear()
     errorCode = 1;
 }
 
+/*
+ Hash file on a host slot without sending it over the bus, data is added
+ like with HASH INPUT. Parameters: host slot, algorithm later passed to
+ HASH COMPUTE, 256 byte path
+*/
+void drivewireFuji::hash_file()
+{
+    Debug_printf("FUJI: HASH FILE\n");
+    char path[256];
+
+    uint8_t hostSlot = fnDwCom.read();
+    Hash::Algorithm alg = Hash::to_algorithm(fnDwCom.read());
+    fnDwCom.readBytes((uint8_t *)path, sizeof(path));
+    path[sizeof(path) - 1] = '\0';
+
+    errorCode = 144;
+    if (hostSlot >= MAX_HOSTS || !hasher.begin(alg))
+        return;
+
+    fujiHost &host = _fnHosts[hostSlot];
+    if (!host.mount())
+        return;
+    fnFile *f = host.fnfile_open(path, path, sizeof(path), FILE_READ);
+    if (f == nullptr)
+        return;
+
+    if (hasher.add_file(f))
+        errorCode = 1;
+    fnio::fclose(f);
+}
+
 // Initializes base settings and adds our devices to the DRIVEWIRE bus
 void drivewireFuji::setup(systemBus *drivewirebus)
 {
@@ -1833,6 +1864,9 @@ void drivewireFuji::process()
     case FUJICMD_HASH_CLEAR:
         hash_clear();
         break;
+    case FUJICMD_HASH_FILE:
+        hash_file();
+        break;
     case FUJICMD_SET_BOOT_MODE:
         set_boot_mode();
         break;
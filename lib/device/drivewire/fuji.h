@@ -166,6 +166,7 @@ protected:
     void hash_output();            // 0xC5
     void get_adapter_config_extended(); // 0xC4
     void hash_clear();             // 0xC2
+    void hash_file();              // 0xC0
 
     void send_error();             // 0x02
     void send_response();          // 0x01
@@ -11,6 +11,7 @@
 #include "fnTcpServer.h"
 #include "fnTcpClient.h"
 #include "modem-sniffer.h"
+#include "modemCommand.h"
 #include "libtelnet.h"
 #include "fnUART.h"
 
@@ -67,7 +68,6 @@
 #define HELPWIFICONNECTING "Connecting to "
 
 #define RING_INTERVAL 3000 // How often to print RING when having a new incoming connection (ms)
-#define MAX_CMD_LENGTH 256 // Maximum length for AT command
 
 #define ANSWER_TIMER_MS 1000 // milliseconds to wait before issuing CONNECT command, to simulate carrier negotiation.
 
@@ -76,72 +76,6 @@ class drivewireModem : public virtualDevice
 private:
     static constexpr int TX_BUF_SIZE = 256;
 
-#define RESULT_CODE_OK              0
-#define RESULT_CODE_CONNECT         1
-#define RESULT_CODE_RING            2
-#define RESULT_CODE_NO_CARRIER      3
-#define RESULT_CODE_ERROR           4
-#define RESULT_CODE_CONNECT_1200    5
-#define RESULT_CODE_BUSY            7
-#define RESULT_CODE_NO_ANSWER       8
-#define RESULT_CODE_CONNECT_2400    10
-#define RESULT_CODE_CONNECT_9600    13
-#define RESULT_CODE_CONNECT_4800    18
-#define RESULT_CODE_CONNECT_19200   85
-
-    /* The actual strings expected for these can be
-     * found in `modem.cpp`'s at_cmds[] array. */
-    enum _at_cmds
-    {
-        AT_AT = 0,
-        AT_NET0,
-        AT_NET1,
-        AT_A,
-        AT_IP,
-        AT_HELP,
-        AT_H,
-        AT_H1,
-        AT_DT,
-        AT_DP,
-        AT_DI,
-        AT_WIFILIST,
-        AT_WIFICONNECT,
-        AT_GET,
-        AT_PORT,
-        AT_V0,
-        AT_V1,
-        AT_ANDF_ignored,
-        AT_S0E0,
-        AT_S0E1,
-        AT_S2E43_ignored,
-        AT_S5E8_ignored,
-        AT_S6E2_ignored,
-        AT_S7E30_ignored,
-        AT_S12E20_ignored,
-        AT_E0,
-        AT_E1,
-        AT_M0_ignored,
-        AT_M1_ignored,
-        AT_X1_ignored,
-        AT_AC1_ignored,
-        AT_AD2_ignored,
-        AT_AW_ignored,
-        AT_OFFHOOK,
-        AT_ZPPP_ignored,
-        AT_BBSX_ignored,
-        AT_SNIFF,
-        AT_UNSNIFF,
-        AT_TERMVT52,
-        AT_TERMVT100,
-        AT_TERMDUMB,
-        AT_TERMANSI,
-        AT_CPM,
-        AT_PHONEBOOKLIST,
-        AT_PHONEBOOKCLR,
-        AT_PHONEBOOK,
-        AT_O,
-        AT_ENUMCOUNT};
-
     unsigned int modemBaud = 115200; // Holds modem baud rate, Default 300
     bool DTR = false;
     bool RTS = false;
@@ -156,25 +90,20 @@ private:
     bool firmware_sent = false;
 
     /* Modem Active Variables */
-    std::string cmd = "";          // Gather a new AT command to this string from serial
     bool cmdMode = true;           // Are we in AT command mode or connected mode
-    bool cmdAtascii = false;       // last CMD contained an ATASCII EOL?
     unsigned short listenPort = 0; // Listen to this if not connected. Set to zero to disable.
     fnTcpClient tcpClient;         // Modem client
     fnTcpServer tcpServer;         // Modem server
     unsigned long lastRingMs = 0;  // Time of last "RING" message (millis())
-    char plusCount = 0;            // Go to AT mode at "+++" sequence, that has to be counted
-    unsigned long plusTime = 0;    // When did we last receive a "+++" sequence
     uint8_t txBuf[TX_BUF_SIZE];
-    bool cmdOutput=true;            // toggle whether to emit command output
-    bool numericResultCode=false;   // Use numeric result codes? (ATV0)
     bool autoAnswer=false;          // Auto answer? (ATS0?)
-    bool commandEcho=true;          // Echo MODEM input. (ATEx)
     bool CRX=false;                 // CRX flag.
     uint8_t mdmStatus[2] = {0x00, 0x00}; // modem status value
     bool answerHack=false;          // ATA answer hack on SIO write.
     FileSystem *activeFS;           // Active Filesystem for ModemSniffer.
     ModemSniffer* modemSniffer;     // ptr to modem sniffer.
+    ModemPortBus<DwCom> modemBus{fnDwCom};  // Computer side of the modem.
+    ModemCommand atCmd{&modemBus, false}; // AT command line, result codes and "+++" escape.
     time_t _lasttime;               // most recent timestamp of data activity.
     telnet_t *telnet;               // telnet FSM state.
     bool use_telnet=false;          // Use telnet mode?
@@ -186,15 +115,6 @@ private:
     void crx_toggle(bool toggle);                // CRX active/inactive?
 
     void modemCommand(); // Execute modem AT command
-
-    // CR/EOL aware println() functions for AT mode
-    void at_connect_resultCode(int modemBaud);
-    void at_cmd_resultCode(int resultCode);
-    void at_cmd_println();
-    void at_cmd_println(const char *s, bool addEol = true);
-    void at_cmd_println(int i, bool addEol = true);
-    void at_cmd_println(std::string s, bool addEol = true);
-
     // Command handlers
     void at_handle_answer();
     void at_handle_dial();
@@ -103,124 +103,27 @@ H89Modem::~H89Modem()
         telnet_free(telnet);
     }
 }
-void H89Modem::at_connect_resultCode(int modemBaud)
-{
-    int resultCode = 0;
-    switch (modemBaud)
-    {
-    case 300:
-        resultCode = 1;
-        break;
-    case 1200:
-        resultCode = 5;
-        break;
-    case 2400:
-        resultCode = 10;
-        break;
-    case 4800:
-        resultCode = 18;
-        break;
-    case 9600:
-        resultCode = 13;
-        break;
-    case 19200:
-        resultCode = 85;
-        break;
-    default:
-        resultCode = 1;
-        break;
-    }
-    // H89_send_int(resultCode);
-    // fnUartBUS.write(ASCII_CR);
-}
-
-/**
- * Emit result code if ATV0
- * No Atascii translation here, as this is intended for machine reading.
- */
-void H89Modem::at_cmd_resultCode(int resultCode)
-{
-    // H89_send_int(resultCode);
-    // H89_send(ASCII_CR);
-    // H89_send(ASCII_LF);
-}
-
-/**
-   replacement println for AT that is CR/EOL aware
-*/
-void H89Modem::at_cmd_println()
-{
-    if (cmdOutput == false)
-        return;
-
-    // H89_send(ASCII_CR);
-    // H89_send(ASCII_LF);
-    // H89_flush();
-}
-
-void H89Modem::at_cmd_println(const char *s, bool addEol)
-{
-    // if (cmdOutput == false)
-    //     return;
-
-    // H89_send_string(s);
-    // if (addEol)
-    // {
-    //     H89_send(ASCII_CR);
-    //     H89_send(ASCII_LF);
-    // }
-    // H89_flush();
-}
-
-void H89Modem::at_cmd_println(int i, bool addEol)
-{
-    // if (cmdOutput == false)
-    //     return;
-
-    // H89_send_int(i);
-    // if (addEol)
-    // {
-    //     H89_send(ASCII_CR);
-    //     H89_send(ASCII_LF);
-    // }
-    // H89_flush();
-}
-
-void H89Modem::at_cmd_println(std::string s, bool addEol)
-{
-    // if (cmdOutput == false)
-    //     return;
-
-    // H89_send_string(s);
-    // if (addEol)
-    // {
-    //     H89_send(ASCII_CR);
-    //     H89_send(ASCII_LF);
-    // }
-    // H89_flush();
-}
-
 void H89Modem::at_handle_wificonnect()
 {
-    int keyIndex = cmd.find(',');
+    int keyIndex = atCmd.line.find(',');
     std::string ssid, key;
     if (keyIndex != std::string::npos)
     {
-        ssid = cmd.substr(13, keyIndex - 13 + 1);
+        ssid = atCmd.line.substr(13, keyIndex - 13 + 1);
         //key = cmd.substring(keyIndex + 1, cmd.length());
-        key = cmd.substr(keyIndex + 1);
+        key = atCmd.line.substr(keyIndex + 1);
     }
     else
     {
         //ssid = cmd.substring(6, cmd.length());
-        ssid = cmd.substr(6);
+        ssid = atCmd.line.substr(6);
         key = "";
     }
 
-    at_cmd_println(HELPWIFICONNECTING, false);
-    at_cmd_println(ssid, false);
-    at_cmd_println("/", false);
-    at_cmd_println(key);
+    atCmd.println(HELPWIFICONNECTING, false);
+    atCmd.println(ssid, false);
+    atCmd.println("/", false);
+    atCmd.println(key);
 
     fnWiFi.connect(ssid.c_str(), key.c_str());
 
@@ -229,42 +132,25 @@ void H89Modem::at_handle_wificonnect()
     {
         fnSystem.delay(1000);
         retries++;
-        at_cmd_println(".", false);
+        atCmd.println(".", false);
     }
     if (retries >= 20)
     {
-        if (numericResultCode == true)
-        {
-            at_cmd_resultCode(RESULT_CODE_ERROR);
-        }
-        else
-        {
-            at_cmd_println("ERROR");
-        }
+        atCmd.result(RESULT_CODE_ERROR);
     }
     else
     {
-        if (numericResultCode == true)
-        {
-            at_cmd_resultCode(RESULT_CODE_OK);
-        }
-        else
-        {
-            at_cmd_println("OK");
-        }
+        atCmd.result(RESULT_CODE_OK);
     }
 }
 
 void H89Modem::at_handle_port()
 {
     //int port = cmd.substring(6).toInt();
-    int port = std::stoi(cmd.substr(6));
+    int port = std::stoi(atCmd.line.substr(6));
     if (port > 65535 || port < 0)
     {
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_ERROR);
-        else
-            at_cmd_println("ERROR");
+        atCmd.result(RESULT_CODE_ERROR);
     }
     else
     {
@@ -277,10 +163,7 @@ void H89Modem::at_handle_port()
         listenPort = port;
         tcpServer.setMaxClients(1);
         tcpServer.begin(listenPort);
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
     }
 }
 
@@ -288,13 +171,13 @@ void H89Modem::at_handle_get()
 {
     // From the URL, acquire required variables
     // (12 = "ATGEThttp://")
-    int portIndex = cmd.find(':', 12); // Index where port number might begin
-    int pathIndex = cmd.find('/', 12); // Index first host name and possible port ends and path begins
+    int portIndex = atCmd.line.find(':', 12); // Index where port number might begin
+    int pathIndex = atCmd.line.find('/', 12); // Index first host name and possible port ends and path begins
     int port;
     std::string path, host;
     if (pathIndex < 0)
     {
-        pathIndex = cmd.length();
+        pathIndex = atCmd.line.length();
     }
     if (portIndex < 0)
     {
@@ -304,39 +187,27 @@ void H89Modem::at_handle_get()
     else
     {
         //port = cmd.substring(portIndex + 1, pathIndex).toInt();
-        port = std::stoi(cmd.substr(portIndex + 1, pathIndex - (portIndex + 1) + 1));
+        port = std::stoi(atCmd.line.substr(portIndex + 1, pathIndex - (portIndex + 1) + 1));
     }
     //host = cmd.substring(12, portIndex);
-    host = cmd.substr(12, portIndex - 12 + 1);
+    host = atCmd.line.substr(12, portIndex - 12 + 1);
     //path = cmd.substring(pathIndex, cmd.length());
-    path = cmd.substr(pathIndex);
+    path = atCmd.line.substr(pathIndex);
     if (path.empty())
         path = "/";
 
     // Establish connection
     if (!tcpClient.connect(host.c_str(), port))
     {
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_NO_CARRIER);
-        else
-            at_cmd_println("NO CARRIER");
+        atCmd.result(RESULT_CODE_NO_CARRIER);
         telnet_free(telnet);
         telnet = telnet_init(telopts, _telnet_event_handler, 0, this);
         CRX = false;
     }
     else
     {
-        if (numericResultCode == true)
-        {
-            at_connect_resultCode(modemBaud);
-            CRX = true;
-        }
-        else
-        {
-            at_cmd_println("CONNECT ", false);
-            at_cmd_println(modemBaud);
-            CRX = true;
-        }
+        atCmd.result_connect(modemBaud);
+        CRX = true;
 
         cmdMode = false;
 
@@ -352,72 +223,69 @@ void H89Modem::at_handle_get()
 
 void H89Modem::at_handle_help()
 {
-    at_cmd_println(HELPL01);
-    at_cmd_println(HELPL02);
-    at_cmd_println(HELPL03);
-    at_cmd_println(HELPL04);
-    at_cmd_println(HELPL05);
-    at_cmd_println(HELPL06);
-    at_cmd_println(HELPL07);
-    at_cmd_println(HELPL08);
-    at_cmd_println(HELPL09);
-    at_cmd_println(HELPL10);
-    at_cmd_println(HELPL11);
-    at_cmd_println(HELPL12);
-    at_cmd_println(HELPL13);
-    at_cmd_println(HELPL14);
-    at_cmd_println(HELPL15);
-    at_cmd_println(HELPL16);
-    at_cmd_println(HELPL17);
-    at_cmd_println(HELPL18);
-    at_cmd_println(HELPL19);
-    at_cmd_println(HELPL20);
-    at_cmd_println(HELPL21);
-    at_cmd_println(HELPL22);
-    at_cmd_println(HELPL23);
-    at_cmd_println(HELPL24);
-    at_cmd_println(HELPL25);
-    at_cmd_println(HELPL26);
-
-    at_cmd_println();
+    atCmd.println(HELPL01);
+    atCmd.println(HELPL02);
+    atCmd.println(HELPL03);
+    atCmd.println(HELPL04);
+    atCmd.println(HELPL05);
+    atCmd.println(HELPL06);
+    atCmd.println(HELPL07);
+    atCmd.println(HELPL08);
+    atCmd.println(HELPL09);
+    atCmd.println(HELPL10);
+    atCmd.println(HELPL11);
+    atCmd.println(HELPL12);
+    atCmd.println(HELPL13);
+    atCmd.println(HELPL14);
+    atCmd.println(HELPL15);
+    atCmd.println(HELPL16);
+    atCmd.println(HELPL17);
+    atCmd.println(HELPL18);
+    atCmd.println(HELPL19);
+    atCmd.println(HELPL20);
+    atCmd.println(HELPL21);
+    atCmd.println(HELPL22);
+    atCmd.println(HELPL23);
+    atCmd.println(HELPL24);
+    atCmd.println(HELPL25);
+    atCmd.println(HELPL26);
+
+    atCmd.println();
 
     if (listenPort > 0)
     {
-        at_cmd_println(HELPPORT1, false);
-        at_cmd_println(listenPort);
-        at_cmd_println(HELPPORT2);
-        at_cmd_println(HELPPORT3);
+        atCmd.println(HELPPORT1, false);
+        atCmd.println(listenPort);
+        atCmd.println(HELPPORT2);
+        atCmd.println(HELPPORT3);
     }
     else
     {
-        at_cmd_println(HELPPORT4);
+        atCmd.println(HELPPORT4);
     }
-    at_cmd_println();
+    atCmd.println();
 
-    if (numericResultCode == true)
-        at_cmd_resultCode(RESULT_CODE_OK);
-    else
-        at_cmd_println("OK");
+    atCmd.result(RESULT_CODE_OK);
 }
 
 void H89Modem::at_handle_wifilist()
 {
-    at_cmd_println();
-    at_cmd_println(HELPSCAN1);
+    atCmd.println();
+    atCmd.println(HELPSCAN1);
 
     int n = fnWiFi.scan_networks();
 
-    at_cmd_println();
+    atCmd.println();
 
     if (n == 0)
     {
-        at_cmd_println(HELPSCAN2);
+        atCmd.println(HELPSCAN2);
     }
     else
     {
-        at_cmd_println(n, false);
-        at_cmd_println(HELPSCAN3);
-        at_cmd_println();
+        atCmd.println(n, false);
+        atCmd.println(HELPSCAN3);
+        atCmd.println();
 
         char ssid[32];
         char bssid[18];
@@ -429,25 +297,22 @@ void H89Modem::at_handle_wifilist()
         {
             // Print SSID and RSSI for each network found
             fnWiFi.get_scan_result(i, ssid, &rssi, &channel, bssid, &encryption);
-            at_cmd_println(i + 1, false);
-            at_cmd_println(": ", false);
-            at_cmd_println(ssid, false);
-            at_cmd_println(" [", false);
-            at_cmd_println(channel, false);
-            at_cmd_println("/", false);
-            at_cmd_println(rssi, false);
-            at_cmd_println("]");
-            at_cmd_println("    ", false);
-            at_cmd_println(bssid, false);
-            at_cmd_println(encryption == WIFI_AUTH_OPEN ? HELPSCAN4 : HELPSCAN5);
+            atCmd.println(i + 1, false);
+            atCmd.println(": ", false);
+            atCmd.println(ssid, false);
+            atCmd.println(" [", false);
+            atCmd.println(channel, false);
+            atCmd.println("/", false);
+            atCmd.println(rssi, false);
+            atCmd.println("]");
+            atCmd.println("    ", false);
+            atCmd.println(bssid, false);
+            atCmd.println(encryption == WIFI_AUTH_OPEN ? HELPSCAN4 : HELPSCAN5);
         }
     }
-    at_cmd_println();
+    atCmd.println();
 
-    if (numericResultCode == true)
-        at_cmd_resultCode(RESULT_CODE_OK);
-    else
-        at_cmd_println("OK");
+    atCmd.result(RESULT_CODE_OK);
 }
 
 void H89Modem::at_handle_answer()
@@ -470,21 +335,9 @@ void H89Modem::at_handle_answer()
 
 void H89Modem::at_handle_dial()
 {
-    int portIndex = cmd.find(':');
     std::string host, port;
     std::string hostpb;
-    if (portIndex != std::string::npos)
-    {
-        host = cmd.substr(4, portIndex - 4);
-        port = cmd.substr(portIndex + 1);
-    }
-    else
-    {
-        host = cmd.substr(4);
-        port = "23"; // Telnet default
-    }
-
-    util_string_trim(host); // allow spaces or no spaces after AT command
+    atCmd.dial_address(&host, &port);
 
     Debug_printf("DIALING: %s\n", host.c_str());
 
@@ -509,15 +362,15 @@ void H89Modem::at_handle_dial()
         answerTimer = fnSystem.millis();
         // This is so macros in Bobterm can do the actual connect.
         fnSystem.delay(ANSWER_TIMER_MS);
-        at_cmd_println("CONNECT ", false);
-        at_cmd_println(modemBaud);
+        atCmd.println("CONNECT ", false);
+        atCmd.println(modemBaud);
     }
     else
     {
-        at_cmd_println("Connecting to ", false);
-        at_cmd_println(host, false);
-        at_cmd_println(":", false);
-        at_cmd_println(port);
+        atCmd.println("Connecting to ", false);
+        atCmd.println(host, false);
+        atCmd.println(":", false);
+        atCmd.println(port);
 
         int portInt = std::stoi(port);
 
@@ -530,10 +383,7 @@ void H89Modem::at_handle_dial()
         }
         else
         {
-            if (numericResultCode == true)
-                at_cmd_resultCode(RESULT_CODE_NO_CARRIER);
-            else
-                at_cmd_println("NO CARRIER");
+            atCmd.result(RESULT_CODE_NO_CARRIER);
             CRX = false;
             telnet_free(telnet);
             telnet = telnet_init(telopts, _telnet_event_handler, 0, this);
@@ -544,21 +394,18 @@ void H89Modem::at_handle_dial()
 /*Display current Phonebook*/
 void H89Modem::at_handle_pblist()
 {
-    at_cmd_println();
-    at_cmd_println("Phone#       Host");
+    atCmd.println();
+    atCmd.println("Phone#       Host");
     for (int i = 0; i < MAX_PB_SLOTS; ++i)
     {
         // Check if empty
         std::string pbEntry = Config.get_pb_entry(i);
         if (!pbEntry.empty())
-            at_cmd_println(pbEntry);
+            atCmd.println(pbEntry);
     }
-    at_cmd_println();
+    atCmd.println();
 
-    if (numericResultCode == true)
-        at_cmd_resultCode(RESULT_CODE_OK);
-    else
-        at_cmd_println("OK");
+    atCmd.result(RESULT_CODE_OK);
 }
 
 /*Add and del entry in the phonebook*/
@@ -568,66 +415,51 @@ void H89Modem::at_handle_pb()
     //or delete ex: atpb4321
     // ("ATPB" length 4)
     std::string phnumber, host, port;
-    int hostIndex = cmd.find('=');
-    int portIndex = cmd.find(':');
+    int hostIndex = atCmd.line.find('=');
+    int portIndex = atCmd.line.find(':');
 
     //Equal symbol found, so assume adding entry
     if (hostIndex != std::string::npos)
     {
-        phnumber = cmd.substr(4, hostIndex - 4);
+        phnumber = atCmd.line.substr(4, hostIndex - 4);
         //Check pure numbers entry
         if (phnumber.find_first_not_of("0123456789") == std::string::npos)
         {
             if (portIndex != std::string::npos)
             {
-                host = cmd.substr(hostIndex + 1, portIndex - hostIndex - 1);
-                port = cmd.substr(portIndex + 1);
+                host = atCmd.line.substr(hostIndex + 1, portIndex - hostIndex - 1);
+                port = atCmd.line.substr(portIndex + 1);
             }
             else
             {
-                host = cmd.substr(hostIndex + 1);
+                host = atCmd.line.substr(hostIndex + 1);
                 port = "23";
             }
             if (Config.add_pb_number(phnumber.c_str(), host.c_str(), port.c_str()))
             {
-                if (numericResultCode == true)
-                    at_cmd_resultCode(RESULT_CODE_OK);
-                else
-                    at_cmd_println("OK");
+                atCmd.result(RESULT_CODE_OK);
             }
             else
             {
-                if (numericResultCode == true)
-                    at_cmd_resultCode(RESULT_CODE_ERROR);
-                else
-                    at_cmd_println("ERROR");
+                atCmd.result(RESULT_CODE_ERROR);
             }
         }
         else
         {
-            if (numericResultCode == true)
-                at_cmd_resultCode(RESULT_CODE_ERROR);
-            else
-                at_cmd_println("ERROR");
+            atCmd.result(RESULT_CODE_ERROR);
         }
     }
     //No Equal symbol present, so Delete an entry
     else
     {
-        std::string phnumber = cmd.substr(4);
+        std::string phnumber = atCmd.line.substr(4);
         if (Config.del_pb_number(phnumber.c_str()))
         {
-            if (numericResultCode == true)
-                at_cmd_resultCode(RESULT_CODE_OK);
-            else
-                at_cmd_println("OK");
+            atCmd.result(RESULT_CODE_OK);
         }
         else
         {
-            if (numericResultCode == true)
-                at_cmd_resultCode(RESULT_CODE_ERROR);
-            else
-                at_cmd_println("ERROR");
+            atCmd.result(RESULT_CODE_ERROR);
         }
     }
 }
@@ -637,101 +469,15 @@ void H89Modem::at_handle_pb()
 */
 void H89Modem::modemCommand()
 {
-    /* Some of these are ignored; to see their meanings,
-     * review `modem.h`'s sioModem class's _at_cmds enums. */
-    static const char *at_cmds[_at_cmds::AT_ENUMCOUNT] =
-        {
-            "AT",
-            "ATNET0",
-            "ATNET1",
-            "ATA",
-            "ATIP",
-            "AT?",
-            "ATH",
-            "+++ATH",
-            "ATDT",
-            "ATDP",
-            "ATDI",
-            "ATWIFILIST",
-            "ATWIFICONNECT",
-            "ATGET",
-            "ATPORT",
-            "ATV0",
-            "ATV1",
-            "AT&F",
-            "ATS0=0",
-            "ATS0=1",
-            "ATS2=43",
-            "ATS5=8",
-            "ATS6=2",
-            "ATS7=30",
-            "ATS12=20",
-            "ATE0",
-            "ATE1",
-            "ATM0",
-            "ATM1",
-            "ATX1",
-            "AT&C1",
-            "AT&D2",
-            "AT&W",
-            "ATH2",
-            "+++ATZ",
-            "ATS2=128 X1 M0",
-            "AT+SNIFF",
-            "AT-SNIFF",
-            "AT+TERM=VT52",
-            "AT+TERM=VT100",
-            "AT+TERM=ANSI",
-            "AT+TERM=DUMB",
-            "ATCPM",
-            "ATPBLIST",
-            "ATPBCLEAR",
-            "ATPB",
-            "ATO"};
-
-    //cmd.trim();
-    util_string_trim(cmd);
-    if (cmd.empty())
+    int cmd_match = atCmd.parse();
+    if (cmd_match < 0)
         return;
 
-    std::string upperCaseCmd = cmd;
-    //upperCaseCmd.toUpperCase();
-    util_string_toupper(upperCaseCmd);
-
-    if (commandEcho == true)
-        at_cmd_println();
-
-    Debug_printf("AT Cmd: %s\n", upperCaseCmd.c_str());
-
-    // Replace EOL with CR
-    //if (upperCaseCmd.indexOf(ATASCII_EOL) != 0)
-    //    upperCaseCmd[upperCaseCmd.indexOf(ATASCII_EOL)] = ASCII_CR;
-    int eol1 = upperCaseCmd.find(ATASCII_EOL);
-    if (eol1 != std::string::npos)
-        upperCaseCmd[eol1] = ASCII_CR;
-
-    // Just AT
-    int cmd_match = AT_ENUMCOUNT;
-    if (upperCaseCmd.compare("AT") == 0)
-    {
-        cmd_match = AT_AT;
-    }
-    else
-    {
-        // Make sure we skip the plain AT command when matching
-        for (cmd_match = _at_cmds::AT_AT + 1; cmd_match < _at_cmds::AT_ENUMCOUNT; cmd_match++)
-            if (upperCaseCmd.compare(0, strlen(at_cmds[cmd_match]), at_cmds[cmd_match]) == 0)
-                break;
-    }
-
     switch (cmd_match)
     {
     // plain AT
     case AT_AT:
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_OFFHOOK: // Off hook, should be ignored.
     // hangup
@@ -742,10 +488,7 @@ void H89Modem::modemCommand()
             tcpClient.flush();
             tcpClient.stop();
             cmdMode = true;
-            if (numericResultCode == true)
-                at_cmd_resultCode(RESULT_CODE_NO_CARRIER);
-            else
-                at_cmd_println("NO CARRIER");
+            atCmd.result(RESULT_CODE_NO_CARRIER);
             telnet_free(telnet);
             telnet = telnet_init(telopts, _telnet_event_handler, 0, this);
 
@@ -759,10 +502,7 @@ void H89Modem::modemCommand()
         }
         else
         {
-            if (numericResultCode == true)
-                at_cmd_resultCode(RESULT_CODE_OK);
-            else
-                at_cmd_println("OK");
+            atCmd.result(RESULT_CODE_OK);
         }
         break;
     // dial to host
@@ -780,17 +520,11 @@ void H89Modem::modemCommand()
     // Change telnet mode
     case AT_NET0:
         use_telnet = false;
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_NET1:
         use_telnet = true;
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_A:
         at_handle_answer();
@@ -798,13 +532,10 @@ void H89Modem::modemCommand()
     // See my IP address
     case AT_IP:
         if (fnWiFi.connected())
-            at_cmd_println(fnSystem.Net.get_ip4_address_str());
+            atCmd.println(fnSystem.Net.get_ip4_address_str());
         else
-            at_cmd_println(HELPNOWIFI);
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+            atCmd.println(HELPNOWIFI);
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_HELP:
         at_handle_help();
@@ -816,40 +547,28 @@ void H89Modem::modemCommand()
         at_handle_port();
         break;
     case AT_V0:
-        at_cmd_resultCode(RESULT_CODE_OK);
-        numericResultCode = true;
+        atCmd.result(RESULT_CODE_OK);
+        atCmd.numeric = true;
         break;
     case AT_V1:
-        at_cmd_println("OK");
-        numericResultCode = false;
+        atCmd.println("OK");
+        atCmd.numeric = false;
         break;
     case AT_S0E0:
         autoAnswer = false;
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_S0E1:
         autoAnswer = true;
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_E0:
-        commandEcho = false;
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.echo = false;
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_E1:
-        commandEcho = true;
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.echo = true;
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_ANDF_ignored: // These are all ignored.
     case AT_S2E43_ignored:
@@ -865,52 +584,31 @@ void H89Modem::modemCommand()
     case AT_AW_ignored:
     case AT_ZPPP_ignored:
     case AT_BBSX_ignored:
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_SNIFF:
         get_modem_sniffer()->setEnable(true);
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_UNSNIFF:
         get_modem_sniffer()->setEnable(false);
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_TERMVT52:
         term_type = "VT52";
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_TERMVT100:
         term_type = "VT100";
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_TERMDUMB:
         term_type = "DUMB";
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_TERMANSI:
         term_type = "ANSI";
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_CPM:
         break;
@@ -922,46 +620,25 @@ void H89Modem::modemCommand()
         break;
     case AT_PHONEBOOKCLR:
         Config.clear_pb();
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_OK);
-        else
-            at_cmd_println("OK");
+        atCmd.result(RESULT_CODE_OK);
         break;
     case AT_O:
         if (tcpClient.connected())
         {
-            if (numericResultCode == true)
-            {
-                at_cmd_resultCode(modemBaud);
-            }
-            else
-            {
-                at_cmd_println("CONNECT ", false);
-                at_cmd_println(modemBaud);
-            }
+            atCmd.result_connect(modemBaud);
             cmdMode = false;
         }
         else
         {
-            if (numericResultCode == true)
-            {
-                at_cmd_resultCode(RESULT_CODE_OK);
-            }
-            else
-            {
-                at_cmd_println("OK");
-            }
+            atCmd.result(RESULT_CODE_OK);
         }
         break;
     default:
-        if (numericResultCode == true)
-            at_cmd_resultCode(RESULT_CODE_ERROR);
-        else
-            at_cmd_println("ERROR");
+        atCmd.result(RESULT_CODE_ERROR);
         break;
     }
 
-    cmd = "";
+    atCmd.line.clear();
 }
 
 /*
@@ -993,10 +670,10 @@ void H89Modem::modemCommand()
 //                 // Print RING every now and then while the new incoming connection exists
 //                 if ((fnSystem.millis() - lastRingMs) > RING_INTERVAL)
 //                 {
-//                     if (numericResultCode == true)
-//                         at_cmd_resultCode(RESULT_CODE_RING);
+//                     if (atCmd.numeric == true)
+//                         atCmd.result(RESULT_CODE_RING);
 //                     else
-//                         at_cmd_println("RING");
+//                         atCmd.println("RING");
 //                     lastRingMs = fnSystem.millis();
 //                 }
 //             }
@@ -1025,7 +702,7 @@ void H89Modem::modemCommand()
 //                     cmd.erase(len - 1);
 //                     // We don't assume that backspace is destructive
 //                     // Clear with a space
-//                     if (commandEcho == true)
+//                     if (atCmd.echo == true)
 //                     {
 //                         // H89_send(ASCII_BACKSPACE);
 //                         // H89_send(' ');
@@ -1037,7 +714,7 @@ void H89Modem::modemCommand()
 //             else if (chr == ATASCII_CLEAR_SCREEN ||
 //                      ((chr >= ATASCII_CURSOR_UP) && (chr <= ATASCII_CURSOR_RIGHT)))
 //             {
-//                 // if (commandEcho == true)
+//                 // if (atCmd.echo == true)
 //                 //     H89_send(chr);
 //             }
 //             else
@@ -1047,7 +724,7 @@ void H89Modem::modemCommand()
 //                     //cmd.concat(chr);
 //                     cmd += chr;
 //                 }
-//                 // if (commandEcho == true)
+//                 // if (atCmd.echo == true)
 //                 //     H89_send(chr);
 //             }
 //         }
@@ -1068,14 +745,14 @@ void H89Modem::modemCommand()
 //         {
 //             answered = true;
 //             answerTimer = 0;
-//             if (numericResultCode == true)
+//             if (atCmd.numeric == true)
 //             {
-//                 at_cmd_resultCode(modemBaud);
+//                 atCmd.result(modemBaud);
 //             }
 //             else
 //             {
-//                 at_cmd_println("CONNECT ", false);
-//                 at_cmd_println(modemBaud);
+//                 atCmd.println("CONNECT ", false);
+//                 atCmd.println(modemBaud);
 //             }
 //         }
 
@@ -1163,7 +840,7 @@ void H89Modem::modemCommand()
 //         {
 //             Debug_println("Going back to command mode");
 
-//             at_cmd_println("OK");
+//             atCmd.println("OK");
     
 //             cmdMode = true;
 
@@ -1177,10 +854,10 @@ void H89Modem::modemCommand()
 //         tcpClient.flush();
 //         tcpClient.stop();
 //         cmdMode = true;
-//         if (numericResultCode == true)
-//             at_cmd_resultCode(RESULT_CODE_NO_CARRIER);
+//         if (atCmd.numeric == true)
+//             atCmd.result(RESULT_CODE_NO_CARRIER);
 //         else
-//             at_cmd_println("NO CARRIER");
+//             atCmd.println("NO CARRIER");
 //         telnet_free(telnet);
 //         telnet = telnet_init(telopts, _telnet_event_handler, 0, this);
 //         CRX = false;
@@ -1195,10 +872,10 @@ void H89Modem::modemCommand()
 //         cmdMode = true;
 //         telnet_free(telnet);
 //         telnet = telnet_init(telopts, _telnet_event_handler, 0, this);
-//         if (numericResultCode == true)
-//             at_cmd_resultCode(RESULT_CODE_NO_CARRIER);
+//         if (atCmd.numeric == true)
+//             atCmd.result(RESULT_CODE_NO_CARRIER);
 //         else
-//             at_cmd_println("NO CARRIER");
+//             atCmd.println("NO CARRIER");
 //         telnet_free(telnet);
 //         telnet = telnet_init(telopts, _telnet_event_handler, 0, this);
 //         CRX = false;
@@ -78,6 +78,8 @@ mediatype_t iwmDisk2::mount_file(fnFile *f, uint32_t disksize, mediatype_t disk_
     }
 
     if (mt == MEDIATYPE_WOZ) {
+        prepared_pos = -1;
+        update_track();
         change_track(0); // initialize spi buffer
     } else {
         Debug_printf("\nMedia Type UNKNOWN - no mount in disk2.cpp");
@@ -141,10 +143,13 @@ void IRAM_ATTR iwmDisk2::change_track(int indicator)
 
 #ifndef DEV_RELAY_SLIP
   // need to tell diskii_xface the number of bits in the track
-  // and where the track data is located so it can convert it
-  if (((MediaTypeWOZ *)_disk)->trackmap(track_pos) != 255)
+  // and where the track data is located so it can convert it.
+  // Only tracks already in memory are used here, this runs in the ISR;
+  // update_track() loads a missing one and copies it in afterwards
+  ((MediaTypeWOZ *)_disk)->lock_tracks();
+  TRK_bitstream *bitstream = ((MediaTypeWOZ *)_disk)->get_track(track_pos);
+  if (bitstream != nullptr)
   {
-    TRK_bitstream *bitstream = ((MediaTypeWOZ *)_disk)->get_track(track_pos);
     diskii_xface.copy_track(
         bitstream->data,
         bitstream->len_bytes,
@@ -159,10 +164,27 @@ void IRAM_ATTR iwmDisk2::change_track(int indicator)
         BLANK_TRACK_LEN, 
         BLANK_TRACK_LEN * 8, 
         NS_PER_BIT_TIME * ((MediaTypeWOZ *)_disk)->optimal_bit_timing);
+  ((MediaTypeWOZ *)_disk)->unlock_tracks();
 #endif // !SLIP
   // Since the empty track has no data, and therefore no length, using a fake length of 51,200 bits (6400 bytes) works very well.
 }
 
+// Task context: read the tracks around the head from the image when it has
+// moved, and copy the current one in if change_track() had to go without it
+void iwmDisk2::update_track()
+{
+  if (!device_active)
+    return;
+
+  int pos = track_pos;
+  if (pos == prepared_pos)
+    return;
+  prepared_pos = pos;
+
+  if (((MediaTypeWOZ *)_disk)->prepare_tracks(pos))
+    change_track(0);
+}
+
 bool iwmDisk2::write_sector(int track, int sector, uint8_t* buffer)
 {
   return _disk->write_sector(track, sector, buffer);
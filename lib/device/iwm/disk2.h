@@ -24,6 +24,7 @@ protected:
     char disk_num;
     int track_pos;
     int old_pos;
+    int prepared_pos = -1;
     uint8_t oldphases;
 
 public:
@@ -36,6 +37,7 @@ public:
     bool phases_valid(uint8_t phases);
     bool move_head();
     void change_track(int indicator);
+    void update_track();
     // void set_disk_number(char c) { disk_num = c; }
     // char get_disk_number() { return disk_num; };
 
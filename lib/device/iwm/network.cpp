@@ -586,8 +586,8 @@ bool iwmNetwork::read_channel_json(unsigned short num_bytes, iwm_decoded_cmd_t c
     }
     else if (num_bytes > current_network_data.json->json_bytes_remaining)
     {
-        data_len = current_network_data.json->readValueLen();
-        current_network_data.json->readValue(data_buffer, data_len);
+        data_len = current_network_data.json->readValueRemaining();
+        current_network_data.json->readValueNext(data_buffer, data_len);
         current_network_data.json->json_bytes_remaining -= data_len;
 
         // Debug_printf("read_channel_json(1) - data_len: %02x, json_bytes_remaining: %02x\n", data_len, current_network_data.json->json_bytes_remaining);
@@ -603,8 +603,8 @@ bool iwmNetwork::read_channel_json(unsigned short num_bytes, iwm_decoded_cmd_t c
     {
         current_network_data.json->json_bytes_remaining -= num_bytes;
 
-        current_network_data.json->readValue(data_buffer, num_bytes);
-        data_len = current_network_data.json->readValueLen();
+        data_len = num_bytes;
+        current_network_data.json->readValueNext(data_buffer, data_len);
 
         // Debug_printf("read_channel_json(2) - data_len: %02x, json_bytes_remaining: %02x\n", num_bytes, current_network_data.json->json_bytes_remaining);
         // int print_len = num_bytes;
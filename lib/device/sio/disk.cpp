@@ -8,6 +8,7 @@
 #include "../../include/debug.h"
 
 #include "fuji.h"
+#include "fnConfig.h"
 #include "utils.h"
 
 #define SIO_DISKCMD_FORMAT 0x21
@@ -272,6 +273,7 @@ mediatype_t sioDisk::mount(fnFile *f, const char *filename, uint32_t disksize, m
             _disk->_disk_host = host;
             strcpy(_disk->_disk_filename, filename);
         }
+        _disk->set_writeback(Config.get_general_disk_writeback());
         return _disk->mount(f, disksize);
     }
 }
@@ -302,6 +304,20 @@ void sioDisk::unmount()
     }
 }
 
+bool sioDisk::flush()
+{
+    if (_disk != nullptr)
+        return _disk->flush();
+    return false;
+}
+
+// Called from bus service loop
+void sioDisk::flush_idle()
+{
+    if (_disk != nullptr)
+        _disk->flush_idle();
+}
+
 // Create blank disk
 bool sioDisk::write_blank(fnFile *f, uint16_t sectorSize, uint16_t numSectors)
 {
@@ -26,6 +26,9 @@ public:
     fujiHost *host;
     mediatype_t mount(fnFile *f, const char *filename, uint32_t disksize, mediatype_t disk_type = MEDIATYPE_UNKNOWN);
     void unmount();
+    // Write sectors held in the write-back cache, returns TRUE on error
+    bool flush();
+    void flush_idle();
     bool write_blank(fnFile *f, uint16_t sectorSize, uint16_t numSectors);
 
     mediatype_t disktype() { return _disk == nullptr ? MEDIATYPE_UNKNOWN : _disk->_disktype; };
@@ -1021,9 +1021,13 @@ int sioFuji::sio_disk_image_umount(bool siomode, int slot)
 
     Debug_printf("Fuji cmd: UNMOUNT IMAGE 0x%02X\n", deviceSlot);
 
+    bool flush_err = false;
+
     // Handle disk slots
     if (deviceSlot < MAX_DISK_DEVICES)
     {
+        // Sectors still in the write-back cache are lost if this fails
+        flush_err = _fnDisks[deviceSlot].disk_dev.flush();
         _fnDisks[deviceSlot].disk_dev.unmount();
         if (_fnDisks[deviceSlot].disk_type == MEDIATYPE_CAS || _fnDisks[deviceSlot].disk_type == MEDIATYPE_WAV)
         {
@@ -1046,13 +1050,18 @@ int sioFuji::sio_disk_image_umount(bool siomode, int slot)
         return;
     }
 
-    sio_complete();
+    if (flush_err)
+        sio_error();
+    else
+        sio_complete();
 #else
     else
     {
         return _on_error(siomode);
     }
 
+    if (flush_err)
+        return _on_error(siomode);
     return _on_ok(siomode);
 #endif
 }
@@ -1075,6 +1084,10 @@ void sioFuji::image_rotate()
     {
         count--;
 
+        // Write pending sectors before the images change drives
+        for (int n = 0; n <= count; n++)
+            _fnDisks[n].disk_dev.flush();
+
         // Save the device ID of the disk in the last slot
         int last_id = _fnDisks[count].disk_dev.id();
 
@@ -2560,6 +2573,53 @@ void sioFuji::sio_hash_clear()
     sio_complete();
 }
 
+/*
+ Hash file on a host slot without sending it over SIO, data is added
+ like with HASH INPUT. aux1 = host slot (1-8), aux2 = algorithm later
+ passed to HASH COMPUTE, data frame = path
+*/
+void sioFuji::sio_hash_file()
+{
+    Debug_printf("FUJI: HASH FILE\n");
+    char path[256];
+
+    uint8_t ck = bus_to_peripheral((uint8_t *)path, sizeof(path));
+    if (ck != sio_checksum((uint8_t *)path, sizeof(path)) || cmdFrame.aux1 < 1 || cmdFrame.aux1 > MAX_HOSTS)
+    {
+        sio_error();
+        return;
+    }
+    path[sizeof(path) - 1] = '\0';
+
+    // Hash the file as it is read instead of keeping it
+    if (!hasher.begin(Hash::to_algorithm(cmdFrame.aux2)))
+    {
+        sio_error();
+        return;
+    }
+
+    fujiHost &host = _fnHosts[cmdFrame.aux1 - 1];
+    if (!host.mount())
+    {
+        sio_error();
+        return;
+    }
+    fnFile *f = host.fnfile_open(path, path, sizeof(path), FILE_READ);
+    if (f == nullptr)
+    {
+        sio_error();
+        return;
+    }
+
+    bool ok = hasher.add_file(f);
+    fnio::fclose(f);
+
+    if (ok)
+        sio_complete();
+    else
+        sio_error();
+}
+
 void sioFuji::sio_process(uint32_t commanddata, uint8_t checksum)
 {
     cmdFrame.commanddata = commanddata;
@@ -2805,6 +2865,10 @@ void sioFuji::sio_process(uint32_t commanddata, uint8_t checksum)
         sio_ack();
         sio_hash_clear();
         break;
+    case FUJICMD_HASH_FILE:
+        sio_late_ack();
+        sio_hash_file();
+        break;
     case FUJICMD_RANDOM_NUMBER:
         sio_ack();
         sio_random_number();
@@ -178,6 +178,7 @@ protected:
     void sio_hash_output();            // 0xC5
     void sio_get_adapter_config_extended(); // 0xC4
     void sio_hash_clear();             // 0xC2
+    void sio_hash_file();              // 0xC0
     void sio_qrcode_input();           // 0xBC
     void sio_qrcode_encode();          // 0xBD
     void sio_qrcode_length();          // OxBE
@@ -1236,6 +1236,7 @@ void sioNetwork::sio_set_json_parameters()
     // aux1  | aux2    |    meaning
     // 0     | 0/1/2   |  Set the json->_queryParam value, which is the translation value for string processing
     // 1     |   c     |  Set the json->lineEnding = c, convert from char to single byte string
+    // 2     |  0/1    |  1: next parse keeps only the subtree of the current query, 0: keep whole document
 
     switch (cmdFrame.aux1)
     {
@@ -1258,6 +1259,16 @@ void sioNetwork::sio_set_json_parameters()
         sio_complete();
         break;
     }
+    case 2:     // PARSE FILTER
+        if (cmdFrame.aux2 > 1)
+        {
+            sio_error();
+            return;
+        }
+        // Query is sent before parse, so large documents don't have to fit in memory
+        json->setParseFilter(cmdFrame.aux2 ? json->getReadQuery() : "");
+        sio_complete();
+        break;
     default:
         sio_error();
         break;
@@ -19,6 +19,9 @@
 #include <sys/time.h>
 #include <utime.h>
 
+#include <string>
+#include <vector>
+
 #include "compat_dirent.h"
 
 #include "modem.h"
@@ -27,6 +30,7 @@
 #include "fnSystem.h"
 
 #include "pclink.h"
+#include "pclinkDir.h"
 
 #include "../../include/debug.h"
 
@@ -35,18 +39,6 @@
 #define mkdir(A, B) _mkdir(A)
 #endif
 
-# ifndef uchar
-#  define uchar unsigned char
-# endif
-
-# ifndef ushort
-#  define ushort unsigned short
-# endif
-
-# ifndef ulong
-#  define ulong unsigned long
-# endif
-
 # define SIOTRACE
 
 # ifdef SIOTRACE
@@ -55,16 +47,6 @@ static int log_flag = 0;		/* enable more SIO messages, if 1 */
 
 # define SDX_MAXLEN 16777215L
 
-/* SDX required attribute mask */
-# define RA_PROTECT	0x01
-# define RA_HIDDEN	0x02
-# define RA_ARCHIVED	0x04
-# define RA_SUBDIR	0x08
-# define RA_NO_PROTECT	0x10
-# define RA_NO_HIDDEN	0x20
-# define RA_NO_ARCHIVED	0x40
-# define RA_NO_SUBDIR	0x80
-
 /* SDX set attribute mask */
 # define SA_PROTECT	0x01
 # define SA_UNPROTECT	0x10
@@ -158,9 +140,6 @@ static struct
 	uchar dirbuf[23];
 } pcl_dbf;
 
-//static ulong upper_dir = UPPER_DIR;
-static ulong upper_dir = 0;
-
 static DEVICE device[16];	/* one PCLINK device with 16 units */
 
 #  define COM_COMD 0
@@ -214,283 +193,6 @@ unix_time_2_sdx(time_t *todp, uchar *ob)
 	ob[5] = t->tm_sec;
 }
 
-static long
-dos_2_allowed(uchar c)
-{
-//# ifndef __CYGWIN__
-#if 1
-	if (upper_dir)
-		return (isupper(c) || isdigit(c) || (c == '_') || (c == '@'));
-
-	return (islower(c) || isdigit(c) || (c == '_') || (c == '@'));
-# else
-	return (isalpha(c) || isdigit(c) || (c == '_') || (c == '@'));
-# endif
-}
-
-static long
-dos_2_term(uchar c)
-{
-	return ((c == 0) || (c == 0x20));
-}
-
-static long
-validate_fn(uchar *name, int len)
-{
-	int x;
-
-	for (x = 0; x < len; x++)
-	{
-		if (dos_2_term(name[x]))
-			return (x != 0);
-		if (name[x] == '.')
-			return 1;
-		if (!dos_2_allowed(name[x]))
-			return 0;
-	}
-
-	return 1;
-}
-
-static void
-ugefina(char *src, char *out)
-{
-	char *dot;
-	ushort i;
-
-	memset(out, 0x20, 8+3);
-
-	dot = strchr(src, '.');
-
-	if (dot)
-	{
-		i = 1;
-		while (dot[i] && (i < 4))
-		{
-			out[i+7] = toupper((uchar)dot[i]);
-			i++;
-		}
-	}
-
-	i = 0;
-	while ((src[i] != '.') && !dos_2_term(src[i]) && (i < 8))
-	{
-		out[i] = toupper((uchar)src[i]);
-		i++;
-	}
-}
-
-static void
-uexpand(uchar *rawname, char *name83)
-{
-	ushort x, y;
-	uchar t;
-
-	name83[0] = 0;
-
-	for (x = 0; x < 8; x++)
-	{
-		t = rawname[x];
-		if (t && (t != 0x20))
-			name83[x] = upper_dir ? toupper(t) : tolower(t);
-		else
-			break;
-	}
-
-	y = 8;
-
-	if (rawname[y] && (rawname[y] != 0x20))
-	{
-		name83[x] = '.';
-		x++;
-
-		while ((y < 11) && rawname[y] && (rawname[y] != 0x20))
-		{
-			name83[x] = upper_dir ? toupper(rawname[y]) : tolower(rawname[y]);
-			x++;
-			y++;
-		}
-	}
-
-	name83[x] = 0;
-}
-
-static int
-match_dos_names(char *name, char *mask, uchar fatr1, struct stat *sb)
-{
-	ushort i;
-
-	if (log_flag)
-	{
-		Debug_printf("match: %c%c%c%c%c%c%c%c%c%c%c with %c%c%c%c%c%c%c%c%c%c%c: ",
-		name[0], name[1], name[2], name[3], name[4], name[5], name[6], name[7], \
-		name[8], name[9], name[10], \
-		mask[0], mask[1], mask[2], mask[3], mask[4], mask[5], mask[6], mask[7], \
-		mask[8], mask[9], mask[10]);
-	}
-
-	for (i = 0; i < 11; i++)
-	{
-		if (mask[i] != '?')
-			if (toupper((uchar)name[i]) != toupper((uchar)mask[i]))
-			{
-				if (log_flag)
-					Debug_printf("no match\n");
-				return 1;
-			}
-	}
-
-	/* There are no such attributes in Unix */
-	fatr1 &= ~(RA_NO_HIDDEN|RA_NO_ARCHIVED);
-
-	/* Now check the attributes */
-	if (fatr1 & (RA_HIDDEN | RA_ARCHIVED))
-	{
-		if (log_flag)
-			Debug_printf("atr mismatch: not HIDDEN or ARCHIVED\n");
-		return 1;
-	}
-
-	if (fatr1 & RA_PROTECT)
-	{
-		if (sb->st_mode & (S_IWUSR|S_IWGRP))
-		{
-			if (log_flag)
-				Debug_printf("atr mismatch: not PROTECTED\n");
-
-			return 1;
-		}
-	}
-
-	if (fatr1 & RA_NO_PROTECT)
-	{
-		if ((sb->st_mode & (S_IWUSR|S_IWGRP)) == 0)
-		{
-			if (log_flag)
-				Debug_printf("atr mismatch: not UNPROTECTED\n");
-
-			return 1;
-		}
-	}
-
-	if (fatr1 & RA_SUBDIR)
-	{
-		if (!S_ISDIR(sb->st_mode))
-		{
-			if (log_flag)
-				Debug_printf("atr mismatch: not SUBDIR\n");
-
-			return 1;
-		}
-	}
-
-	if (fatr1 & RA_NO_SUBDIR)
-	{
-		if (S_ISDIR(sb->st_mode))
-		{
-			if (log_flag)
-				Debug_printf("atr mismatch: not FILE\n");
-
-			return 1;
-		}
-	}
-
-	if (log_flag)
-		Debug_printf("match\n");
-
-	return 0;
-}
-
-static int
-validate_dos_name(char *fname)
-{
-	char *dot = strchr(fname, '.');
-	long valid_fn, valid_xx;
-			
-	if ((dot == NULL) && (strlen(fname) > 8))
-		return 1;
-	if (dot)
-	{
-		long dd = strlen(dot);
-
-		if (dd > 4)
-			return 1;
-		if ((dot - fname) > 8)
-			return 1;
-		if ((dot == fname) && (dd == 1))
-			return 1;
-		if ((dd == 2) && (dot[1] == '.'))
-			return 1;
-		if ((dd == 3) && ((dot[1] == '.') || (dot[2] == '.')))
-			return 1;
-		if ((dd == 4) && ((dot[1] == '.') || (dot[2] == '.') || (dot[3] == '.')))
-			return 1;
-	}
-
-	valid_fn = validate_fn((uchar *)fname, 8);
-	if (dot != NULL)
-		valid_xx = validate_fn((uchar *)(dot + 1), 3);
-	else
-		valid_xx = 1;
-
-	if (!valid_fn || !valid_xx)
-		return 1;
-
-	return 0;
-}
-
-static int
-check_dos_name(char *newpath, struct dirent *dp, struct stat *sb)
-{
-	char temp_fspec[1024], fname[256];
-
-	strcpy(fname, dp->d_name);
-
-	if (log_flag)
-		Debug_printf("%s: got fname '%s'\n", __func__, fname); 
-
-	if (validate_dos_name(fname))
-		return 1;
-
-	/* stat() the file (fetches the length) */
-	sprintf(temp_fspec, "%s/%s", newpath, fname);
-
-	if (log_flag)
-		Debug_printf("%s: stat '%s'\n", __func__, temp_fspec);
-
-	if (stat(temp_fspec, sb))
-	{
-		Debug_printf("cannot stat '%s'\n", temp_fspec);
-		return 1;
-	}
-
-	if (!S_ISREG(sb->st_mode) && !S_ISDIR(sb->st_mode))
-	{
-		Debug_printf("'%s' is not regular file nor directory\n", temp_fspec);
-		return 1;
-	}
-
-	/*if (sb->st_uid != our_uid)
-	{
-		Debug_printf("'%s' wrong uid\n", temp_fspec);
-		return 1;
-	}*/
-
-	if ((sb->st_mode & S_IRUSR) == 0)
-	{
-		Debug_printf("'%s' is unreadable\n", temp_fspec);
-		return 1;
-	}
-
-	if (S_ISDIR(sb->st_mode) && ((sb->st_mode & S_IXUSR) == 0))
-	{
-		Debug_printf("dir '%s' is unbrowseable\n", temp_fspec);
-		return 1;
-	}
-
-	return 0;
-}
-
 static void
 fps_close(int i)
 {
@@ -533,21 +235,14 @@ static ulong
 get_file_len(uchar handle)
 {
 	ulong filelen;
-	struct dirent *dp;
-	struct stat sb;
 
 	if (iodesc[handle].fpmode & 0x10)	/* directory */
 	{
-		rewinddir(iodesc[handle].fps.dir);
-		filelen = sizeof(DIRENTRY);
+		DIRINDEX *di = dir_index_get(iodesc[handle].pathname);
 
-		while ((dp = readdir(iodesc[handle].fps.dir)) != NULL)
-		{
-			if (check_dos_name(iodesc[handle].pathname, dp, &sb))
-				continue;
-			filelen += sizeof(DIRENTRY);
-		}
-		rewinddir(iodesc[handle].fps.dir);
+		filelen = sizeof(DIRENTRY);
+		if (di != NULL)
+			filelen += di->entries.size() * sizeof(DIRENTRY);
 	}
 	else
 		filelen = iodesc[handle].fpstat.st_size;
@@ -566,8 +261,7 @@ cache_dir(uchar handle)
 	ushort node;
 	ulong dlen, flen, sl, dirlen = iodesc[handle].fpstat.st_size;
 	DIRENTRY *dbuf, *dir;
-	struct dirent *dp;
-	struct stat sb;
+	DIRINDEX *di;
 
 	if (iodesc[handle].dir_cache != NULL)
 	{
@@ -620,20 +314,24 @@ cache_dir(uchar handle)
 
 	node = 1;
 
-	while ((dp = readdir(iodesc[handle].fps.dir)) != NULL)
+	di = dir_index_get(iodesc[handle].pathname);
+	if (di == NULL)
+		return dbuf;
+
+	for (const DIRINDEX_ENTRY &e : di->entries)
 	{
 		ushort map;
 
-		if (check_dos_name(iodesc[handle].pathname, dp, &sb))
-			continue;
+		if (flen >= dirlen)
+			break;
 
-		dlen = sb.st_size;
+		dlen = e.size;
 		if (dlen > SDX_MAXLEN)
 			dlen = SDX_MAXLEN;
 
-		dir->status = (sb.st_mode & (S_IWUSR|S_IWGRP)) ? 0x08 : 0x09;
+		dir->status = (e.mode & (S_IWUSR|S_IWGRP)) ? 0x08 : 0x09;
 
-		if (S_ISDIR(sb.st_mode))
+		if (S_ISDIR(e.mode))
 		{
 			dir->status |= 0x20;		/* directory */
 			dlen = sizeof(DIRENTRY);
@@ -648,16 +346,14 @@ cache_dir(uchar handle)
 		dir->len_m = (dlen & 0x0000ff00L) >> 8;
 		dir->len_h = (dlen & 0x00ff0000L) >> 16;
 
-		ugefina(dp->d_name, (char *)dir->fname);
+		memcpy(dir->fname, e.raw_name, sizeof(dir->fname));
 
-		unix_time_2_sdx(&sb.st_mtime, dir->stamp);
+		time_t mtime = e.mtime;
+		unix_time_2_sdx(&mtime, dir->stamp);
 
 		node++;
 		dir++;
 		flen += sizeof(DIRENTRY);
-
-		if (flen >= dirlen)
-			break;
 	}
 
 	return dbuf;
@@ -911,7 +607,6 @@ do_pclink(uchar devno, uchar ccom, uchar caux1, uchar caux2)
 	ushort cunit = caux2 & 0x0f, parsize;
 	ulong faux;
 	struct stat sb;
-	struct dirent *dp;
 	static uchar old_ccom = 0;
 
 	if (caux2 & 0xf0)	/* protocol version number must be 0 */
@@ -1368,7 +1063,7 @@ do_pclink(uchar devno, uchar ccom, uchar caux1, uchar caux2)
 					else
 						ts.st_mode |= S_IFREG;
 
-					match = !match_dos_names((char *)pcl_dbf.dirbuf+6, iodesc[handle].fpname, iodesc[handle].fatr1, &ts);
+					match = !match_dos_names((char *)pcl_dbf.dirbuf+6, iodesc[handle].fpname, iodesc[handle].fatr1, ts.st_mode);
 				}
 
 			} while (!eof_flg && !match);
@@ -1451,6 +1146,9 @@ do_pclink(uchar devno, uchar ccom, uchar caux1, uchar caux2)
 
             utime(pathname,&ub);
 		}
+
+		if (fpmode & 0x08)
+			dir_index_invalidate_parent(pathname);
 		goto complete;
 	}
 
@@ -1571,29 +1269,41 @@ do_pclink(uchar devno, uchar ccom, uchar caux1, uchar caux2)
 			}
 			else
 			{
-				while ((dp = readdir(dh)) != NULL)
+				DIRINDEX *di = dir_index_get(newpath);
+				const DIRINDEX_ENTRY *found = NULL;
+
+				if (di != NULL)
 				{
-					if (check_dos_name(newpath, dp, &sb))
-						continue;
-		
-					/* convert 8+3 to NNNNNNNNXXX */
-					ugefina(dp->d_name, raw_name);
-
-					/* match */
-					if (match_dos_names(raw_name, \
-						(char *)device[cunit].parbuf.name, \
-							device[cunit].parbuf.fatr1, &sb) == 0)
-						break;
+					for (const DIRINDEX_ENTRY &e : di->entries)
+					{
+						/* match */
+						if (match_dos_names((char *)e.raw_name, \
+							(char *)device[cunit].parbuf.name, \
+								device[cunit].parbuf.fatr1, e.mode) == 0)
+						{
+							found = &e;
+							break;
+						}
+					}
 				}
 
 				sl = strlen(newpath);
 				if (sl && (newpath[sl-1] != '/'))
 					strcat(newpath, "/");
 
-				if (dp)
+				if (found)
 				{
-					strcat(newpath, dp->d_name);
-					ugefina(dp->d_name, raw_name);
+					strcat(newpath, found->fname.c_str());
+					memcpy(raw_name, found->raw_name, sizeof(raw_name));
+
+					/* the index may be a few seconds old, get the current length */
+					if (stat(newpath, &sb) < 0)
+					{
+						memset(&sb, 0, sizeof(struct stat));
+						sb.st_mode = found->mode;
+						sb.st_size = found->size;
+						sb.st_mtime = found->mtime;
+					}
 					if ((device[cunit].parbuf.fmode & 0x0c) == 0x08)
 						sb.st_mtime = timestamp2mtime(&device[cunit].parbuf.f1);
 				}
@@ -1604,7 +1314,6 @@ do_pclink(uchar devno, uchar ccom, uchar caux1, uchar caux2)
 						Debug_printf("FOPEN: file not found\n");
 						device[cunit].status.err = 170;
 						closedir(dh);
-						dp = NULL;
 						goto complete_fopen;
 					}
 					else
@@ -1687,8 +1396,10 @@ do_pclink(uchar devno, uchar ccom, uchar caux1, uchar caux2)
 				else if ((device[cunit].parbuf.fmode & 0x0d) == 0x0c)
 					iodesc[i].fps.file = fopen(newpath, "r+");
 
+				if (device[cunit].parbuf.fmode & 0x08)
+					dir_index_invalidate_parent(newpath);
+
 				closedir(dh);
-				dp = NULL;
 			}
 
 			if (iodesc[i].fps.file == NULL)
@@ -1818,7 +1529,7 @@ complete_fopen:
 	if (fno == 0x0b)	/* RENAME/RENDIR */
 	{
 		char newpath[1024];
-		DIR *renamedir;
+		DIRINDEX *di;
 		ulong fcnt = 0;
 
 		if (ccom == 'R')
@@ -1838,9 +1549,9 @@ complete_fopen:
 			goto complete;
 		}
 
-		renamedir = opendir(newpath);
+		di = dir_index_get(newpath);
 
-		if (renamedir == NULL)
+		if (di == NULL)
 		{
 			Debug_printf("cannot open dir '%s'\n", newpath);
 			device[cunit].status.err = 255;
@@ -1852,19 +1563,14 @@ complete_fopen:
 
 		device[cunit].status.err = 1;
 
-		while ((dp = readdir(renamedir)) != NULL)
+		/* the index is a snapshot, renamed entries don't come round again */
+		for (const DIRINDEX_ENTRY &e : di->entries)
 		{
-			char raw_name[12];
- 
-			if (check_dos_name(newpath, dp, &sb))
-				continue;
-
-			/* convert 8+3 to NNNNNNNNXXX */
-			ugefina(dp->d_name, raw_name);
+			const char *raw_name = e.raw_name;
 
 			/* match */
-			if (match_dos_names(raw_name, (char *)device[cunit].parbuf.name, \
-				device[cunit].parbuf.fatr1 | RA_NO_PROTECT, &sb) == 0)
+			if (match_dos_names((char *)raw_name, (char *)device[cunit].parbuf.name, \
+				device[cunit].parbuf.fatr1 | RA_NO_PROTECT, e.mode) == 0)
 			{
 				char xpath[1024], xpath2[1024], newname[16];
 				uchar names[12];
@@ -1875,7 +1581,7 @@ complete_fopen:
 
 				strcpy(xpath, newpath);
 				strcat(xpath, "/");
-				strcat(xpath, dp->d_name);
+				strcat(xpath, e.fname.c_str());
 
 				memcpy(names, device[cunit].parbuf.names, 12);
 
@@ -1891,7 +1597,7 @@ complete_fopen:
 				strcat(xpath2, "/");
 				strcat(xpath2, newname);
 
-				Debug_printf("RENAME: renaming '%s' -> '%s'\n", dp->d_name, newname);
+				Debug_printf("RENAME: renaming '%s' -> '%s'\n", e.fname.c_str(), newname);
 
 				if (stat(xpath2, &dummy) == 0)
 				{
@@ -1908,7 +1614,7 @@ complete_fopen:
 			}
 		}
 
-		closedir(renamedir);
+		dir_index_invalidate(newpath);
 
 		if ((fcnt == 0) && (device[cunit].status.err == 1))
 			device[cunit].status.err = 170;
@@ -1918,7 +1624,7 @@ complete_fopen:
 	if (fno == 0x0c)	/* REMOVE */
 	{
 		char newpath[1024];
-		DIR *deldir;
+		DIRINDEX *di;
 		ulong delcnt = 0;
 
 		if (ccom == 'R')
@@ -1940,9 +1646,9 @@ complete_fopen:
 
 		Debug_printf("local path '%s'\n", newpath);
 
-		deldir = opendir(newpath);
+		di = dir_index_get(newpath);
 
-		if (deldir == NULL)
+		if (di == NULL)
 		{
 			Debug_printf("cannot open dir '%s'\n", newpath);
 			device[cunit].status.err = 255;
@@ -1951,27 +1657,19 @@ complete_fopen:
 
 		device[cunit].status.err = 1;
 
-		while ((dp = readdir(deldir)) != NULL)
+		for (const DIRINDEX_ENTRY &e : di->entries)
 		{
-			char raw_name[12];
- 
-			if (check_dos_name(newpath, dp, &sb))
-				continue;
-
-			/* convert 8+3 to NNNNNNNNXXX */
-			ugefina(dp->d_name, raw_name);
-
 			/* match */
-			if (match_dos_names(raw_name, (char *)device[cunit].parbuf.name, \
-				RA_NO_PROTECT | RA_NO_SUBDIR | RA_NO_HIDDEN, &sb) == 0)
+			if (match_dos_names((char *)e.raw_name, (char *)device[cunit].parbuf.name, \
+				RA_NO_PROTECT | RA_NO_SUBDIR | RA_NO_HIDDEN, e.mode) == 0)
 			{
 				char xpath[1024];
 
 				strcpy(xpath, newpath);
 				strcat(xpath, "/");
-				strcat(xpath, dp->d_name);
+				strcat(xpath, e.fname.c_str());
 
-				if (!S_ISDIR(sb.st_mode))
+				if (!S_ISDIR(e.mode))
 				{				
 					Debug_printf("REMOVE: delete '%s'\n", xpath);
 					if (unlink(xpath))
@@ -1983,7 +1681,7 @@ complete_fopen:
 				}
 			}
 		}
-		closedir(deldir);
+		dir_index_invalidate(newpath);
 		if (delcnt == 0)
 			device[cunit].status.err = 170;
 		goto complete;
@@ -1992,7 +1690,7 @@ complete_fopen:
 	if (fno == 0x0d)	/* CHMOD */
 	{
 		char newpath[1024];
-		DIR *chmdir;
+		DIRINDEX *di;
 		ulong fcnt = 0;
 		uchar fatr2 = device[cunit].parbuf.fatr2;
 
@@ -2023,9 +1721,9 @@ complete_fopen:
 		Debug_printf("local path '%s', fatr1 $%02x fatr2 $%02x\n", newpath, \
 				device[cunit].parbuf.fatr1, fatr2);
 
-		chmdir = opendir(newpath);
+		di = dir_index_get(newpath);
 
-		if (chmdir == NULL)
+		if (di == NULL)
 		{
 			Debug_printf("CHMOD: cannot open dir '%s'\n", newpath);
 			device[cunit].status.err = 255;
@@ -2035,26 +1733,18 @@ complete_fopen:
 
 		device[cunit].status.err = 1;
 
-		while ((dp = readdir(chmdir)) != NULL)
+		for (const DIRINDEX_ENTRY &e : di->entries)
 		{
-			char raw_name[12];
- 
-			if (check_dos_name(newpath, dp, &sb))
-				continue;
-
-			/* convert 8+3 to NNNNNNNNXXX */
-			ugefina(dp->d_name, raw_name);
-
 			/* match */
-			if (match_dos_names(raw_name, (char *)device[cunit].parbuf.name, \
-				device[cunit].parbuf.fatr1, &sb) == 0)
+			if (match_dos_names((char *)e.raw_name, (char *)device[cunit].parbuf.name, \
+				device[cunit].parbuf.fatr1, e.mode) == 0)
 			{
 				char xpath[1024];
-				mode_t newmode = sb.st_mode;
+				mode_t newmode = e.mode;
 
 				strcpy(xpath, newpath);
 				strcat(xpath, "/");
-				strcat(xpath, dp->d_name);
+				strcat(xpath, e.fname.c_str());
 				Debug_printf("CHMOD: change atrs in '%s'\n", xpath);
 
 				/* On Unix, ignore Hidden and Archive bits */
@@ -2073,7 +1763,7 @@ complete_fopen:
 				fcnt++;
 			}
 		}
-		closedir(chmdir);
+		dir_index_invalidate(newpath);
 		if (fcnt == 0)
 			device[cunit].status.err = 170;
 		goto complete;
@@ -2136,6 +1826,7 @@ complete_fopen:
 			time_t mtime = timestamp2mtime(dt);
 
 			device[cunit].status.err = 1;
+			dir_index_invalidate_parent(newpath);
 
 			if (mtime)
 			{
@@ -2226,6 +1917,11 @@ complete_fopen:
 			else
 				device[cunit].status.err = 255;
 		}
+		else
+		{
+			dir_index_invalidate(newpath);
+			dir_index_invalidate_parent(newpath);
+		}
 		goto complete;
 	}
 
@@ -2651,6 +2347,7 @@ void sioPCLink::mount(int no, const char* path)
     device[no].dirname[1023]=0;
     device[no].cwd[0]=0;
     device[no].on = 1;
+    dir_index_flush();
 
     Debug_printf("PCLINK[%d] MOUNT \"%s\"\n", no, path);
 }
@@ -2665,6 +2362,7 @@ void sioPCLink::unmount(int no)
     device[no].on = 0;
     device[no].dirname[0]=0;
     device[no].cwd[0]=0;
+    dir_index_flush();
 
     Debug_printf("PCLINK[%d] UNMOUNT\n", no);
 }
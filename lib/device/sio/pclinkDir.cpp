@@ -0,0 +1,427 @@
+#ifdef BUILD_ATARI
+
+/*
+ * DOS 8.3 names and the host directory index of PCLink.
+ * This file contains code from the SIO2BSD project by KMK (drac030),
+ * split out of pclink.cpp
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <ctype.h>
+#include <sys/stat.h>
+
+#include "compat_dirent.h"
+
+#include "fnSystem.h"
+
+#include "pclinkDir.h"
+
+#include "../../include/debug.h"
+
+static int log_flag = 0;		/* enable more messages, if 1 */
+
+//ulong upper_dir = UPPER_DIR;
+ulong upper_dir = 0;
+
+static long
+dos_2_allowed(uchar c)
+{
+//# ifndef __CYGWIN__
+#if 1
+	if (upper_dir)
+		return (isupper(c) || isdigit(c) || (c == '_') || (c == '@'));
+
+	return (islower(c) || isdigit(c) || (c == '_') || (c == '@'));
+# else
+	return (isalpha(c) || isdigit(c) || (c == '_') || (c == '@'));
+# endif
+}
+
+static long
+dos_2_term(uchar c)
+{
+	return ((c == 0) || (c == 0x20));
+}
+
+static long
+validate_fn(uchar *name, int len)
+{
+	int x;
+
+	for (x = 0; x < len; x++)
+	{
+		if (dos_2_term(name[x]))
+			return (x != 0);
+		if (name[x] == '.')
+			return 1;
+		if (!dos_2_allowed(name[x]))
+			return 0;
+	}
+
+	return 1;
+}
+
+void
+ugefina(char *src, char *out)
+{
+	char *dot;
+	ushort i;
+
+	memset(out, 0x20, 8+3);
+
+	dot = strchr(src, '.');
+
+	if (dot)
+	{
+		i = 1;
+		while (dot[i] && (i < 4))
+		{
+			out[i+7] = toupper((uchar)dot[i]);
+			i++;
+		}
+	}
+
+	i = 0;
+	while ((src[i] != '.') && !dos_2_term(src[i]) && (i < 8))
+	{
+		out[i] = toupper((uchar)src[i]);
+		i++;
+	}
+}
+
+void
+uexpand(uchar *rawname, char *name83)
+{
+	ushort x, y;
+	uchar t;
+
+	name83[0] = 0;
+
+	for (x = 0; x < 8; x++)
+	{
+		t = rawname[x];
+		if (t && (t != 0x20))
+			name83[x] = upper_dir ? toupper(t) : tolower(t);
+		else
+			break;
+	}
+
+	y = 8;
+
+	if (rawname[y] && (rawname[y] != 0x20))
+	{
+		name83[x] = '.';
+		x++;
+
+		while ((y < 11) && rawname[y] && (rawname[y] != 0x20))
+		{
+			name83[x] = upper_dir ? toupper(rawname[y]) : tolower(rawname[y]);
+			x++;
+			y++;
+		}
+	}
+
+	name83[x] = 0;
+}
+
+int
+match_dos_names(char *name, char *mask, uchar fatr1, mode_t mode)
+{
+	ushort i;
+
+	if (log_flag)
+	{
+		Debug_printf("match: %c%c%c%c%c%c%c%c%c%c%c with %c%c%c%c%c%c%c%c%c%c%c: ",
+		name[0], name[1], name[2], name[3], name[4], name[5], name[6], name[7], \
+		name[8], name[9], name[10], \
+		mask[0], mask[1], mask[2], mask[3], mask[4], mask[5], mask[6], mask[7], \
+		mask[8], mask[9], mask[10]);
+	}
+
+	for (i = 0; i < 11; i++)
+	{
+		if (mask[i] != '?')
+			if (toupper((uchar)name[i]) != toupper((uchar)mask[i]))
+			{
+				if (log_flag)
+					Debug_printf("no match\n");
+				return 1;
+			}
+	}
+
+	/* There are no such attributes in Unix */
+	fatr1 &= ~(RA_NO_HIDDEN|RA_NO_ARCHIVED);
+
+	/* Now check the attributes */
+	if (fatr1 & (RA_HIDDEN | RA_ARCHIVED))
+	{
+		if (log_flag)
+			Debug_printf("atr mismatch: not HIDDEN or ARCHIVED\n");
+		return 1;
+	}
+
+	if (fatr1 & RA_PROTECT)
+	{
+		if (mode & (S_IWUSR|S_IWGRP))
+		{
+			if (log_flag)
+				Debug_printf("atr mismatch: not PROTECTED\n");
+
+			return 1;
+		}
+	}
+
+	if (fatr1 & RA_NO_PROTECT)
+	{
+		if ((mode & (S_IWUSR|S_IWGRP)) == 0)
+		{
+			if (log_flag)
+				Debug_printf("atr mismatch: not UNPROTECTED\n");
+
+			return 1;
+		}
+	}
+
+	if (fatr1 & RA_SUBDIR)
+	{
+		if (!S_ISDIR(mode))
+		{
+			if (log_flag)
+				Debug_printf("atr mismatch: not SUBDIR\n");
+
+			return 1;
+		}
+	}
+
+	if (fatr1 & RA_NO_SUBDIR)
+	{
+		if (S_ISDIR(mode))
+		{
+			if (log_flag)
+				Debug_printf("atr mismatch: not FILE\n");
+
+			return 1;
+		}
+	}
+
+	if (log_flag)
+		Debug_printf("match\n");
+
+	return 0;
+}
+
+int
+validate_dos_name(char *fname)
+{
+	char *dot = strchr(fname, '.');
+	long valid_fn, valid_xx;
+			
+	if ((dot == NULL) && (strlen(fname) > 8))
+		return 1;
+	if (dot)
+	{
+		long dd = strlen(dot);
+
+		if (dd > 4)
+			return 1;
+		if ((dot - fname) > 8)
+			return 1;
+		if ((dot == fname) && (dd == 1))
+			return 1;
+		if ((dd == 2) && (dot[1] == '.'))
+			return 1;
+		if ((dd == 3) && ((dot[1] == '.') || (dot[2] == '.')))
+			return 1;
+		if ((dd == 4) && ((dot[1] == '.') || (dot[2] == '.') || (dot[3] == '.')))
+			return 1;
+	}
+
+	valid_fn = validate_fn((uchar *)fname, 8);
+	if (dot != NULL)
+		valid_xx = validate_fn((uchar *)(dot + 1), 3);
+	else
+		valid_xx = 1;
+
+	if (!valid_fn || !valid_xx)
+		return 1;
+
+	return 0;
+}
+
+static int
+check_dos_name(char *newpath, struct dirent *dp, struct stat *sb)
+{
+	char temp_fspec[1024], fname[256];
+
+	strcpy(fname, dp->d_name);
+
+	if (log_flag)
+		Debug_printf("%s: got fname '%s'\n", __func__, fname); 
+
+	if (validate_dos_name(fname))
+		return 1;
+
+	/* stat() the file (fetches the length) */
+	sprintf(temp_fspec, "%s/%s", newpath, fname);
+
+	if (log_flag)
+		Debug_printf("%s: stat '%s'\n", __func__, temp_fspec);
+
+	if (stat(temp_fspec, sb))
+	{
+		Debug_printf("cannot stat '%s'\n", temp_fspec);
+		return 1;
+	}
+
+	if (!S_ISREG(sb->st_mode) && !S_ISDIR(sb->st_mode))
+	{
+		Debug_printf("'%s' is not regular file nor directory\n", temp_fspec);
+		return 1;
+	}
+
+	/*if (sb->st_uid != our_uid)
+	{
+		Debug_printf("'%s' wrong uid\n", temp_fspec);
+		return 1;
+	}*/
+
+	if ((sb->st_mode & S_IRUSR) == 0)
+	{
+		Debug_printf("'%s' is unreadable\n", temp_fspec);
+		return 1;
+	}
+
+	if (S_ISDIR(sb->st_mode) && ((sb->st_mode & S_IXUSR) == 0))
+	{
+		Debug_printf("dir '%s' is unbrowseable\n", temp_fspec);
+		return 1;
+	}
+
+	return 0;
+}
+
+static DIRINDEX dir_index[DIR_INDEX_SLOTS];
+
+static std::string
+dir_index_key(const char *path)
+{
+	std::string key(path);
+
+	while ((key.size() > 1) && (key.back() == '/'))
+		key.pop_back();
+
+	return key;
+}
+
+DIRINDEX *
+dir_index_get(const char *path)
+{
+	std::string key = dir_index_key(path);
+	uint64_t now = fnSystem.millis();
+	DIRINDEX *di = NULL;
+	struct stat st;
+	struct dirent *dp;
+	DIR *dh;
+	int i;
+
+	if (stat(key.c_str(), &st) < 0)
+		return NULL;
+
+	for (i = 0; i < DIR_INDEX_SLOTS; i++)
+	{
+		if (dir_index[i].path == key)
+		{
+			di = &dir_index[i];
+			break;
+		}
+		if ((di == NULL) || (dir_index[i].used < di->used))
+			di = &dir_index[i];
+	}
+
+	if ((di->path == key) && (di->dir_mtime == st.st_mtime) && ((now - di->built) < DIR_INDEX_MAX_AGE))
+	{
+		di->used = now;
+		return di;
+	}
+
+	dh = opendir(key.c_str());
+	if (dh == NULL)
+	{
+		di->path.clear();
+		di->entries.clear();
+		return NULL;
+	}
+
+	di->path = key;
+	di->dir_mtime = st.st_mtime;
+	di->built = di->used = now;
+	di->entries.clear();
+
+	while ((dp = readdir(dh)) != NULL)
+	{
+		DIRINDEX_ENTRY e;
+		struct stat sb;
+
+		if (check_dos_name((char *)key.c_str(), dp, &sb))
+			continue;
+
+		e.fname = dp->d_name;
+		ugefina(dp->d_name, e.raw_name);
+		e.raw_name[11] = 0;
+		e.mode = sb.st_mode;
+		e.size = sb.st_size;
+		e.mtime = sb.st_mtime;
+		di->entries.push_back(e);
+	}
+	closedir(dh);
+	di->entries.shrink_to_fit();
+
+	if (log_flag)
+		Debug_printf("indexed '%s', %u entries\n", key.c_str(), (unsigned)di->entries.size());
+
+	return di;
+}
+
+void
+dir_index_invalidate(const char *path)
+{
+	std::string key = dir_index_key(path);
+	int i;
+
+	for (i = 0; i < DIR_INDEX_SLOTS; i++)
+	{
+		if (dir_index[i].path == key)
+		{
+			dir_index[i].path.clear();
+			dir_index[i].entries.clear();
+			dir_index[i].entries.shrink_to_fit();
+		}
+	}
+}
+
+/* Drop the index of the directory holding this file or subdirectory */
+void
+dir_index_invalidate_parent(const char *path)
+{
+	std::string key = dir_index_key(path);
+	size_t sl = key.rfind('/');
+
+	if (sl != std::string::npos)
+		dir_index_invalidate(key.substr(0, sl ? sl : 1).c_str());
+}
+
+void
+dir_index_flush(void)
+{
+	int i;
+
+	for (i = 0; i < DIR_INDEX_SLOTS; i++)
+	{
+		dir_index[i].path.clear();
+		dir_index[i].entries.clear();
+		dir_index[i].entries.shrink_to_fit();
+	}
+}
+
+#endif /* BUILD_ATARI */
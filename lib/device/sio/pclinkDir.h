@@ -0,0 +1,71 @@
+#ifndef PCLINK_DIR_H
+#define PCLINK_DIR_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+# ifndef uchar
+#  define uchar unsigned char
+# endif
+
+# ifndef ushort
+#  define ushort unsigned short
+# endif
+
+# ifndef ulong
+#  define ulong unsigned long
+# endif
+
+/* SDX required attribute mask */
+# define RA_PROTECT	0x01
+# define RA_HIDDEN	0x02
+# define RA_ARCHIVED	0x04
+# define RA_SUBDIR	0x08
+# define RA_NO_PROTECT	0x10
+# define RA_NO_HIDDEN	0x20
+# define RA_NO_ARCHIVED	0x40
+# define RA_NO_SUBDIR	0x80
+
+extern ulong upper_dir;	/* host names are upper case */
+
+void ugefina(char *src, char *out);
+void uexpand(uchar *rawname, char *name83);
+int match_dos_names(char *name, char *mask, uchar fatr1, mode_t mode);
+int validate_dos_name(char *fname);
+
+/* Directory index: the DOS visible entries of recently used host directories,
+ * so directory reads and file opens don't readdir() and stat() every entry
+ * each time. An index is rebuilt when the directory's mtime changes or it gets
+ * older than DIR_INDEX_MAX_AGE (FAT doesn't update directory mtimes), and is
+ * dropped when PCLink itself changes the directory.
+ */
+# define DIR_INDEX_SLOTS	4
+# define DIR_INDEX_MAX_AGE	10000	/* ms */
+
+typedef struct
+{
+	std::string fname;	/* host file name */
+	char raw_name[12];	/* NNNNNNNNXXX */
+	mode_t mode;
+	off_t size;
+	time_t mtime;
+} DIRINDEX_ENTRY;
+
+typedef struct
+{
+	std::string path;
+	time_t dir_mtime;
+	uint64_t built;
+	uint64_t used;
+	std::vector<DIRINDEX_ENTRY> entries;
+} DIRINDEX;
+
+DIRINDEX *dir_index_get(const char *path);
+void dir_index_invalidate(const char *path);
+void dir_index_invalidate_parent(const char *path);
+void dir_index_flush(void);
+
+#endif // PCLINK_DIR_H
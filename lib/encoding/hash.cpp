@@ -1,16 +1,44 @@
 #include <sstream>
 #include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
 
 #include "hash.h"
 
+// Chunk size for hashing files
+#define HASH_FILE_BUFFER_SIZE 4096
+
 Hash hasher;
 
-Hash::Hash() {}
+static const Hash::Algorithm all_algorithms[] = {
+    Hash::Algorithm::MD5, Hash::Algorithm::SHA1, Hash::Algorithm::SHA256, Hash::Algorithm::SHA512
+};
+
+static std::map<std::string, std::unique_ptr<Hash>> hash_sessions;
+static std::mutex hash_sessions_mutex;
+
+Hash::Hash() {
+}
 
 Hash::~Hash() {
     clear();
 }
 
+Hash& Hash::session(const std::string& name) {
+    std::lock_guard<std::mutex> lock(hash_sessions_mutex);
+    std::unique_ptr<Hash>& h = hash_sessions[name];
+    if (!h) {
+        h.reset(new Hash());
+    }
+    return *h;
+}
+
+void Hash::end_session(const std::string& name) {
+    std::lock_guard<std::mutex> lock(hash_sessions_mutex);
+    hash_sessions.erase(name);
+}
+
 Hash::Algorithm Hash::to_algorithm(uint8_t value) {
     switch (value) {
         case static_cast<uint8_t>(Algorithm::MD5):
@@ -41,16 +69,70 @@ Hash::Algorithm Hash::from_string(std::string hash_name)
     }
 }
 
+void Hash::add_data(const uint8_t* data, size_t len) {
+    if (!started) {
+        for (Algorithm algorithm : all_algorithms) {
+            start_context(algorithm);
+        }
+        started = true;
+    }
+    for (Algorithm algorithm : all_algorithms) {
+        if (running(algorithm)) {
+            update_context(algorithm, data, len);
+        }
+    }
+}
+
 void Hash::add_data(const std::vector<uint8_t>& data) {
-    accumulated_data.insert(accumulated_data.end(), data.begin(), data.end());
+    add_data(data.data(), data.size());
 }
 
 void Hash::add_data(const std::string& data) {
-    accumulated_data.insert(accumulated_data.end(), data.begin(), data.end());
+    add_data(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+bool Hash::begin(Algorithm algorithm) {
+    if (algorithm == Algorithm::UNKNOWN) {
+        return false;
+    }
+    if (selected != Algorithm::UNKNOWN) {
+        return selected == algorithm;
+    }
+    if (started) {
+        // drop the algorithms nobody will ask for
+        for (Algorithm other : all_algorithms) {
+            if (other != algorithm) {
+                free_context(other);
+            }
+        }
+    } else {
+        start_context(algorithm);
+        started = true;
+    }
+    selected = algorithm;
+    return true;
+}
+
+bool Hash::add_file(fnFile* f) {
+    if (f == nullptr) {
+        return false;
+    }
+    std::vector<uint8_t> buffer(HASH_FILE_BUFFER_SIZE);
+    size_t len;
+    while ((len = fnio::fread(buffer.data(), 1, buffer.size(), f)) > 0) {
+        add_data(buffer.data(), len);
+    }
+    return fnio::feof(f) != 0;
 }
 
 void Hash::clear() {
-    accumulated_data.clear();
+    for (Algorithm algorithm : all_algorithms) {
+        if (running(algorithm)) {
+            free_context(algorithm);
+        }
+    }
+    started = false;
+    selected = Algorithm::UNKNOWN;
 }
 
 size_t Hash::hash_length(Algorithm algorithm, bool is_hex) const {
@@ -76,132 +158,135 @@ size_t Hash::hash_length(Algorithm algorithm, bool is_hex) const {
 
 void Hash::compute(Algorithm algorithm, bool clear_data) {
     hash_output.clear();
+    if (!started) {
+        // nothing added, digest of no data
+        start_context(algorithm);
+        finish_context(algorithm);
+        free_context(algorithm);
+    } else if (running(algorithm)) {
+        finish_context(algorithm);
+    }
+    // else data is gone, only the algorithm given to begin() can be computed
+    if (clear_data) {
+        clear();
+    }
+}
+
+std::vector<uint8_t> Hash::output_binary() const {
+    return hash_output;
+}
+
+std::string Hash::output_hex() const {
+    return bytes_to_hex(hash_output);
+}
+
+bool Hash::running(Algorithm algorithm) const {
+    return started && (selected == Algorithm::UNKNOWN || selected == algorithm);
+}
+
+void Hash::start_context(Algorithm algorithm) {
     switch (algorithm) {
+        case Algorithm::MD5:
+            mbedtls_md5_init(&md5_ctx);
+            mbedtls_md5_starts(&md5_ctx);
+            break;
         case Algorithm::SHA1:
-            compute_sha1();
+            mbedtls_sha1_init(&sha1_ctx);
+            mbedtls_sha1_starts(&sha1_ctx);
             break;
         case Algorithm::SHA256:
-            compute_sha256();
+            mbedtls_sha256_init(&sha256_ctx);
+            mbedtls_sha256_starts(&sha256_ctx, 0);
             break;
         case Algorithm::SHA512:
-            compute_sha512();
+            mbedtls_sha512_init(&sha512_ctx);
+            mbedtls_sha512_starts(&sha512_ctx, 0);
             break;
         default:
             break;
     }
-    if (clear_data) {
-        clear();
-    }
 }
 
-std::vector<uint8_t> Hash::output_binary() const {
-    return hash_output;
+void Hash::update_context(Algorithm algorithm, const uint8_t* data, size_t len) {
+    switch (algorithm) {
+        case Algorithm::MD5:
+            mbedtls_md5_update(&md5_ctx, data, len);
+            break;
+        case Algorithm::SHA1:
+            mbedtls_sha1_update(&sha1_ctx, data, len);
+            break;
+        case Algorithm::SHA256:
+            mbedtls_sha256_update(&sha256_ctx, data, len);
+            break;
+        case Algorithm::SHA512:
+            mbedtls_sha512_update(&sha512_ctx, data, len);
+            break;
+        default:
+            break;
+    }
 }
 
-std::string Hash::output_hex() const {
-    return bytes_to_hex(hash_output);
+// Finish a copy of the context, so more data can still be added
+void Hash::finish_context(Algorithm algorithm) {
+    switch (algorithm) {
+        case Algorithm::MD5: {
+            mbedtls_md5_context ctx;
+            mbedtls_md5_init(&ctx);
+            mbedtls_md5_clone(&ctx, &md5_ctx);
+            hash_output.resize(16);
+            mbedtls_md5_finish(&ctx, hash_output.data());
+            mbedtls_md5_free(&ctx);
+            break;
+        }
+        case Algorithm::SHA1: {
+            mbedtls_sha1_context ctx;
+            mbedtls_sha1_init(&ctx);
+            mbedtls_sha1_clone(&ctx, &sha1_ctx);
+            hash_output.resize(20);
+            mbedtls_sha1_finish(&ctx, hash_output.data());
+            mbedtls_sha1_free(&ctx);
+            break;
+        }
+        case Algorithm::SHA256: {
+            mbedtls_sha256_context ctx;
+            mbedtls_sha256_init(&ctx);
+            mbedtls_sha256_clone(&ctx, &sha256_ctx);
+            hash_output.resize(32);
+            mbedtls_sha256_finish(&ctx, hash_output.data());
+            mbedtls_sha256_free(&ctx);
+            break;
+        }
+        case Algorithm::SHA512: {
+            mbedtls_sha512_context ctx;
+            mbedtls_sha512_init(&ctx);
+            mbedtls_sha512_clone(&ctx, &sha512_ctx);
+            hash_output.resize(64);
+            mbedtls_sha512_finish(&ctx, hash_output.data());
+            mbedtls_sha512_free(&ctx);
+            break;
+        }
+        default:
+            break;
+    }
 }
 
-void Hash::compute_sha1() {
-    mbedtls_sha1_context ctx;
-    mbedtls_sha1_init(&ctx);
-    
-    int ret = 0;
-    
-    hash_output.resize(20);
-    
-#if defined(mbedtls_sha1_starts_ret) && defined(mbedtls_sha1_update_ret) && defined(mbedtls_sha1_finish_ret)
-    // Use newer API that returns status code
-    if ((ret = mbedtls_sha1_starts_ret(&ctx)) != 0) {
-        mbedtls_sha1_free(&ctx);
-        return; // Handle error appropriately
-    }
-    
-    if ((ret = mbedtls_sha1_update_ret(&ctx, accumulated_data.data(), accumulated_data.size())) != 0) {
-        mbedtls_sha1_free(&ctx);
-        return; // Handle error appropriately
-    }
-    
-    if ((ret = mbedtls_sha1_finish_ret(&ctx, hash_output.data())) != 0) {
-        mbedtls_sha1_free(&ctx);
-        return; // Handle error appropriately
-    }
-#else
-    // Use legacy API
-    mbedtls_sha1_starts(&ctx);
-    mbedtls_sha1_update(&ctx, accumulated_data.data(), accumulated_data.size());
-    mbedtls_sha1_finish(&ctx, hash_output.data());
-#endif
-    
-    mbedtls_sha1_free(&ctx);
-}
-
-void Hash::compute_sha256() {
-    mbedtls_sha256_context ctx;
-    mbedtls_sha256_init(&ctx);
-    
-    int ret = 0;
-    
-    hash_output.resize(32);
-    
-#if defined(mbedtls_sha256_starts_ret) && defined(mbedtls_sha256_update_ret) && defined(mbedtls_sha256_finish_ret)
-    // Use newer API that returns status code
-    if ((ret = mbedtls_sha256_starts_ret(&ctx, 0)) != 0) {
-        mbedtls_sha256_free(&ctx);
-        return; // Handle error appropriately
-    }
-    
-    if ((ret = mbedtls_sha256_update_ret(&ctx, accumulated_data.data(), accumulated_data.size())) != 0) {
-        mbedtls_sha256_free(&ctx);
-        return; // Handle error appropriately
-    }
-    
-    if ((ret = mbedtls_sha256_finish_ret(&ctx, hash_output.data())) != 0) {
-        mbedtls_sha256_free(&ctx);
-        return; // Handle error appropriately
-    }
-#else
-    // Use legacy API
-    mbedtls_sha256_starts(&ctx, 0);
-    mbedtls_sha256_update(&ctx, accumulated_data.data(), accumulated_data.size());
-    mbedtls_sha256_finish(&ctx, hash_output.data());
-#endif
-    
-    mbedtls_sha256_free(&ctx);
-}
-
-void Hash::compute_sha512() {
-    mbedtls_sha512_context ctx;
-    mbedtls_sha512_init(&ctx);
-    
-    int ret = 0;
-    
-    hash_output.resize(64);
-    
-#if defined(mbedtls_sha512_starts_ret) && defined(mbedtls_sha512_update_ret) && defined(mbedtls_sha512_finish_ret)
-    // Use newer API that returns status code
-    if ((ret = mbedtls_sha512_starts_ret(&ctx, 0)) != 0) {
-        mbedtls_sha512_free(&ctx);
-        return; // Handle error appropriately
-    }
-    
-    if ((ret = mbedtls_sha512_update_ret(&ctx, accumulated_data.data(), accumulated_data.size())) != 0) {
-        mbedtls_sha512_free(&ctx);
-        return; // Handle error appropriately
-    }
-    
-    if ((ret = mbedtls_sha512_finish_ret(&ctx, hash_output.data())) != 0) {
-        mbedtls_sha512_free(&ctx);
-        return; // Handle error appropriately
-    }
-#else
-    // Use legacy API
-    mbedtls_sha512_starts(&ctx, 0);
-    mbedtls_sha512_update(&ctx, accumulated_data.data(), accumulated_data.size());
-    mbedtls_sha512_finish(&ctx, hash_output.data());
-#endif
-    
-    mbedtls_sha512_free(&ctx);
+void Hash::free_context(Algorithm algorithm) {
+    switch (algorithm) {
+        case Algorithm::MD5:
+            mbedtls_md5_free(&md5_ctx);
+            break;
+        case Algorithm::SHA1:
+            mbedtls_sha1_free(&sha1_ctx);
+            break;
+        case Algorithm::SHA256:
+            mbedtls_sha256_free(&sha256_ctx);
+            break;
+        case Algorithm::SHA512:
+            mbedtls_sha512_free(&sha512_ctx);
+            break;
+        default:
+            break;
+    }
 }
 
 std::string Hash::bytes_to_hex(const std::vector<uint8_t>& bytes) const {
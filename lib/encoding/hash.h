@@ -8,6 +8,8 @@
 #include <mbedtls/sha256.h>
 #include <mbedtls/sha512.h>
 
+#include "fnio.h"
+
 class Hash {
 public:
     enum class Algorithm {
@@ -16,9 +18,19 @@ public:
 
     Hash();
     ~Hash();
+    Hash(const Hash&) = delete;
+    Hash& operator=(const Hash&) = delete;
 
+    // Data is hashed as it arrives. Until begin() selects one algorithm,
+    // every algorithm is kept up to date so compute() can pick any of them
+    void add_data(const uint8_t* data, size_t len);
     void add_data(const std::vector<uint8_t>& data);
     void add_data(const std::string& data);
+    // Hash with given algorithm only from now on, data added before is kept,
+    // returns false if another algorithm was selected since last clear()
+    bool begin(Algorithm algorithm);
+    // Hash rest of file, returns false on read error
+    bool add_file(fnFile* f);
     void clear();
     size_t hash_length(Algorithm algorithm, bool is_hex) const;
     void compute(Algorithm algorithm, bool clear_data);
@@ -28,13 +40,24 @@ public:
     static Hash::Algorithm to_algorithm(uint8_t value);
     static Hash::Algorithm from_string(std::string hash_name);
 
+    // Named hash sessions, independent of each other and of the global hasher
+    static Hash& session(const std::string& name);
+    static void end_session(const std::string& name);
+
 private:
-    std::vector<uint8_t> accumulated_data;
+    bool started = false;                     // contexts hold data since last clear()
+    Algorithm selected = Algorithm::UNKNOWN;  // by begin(), UNKNOWN runs all of them
+    mbedtls_md5_context md5_ctx;
+    mbedtls_sha1_context sha1_ctx;
+    mbedtls_sha256_context sha256_ctx;
+    mbedtls_sha512_context sha512_ctx;
     std::vector<uint8_t> hash_output;
 
-    void compute_sha1();
-    void compute_sha256();
-    void compute_sha512();
+    bool running(Algorithm algorithm) const;
+    void start_context(Algorithm algorithm);
+    void update_context(Algorithm algorithm, const uint8_t* data, size_t len);
+    void finish_context(Algorithm algorithm);
+    void free_context(Algorithm algorithm);
     std::string bytes_to_hex(const std::vector<uint8_t>& bytes) const;
 };
 
@@ -8,10 +8,8 @@
 #include "fnjson.h"
 
 #include <string.h>
-#include <sstream>
+#include <stdio.h>
 #include <math.h>
-#include <iomanip>
-#include <ostream>
 #include "string_utils.h"
 #include "../../include/debug.h"
 #include "../utils/utils.h"
@@ -48,6 +46,7 @@ FNJSON::~FNJSON()
 void FNJSON::setLineEnding(const std::string &_lineEnding)
 {
     lineEnding = _lineEnding;
+    invalidateValue();
 }
 
 /**
@@ -67,6 +66,7 @@ void FNJSON::setQueryParam(uint8_t qp)
     Debug_printf("FNJSON::setQueryParam(0x%02hx)\r\n", qp);
 #endif
     _queryParam = qp;
+    invalidateValue();
 }
 
 /**
@@ -80,9 +80,30 @@ void FNJSON::setReadQuery(const std::string &queryString, uint8_t queryParam)
     _queryString = queryString;
     _queryParam = queryParam;
     _item = resolveQuery();
+    invalidateValue();
     json_bytes_remaining = readValueLen();
 }
 
+/**
+ * Get read query string
+ */
+const std::string &FNJSON::getReadQuery()
+{
+    return _queryString;
+}
+
+/**
+ * Set JSON pointer of the subtree kept by next parse(), empty to keep whole document.
+ * Queries outside of the subtree won't resolve.
+ */
+void FNJSON::setParseFilter(const std::string &filter)
+{
+#ifdef VERBOSE_PROTOCOL
+    Debug_printf("FNJSON::setParseFilter filter: %s\r\n", filter.c_str());
+#endif
+    _parseFilter = filter;
+}
+
 /**
  * Resolve query string
  */
@@ -94,21 +115,51 @@ cJSON *FNJSON::resolveQuery()
     return cJSONUtils_GetPointer(_json, _queryString.c_str());
 }
 
+#ifdef BUILD_ATARI
 /**
- * Process string, strip out HTML tags if needed
+ * Latin-1 characters mapped to ATASCII, indexed by code point - 0x80.
+ * nullptr entries are copied unchanged.
  */
-std::string FNJSON::processString(std::string in)
+struct CharMapping
 {
-    while (in.find("<") != std::string::npos)
-    {
-        auto startpos = in.find("<");
-        auto endpos = in.find(">") + 1;
+    uint8_t from;
+    const char *to;
+};
+
+// ATASCII international charset (need to be switched on ATARI, i.e via POKE 756,204)
+// á is 0x00 in that charset, it can't be sent inside of a C string so it is dropped.
+static const CharMapping intlMapping[] = {
+    {0xE1, ""}, {0xF9, "\x01"}, {0xD1, "\x02"}, {0xC9, "\x03"}, {0xE7, "\x04"}, {0xF4, "\x05"},
+    {0xF2, "\x06"}, {0xEC, "\x07"}, {0xA3, "\x08"}, {0xEF, "\x09"}, {0xFC, "\x0a"}, {0xE4, "\x0b"},
+    {0xD6, "\x0c"}, {0xFA, "\x0d"}, {0xF3, "\x0e"}, {0xF6, "\x0f"}, {0xDC, "\x10"}, {0xE2, "\x11"},
+    {0xFB, "\x12"}, {0xEE, "\x13"}, {0xE9, "\x14"}, {0xE8, "\x15"}, {0xF1, "\x16"}, {0xEA, "\x17"},
+    {0xE5, "\x18"}, {0xE0, "\x19"}, {0xC5, "\x1a"}, {0xA1, "\x60"}, {0xC4, "\x7b"}, {0xDF, "ss"}};
+
+// generic ASCII/ATASCII, umlaut removal (no font change needed)
+static const CharMapping asciiMapping[] = {
+    {0xC4, "Ae"}, {0xD6, "Oe"}, {0xDC, "Ue"}, {0xE4, "ae"}, {0xF6, "oe"}, {0xFC, "ue"}, {0xDF, "ss"},
+    {0xE9, "e"}, {0xE8, "e"}, {0xE1, "a"}, {0xE0, "a"}, {0xF3, "o"}, {0xF2, "o"}, {0xFA, "u"}, {0xF9, "u"}};
+
+struct CharTable
+{
+    const char *map[128] = {};
 
-        if (endpos != std::string::npos)
-        {
-            in.erase(startpos, endpos - startpos);
-        }
+    template <size_t N>
+    CharTable(const CharMapping (&mappings)[N])
+    {
+        for (const CharMapping &m : mappings)
+            map[m.from - 0x80] = m.to;
     }
+};
+#endif
+
+/**
+ * Process string, strip out HTML tags and map characters if needed.
+ * Result is appended to out in a single pass.
+ */
+void FNJSON::processString(const char *in, std::string &out)
+{
+    const char * const *charMap = nullptr;
 
 #ifdef BUILD_IEC
     // TODO: fix translations. There needs to be the ability to decide if we translate the TRANSMIT to internet and RECEIVE back to the host separately.
@@ -130,62 +181,64 @@ std::string FNJSON::processString(std::string in)
     // SIO AUX2 Bit 1 set?
     if ((_queryParam & 1) != 0)
     {
-        // yes, map special characters
-        Debug_printf("S: [Mapping->ATARI]\r\n");
-
+        static const CharTable intlTable(intlMapping);
+        static const CharTable asciiTable(asciiMapping);
         // SIO AUX2 Bit 2 set?
-        if ((_queryParam & 2) != 0)
+        charMap = ((_queryParam & 2) != 0) ? intlTable.map : asciiTable.map;
+    }
+#endif
+
+    const unsigned char *p = (const unsigned char *)in;
+    while (*p != '\0')
+    {
+        if (*p == '<')
         {
-            Debug_printf("Applying international charset mapping\r\n");
-            // yes, mapping to international charset
-            std::string mapFrom[] = {"á", "ù", "Ñ", "É", "ç", "ô", "ò", "ì", "£", "ï", "ü", "ä", "Ö", "ú", "ó", "ö", "Ü", "â", "û", "î", "é", "è", "ñ", "ê", "å", "à", "Å", "¡", "Ä", "ß"};
-            std::string mapTo[] = {"\x00", "\x01", "\x02", "\x03", "\x04", "\x05", "\x06", "\x07", "\x08", "\x09", "\x0a", "\x0b", "\x0c", "\x0d", "\x0e", "\x0f", "\x10", "\x11", "\x12", "\x13", "\x14", "\x15", "\x16", "\x17", "\x18", "\x19", "\x1a", "\x60", "\x7b", "ss"};
-            int elementCount = sizeof(mapFrom) / sizeof(mapFrom[0]);
-            for (int elementIndex = 0; elementIndex < elementCount; elementIndex++)
-                if (in.find(mapFrom[elementIndex]) != std::string::npos)
-                    in.replace(in.find(mapFrom[elementIndex]), std::string(mapFrom[elementIndex]).size(), mapTo[elementIndex]);
+            // skip HTML tag, unterminated tag removes the rest
+            while (*p != '\0' && *p != '>')
+                p++;
+            if (*p == '>')
+                p++;
+            continue;
         }
-        else
+
+        // two byte UTF-8 sequences cover all mapped characters
+        if (charMap != nullptr && (p[0] == 0xC2 || p[0] == 0xC3) && (p[1] & 0xC0) == 0x80)
         {
-            Debug_printf("Applying umlaut removal mapping\r\n");
-            // no, mapping to normal ASCI (workaround)
-            std::string mapFrom[] = {"Ä", "Ö", "Ü", "ä", "ö", "ü", "ß", "é", "è", "á", "à", "ó", "ò", "ú", "ù"};
-            std::string mapTo[] = {"Ae", "Oe", "Ue", "ae", "oe", "ue", "ss", "e", "e", "a", "a", "o", "o", "u", "u"};
-            int elementCount = sizeof(mapFrom) / sizeof(mapFrom[0]);
-            for (int elementIndex = 0; elementIndex < elementCount; elementIndex++)
-                if (in.find(mapFrom[elementIndex]) != std::string::npos)
-                    in.replace(in.find(mapFrom[elementIndex]), std::string(mapFrom[elementIndex]).size(), mapTo[elementIndex]);
+            const char *to = charMap[(((p[0] & 0x1F) << 6) | (p[1] & 0x3F)) - 0x80];
+            if (to != nullptr)
+            {
+                out += to;
+                p += 2;
+                continue;
+            }
         }
 
+        // copy run of plain characters
+        const unsigned char *run = p++;
+        while (*p != '\0' && *p != '<' && (charMap == nullptr || (*p != 0xC2 && *p != 0xC3)))
+            p++;
+        out.append((const char *)run, p - run);
     }
-#endif
-
-    return in;
 }
 
 /**
- * Return normalized string of JSON item
+ * Append normalized string of JSON item to out
  */
-std::string FNJSON::getValue(cJSON *item)
+void FNJSON::getValue(cJSON *item, std::string &out)
 {
     if (item == NULL)
     {
         Debug_printf("\r\nFNJSON::getValue called with null item, returning empty string.\r\n");
-        return std::string("");
+        return;
     }
-    // Fix where the print cursor is.
-    // Debug_printf("\r\n");
-
-    std::stringstream ss;
 
     if (cJSON_IsString(item))
     {
-        char *strValue = cJSON_GetStringValue(item);
-        // Debug_printf("S: [cJSON_IsString] %s\r\n", strValue);
 #ifdef VERBOSE_PROTOCOL
         Debug_printf("S: [cJSON_IsString] ... (not printing)\r\n");
 #endif
-        ss << processString(strValue + lineEnding);
+        processString(cJSON_GetStringValue(item), out);
+        processString(lineEnding.c_str(), out);
     }
     else if (cJSON_IsBool(item))
     {
@@ -193,19 +246,22 @@ std::string FNJSON::getValue(cJSON *item)
 #ifdef VERBOSE_PROTOCOL
         Debug_printf("S: [cJSON_IsBool] %s\r\n", isTrue ? "true" : "false");
 #endif
-        ss << (isTrue ? "TRUE" : "FALSE") + lineEnding;
+        out += isTrue ? "TRUE" : "FALSE";
+        out += lineEnding;
     }
     else if (cJSON_IsNull(item))
     {
 #ifdef VERBOSE_PROTOCOL
         Debug_printf("S: [cJSON_IsNull]\r\n");
 #endif
-        ss << "NULL" + lineEnding;
+        out += "NULL";
+        out += lineEnding;
     }
     else if (cJSON_IsNumber(item))
     {
         double num = cJSON_GetNumberValue(item);
         bool isInt = isApproximatelyInteger(num);
+        char numStr[32];
         // Is the number an integer?
         if (isInt)
         {
@@ -213,7 +269,7 @@ std::string FNJSON::getValue(cJSON *item)
 #ifdef VERBOSE_PROTOCOL
             Debug_printf("S: [cJSON_IsNumber INT] %llu\r\n", (int64_t)num);
 #endif
-            ss << (int64_t)num;
+            snprintf(numStr, sizeof(numStr), "%lld", (long long)num);
         }
         else
         {
@@ -221,16 +277,17 @@ std::string FNJSON::getValue(cJSON *item)
 #ifdef VERBOSE_PROTOCOL
             Debug_printf("S: [cJSON_IsNumber] %f\r\n", num);
 #endif
-            ss << std::setprecision(10) << num;
+            snprintf(numStr, sizeof(numStr), "%.10g", num);
         }
 
-        ss << lineEnding;
+        out += numStr;
+        out += lineEnding;
     }
     else if (cJSON_IsObject(item))
     {
         #ifdef BUILD_IEC
             // Set line ending when returning multiple values
-            setLineEnding("\x0a");
+            lineEnding = "\x0a";
         #endif
 
         if (item->child == NULL)
@@ -238,7 +295,7 @@ std::string FNJSON::getValue(cJSON *item)
 #ifdef VERBOSE_PROTOCOL
             Debug_printf("FNJSON::getValue OBJECT has no CHILD, adding empty string\r\n");
 #endif
-            ss << lineEnding;
+            out += lineEnding;
         }
         else
         {
@@ -248,74 +305,148 @@ std::string FNJSON::getValue(cJSON *item)
                 // #ifdef BUILD_IEC
                 //     // Convert key to PETSCII
                 //     string tempStr = string((const char *)item->string);
-                //     ss << mstr::toPETSCII2(tempStr);
+                //     out += mstr::toPETSCII2(tempStr);
                 // #else
-                    ss << item->string;
+                    out += item->string;
                 // #endif
 
-                ss << lineEnding + getValue(item);
+                out += lineEnding;
+                getValue(item, out);
             } while ((item = item->next) != NULL);
         }
 
     }
     else if (cJSON_IsArray(item))
     {
-        cJSON *child = item->child;
-        do
-        {
-            ss << getValue(child);
-        } while ((child = child->next) != NULL);
+        for (cJSON *child = item->child; child != NULL; child = child->next)
+            getValue(child, out);
     }
     else
-        ss << "UNKNOWN" + lineEnding;
-  
-    return ss.str();
+    {
+        out += "UNKNOWN";
+        out += lineEnding;
+    }
 }
 
 /**
- * Return requested value
+ * Render value of current query into _value, only once per query
+ */
+void FNJSON::renderValue()
+{
+    if (_valueRendered)
+        return;
+
+    _value.clear();
+    _valuePos = 0;
+    if (_item != nullptr)
+        getValue(_item, _value);
+    _valueRendered = true;
+}
+
+/**
+ * Drop rendered value, it is rendered again on next read
+ */
+void FNJSON::invalidateValue()
+{
+    _value.clear();
+    _value.shrink_to_fit();
+    _valuePos = 0;
+    _valueRendered = false;
+}
+
+/**
+ * Copy the first len bytes of requested value, zero filled past its end
  */
 bool FNJSON::readValue(uint8_t *rx_buf, unsigned short len)
 {    
     if (_item == nullptr)
         return true; // error
 
-    memcpy(rx_buf, getValue(_item).data(), len);
+    renderValue();
+
+    size_t n = _value.size();
+    if (n > len)
+        n = len;
+    memcpy(rx_buf, _value.data(), n);
+    if (n < len)
+        memset(rx_buf + n, 0, len - n);
 
     return false; // no error.
 }
 
 /**
- * Return requested value length
+ * Return length of requested value
  */
 int FNJSON::readValueLen()
 {
     if (_item == nullptr)
         return 0;
 
-    return getValue(_item).size();
+    renderValue();
+
+    return _value.size();
+}
+
+/**
+ * Copy next len bytes of requested value and move the read cursor past them,
+ * for callers reading the value in pieces. Zero filled past its end.
+ */
+bool FNJSON::readValueNext(uint8_t *rx_buf, unsigned short len)
+{
+    if (_item == nullptr)
+        return true; // error
+
+    renderValue();
+
+    size_t n = _value.size() - _valuePos;
+    if (n > len)
+        n = len;
+    memcpy(rx_buf, _value.data() + _valuePos, n);
+    if (n < len)
+        memset(rx_buf + n, 0, len - n);
+    _valuePos += n;
+
+    return false; // no error.
+}
+
+/**
+ * Return length of requested value not read by readValueNext() yet
+ */
+int FNJSON::readValueRemaining()
+{
+    if (_item == nullptr)
+        return 0;
+
+    renderValue();
+
+    return _value.size() - _valuePos;
 }
 
 /**
  * Parse data from protocol
+ * Data is parsed as it arrives, the document text is not kept in memory.
  */
 bool FNJSON::parse()
 {
     NetworkStatus ns;
+    FNJSONStream stream;
+    size_t parsed = 0;
 
     if (_json != nullptr)
     {
-        // delete and set to null. we only set a new _json value if the parsebuffer is not empty
+        // delete and set to null. we only set a new _json value if there was some data
         cJSON_Delete(_json);
         _json = nullptr;
     }
+    _item = nullptr;
+    invalidateValue();
 
     if (_protocol == nullptr)
     {
         // Debug_printf("FNJSON::parse() - NULL protocol.\r\n");
         return false;
     }
-    _parseBuffer.clear();
+    stream.begin(_parseFilter);
     _protocol->status(&ns);
 #ifdef VERBOSE_PROTOCOL
     Debug_printf("json parse, initial status: ns.rxBW: %d, ns.conn: %d, ns.err: %d\r\n", ns.rxBytesWaiting, ns.connected, ns.error);
@@ -331,26 +462,31 @@ bool FNJSON::parse()
         if (ns.rxBytesWaiting > 0)
         {
             _protocol->read(ns.rxBytesWaiting);
-            _parseBuffer += *_protocol->receiveBuffer;
+            // keep reading after an error to drain the response
+            if (!stream.failed())
+                stream.feed(_protocol->receiveBuffer->data(), _protocol->receiveBuffer->size());
+            parsed += _protocol->receiveBuffer->size();
             _protocol->receiveBuffer->clear();
         }
+        // no need to wait for connection close once the document is complete
+        if (stream.done())
+            break;
         _protocol->status(&ns);
 #ifdef ESP_PLATFORM
         vTaskDelay(10);
 #endif
     }
 
-    // Debug_printf("S: %s\r\n", _parseBuffer.c_str());
-    // only try and parse the buffer if it has data. Empty response doesn't need parsing.
-    if (!_parseBuffer.empty())
+    // only take the result if there was data. Empty response doesn't need parsing.
+    if (parsed > 0)
     {
-        _json = cJSON_Parse(_parseBuffer.c_str());
+        _json = stream.finish();
     }
 
     if (_json == nullptr)
     {
 #ifdef VERBOSE_PROTOCOL
-        Debug_printf("FNJSON::parse() - Could not parse JSON, parseBuffer length: %d\r\n", _parseBuffer.size());
+        Debug_printf("FNJSON::parse() - Could not parse JSON, received length: %u\r\n", (unsigned)parsed);
 #endif
         return false;
     }
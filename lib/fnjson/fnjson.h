@@ -13,6 +13,7 @@
 #include <string.h>
 
 #include "../network-protocol/Protocol.h"
+#include "fnjsonstream.h"
 
 class FNJSON
 {
@@ -23,13 +24,17 @@ public:
     void setLineEnding(const std::string &_lineEnding);
     void setProtocol(NetworkProtocol *newProtocol);
     void setReadQuery(const std::string &queryString, uint8_t queryParam);
+    const std::string &getReadQuery();
+    void setParseFilter(const std::string &filter);
     cJSON *resolveQuery();
     bool status(NetworkStatus *status);
     
     bool parse();
     int readValueLen();
     bool readValue(uint8_t *buf, unsigned short len);
-    std::string processString(std::string in);
+    bool readValueNext(uint8_t *buf, unsigned short len);
+    int readValueRemaining();
+    void processString(const char *in, std::string &out);
     int json_bytes_remaining = 0;
     void setQueryParam(uint8_t qp);
     
@@ -40,8 +45,15 @@ private:
     std::string _queryString;
     uint8_t _queryParam = 0;
     std::string lineEnding;
-    std::string getValue(cJSON *item);
-    std::string _parseBuffer;
+    void getValue(cJSON *item, std::string &out);
+    std::string _parseFilter;
+
+    // rendered value of current query and readValueNext() position
+    std::string _value;
+    size_t _valuePos = 0;
+    bool _valueRendered = false;
+    void renderValue();
+    void invalidateValue();
 };
 
 #endif /* JSON_H */
\ No newline at end of file
@@ -0,0 +1,480 @@
+/**
+ * Incremental JSON parser for #FujiNet
+ */
+
+#include "fnjsonstream.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../include/debug.h"
+
+// Same limit as cJSON_Parse()
+#define FNJSON_NESTING_LIMIT 1000
+
+/**
+ * ctor
+ */
+FNJSONStream::FNJSONStream()
+{
+}
+
+/**
+ * dtor
+ */
+FNJSONStream::~FNJSONStream()
+{
+    if (_root != nullptr)
+        cJSON_Delete(_root);
+}
+
+/**
+ * Start new document, split filter pointer into reference tokens
+ */
+void FNJSONStream::begin(const std::string &filter)
+{
+    if (_root != nullptr)
+        cJSON_Delete(_root);
+    _root = nullptr;
+    _stack.clear();
+    _filter.clear();
+    _token.clear();
+    _high_surrogate = 0;
+    _state = STATE_VALUE;
+
+    size_t pos = 0;
+    while (pos < filter.size())
+    {
+        if (filter[pos] != '/')
+        {
+            // not a JSON pointer, nothing would match
+            Debug_printf("FNJSONStream::begin - invalid filter \"%s\"\r\n", filter.c_str());
+            break;
+        }
+        size_t next = filter.find('/', pos + 1);
+        if (next == std::string::npos)
+            next = filter.size();
+        std::string token = filter.substr(pos + 1, next - pos - 1);
+        // unescape ~1 and ~0, in this order
+        for (size_t i = token.find("~1"); i != std::string::npos; i = token.find("~1", i + 1))
+            token.replace(i, 2, "/");
+        for (size_t i = token.find("~0"); i != std::string::npos; i = token.find("~0", i + 1))
+            token.replace(i, 2, "~");
+        _filter.push_back(token);
+        pos = next;
+    }
+}
+
+/**
+ * Decide what to do with the value which is about to start
+ * @return 0 skip it, 1 keep the container but filter its members, 2 keep whole value
+ */
+int FNJSONStream::_keep_value()
+{
+    if (_stack.empty())
+        return _filter.empty() ? 2 : 1;
+
+    Frame &parent = _stack.back();
+    if (parent.node == nullptr)
+        return 0;
+    if (parent.capture)
+        return 2;
+
+    const std::string &token = _filter[_stack.size() - 1];
+    if (parent.is_object)
+    {
+        if (parent.key != token)
+            return 0;
+    }
+    else if (std::to_string(parent.index) != token)
+    {
+        // skipped elements before the match are kept as null so the index still resolves
+        if (parent.index < atoi(token.c_str()))
+            cJSON_AddItemToArray(parent.node, cJSON_CreateNull());
+        return 0;
+    }
+    return _stack.size() == _filter.size() ? 2 : 1;
+}
+
+/**
+ * Attach finished (or just opened) value to its parent
+ */
+void FNJSONStream::_add_value(cJSON *item)
+{
+    if (_stack.empty())
+    {
+        _root = item;
+        return;
+    }
+    Frame &parent = _stack.back();
+    if (parent.is_object)
+        cJSON_AddItemToObject(parent.node, parent.key.c_str(), item);
+    else
+        cJSON_AddItemToArray(parent.node, item);
+}
+
+bool FNJSONStream::_push_container(bool is_object)
+{
+    if (_stack.size() >= FNJSON_NESTING_LIMIT)
+        return _fail();
+
+    int keep = _keep_value();
+    cJSON *node = nullptr;
+    if (keep)
+    {
+        node = is_object ? cJSON_CreateObject() : cJSON_CreateArray();
+        if (node == nullptr)
+            return _fail();
+        _add_value(node);
+    }
+    _stack.push_back({node, is_object, keep == 2, 0, std::string()});
+    _state = is_object ? STATE_KEY : STATE_VALUE;
+    return true;
+}
+
+bool FNJSONStream::_pop_container(bool is_object)
+{
+    if (_stack.empty() || _stack.back().is_object != is_object)
+        return _fail();
+    _stack.pop_back();
+    _state = _stack.empty() ? STATE_DONE : STATE_AFTER_VALUE;
+    return true;
+}
+
+/**
+ * First character of a value
+ */
+bool FNJSONStream::_start_value(char c)
+{
+    switch (c)
+    {
+    case '{':
+        return _push_container(true);
+    case '[':
+        return _push_container(false);
+    case '"':
+        _token.clear();
+        _token_is_key = false;
+        _keep_token = _keep_value() != 0;
+        _state = STATE_STRING;
+        return true;
+    case 't':
+        _literal = "true";
+        break;
+    case 'f':
+        _literal = "false";
+        break;
+    case 'n':
+        _literal = "null";
+        break;
+    default:
+        if (c == '-' || (c >= '0' && c <= '9'))
+        {
+            _token.assign(1, c);
+            _keep_token = _keep_value() != 0;
+            _state = STATE_NUMBER;
+            return true;
+        }
+        return _fail();
+    }
+    _literal_pos = 1;
+    _keep_token = _keep_value() != 0;
+    _state = STATE_LITERAL;
+    return true;
+}
+
+bool FNJSONStream::_end_string()
+{
+    if (_high_surrogate != 0)
+        return _fail();
+
+    if (_token_is_key)
+    {
+        _stack.back().key = _token;
+        _state = STATE_COLON;
+        return true;
+    }
+
+    if (_keep_token)
+    {
+        cJSON *item = cJSON_CreateString(_token.c_str());
+        if (item == nullptr)
+            return _fail();
+        _add_value(item);
+    }
+    _state = _stack.empty() ? STATE_DONE : STATE_AFTER_VALUE;
+    return true;
+}
+
+bool FNJSONStream::_end_number()
+{
+    char *end = nullptr;
+    double num = strtod(_token.c_str(), &end);
+    if (end == _token.c_str() || *end != '\0')
+        return _fail();
+
+    if (_keep_token)
+    {
+        cJSON *item = cJSON_CreateNumber(num);
+        if (item == nullptr)
+            return _fail();
+        _add_value(item);
+    }
+    _state = _stack.empty() ? STATE_DONE : STATE_AFTER_VALUE;
+    return true;
+}
+
+void FNJSONStream::_append_utf8(uint32_t cp)
+{
+    if (!_keep_token)
+        return;
+    if (cp < 0x80)
+    {
+        _token += (char)cp;
+    }
+    else if (cp < 0x800)
+    {
+        _token += (char)(0xC0 | (cp >> 6));
+        _token += (char)(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        _token += (char)(0xE0 | (cp >> 12));
+        _token += (char)(0x80 | ((cp >> 6) & 0x3F));
+        _token += (char)(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        _token += (char)(0xF0 | (cp >> 18));
+        _token += (char)(0x80 | ((cp >> 12) & 0x3F));
+        _token += (char)(0x80 | ((cp >> 6) & 0x3F));
+        _token += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+bool FNJSONStream::_fail()
+{
+    _state = STATE_ERROR;
+    return false;
+}
+
+/**
+ * Feed next chunk of document text
+ */
+bool FNJSONStream::feed(const char *data, size_t len)
+{
+    size_t i = 0;
+    while (i < len)
+    {
+        char c = data[i];
+
+        switch (_state)
+        {
+        case STATE_DONE:
+            return true; // trailing data is ignored, like cJSON_Parse() does
+
+        case STATE_ERROR:
+            return false;
+
+        case STATE_VALUE:
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+                break;
+            // empty array
+            if (c == ']' && !_stack.empty() && !_stack.back().is_object && _stack.back().index == 0)
+            {
+                if (!_pop_container(false))
+                    return false;
+                break;
+            }
+            if (!_start_value(c))
+                return false;
+            break;
+
+        case STATE_AFTER_VALUE:
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+                break;
+            if (c == ',')
+            {
+                Frame &top = _stack.back();
+                top.index++;
+                _state = top.is_object ? STATE_KEY : STATE_VALUE;
+                break;
+            }
+            if (c != '}' && c != ']')
+                return _fail();
+            if (!_pop_container(c == '}'))
+                return false;
+            break;
+
+        case STATE_KEY:
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+                break;
+            if (c == '}' && _stack.back().index == 0)
+            {
+                if (!_pop_container(true))
+                    return false;
+                break;
+            }
+            if (c != '"')
+                return _fail();
+            _token.clear();
+            _token_is_key = true;
+            // key is needed for matching the filter or for the kept object
+            _keep_token = _stack.back().node != nullptr;
+            _state = STATE_STRING;
+            break;
+
+        case STATE_COLON:
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+                break;
+            if (c != ':')
+                return _fail();
+            _state = STATE_VALUE;
+            break;
+
+        case STATE_STRING:
+        {
+            // copy plain characters in one go
+            size_t start = i;
+            while (i < len && data[i] != '"' && data[i] != '\\')
+                i++;
+            if (i > start)
+            {
+                if (_high_surrogate != 0)
+                    return _fail();
+                if (_keep_token)
+                    _token.append(data + start, i - start);
+            }
+            if (i == len)
+                continue;
+            if (data[i] == '"')
+            {
+                if (!_end_string())
+                    return false;
+            }
+            else
+                _state = STATE_STRING_ESC;
+            break;
+        }
+
+        case STATE_STRING_ESC:
+            if (c == 'u')
+            {
+                _hex = 0;
+                _hex_digits = 0;
+                _state = STATE_STRING_HEX;
+                break;
+            }
+            if (_high_surrogate != 0)
+                return _fail();
+            switch (c)
+            {
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case '"':
+            case '\\':
+            case '/':
+                break;
+            default:
+                return _fail();
+            }
+            if (_keep_token)
+                _token += c;
+            _state = STATE_STRING;
+            break;
+
+        case STATE_STRING_HEX:
+            if (c >= '0' && c <= '9')
+                _hex = (_hex << 4) | (c - '0');
+            else if (c >= 'a' && c <= 'f')
+                _hex = (_hex << 4) | (c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F')
+                _hex = (_hex << 4) | (c - 'A' + 10);
+            else
+                return _fail();
+            if (++_hex_digits < 4)
+                break;
+
+            if (_hex >= 0xD800 && _hex <= 0xDBFF)
+            {
+                // high surrogate, low surrogate must follow
+                if (_high_surrogate != 0)
+                    return _fail();
+                _high_surrogate = _hex;
+            }
+            else if (_hex >= 0xDC00 && _hex <= 0xDFFF)
+            {
+                if (_high_surrogate == 0)
+                    return _fail();
+                _append_utf8(0x10000 + (((_high_surrogate & 0x3FF) << 10) | (_hex & 0x3FF)));
+                _high_surrogate = 0;
+            }
+            else
+            {
+                if (_high_surrogate != 0)
+                    return _fail();
+                if (_hex != 0) // can't be stored in C string
+                    _append_utf8(_hex);
+            }
+            _state = STATE_STRING;
+            break;
+
+        case STATE_NUMBER:
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-')
+            {
+                _token += c;
+                break;
+            }
+            if (!_end_number())
+                return false;
+            continue; // process this character again
+
+        case STATE_LITERAL:
+            if (c != _literal[_literal_pos])
+                return _fail();
+            if (_literal[++_literal_pos] == '\0')
+            {
+                if (_keep_token)
+                {
+                    cJSON *item = (_literal[0] == 't') ? cJSON_CreateTrue() :
+                                  (_literal[0] == 'f') ? cJSON_CreateFalse() : cJSON_CreateNull();
+                    if (item == nullptr)
+                        return _fail();
+                    _add_value(item);
+                }
+                _state = _stack.empty() ? STATE_DONE : STATE_AFTER_VALUE;
+            }
+            break;
+        }
+        i++;
+    }
+    return _state != STATE_ERROR;
+}
+
+/**
+ * Finish document, hand over the tree to caller
+ */
+cJSON *FNJSONStream::finish()
+{
+    // a number as root value ends with the document
+    if (_state == STATE_NUMBER && _stack.empty())
+        _end_number();
+
+    cJSON *result = nullptr;
+    if (_state == STATE_DONE)
+    {
+        result = _root;
+    }
+    else if (_root != nullptr)
+    {
+        Debug_printf("FNJSONStream::finish - incomplete or invalid JSON\r\n");
+        cJSON_Delete(_root);
+    }
+    _root = nullptr;
+    _stack.clear();
+    _token.clear();
+    return result;
+}
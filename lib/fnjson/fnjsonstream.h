@@ -0,0 +1,98 @@
+/**
+ * Incremental JSON parser for #FujiNet
+ *
+ * Builds a cJSON tree from data fed in arbitrary chunks as it
+ * arrives from the network, so the document text never has to be
+ * held in memory. An optional JSON pointer filter limits the tree
+ * to the matching subtree, everything else is skipped while parsing.
+ */
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <cJSON.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class FNJSONStream
+{
+public:
+    FNJSONStream();
+    virtual ~FNJSONStream();
+
+    /**
+     * Start new document.
+     * @param filter JSON pointer (RFC 6901) of the subtree to keep, empty to keep everything.
+     */
+    void begin(const std::string &filter);
+
+    /**
+     * Feed next chunk of document
+     * @return false if the document is not valid JSON
+     */
+    bool feed(const char *data, size_t len);
+
+    /**
+     * Finish parsing, caller takes ownership of returned tree.
+     * @return root of the document or nullptr if the document is empty or invalid
+     */
+    cJSON *finish();
+
+    // true once the root value is complete, any further data is ignored
+    bool done() { return _state == STATE_DONE; }
+    bool failed() { return _state == STATE_ERROR; }
+
+private:
+    enum State
+    {
+        STATE_VALUE,        // expecting value
+        STATE_AFTER_VALUE,  // expecting ',' or closing bracket
+        STATE_KEY,          // expecting object key (or '}' for empty object)
+        STATE_COLON,        // expecting ':' after key
+        STATE_STRING,
+        STATE_STRING_ESC,
+        STATE_STRING_HEX,
+        STATE_NUMBER,
+        STATE_LITERAL,      // true, false or null
+        STATE_DONE,
+        STATE_ERROR
+    };
+
+    // Open object or array
+    struct Frame
+    {
+        cJSON *node;        // nullptr if container is skipped
+        bool is_object;
+        bool capture;       // keep the whole container
+        int index;          // array element index
+        std::string key;    // key of the member being parsed
+    };
+
+    State _state = STATE_VALUE;
+    cJSON *_root = nullptr;
+    std::vector<Frame> _stack;
+    std::vector<std::string> _filter;
+
+    // token being parsed
+    std::string _token;
+    bool _token_is_key = false;
+    bool _keep_token = false;
+    const char *_literal = nullptr;
+    size_t _literal_pos = 0;
+    uint32_t _hex = 0;
+    int _hex_digits = 0;
+    uint32_t _high_surrogate = 0;
+
+    int _keep_value();
+    void _add_value(cJSON *item);
+    bool _push_container(bool is_object);
+    bool _pop_container(bool is_object);
+    bool _start_value(char c);
+    bool _end_string();
+    bool _end_number();
+    void _append_utf8(uint32_t cp);
+    bool _fail();
+};
+
+#endif /* JSON_STREAM_H */
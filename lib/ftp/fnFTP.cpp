@@ -781,7 +781,26 @@ bool fnFTP::reconnect()
     return login(username, password, hostname, control_port);
 }
 
-bool fnFTP::open_file(string path, bool stor)
+bool fnFTP::keep_alive()
+{
+    if (control->connected())
+    {
+        if (fnSystem.millis() - _last_response < FTP_IDLE_CHECK)
+            return false;
+
+        control->flush();
+        NOOP();
+        if (!parse_response() && is_positive_completion_reply())
+            return false;
+
+        Debug_printf("fnFTP::keep_alive() - no response to NOOP\r\n");
+        control->stop();
+    }
+    Debug_println("Trying to re-login");
+    return login(username, password, hostname, control_port);
+}
+
+bool fnFTP::open_file(string path, bool stor, long offset)
 {
     if (!control->connected())
     {
@@ -803,6 +822,18 @@ bool fnFTP::open_file(string path, bool stor)
         return true;
     }
 
+    // Resume where transfer should start
+    if (!stor && offset > 0)
+    {
+        REST(offset);
+        if (parse_response() || !is_positive_intermediate_reply())
+        {
+            Debug_printf("Server could not restart at %ld. Response was: %s\r\n", offset, controlResponse.c_str());
+            data->stop();
+            return true;
+        }
+    }
+
     // Do command
     if (stor == true)
     {
@@ -833,6 +864,58 @@ bool fnFTP::open_file(string path, bool stor)
     }
 }
 
+bool fnFTP::abort_file()
+{
+    Debug_printf("fnFTP::abort_file()\r\n");
+    data->stop();
+    _stor = false;
+    _expect_control_response = false;
+
+    // Servers reply to ABOR with 426 and 226, only 226 or 225, NOOP reply marks the end
+    ABOR();
+    NOOP();
+    do
+    {
+        if (parse_response())
+        {
+            Debug_printf("Timed out waiting for 200.\r\n");
+            return true;
+        }
+    } while (_statusCode != 200);
+
+    return false;
+}
+
+bool fnFTP::get_size(string path, long &filesize)
+{
+    if (!control->connected())
+        return true;
+
+    SIZE(path);
+    if (parse_response() || _statusCode != 213)
+    {
+        Debug_printf("fnFTP::get_size(%s) - %s\r\n", path.c_str(), controlResponse.c_str());
+        return true;
+    }
+    filesize = atol(controlResponse.substr(4).c_str());
+    return false;
+}
+
+bool fnFTP::get_mtime(string path, string &mtime)
+{
+    if (!control->connected())
+        return true;
+
+    MDTM(path);
+    if (parse_response() || _statusCode != 213 || controlResponse.size() < 18)
+    {
+        Debug_printf("fnFTP::get_mtime(%s) - %s\r\n", path.c_str(), controlResponse.c_str());
+        return true;
+    }
+    mtime = controlResponse.substr(4, 14);
+    return false;
+}
+
 bool fnFTP::open_directory(string path, string pattern)
 {
     if (!control->connected())
@@ -1059,6 +1142,7 @@ bool fnFTP::parse_response()
     // update control response and status code
     controlResponse = string((char *)respBuf, num_read);
     _statusCode = atoi(controlResponse.substr(0, 3).c_str());
+    _last_response = fnSystem.millis();
     Debug_printf("fnFTP::parse_response() - %d, \"%s\"\r\n", _statusCode, controlResponse.c_str());
 
     return false; // ok
@@ -1068,7 +1152,7 @@ int fnFTP::read_response_line(char *buf, int buflen)
 {
     int num_read = 0;
     int c;
-    int tmout_counter = 1 + FTP_TIMEOUT / 50;
+    int tmout_counter = 1 + FTP_TIMEOUT / FTP_RESPONSE_POLL;
 
     while(true)
     {
@@ -1079,7 +1163,7 @@ int fnFTP::read_response_line(char *buf, int buflen)
                 Debug_printf("fnFTP::read_response_line() - Timeout waiting response\r\n");
                 return -1;
             }
-            fnSystem.delay(50);
+            fnSystem.delay(FTP_RESPONSE_POLL);
             continue;
         }
 
@@ -1102,7 +1186,7 @@ int fnFTP::read_response_line(char *buf, int buflen)
         // store char, ignore rest of too long response
         if (num_read < buflen)
             buf[num_read++] = (char) c;
-        tmout_counter = 1 + FTP_TIMEOUT / 50; // reset timeout counter
+        tmout_counter = 1 + FTP_TIMEOUT / FTP_RESPONSE_POLL; // reset timeout counter
     }
     return num_read;
 }
@@ -1231,3 +1315,27 @@ void fnFTP::STOR(string path)
     Debug_printf("fnFTP::STOR(%s)\r\n",path.c_str());
     control->write("STOR " + path + "\r\n");
 }
+
+void fnFTP::NOOP()
+{
+    Debug_printf("fnFTP::NOOP()\r\n");
+    control->write("NOOP\r\n");
+}
+
+void fnFTP::REST(long offset)
+{
+    Debug_printf("fnFTP::REST(%ld)\r\n", offset);
+    control->write("REST " + std::to_string(offset) + "\r\n");
+}
+
+void fnFTP::SIZE(string path)
+{
+    Debug_printf("fnFTP::SIZE(%s)\r\n", path.c_str());
+    control->write("SIZE " + path + "\r\n");
+}
+
+void fnFTP::MDTM(string path)
+{
+    Debug_printf("fnFTP::MDTM(%s)\r\n", path.c_str());
+    control->write("MDTM " + path + "\r\n");
+}
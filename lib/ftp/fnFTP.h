@@ -12,6 +12,8 @@
 using std::string;
 
 #define FTP_TIMEOUT 15000 // This is how long we wait for a reply packet from the server
+#define FTP_RESPONSE_POLL 5 // ms between checks for a reply, keep short as most commands wait for one
+#define FTP_IDLE_CHECK 30000 // Control connection quiet for longer than this is tested with NOOP before use
 
 class fnFTP
 {
@@ -54,9 +56,32 @@ public:
      * Open file on FTP server
      * @param path to file to open.
      * @param stor TRUE means STOR, otherwise RETR
+     * @param offset RETR only, start transfer at this byte offset (REST)
      * @return TRUE if error, FALSE if successful.
      */
-    bool open_file(string path, bool stor);
+    bool open_file(string path, bool stor, long offset = 0);
+
+    /**
+     * Stop RETR before end of file, control connection is ready for next command after.
+     * @return TRUE if error, FALSE if successful.
+     */
+    bool abort_file();
+
+    /**
+     * Get size of file on FTP server (SIZE)
+     * @param path file path
+     * @param filesize output file size
+     * @return TRUE if error, FALSE if successful.
+     */
+    bool get_size(string path, long &filesize);
+
+    /**
+     * Get modification time of file on FTP server (MDTM)
+     * @param path file path
+     * @param mtime output time as YYYYMMDDhhmmss
+     * @return TRUE if error, FALSE if successful.
+     */
+    bool get_mtime(string path, string &mtime);
 
     /**
      * Open directory on FTP server, grab it, and return back.
@@ -120,6 +145,13 @@ public:
      */
     bool reconnect();
 
+    /**
+     * Make sure control connection can be used, NOOP if it was quiet for a while,
+     * log in again if it was dropped.
+     * @return TRUE on error, FALSE on success
+     */
+    bool keep_alive();
+
 protected:
 private:
     /**
@@ -136,6 +168,9 @@ private:
     /* FTP status code, taken from FTP server response */
     int _statusCode = 0;
 
+    /* fnSystem.millis() of last control response */
+    uint64_t _last_response = 0;
+
     /**
      * The port number. (21 by default)
      */
@@ -316,6 +351,29 @@ private:
      */
     void STOR(string path);
 
+    /**
+     * @brief do nothing, keeps control connection open
+     */
+    void NOOP();
+
+    /**
+     * @brief start next transfer at offset
+     * @param offset byte offset in file
+     */
+    void REST(long offset);
+
+    /**
+     * @brief ask server for size of path
+     * @param path file path
+     */
+    void SIZE(string path);
+
+    /**
+     * @brief ask server for modification time of path
+     * @param path file path
+     */
+    void MDTM(string path);
+
 };
 
 #endif /* FNFTP_H */
\ No newline at end of file
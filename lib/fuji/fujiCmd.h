@@ -63,6 +63,7 @@
 #define FUJICMD_HASH_COMPUTE_NO_CLEAR      0xC3
 #define FUJICMD_HASH_CLEAR                 0xC2
 #define FUJICMD_GET_HEAP                   0xC1
+#define FUJICMD_HASH_FILE                  0xC0
 #define FUJICMD_QRCODE_OUTPUT              0xBF
 #define FUJICMD_QRCODE_LENGTH              0xBE
 #define FUJICMD_QRCODE_ENCODE              0xBD
@@ -10,6 +10,8 @@
 #include "fnFsSMB.h"
 #include "fnFsFTP.h"
 #include "fnFsHTTP.h"
+#include "fnDirListCache.h"
+#include "fnSystem.h"
 
 #include "utils.h"
 
@@ -22,6 +24,7 @@ void fujiHost::unmount()
 */
 void fujiHost::cleanup()
 {
+    _dir_cache_close();
     if (_fs != nullptr)
         _fs->dir_close();
 
@@ -97,12 +100,31 @@ void fujiHost::set_prefix(const char *prefix)
     Debug_printf("fujiHost::set_prefix new prefix = \"%s\"\n", _prefix);
 }
 
+/* Directory listings of remote hosts go through fnDirListCache
+*/
+bool fujiHost::_is_remote()
+{
+    return _type == HOSTTYPE_TNFS || _type == HOSTTYPE_SMB || _type == HOSTTYPE_FTP || _type == HOSTTYPE_HTTP;
+}
+
+void fujiHost::_dir_cache_close()
+{
+    if (_dir_cached)
+    {
+        _dircache.clear();
+        _dir_cached = false;
+    }
+}
+
 uint16_t fujiHost::dir_tell()
 {
     Debug_printf("::dir_tell {%d:%d}\n", slotid, _type);
     if (_fs == nullptr)
         return FNFS_INVALID_DIRPOS;
 
+    if (_dir_cached)
+        return _dircache.tell();
+
     uint16_t result = FNFS_INVALID_DIRPOS;
     switch (_type)
     {
@@ -125,6 +147,9 @@ bool fujiHost::dir_seek(uint16_t pos)
     if (_fs == nullptr)
         return false;
 
+    if (_dir_cached)
+        return _dircache.seek(pos);
+
     bool result = false;
     switch (_type)
     {
@@ -157,6 +182,10 @@ bool fujiHost::dir_open(const char *path, const char *pattern, uint16_t options)
 
     Debug_printf("::dir_open actual path = \"%s\"\n", realpath);
 
+    _dir_cache_close();
+    if (_is_remote())
+        return _dir_open_cached(realpath, pattern, options);
+
     int result = false;
     switch (_type)
     {
@@ -173,10 +202,49 @@ bool fujiHost::dir_open(const char *path, const char *pattern, uint16_t options)
     return result;
 }
 
+/* Serve listing from fnDirListCache, or read it from the file system and
+   store it there. Listings too large for the cache are read directly.
+*/
+bool fujiHost::_dir_open_cached(const char *realpath, const char *pattern, uint16_t options)
+{
+    if (fnDirListCache.lookup(_hostname, realpath, pattern, options, _fs, _dircache))
+    {
+        _dir_cached = true;
+        return true;
+    }
+
+    uint64_t start = fnSystem.millis();
+    if (!_fs->dir_open(realpath, pattern, options))
+        return false;
+
+    fsdir_entry_t *entry;
+    while ((entry = _fs->dir_read()) != nullptr)
+    {
+        if (_dircache.size() >= DIRLIST_CACHE_MAX_ENTRIES ||
+            !_dircache.add_entry(entry->filename, entry->isDir, entry->size, entry->modified_time))
+        {
+            Debug_printf("::dir_open \"%s\" too large to cache\n", realpath);
+            _dircache.clear();
+            _fs->dir_seek(0);
+            return true;
+        }
+    }
+    _fs->dir_close();
+    uint32_t list_ms = fnSystem.millis() - start;
+
+    fnDirListCache.store(_hostname, realpath, pattern, options, _dircache, _fs->dir_mtime(realpath), list_ms);
+    _dircache.apply_listing_order();
+    _dir_cached = true;
+    return true;
+}
+
 fsdir_entry_t *fujiHost::dir_nextfile()
 {
     Debug_printf("::dir_nextfile {%d:%d}\n", slotid, _type);
 
+    if (_dir_cached)
+        return _dircache.read();
+
     switch (_type)
     {
     case HOSTTYPE_LOCAL:
@@ -194,6 +262,11 @@ fsdir_entry_t *fujiHost::dir_nextfile()
 
 void fujiHost::dir_close()
 {
+    if (_dir_cached)
+    {
+        _dir_cache_close();
+        return;
+    }
     if (_type != HOSTTYPE_UNINITIALIZED && _fs != nullptr)
         _fs->dir_close();
 }
@@ -245,6 +318,10 @@ fnFile * fujiHost::fnfile_open(const char *path, char *fullpath, int fullpathlen
     }
     Debug_printf("fujiHost #%d opening file path \"%s\"\n", slotid, fullpath);
 
+    // Writing may create or change the file, cached listing would be stale
+    if (_is_remote() && strpbrk(mode, "wa+") != nullptr)
+        fnDirListCache.invalidate(_hostname, realpath);
+
     return _fs->fnfile_open(fullpath, mode);
 }
 
@@ -256,6 +333,9 @@ bool fujiHost::file_remove(char *fullpath)
     if (_type == HOSTTYPE_UNINITIALIZED || _fs == nullptr)
         return true;
 
+    if (_is_remote())
+        fnDirListCache.invalidate(_hostname, fullpath);
+
     return _fs->remove(fullpath);
 }
 
@@ -2,6 +2,7 @@
 #define _FUJI_HOST_
 
 #include "fnFS.h"
+#include "fnDirCache.h"
 
 #define MAX_HOSTNAME_LEN 32
 #define MAX_HOST_PREFIX_LEN 256
@@ -25,6 +26,14 @@ private:
     char _hostname[MAX_HOSTNAME_LEN] = { '\0' };
     char _prefix[MAX_HOST_PREFIX_LEN] = { '\0' };
 
+    // Directory being read comes from fnDirListCache instead of _fs
+    DirCache _dircache;
+    bool _dir_cached = false;
+
+    bool _is_remote();
+    void _dir_cache_close();
+    bool _dir_open_cached(const char *realpath, const char *pattern, uint16_t options);
+
     void cleanup();
     void unmount();
 
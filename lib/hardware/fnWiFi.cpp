@@ -19,6 +19,7 @@
 #include "fuji.h"
 #include "fnSystem.h"
 #include "fnConfig.h"
+#include "fnDNS.h"
 #include "httpService.h"
 #include "led.h"
 
@@ -628,6 +629,7 @@ void WiFiManager::_wifi_event_handler(void *arg, esp_event_base_t event_base,
             Debug_println("IP_EVENT_STA_GOT_IP");
             Debug_printf("Obtained IP address: %s\r\n", fnSystem.Net.get_ip4_address_str().c_str());
             pFnWiFi->_connected = true;
+            dns_cache_flush(); // may be a different network with different answers
             fnLedManager.set(eLed::LED_WIFI, true);
             fnSystem.Net.start_sntp_client();
             fnHTTPD.start();
@@ -644,6 +646,7 @@ void WiFiManager::_wifi_event_handler(void *arg, esp_event_base_t event_base,
             break;
         case IP_EVENT_STA_LOST_IP:
             Debug_println("IP_EVENT_STA_LOST_IP");
+            dns_cache_flush();
             break;
         case IP_EVENT_ETH_GOT_IP:
             Debug_println("IP_EVENT_ETH_GOT_IP");
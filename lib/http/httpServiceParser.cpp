@@ -8,6 +8,9 @@
 #include "fnSystem.h"
 #include "fnConfig.h"
 #include "fnWiFi.h"
+#include "fnDNS.h"
+#include "tnfslibBlockCache.h"
+#include "fnDirListCache.h"
 #include "fsFlash.h"
 #include "httpService.h"
 #include "fuji.h"
@@ -30,6 +33,9 @@ const string fnHttpServiceParser::substitute_tag(const string &tag)
         FN_IPMASK,
         FN_IPGATEWAY,
         FN_IPDNS,
+        FN_DNS_CACHE,
+        FN_TNFS_CACHE,
+        FN_DIRLIST_CACHE,
         FN_WIFISSID,
         FN_WIFIBSSID,
         FN_WIFIMAC,
@@ -148,6 +154,9 @@ const string fnHttpServiceParser::substitute_tag(const string &tag)
         "FN_IPMASK",
         "FN_IPGATEWAY",
         "FN_IPDNS",
+        "FN_DNS_CACHE",
+        "FN_TNFS_CACHE",
+        "FN_DIRLIST_CACHE",
         "FN_WIFISSID",
         "FN_WIFIBSSID",
         "FN_WIFIMAC",
@@ -302,6 +311,32 @@ const string fnHttpServiceParser::substitute_tag(const string &tag)
     case FN_IPDNS:
         resultstream << fnSystem.Net.get_ip4_dns_str();
         break;
+    case FN_DNS_CACHE:
+    {
+        fnDnsStats stats = dns_cache_stats();
+        resultstream << stats.hits << " hits, " << stats.negative_hits << " negative hits, "
+                     << stats.misses << " misses, " << stats.shared << " shared, " << stats.failures << " failures";
+        break;
+    }
+    case FN_TNFS_CACHE:
+    {
+        if (tnfs_block_cache.get_budget() == 0)
+        {
+            resultstream << "disabled";
+            break;
+        }
+        tnfsBlockCacheStats stats = tnfs_block_cache.get_stats();
+        resultstream << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions << " evictions, "
+                     << stats.invalidations << " invalidated, " << stats.blocks_used << " of " << stats.blocks_total << " blocks used";
+        break;
+    }
+    case FN_DIRLIST_CACHE:
+    {
+        DirListCacheStats stats = fnDirListCache.get_stats();
+        resultstream << stats.hits << " of " << stats.lookups << " lookups hit, " << stats.revalidated << " revalidated, "
+                     << stats.invalidations << " invalidated, " << stats.saved_ms << " ms saved";
+        break;
+    }
     case FN_WIFISSID:
         resultstream << fnWiFi.get_current_ssid();
         break;
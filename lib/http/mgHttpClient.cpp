@@ -1,14 +1,17 @@
 #ifndef ESP_PLATFORM
 
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <ctype.h>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sstream>
 #include <string>
 #include <vector>
+#include <sys/stat.h>
 
 // #include <mbedtls/debug.h>
 
@@ -44,13 +47,46 @@
 
 const char *webdav_depths[] = {"0", "1", "infinity"};
 
+void HttpBodyBuffer::release()
+{
+    std::vector<uint8_t>().swap(_buf);
+    clear();
+}
+
+size_t HttpBodyBuffer::put(const uint8_t *data, size_t len)
+{
+    if (_buf.empty())
+        _buf.resize(HTTP_CLIENT_BODY_BUFFER);
+
+    len = std::min(len, space());
+    size_t tail = (_head + _count) % _buf.size();
+    size_t first = std::min(len, _buf.size() - tail);
+    memcpy(&_buf[tail], data, first);
+    memcpy(&_buf[0], data + first, len - first);
+    _count += len;
+    return len;
+}
+
+size_t HttpBodyBuffer::get(uint8_t *dest, size_t len)
+{
+    len = std::min(len, _count);
+    if (len == 0)
+        return 0;
+
+    size_t first = std::min(len, _buf.size() - _head);
+    memcpy(dest, &_buf[_head], first);
+    memcpy(dest + first, &_buf[0], len - first);
+    _head = (_head + len) % _buf.size();
+    _count -= len;
+    if (_count == 0)
+        _head = 0;
+    return len;
+}
+
 mgHttpClient::mgHttpClient()
 {
     // Used for cert debugging:
     // mbedtls_debug_set_threshold(5);
-
-    _buffer_str.clear();
-    load_system_certs();
 }
 
 // Close connection, destroy any resoruces
@@ -59,15 +95,13 @@ mgHttpClient::~mgHttpClient()
     close();
 }
 
-void mgHttpClient::load_system_certs() {
-#if defined(__linux__) || defined(__APPLE__)
-    load_system_certs_unix();
-#elif defined(_WIN32)
-    load_system_certs_windows();
-#else
-    // report unsupported...
-#endif
-}
+/*
+ One CA bundle is shared by every client. It's read the first time a TLS connection
+ needs it and reloaded only when the bundle file changes. Clients keep a reference,
+ so a reload never frees the certificates from under an open connection.
+*/
+static std::mutex ca_store_mutex;
+static std::shared_ptr<const std::string> ca_store;
 
 #if defined(_WIN32)
 
@@ -162,79 +196,244 @@ std::vector<std::vector<unsigned char>> EnumerateCertificates() {
     return certificates;
 }
 
-void mgHttpClient::load_system_certs_windows() {
-    auto certificates = EnumerateCertificates();
-    auto pemCertificates = ConvertCertificatesToPEM(certificates);
+static std::shared_ptr<const std::string> ca_store_get()
+{
+    std::lock_guard<std::mutex> lock(ca_store_mutex);
+
+    // The system store has no modification time to watch, load it once
+    if (ca_store)
+        return ca_store;
+
+    auto pem = std::make_shared<std::string>();
+    auto pemCertificates = ConvertCertificatesToPEM(EnumerateCertificates());
     if (!pemCertificates.empty()) {
         Debug_printf("System certificates loaded, count: %d\n", pemCertificates.size());
         for (const auto& pemData : pemCertificates) {
-            concatenatedPEM.append(pemData.begin(), pemData.end());
+            pem->append(pemData.begin(), pemData.end());
         }
-
-        ca.ptr = concatenatedPEM.c_str();
-        ca.len = concatenatedPEM.length();
     }
     else {
         Debug_printf("WARNING: could not find system certificate file, falling back to local file.\n");
-        ca = mg_file_read(&mg_fs_posix, "data/ca.pem");
+        mg_str tempCa = mg_file_read(&mg_fs_posix, "data/ca.pem");
+        if (tempCa.ptr != NULL) {
+            pem->assign(tempCa.ptr, tempCa.len);
+            free((void*)tempCa.ptr);
+        }
     }
+
+    ca_store = pem;
+    return ca_store;
 }
 
 #else // !_WIN32
 
-void mgHttpClient::load_system_certs_unix() {
-    int cert_count = 0;
-    certDataStorage.clear();
-
-    // Load the initial certificate file
+static const char *ca_bundle_paths[] = {
 #if defined(__linux__)
-    mg_str tempCa = mg_file_read(&mg_fs_posix, "/etc/ssl/certs/ca-certificates.crt");
+    "/etc/ssl/certs/ca-certificates.crt",
 #else // MAC
-    mg_str tempCa = mg_file_read(&mg_fs_posix, "/etc/ssl/cert.pem");
+    "/etc/ssl/cert.pem",
 #endif
+    "data/ca.pem"
+};
 
-    if (tempCa.len == 0) {
-        Debug_printf("WARNING: could not find system certificate file, falling back to local file.\n");
-        // If the initial load fails, try the fallback file
-        if (tempCa.ptr != NULL) {
-            free((void*)tempCa.ptr); // Free the memory if it was allocated
-        }
-        tempCa = mg_file_read(&mg_fs_posix, "data/ca.pem");
+static std::string ca_store_path;
+static time_t ca_store_mtime = 0;
+static off_t ca_store_size = 0;
+
+// Keep just the certificate blocks of a PEM bundle
+static std::string ca_extract_certs(const std::string &bundle, int &cert_count)
+{
+    static const std::string begin = "-----BEGIN CERTIFICATE-----";
+    static const std::string end = "-----END CERTIFICATE-----";
+
+    std::string certs;
+    certs.reserve(bundle.size());
+
+    size_t pos = 0;
+    while ((pos = bundle.find(begin, pos)) != std::string::npos)
+    {
+        size_t stop = bundle.find(end, pos);
+        if (stop == std::string::npos)
+            break;
+        stop += end.size();
+        certs.append(bundle, pos, stop - pos);
+        certs += '\n';
+        cert_count++;
+        pos = stop;
     }
+    certs.shrink_to_fit();
+    return certs;
+}
 
-    if (tempCa.ptr != NULL) {
-        // Process the certificate data
-        std::string certData(tempCa.ptr, tempCa.len);
-        std::istringstream certStream(certData);
-        std::string line;
-        bool inCertBlock = false;
-
-        while (std::getline(certStream, line)) {
-            if (line.find("-----BEGIN CERTIFICATE-----") != std::string::npos) {
-                inCertBlock = true;
-                cert_count++;
-            }
-            if (inCertBlock) {
-                certDataStorage += line + "\n";
-            }
-            if (line.find("-----END CERTIFICATE-----") != std::string::npos) {
-                inCertBlock = false;
-            }
-        }
+static std::shared_ptr<const std::string> ca_store_get()
+{
+    std::lock_guard<std::mutex> lock(ca_store_mutex);
+
+    for (const char *path : ca_bundle_paths)
+    {
+        struct stat st;
+        if (stat(path, &st) != 0 || st.st_size == 0)
+            continue;
+
+        if (ca_store && ca_store_path == path && ca_store_mtime == st.st_mtime && ca_store_size == st.st_size)
+            return ca_store;
 
-        // Free the memory allocated by mg_file_read
+        mg_str tempCa = mg_file_read(&mg_fs_posix, path);
+        if (tempCa.ptr == NULL)
+            continue;
+
+        int cert_count = 0;
+        ca_store = std::make_shared<const std::string>(ca_extract_certs(std::string(tempCa.ptr, tempCa.len), cert_count));
         free((void*)tempCa.ptr);
-    }
 
-    // Update 'ca' to point to the processed certificates stored in 'certDataStorage'
-    ca.ptr = certDataStorage.c_str();
-    ca.len = certDataStorage.length();
+        ca_store_path = path;
+        ca_store_mtime = st.st_mtime;
+        ca_store_size = st.st_size;
+        Debug_printf("System certificates loaded from %s, count: %d\n", path, cert_count);
+        return ca_store;
+    }
 
-    Debug_printf("System certificates loaded, count: %d\n", cert_count);
+    if (!ca_store)
+    {
+        Debug_printf("WARNING: could not find a certificate file\n");
+        ca_store = std::make_shared<const std::string>();
+    }
+    return ca_store;
 }
 
 #endif
 
+void mgHttpClient::load_system_certs()
+{
+    _ca_store = ca_store_get();
+    ca = mg_str_n(_ca_store->data(), _ca_store->size());
+}
+
+/*
+ Connections the server keeps open after a response are parked here with their manager
+ and handed to the next request for the same scheme, host and port, from any client.
+ A parked connection isn't polled, so it's checked for a close by the server when taken.
+ Parked connections have no client (fn_data is nullptr) and ignore their events.
+*/
+struct http_pool_entry
+{
+    std::string key;
+    std::unique_ptr<mg_mgr, MgMgrDeleter> mgr;
+    mg_connection *conn = nullptr;
+    uint64_t idle_since = 0;
+};
+
+static std::mutex http_pool_mutex;
+static std::vector<http_pool_entry> http_pool; // oldest first
+
+static std::string http_pool_key(const char *url)
+{
+    struct mg_str host = mg_url_host(url);
+    return std::string(mg_url_is_ssl(url) ? "https://" : "http://") + std::string(host.ptr, host.len)
+        + ":" + std::to_string(mg_url_port(url));
+}
+
+// Must be called with http_pool_mutex held
+static void http_pool_expire()
+{
+    uint64_t now = fnSystem.millis();
+    while (!http_pool.empty() && now - http_pool.front().idle_since > HTTP_CLIENT_POOL_IDLE)
+        http_pool.erase(http_pool.begin());
+}
+
+// Drops expired idle connections, skipped while a client is using the pool
+void mgHttpClient::pool_service()
+{
+    std::unique_lock<std::mutex> lock(http_pool_mutex, std::try_to_lock);
+    if (lock.owns_lock())
+        http_pool_expire();
+}
+
+static bool http_pool_alive(mg_mgr *mgr, mg_connection *conn)
+{
+    // Let the manager notice a close or stray data that arrived while idle
+    mg_mgr_poll(mgr, 0);
+    for (mg_connection *c = mgr->conns; c != nullptr; c = c->next)
+    {
+        if (c == conn)
+            return !c->is_closing && !c->is_draining && c->recv.len == 0;
+    }
+    return false;
+}
+
+// Hands out the newest open connection for key along with its manager
+static bool http_pool_take(const std::string &key, std::unique_ptr<mg_mgr, MgMgrDeleter> &mgr, mg_connection *&conn)
+{
+    std::lock_guard<std::mutex> lock(http_pool_mutex);
+    http_pool_expire();
+
+    for (size_t i = http_pool.size(); i-- > 0;)
+    {
+        if (http_pool[i].key != key)
+            continue;
+
+        bool alive = http_pool_alive(http_pool[i].mgr.get(), http_pool[i].conn);
+        if (alive)
+        {
+            mgr = std::move(http_pool[i].mgr);
+            conn = http_pool[i].conn;
+        }
+        http_pool.erase(http_pool.begin() + i);
+        if (alive)
+            return true;
+    }
+    return false;
+}
+
+static void http_pool_put(const std::string &key, std::unique_ptr<mg_mgr, MgMgrDeleter> &mgr, mg_connection *conn)
+{
+    std::lock_guard<std::mutex> lock(http_pool_mutex);
+    http_pool_expire();
+
+    // Make room, closing the longest idle connection to this host or else to any host
+    int same_host = 0;
+    for (const auto &e : http_pool)
+        if (e.key == key)
+            same_host++;
+    if (same_host >= HTTP_CLIENT_POOL_PER_HOST)
+    {
+        for (size_t i = 0; i < http_pool.size(); i++)
+        {
+            if (http_pool[i].key == key)
+            {
+                http_pool.erase(http_pool.begin() + i);
+                break;
+            }
+        }
+    }
+    else if (http_pool.size() >= HTTP_CLIENT_POOL_SIZE)
+        http_pool.erase(http_pool.begin());
+
+    conn->fn_data = nullptr;
+    http_pool_entry e;
+    e.key = key;
+    e.mgr = std::move(mgr);
+    e.conn = conn;
+    e.idle_since = fnSystem.millis();
+    http_pool.push_back(std::move(e));
+}
+
+// Keep a connection the server left open for the next request, close anything else
+void mgHttpClient::_release_connection()
+{
+    if (_conn != nullptr && _handle != nullptr)
+    {
+        if (HTTP_CLIENT_POOL_SIZE > 0 && _conn_idle && !_conn->is_closing && !_conn->is_draining && _conn->recv.len == 0)
+        {
+            http_pool_put(_conn_key, _handle, _conn);
+        }
+        else
+            _handle.reset(); // closes the connection
+    }
+    _conn = nullptr;
+    _conn_idle = false;
+}
+
 // Start an HTTP client session to the given URL
 bool mgHttpClient::begin(std::string url)
 {
@@ -247,26 +446,25 @@ bool mgHttpClient::begin(std::string url)
 
     _post_data = nullptr;
     _post_datalen = 0;
-    
-    _handle.reset(new mg_mgr());
-    if (_handle == nullptr)
-        return false;
+
+    // Any connection still open from a previous request goes back to the pool,
+    // a manager is only set up once a request needs a new connection
+    _release_connection();
 
     _url = url;
     // For mongoose, lowercase the first 5 characters of the URL, assuming it starts with http:// or https://
     for (size_t i = 0; i < 5 && i < _url.size(); ++i)
         _url[i] = std::tolower(_url[i]);
-    mg_mgr_init(_handle.get());
     return true;
 }
 
 int mgHttpClient::available()
 {
-    if (_handle != nullptr && !_transaction_done && _buffer_str.size() == 0)
+    if (_handle != nullptr && !_transaction_done && _body.used() == 0)
     {
         _perform_fetch();
     }
-    return _buffer_str.size();
+    return _body.used();
 }
 
 /*
@@ -277,25 +475,19 @@ int mgHttpClient::available()
 */
 int mgHttpClient::read(uint8_t *dest_buffer, int dest_bufflen)
 {
-    if (_handle == nullptr || dest_buffer == nullptr)
+    if (_url.empty() || dest_buffer == nullptr)
         return -1;
 
     int bytes_copied = 0;
-    int bytes_available = _buffer_str.size();
 
     while (bytes_copied < dest_bufflen)
     {
-        if (bytes_available > 0)
+        if (_body.used() > 0)
         {
-            // Copy our buffer to the destination buffer
-            int dest_size = dest_bufflen - bytes_copied;
-            int bytes_to_copy = dest_size > bytes_available ? bytes_available : dest_size;
 #ifdef VERBOSE_HTTP
-            Debug_printf("::read from buffer %d\r\n", bytes_to_copy);
+            Debug_printf("::read from buffer %u\r\n", (unsigned)std::min<size_t>(_body.used(), dest_bufflen - bytes_copied));
 #endif
-            memcpy(dest_buffer + bytes_copied, _buffer_str.data(), bytes_to_copy);
-            _buffer_str.erase(0, bytes_to_copy);
-            bytes_copied += bytes_to_copy;
+            bytes_copied += _body.get(dest_buffer + bytes_copied, dest_bufflen - bytes_copied);
         }
         else 
         {
@@ -303,14 +495,13 @@ int mgHttpClient::read(uint8_t *dest_buffer, int dest_bufflen)
             if (!_transaction_done)
             {
                 _perform_fetch();
-                bytes_available = _buffer_str.size();
             }
             if (_status_code >= 400)
             {
                 // HTTP client error occurred
                 return -1;
             }
-            if (bytes_available == 0)
+            if (_body.used() == 0)
             {
                 // No more data to read
 #ifdef VERBOSE_HTTP
@@ -328,9 +519,10 @@ int mgHttpClient::read(uint8_t *dest_buffer, int dest_bufflen)
 void mgHttpClient::close()
 {
     Debug_println("mgHttpClient::close");
+    _release_connection();
     _stored_headers.clear();
     _request_headers.clear();
-    _buffer_str.clear();
+    _body.release();
 }
 
 const char* mgHttpClient::method_to_string(HttpMethod method)
@@ -350,6 +542,12 @@ const char* mgHttpClient::method_to_string(HttpMethod method)
     }
 }
 
+// Methods that can be sent again when it's unknown whether the server got them
+bool mgHttpClient::_method_is_idempotent()
+{
+    return _method == HTTP_GET || _method == HTTP_HEAD || _method == HTTP_PROPFIND;
+}
+
 void mgHttpClient::handle_connect(struct mg_connection *c)
 {
 #ifdef VERBOSE_HTTP
@@ -358,7 +556,6 @@ void mgHttpClient::handle_connect(struct mg_connection *c)
     _transaction_done = false;
 
     const char *url = _url.c_str();
-    struct mg_str host = mg_url_host(url);
     // If url is https://, tell client connection to use TLS
     if (mg_url_is_ssl(url))
     {
@@ -367,17 +564,26 @@ void mgHttpClient::handle_connect(struct mg_connection *c)
 #ifdef SKIP_SERVER_CERT_VERIFY                
         opts.ca.ptr = nullptr; // disable certificate checking 
 #else
-        // certificates are loaded on initialization of the client in cross platform way.
+        // shared with the other clients, loaded on first use
+        load_system_certs();
         opts.ca = ca;
 
         // this is how to load the files rather than refer to them by name (for BUILT_IN tls)
         // opts.cert = mg_file_read(&mg_fs_posix, "tls/cert.pem");
         // opts.key = mg_file_read(&mg_fs_posix, "tls/private-key.pem");
 #endif
-        opts.name = host;
+        opts.name = mg_url_host(url);
         mg_tls_init(c, &opts);
     }
 
+    send_request(c);
+}
+
+void mgHttpClient::send_request(struct mg_connection *c)
+{
+    const char *url = _url.c_str();
+    struct mg_str host = mg_url_host(url);
+
     // reset response status code
     _status_code = -1;
 
@@ -407,8 +613,9 @@ void mgHttpClient::handle_connect(struct mg_connection *c)
             // start the request
             mg_printf(c, "%s %s HTTP/1.1\r\n"
                             "Host: %.*s\r\n"
-                            "Connection: close\r\n",
-                            method_str, mg_url_uri(url), (int)host.len, host.ptr);
+                            "Connection: %s\r\n",
+                            method_str, mg_url_uri(url), (int)host.len, host.ptr,
+                            HTTP_CLIENT_POOL_SIZE > 0 ? "keep-alive" : "close");
 
             // send auth header
             if (!_username.empty())
@@ -485,14 +692,23 @@ void mgHttpClient::handle_read(struct mg_connection *c)
             process_response_headers(c, hm, hdrs_len);
             _transaction_begin = false; // indicate the headers are processed
             _processed = true; // stop polling, headers are available
+            if (_body_remaining == 0)
+                response_done(c);
         }
     }
 
-    // Append body data to buffer, if any
-    if (!_transaction_begin && c->recv.len > 0)
+    // Move body data to our buffer, as much as fits
+    if (!_transaction_begin && !_transaction_done && c->recv.len > 0)
     {
-        process_body_data(c, (char *)c->recv.buf, c->recv.len);
+        size_t used = process_body_data(c, (const char *)c->recv.buf, c->recv.len);
+        if (used < c->recv.len)
+            mg_iobuf_del(&c->recv, 0, used);
+        else
+            c->recv.len = 0;
     }
+
+    // Leave the socket unread until read() makes room, the rest waits in c->recv
+    c->is_full = !_transaction_begin && !_transaction_done && c->recv.len > 0 && _body.space() == 0;
 }
 
 void mgHttpClient::process_response_headers(struct mg_connection *c, struct mg_http_message &hm, int hdrs_len)
@@ -520,6 +736,24 @@ void mgHttpClient::process_response_headers(struct mg_connection *c, struct mg_h
         }
     }
 
+    // Find where the response ends, the connection can be reused after that
+    struct mg_str *conn_hdr = mg_http_get_header(&hm, "Connection");
+    if (conn_hdr != nullptr && mg_vcasecmp(conn_hdr, "close") == 0)
+        _keep_alive = false;
+    else if (mg_vcasecmp(&hm.method, "HTTP/1.0") == 0)
+        _keep_alive = conn_hdr != nullptr && mg_vcasecmp(conn_hdr, "keep-alive") == 0;
+    else
+        _keep_alive = true;
+
+    if (_method == HTTP_HEAD || _status_code == 204 || _status_code == 304)
+        _body_remaining = 0;
+    else if (_is_chunked)
+        _body_remaining = (size_t)-1; // ends with the last chunk
+    else
+        _body_remaining = hm.body.len;
+    if (_body_remaining == (size_t)-1 && !_is_chunked)
+        _keep_alive = false; // body ends when the server closes
+
 #ifdef VERBOSE_HTTP
     Debug_printf("  Headers: %d bytes\n", hdrs_len);
     Debug_printf("  status_code: %d\n", _status_code);
@@ -564,71 +798,109 @@ static bool is_hex_digit(int c)
            (c >= 'A' && c <= 'F');
 }
 
-// from mongoose.c
-static int skip_chunk(const char *buf, int len, int *pl, int *dl) 
-{
-    int i = 0, n = 0;
-    if (len < 3) return 0;
-    while (i < len && is_hex_digit(buf[i])) i++;
-    if (i == 0) return -1;                     // Error, no length specified
-    if (i > (int) sizeof(int) * 2) return -1;  // Chunk length is too big
-    if (len < i + 1 || buf[i] != '\r' || buf[i + 1] != '\n') return -1;  // Error
-    n = (int) mg_unhexn(buf, (size_t) i);  // Decode chunk length
-    if (n < 0) return -1;                  // Error
-    if (n > len - i - 4) return 0;         // Chunk not yet fully buffered
-    if (buf[i + n + 2] != '\r' || buf[i + n + 3] != '\n') return -1;  // Error
-    *pl = i + 2, *dl = n;
-    return i + 2 + n + 2;
-}
-  
-void mgHttpClient::process_body_data(struct mg_connection *c, char *data, int len)
+/*
+ Moves body data from the mongoose receive buffer to ours, returns bytes used up.
+ Stops when our buffer is full, chunks are decoded as they arrive so one larger
+ than the buffer is passed on in pieces.
+*/
+size_t mgHttpClient::process_body_data(struct mg_connection *c, const char *data, size_t len)
 {
 #ifdef VERBOSE_HTTP
-        Debug_printf("  Body: %d bytes\n", len);
+        Debug_printf("  Body: %u bytes\n", (unsigned)len);
         //Debug_printf("  Body data:\n%.*s\n", len, data);  // Print body
 #endif
+    size_t used = 0;
+
     if (_is_chunked)
     {
-        int o = 0, l = 0, pl, dl, cl;
-        // Get all complete chunks out of mongoose buffer
-        while ((cl = skip_chunk(data + o, len - o, &pl, &dl)) > 0)
+        while (used < len && !_transaction_done)
         {
-            // Append chunks data to our buffer
-            if (dl > 0)
+            if (_chunk_left > 0)
             {
-                _buffer_str.append(data + o + pl, dl);
+                size_t n = _body.put((const uint8_t *)data + used, std::min(_chunk_left, len - used));
+                if (n == 0)
+                    break; // our buffer is full
+                used += n;
+                _chunk_left -= n;
+                _processed = true; // stop polling, data is available in _body
+                continue;
             }
-            o += cl;
-        }
-        if (o > 0)
-        {
-            // Remove chunks from mongoose buffer
-            if (o < len)
+
+            // Chunk size line, or the CRLF ending the previous chunk's data
+            const char *line = data + used;
+            const char *nl = (const char *)memchr(line, '\n', len - used);
+            if (nl == nullptr)
             {
-                memmove(data, data + o, (size_t)(len - o));
-                c->recv.len -= o;
+                if (len - used < 32)
+                    break; // wait for the rest of the line
+                nl = line; // too long for a chunk size
             }
-            else
+            size_t line_len = nl - line + 1;
+
+            int digits = 0;
+            while (line + digits < nl && is_hex_digit(line[digits]))
+                digits++;
+
+            if (_chunk_crlf ? line_len != 2 || line[0] != '\r'
+                            : digits == 0 || digits > (int)sizeof(int) * 2 || nl[-1] != '\r')
             {
-                c->recv.len = 0;
+                Debug_println("mgHttpClient: Invalid chunk");
+                c->is_draining = 1;
+                return len;
+            }
+            used += line_len;
+
+            if (_chunk_crlf)
+            {
+                _chunk_crlf = false;
+                continue;
+            }
+
+            _chunk_left = mg_unhexn(line, digits);
+            _chunk_crlf = true;
+            if (_chunk_left == 0)
+            {
+                // Last chunk, don't reuse the connection if trailers follow
+                if (len - used >= 2 && data[used] == '\r' && data[used + 1] == '\n')
+                    used += 2;
+                else
+                    _keep_alive = false;
+                _processed = true;
+                response_done(c);
             }
-            _processed = true; // stop polling, data is available in _buffer_str
-        }
-        if (cl < 0) 
-        {
-            Debug_println("mgHttpClient: Invalid chunk");
-            c->is_draining = 1;
-            c->recv.len = 0;
-            return;
         }
     }
     else
     {
-        // Append entire body data to buffer
-        _buffer_str.append(data, len);
-        c->recv.len = 0;   // cleanup mongoose receive buffer
-        _processed = true; // stop polling, data is available in _buffer_str
+        // Append body data to buffer, up to the end of the response
+        size_t n = len;
+        if (_body_remaining != (size_t)-1)
+            n = std::min(n, _body_remaining);
+        n = _body.put((const uint8_t *)data, n);
+        if (_body_remaining != (size_t)-1)
+            _body_remaining -= n;
+        used = n;
+        if (n > 0)
+            _processed = true; // stop polling, data is available in _body
+
+        if (_body_remaining == 0)
+        {
+            if (used < len)
+            {
+                used = len;
+                _keep_alive = false; // more than was announced, don't trust the connection
+            }
+            response_done(c);
+        }
     }
+    return used;
+}
+
+// Whole response received, the connection stays open if the server allows another request
+void mgHttpClient::response_done(struct mg_connection *c)
+{
+    _transaction_done = true;
+    _conn_idle = _keep_alive && c == _conn;
 }
 
 void report_unhandled(int ev)
@@ -681,7 +953,11 @@ void mgHttpClient::_httpevent_handler(struct mg_connection *c, int ev, void *ev_
     // // Our user_data should be a pointer to our mgHttpClient object
     mgHttpClient *client = (mgHttpClient *)c->fn_data;
     bool progress = true;
-    
+
+    // Idle connection waiting in the pool
+    if (client == nullptr)
+        return;
+
     switch (ev)
     {
     case MG_EV_CONNECT:
@@ -697,11 +973,17 @@ void mgHttpClient::_httpevent_handler(struct mg_connection *c, int ev, void *ev_
         Debug_printf("mgHttpClient: Connection closed\n");
 #endif
         client->_transaction_done = true;
+        if (client->_conn == c)
+        {
+            client->_conn = nullptr;
+            client->_conn_idle = false;
+        }
         break;
     
     case MG_EV_ERROR:
         Debug_printf("mgHttpClient: Error - %s\n", (const char*)ev_data);
         client->_transaction_done = true;
+        client->_conn_idle = false;
         client->_status_code = 901; // Fake HTTP status code to indicate connection error
         break;
     
@@ -737,6 +1019,14 @@ int mgHttpClient::_perform()
     while (!done)
     {
         _perform_fetch(); // process up until we have all headers
+        // A pooled connection may have been closed by the server just as it was reused.
+        // The request may have been acted on, so it's only sent again if that does no harm.
+        if (_conn_reused && _transaction_begin && _transaction_done && _status_code != 408 && _method_is_idempotent())
+        {
+            Debug_println("mgHttpClient: kept-alive connection lost, reconnecting");
+            _perform_connect(false);
+            continue;
+        }
         // check the response code
         if (_status_code == 301 || _status_code == 302)
             done = !_perform_redirect(); // continue if we're going to redirect
@@ -757,23 +1047,54 @@ int mgHttpClient::_perform()
 /*
  Initiate HTTP connection
  */
-void mgHttpClient::_perform_connect()
+void mgHttpClient::_perform_connect(bool reuse)
 {
     _status_code = -1;
     _content_length = 0;
     _is_chunked = false;
+    _chunk_left = 0;
+    _chunk_crlf = false;
+    _keep_alive = false;
+    _body_remaining = 0;
+
+    // Done with the previous connection, it's parked in the pool if the server keeps it open
+    _release_connection();
 
     _transaction_begin = true; // waiting for response headers
     _transaction_done = false;
 
+    // Send on an open connection to the same server if there is one
+    _conn_key = http_pool_key(_url.c_str());
+    _conn_reused = reuse && HTTP_CLIENT_POOL_SIZE > 0 && http_pool_take(_conn_key, _handle, _conn);
+    if (_conn_reused)
+    {
+#ifdef VERBOSE_HTTP
+        Debug_printf("mgHttpClient: reusing connection to %s\n", _conn_key.c_str());
+#endif
+        _conn->fn_data = this;
+        send_request(_conn);
+        return;
+    }
+
     if (_handle == nullptr)
+    {
+        _handle.reset(new mg_mgr());
+        if (_handle == nullptr)
+        {
+            _transaction_begin = false;
+            _transaction_done = true;
+            _status_code = 900; // Fake HTTP status code to indicate general error
+            return;
+        }
+        mg_mgr_init(_handle.get());
+    }
+
+    _conn = mg_connect(_handle.get(), _url.c_str(), _httpevent_handler, this);  // Create client connection
+    if (_conn == nullptr)
     {
         _transaction_done = true;
-        _status_code = 900; // Fake HTTP status code to indicate general error
-        return;
+        _status_code = 900;
     }
-    
-    mg_connect(_handle.get(), _url.c_str(), _httpevent_handler, this);  // Create client connection
 }
 
 void mgHttpClient::_perform_fetch()
@@ -789,9 +1110,18 @@ void mgHttpClient::_perform_fetch()
         return;
     }
 
+    // Body data held back while our buffer was full
+    if (_conn != nullptr && !_transaction_begin && _conn->recv.len > 0)
+    {
+        handle_read(_conn);
+        if (_processed || _transaction_done)
+            return;
+    }
+
     while (true)
     {
         mg_mgr_poll(_handle.get(), 50);
+        pool_service();
         
         if (_processed || _transaction_done)
             break; // header and/or body data processed, or transaction done
@@ -847,9 +1177,10 @@ void mgHttpClient::_flush_response()
 {
     while (!_transaction_done)
     {
+        _body.clear();
         _perform_fetch();
     }
-    _buffer_str.clear();
+    _body.clear();
 }
 
 int mgHttpClient::PUT(const char *put_data, int put_datalen)
@@ -857,7 +1188,7 @@ int mgHttpClient::PUT(const char *put_data, int put_datalen)
 #ifdef VERBOSE_HTTP
     Debug_println("mgHttpClient::PUT");
 #endif
-    if (_handle == nullptr || put_data == nullptr || put_datalen < 1)
+    if (_url.empty() || put_data == nullptr || put_datalen < 1)
         return -1;
 
     // Get rid of any pending data
@@ -876,7 +1207,7 @@ int mgHttpClient::PROPFIND(webdav_depth depth, const char *properties_xml)
 #ifdef VERBOSE_HTTP
     Debug_println("mgHttpClient::PROPFIND");
 #endif
-    if (_handle == nullptr)
+    if (_url.empty())
         return -1;
 
     // Get rid of any pending data
@@ -906,7 +1237,7 @@ int mgHttpClient::DELETE()
 #ifdef VERBOSE_HTTP
     Debug_println("mgHttpClient::DELETE");
 #endif
-    if (_handle == nullptr)
+    if (_url.empty())
         return -1;
 
     // Get rid of any pending data
@@ -923,7 +1254,7 @@ int mgHttpClient::MKCOL()
 #ifdef VERBOSE_HTTP
     Debug_println("mgHttpClient::MKCOL");
 #endif
-    if (_handle == nullptr)
+    if (_url.empty())
         return -1;
 
     // Get rid of any pending data
@@ -940,7 +1271,7 @@ int mgHttpClient::COPY(const char *destination, bool overwrite, bool move)
 #ifdef VERBOSE_HTTP
     Debug_println("mgHttpClient::COPY");
 #endif
-    if (_handle == nullptr || destination == nullptr)
+    if (_url.empty() || destination == nullptr)
         return -1;
 
     // Get rid of any pending data
@@ -976,7 +1307,7 @@ int mgHttpClient::POST(const char *post_data, int post_datalen)
 #ifdef VERBOSE_HTTP
     Debug_println("mgHttpClient::POST");
 #endif
-    if (_handle == nullptr || post_data == nullptr || post_datalen < 1)
+    if (_url.empty() || post_data == nullptr || post_datalen < 1)
         return -1;
 
     // Get rid of any pending data
@@ -996,7 +1327,7 @@ int mgHttpClient::GET()
 #ifdef VERBOSE_HTTP
     Debug_println("mgHttpClient::GET");
 #endif
-    if (_handle == nullptr)
+    if (_url.empty())
         return -1;
 
     // Get rid of any pending data
@@ -1013,7 +1344,7 @@ int mgHttpClient::HEAD()
 #ifdef VERBOSE_HTTP
     Debug_println("mgHttpClient::HEAD");
 #endif
-    if (_handle == nullptr)
+    if (_url.empty())
         return -1;
 
     // Get rid of any pending data
@@ -1028,7 +1359,7 @@ int mgHttpClient::HEAD()
 // Existing connection will be closed if this is a different host
 bool mgHttpClient::set_url(const char *url)
 {
-    if (_handle == nullptr)
+    if (_url.empty())
         return false;
 
     _url = std::string(url);
@@ -1047,7 +1378,7 @@ bool mgHttpClient::set_post_data(const char *post_data, int post_datalen)
 // Sets an HTTP request header
 bool mgHttpClient::set_header(const char *header_key, const char *header_value)
 {
-    if (_handle == nullptr || header_key == nullptr || header_value == nullptr)
+    if (_url.empty() || header_key == nullptr || header_value == nullptr)
         return false;
 
     if (_request_headers.size() >= 20)
@@ -1099,7 +1430,7 @@ const std::string mgHttpClient::get_header(const char *header)
 // Specifies names of response headers to be stored from the server response
 void mgHttpClient::create_empty_stored_headers(const std::vector<std::string>& headerKeys)
 {
-    if (_handle == nullptr || headerKeys.empty())
+    if (_url.empty() || headerKeys.empty())
         return;
 
     _stored_headers.clear();
@@ -15,6 +15,19 @@
 // while debugging, increase timeout
 // #define HTTP_CLIENT_TIMEOUT 600000
 
+// idle keep-alive connections kept for reuse by any client, 0 disables keep-alive
+#ifndef HTTP_CLIENT_POOL_SIZE
+#define HTTP_CLIENT_POOL_SIZE 8
+#endif
+#define HTTP_CLIENT_POOL_PER_HOST 2
+// ms an idle connection is kept, servers commonly drop them after 5 - 15 s
+#define HTTP_CLIENT_POOL_IDLE 5000
+
+// response body buffered ahead of read(), the socket isn't read while it's full
+#ifndef HTTP_CLIENT_BODY_BUFFER
+#define HTTP_CLIENT_BODY_BUFFER 16384
+#endif
+
 // on Windows/MinGW DELETE is defined already ...
 #if defined(_WIN32) && defined(DELETE)
 #undef DELETE
@@ -29,6 +42,26 @@ struct MgMgrDeleter {
     }
 };
 
+// Fixed size FIFO for response body data, allocated on first use
+class HttpBodyBuffer
+{
+private:
+    std::vector<uint8_t> _buf;
+    size_t _head = 0;
+    size_t _count = 0;
+
+public:
+    void clear() { _head = _count = 0; }
+    // Frees the memory until the next put
+    void release();
+
+    size_t used() const { return _count; }
+    size_t space() const { return HTTP_CLIENT_BODY_BUFFER - _count; }
+
+    size_t put(const uint8_t *data, size_t len);
+    size_t get(uint8_t *dest, size_t len);
+};
+
 class mgHttpClient
 {
 private:
@@ -37,7 +70,7 @@ private:
 
     std::string _url;
 
-    std::string _buffer_str; // Will be used to hold the received message
+    HttpBodyBuffer _body; // response body waiting to be read
 
     bool _processed = false;
     bool _progressed = false;
@@ -57,12 +90,22 @@ private:
     // esp_http_client_handle_t _handle = nullptr;
     std::unique_ptr<mg_mgr, MgMgrDeleter> _handle;
 
+    // connection of the current request, owned by _handle
+    mg_connection *_conn = nullptr;
+    std::string _conn_key;       // scheme://host:port of _conn
+    bool _conn_reused = false;   // request was sent on a pooled connection
+    bool _conn_idle = false;     // response complete, _conn can take another request
+    bool _keep_alive = false;    // server leaves _conn open after the response
+    size_t _body_remaining = 0;  // body bytes still expected, (size_t)-1 if read until close
+
     // http response status code and content length
     int _status_code = -1;
     int _content_length = 0;
 
     // chunked transfer encoding
     bool _is_chunked = false;
+    size_t _chunk_left = 0;   // data bytes of the current chunk still to come
+    bool _chunk_crlf = false; // CRLF after the chunk data still to come
 
     // authentication
     std::string _username;
@@ -96,18 +139,22 @@ private:
 	void _flush_response();
 
 	int _perform();
-    void _perform_connect();
+    void _perform_connect(bool reuse = true);
+    void _release_connection();
+    bool _method_is_idempotent();
 	void _perform_fetch();
 	bool _perform_redirect();
 	// int _perform_stream(esp_http_client_method_t method, uint8_t *write_data, int write_size);
 
     void handle_connect(struct mg_connection *c);
+    void send_request(struct mg_connection *c);
+    void response_done(struct mg_connection *c);
     void handle_http_msg(struct mg_connection *c, struct mg_http_message *hm);
     void handle_read(struct mg_connection *c);
 	void process_response_headers(mg_connection *c, mg_http_message &hm, int hdrs_len);
-	void process_body_data(mg_connection *c, char *data, int len);
+	size_t process_body_data(mg_connection *c, const char *data, size_t len);
 
-    std::string certDataStorage; // Store the processed certificate data
+    std::shared_ptr<const std::string> _ca_store; // keeps the shared CA bundle alive while in use
 
 public:
 
@@ -161,14 +208,10 @@ public:
 
     // Certificate handling
     void load_system_certs();
-    mg_str ca;
+    mg_str ca = {nullptr, 0};
 
-#if defined(_WIN32)
-    void load_system_certs_windows();
-    std::string concatenatedPEM;
-#else
-    void load_system_certs_unix();
-#endif
+    // Closes pooled connections idle for longer than HTTP_CLIENT_POOL_IDLE
+    static void pool_service();
 
 };
 
@@ -22,13 +22,14 @@
 
 // forward reference
 static void serialise_track(TRK_bitstream *dest, const uint8_t *src, uint8_t track_number, bool is_prodos);
+static void serialise_sector_data(TRK_bitstream *dest, const uint8_t *src, uint8_t sector);
 
 bool MediaTypeDSK::write_sector(int qtrack, int sector, uint8_t *buffer)
 {
   size_t offset, size;
   size_t sectors_per_track = 16; // FIXME - what about 13 sector disks?
-  uint8_t *trackbuf;
   int track = tmap[qtrack];
+  int physical_sector = sector;
   const int phys2log[] = {0, 7, 14, 6, 13, 5, 12, 4, 11, 3, 10, 2, 9, 1, 8, 15};
   const int prodos[] = {0, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 15};
 
@@ -40,6 +41,9 @@ bool MediaTypeDSK::write_sector(int qtrack, int sector, uint8_t *buffer)
     return true;
   }
 
+  if (track == 0xff || track >= (int)num_tracks || sector < 0 || sector >= (int)sectors_per_track)
+    return true;
+
   sector = phys2log[sector];
   if (_mediatype == MEDIATYPE_PO)
     sector = prodos[sector];
@@ -53,26 +57,13 @@ bool MediaTypeDSK::write_sector(int qtrack, int sector, uint8_t *buffer)
   if (size != BYTES_PER_SECTOR)
     return true;
 
-  offset = track * sectors_per_track * BYTES_PER_SECTOR;
-  if (fnio::fseek(_media_fileh, offset, SEEK_SET) != 0)
-    return true;
-
-  size = sectors_per_track * BYTES_PER_SECTOR;
-  trackbuf = (uint8_t *) malloc(size);
-  if (!trackbuf)
-    return true;
-
-  offset = fnio::fread(trackbuf, 1, size, _media_fileh);
-  if (offset != size)
-    return true;
-
-  offset = sector * BYTES_PER_SECTOR;
-  memcpy(&trackbuf[offset], buffer, BYTES_PER_SECTOR);
-
-  memset(trk_data[track], 0, BITSTREAM_ALLOC_SIZE(WOZ1_TRACK_LEN));
-  serialise_track(trk_data[track], trackbuf, track, _mediatype == MEDIATYPE_PO);
-
-  free(trackbuf);
+  // Only the data field of this sector changes in the bitstream, tracks not
+  // in memory get the new sector from the file when they are loaded
+  trk_cache.lock();
+  TRK_bitstream *bitstream = (TRK_bitstream *)trk_cache.get(track);
+  if (bitstream != nullptr)
+    serialise_sector_data(bitstream, buffer, physical_sector);
+  trk_cache.unlock();
 
   return false;
 }
@@ -94,24 +85,11 @@ mediatype_t MediaTypeDSK::mount(fnFile *f, uint32_t disksize)
     diskiiemulation = true;
     num_tracks = disksize / BYTES_PER_TRACK;
 
-    // allocated SPRAM
-    const size_t dsk_image_size = num_tracks * BYTES_PER_TRACK;
-#ifdef ESP_PLATFORM
-    uint8_t *dsk = (uint8_t*)heap_caps_malloc(dsk_image_size, MALLOC_CAP_SPIRAM);
-#else
-	uint8_t *dsk = (uint8_t*)malloc(dsk_image_size);
-#endif
-    if (fnio::fseek(f, 0, SEEK_SET) != 0)
-        return MEDIATYPE_UNKNOWN;
-    size_t bytes_read = fnio::fread(dsk, 1, dsk_image_size, f);
-    if (bytes_read != dsk_image_size)
-        return MEDIATYPE_UNKNOWN;
+	Debug_printf("\nMediaTypeDSK is_prodos: %s", _mediatype == MEDIATYPE_PO ? "Y" : "N");
 
     dsk2woz_info();
     dsk2woz_tmap();
-	dsk2woz_tracks(dsk);
 
-    free(dsk);
     return MEDIATYPE_WOZ;
 }
 
@@ -149,9 +127,8 @@ void MediaTypeDSK::dsk2woz_tmap()
 #endif
 }
 
-bool MediaTypeDSK::dsk2woz_tracks(uint8_t *dsk)
-{    // depend upon little endian-ness
-
+TRK_bitstream *MediaTypeDSK::load_track(uint8_t idx, size_t *alloc_size)
+{
     // woz1 track data organized as:
     // Offset	Size	    Name	        Usage
     // +0	    6646 bytes  Bitstream	    The bitstream data padded out to 6646 bytes
@@ -162,35 +139,38 @@ bool MediaTypeDSK::dsk2woz_tracks(uint8_t *dsk)
     // +6653	uint8	    Splice Bit Count	Bit count of splice nibble (write hint).
     // +6654	uint16		Reserved for future use.
 
-    // Debug_printf("\nStart Block, Block Count, Bit Count");
+    if (idx >= num_tracks)
+        return nullptr;
 
-	Debug_printf("\nMediaTypeDSK is_prodos: %s", _mediatype == MEDIATYPE_PO ? "Y" : "N");
-
-	// TODO: adapt this to that
-	// Write out all tracks.
-	for (size_t c = 0; c < num_tracks; c++)
-	{
+    uint8_t *trackbuf = (uint8_t *)malloc(BYTES_PER_TRACK);
+    *alloc_size = BITSTREAM_ALLOC_SIZE(WOZ1_TRACK_LEN);
 #ifdef ESP_PLATFORM
-		TRK_bitstream *bitstream = (TRK_bitstream *) heap_caps_malloc(BITSTREAM_ALLOC_SIZE(WOZ1_TRACK_LEN), MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+    TRK_bitstream *bitstream = (TRK_bitstream *) heap_caps_malloc(*alloc_size, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
 #else
-		TRK_bitstream *bitstream = (TRK_bitstream *)malloc(BITSTREAM_ALLOC_SIZE(WOZ1_TRACK_LEN));
+    TRK_bitstream *bitstream = (TRK_bitstream *)malloc(*alloc_size);
 #endif
-		if (bitstream != nullptr)
-		{
-			trk_data[c] = bitstream;
-			memset(bitstream, 0, BITSTREAM_ALLOC_SIZE(WOZ1_TRACK_LEN));
-			serialise_track(bitstream, &dsk[c * 16 * 256], c, _mediatype == MEDIATYPE_PO);
-                        bitstream->len_blocks = (bitstream->len_bytes + 511) / 512; //  WOZ1_NUM_BLKS;
-			Debug_printf("\nStored %d bytes containing %d bits of track %d into location %lx", bitstream->len_bytes, bitstream->len_bits, c, trk_data[c]);
-			Debug_printf(" -- %02x %02x %02x %02x %02x", bitstream->data[0], bitstream->data[1], bitstream->data[2], bitstream->data[3], bitstream->data[4] );
-		}
-		else
-		{
-			Debug_printf("\nNo RAM allocated!");
-			return true;
-            }
-	}
-	return false;
+    if (trackbuf == nullptr || bitstream == nullptr)
+    {
+        Debug_printf("\nNo RAM allocated!");
+        free(trackbuf);
+        free(bitstream);
+        return nullptr;
+    }
+
+    if (fnio::fseek(_media_fileh, idx * BYTES_PER_TRACK, SEEK_SET) != 0 ||
+        fnio::fread(trackbuf, 1, BYTES_PER_TRACK, _media_fileh) != BYTES_PER_TRACK)
+    {
+        Debug_printf("\nMediaTypeDSK error reading track %d", idx);
+        free(trackbuf);
+        free(bitstream);
+        return nullptr;
+    }
+
+    memset(bitstream, 0, *alloc_size);
+    serialise_track(bitstream, trackbuf, idx, _mediatype == MEDIATYPE_PO);
+    bitstream->len_blocks = (bitstream->len_bytes + 511) / 512; //  WOZ1_NUM_BLKS;
+    free(trackbuf);
+    return bitstream;
 }
 
 // ================ code below from TomHarte dsk2woz program ===============
@@ -452,4 +432,35 @@ static void serialise_track(TRK_bitstream *dest, const uint8_t *src, uint8_t tra
         dest->len_bits = track_position;
 }
 
+/*!
+	Replaces the data field of one sector in a track made by serialise_track,
+	leaving the rest of the track as it is.
+
+	@param dest The track to update.
+	@param src The 256-byte new sector contents.
+	@param sector The physical sector number.
+*/
+static void serialise_sector_data(TRK_bitstream *dest, const uint8_t *src, uint8_t sector) {
+	// Bit counts of the parts serialise_track writes, syncs are 10 bits.
+	const size_t gap1 = 16 * 10;
+	const size_t address_field = (3 + 8 + 3) * 8;
+	const size_t gap2 = 7 * 10;
+	const size_t data_field = (3 + 343 + 3) * 8;
+	const size_t gap3 = 16 * 10;
+
+	size_t track_position = gap1 + sector * (address_field + gap2 + data_field + gap3) +
+		address_field + gap2 + 3 * 8;
+
+	uint8_t contents[343];
+	encode_6_and_2(contents, src);
+	for(size_t c = 0; c < sizeof(contents); ++c) {
+		// write_byte only sets bits, clear the old ones first
+		const size_t shift = track_position & 7;
+		const size_t byte_position = track_position >> 3;
+		dest->data[byte_position] &= (uint8_t)~(0xff >> shift);
+		if(shift) dest->data[byte_position+1] &= (uint8_t)~(0xff << (8 - shift));
+		track_position = write_byte(dest->data, track_position, contents[c]);
+	}
+}
+
 #endif // BUILD_APPLE
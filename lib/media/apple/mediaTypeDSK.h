@@ -23,12 +23,14 @@ private:
 
     void dsk2woz_info();
     void dsk2woz_tmap();
-    bool dsk2woz_tracks(uint8_t *dsk); 
+
+protected:
+    // Read the sectors of track idx and convert them to a bitstream
+    virtual TRK_bitstream *load_track(uint8_t idx, size_t *alloc_size) override;
 
 public:
 
     virtual mediatype_t mount(fnFile *f, uint32_t disksize) override;
-    // virtual void unmount() override;
     virtual bool write_sector(int track, int sector, uint8_t *buffer) override;
 
     // static bool create(FILE *f, uint32_t numBlock);
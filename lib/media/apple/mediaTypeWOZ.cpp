@@ -5,7 +5,9 @@
 #endif
 #include "mediaTypeWOZ.h"
 #include "../../include/debug.h"
+#include "compat_esp.h" // empty IRAM_ATTR macro for FujiNet-PC
 #include <string.h>
+#include <algorithm>
 
 #define WOZ1 '1'
 #define WOZ2 '2'
@@ -31,15 +33,14 @@ mediatype_t MediaTypeWOZ::mount(fnFile *f, uint32_t disksize)
     if (wozX_read_tmap())
         return MEDIATYPE_UNKNOWN;
         
-    // read TRKS table
+    // read TRKS table, track data is read when the head gets there
     switch (woz_version)
     {
     case WOZ1:
-        if (woz1_read_tracks())
-            return MEDIATYPE_UNKNOWN;
+        // fixed size tracks, nothing to read
         break;
     case WOZ2:
-        if (woz2_read_tracks())
+        if (woz2_read_trks())
             return MEDIATYPE_UNKNOWN;
         break;
     default:
@@ -53,11 +54,7 @@ mediatype_t MediaTypeWOZ::mount(fnFile *f, uint32_t disksize)
 void MediaTypeWOZ::unmount()
 {
     MediaType::unmount();
-    for (int i = 0; i < MAX_TRACKS; i++)
-    {
-        if (trk_data[i] != nullptr)
-            free(trk_data[i]);
-    }
+    trk_cache.clear();
 }
 
 bool MediaTypeWOZ::wozX_check_header()
@@ -159,24 +156,30 @@ bool MediaTypeWOZ::wozX_read_tmap()
     return false;
 }
 
-bool MediaTypeWOZ::woz1_read_tracks()
+bool MediaTypeWOZ::woz2_read_trks()
 {    // depend upon little endian-ness
-    fnio::fseek(_media_fileh, 256, SEEK_SET);
-
+    if (fnio::fseek(_media_fileh, 256, SEEK_SET) != 0 ||
+        fnio::fread(trks, sizeof(WOZ2_TRK_t), MAX_TRACKS, _media_fileh) != MAX_TRACKS)
+    {
+        Debug_printf("\nError reading TRKS chunk");
+        return true;
+    }
+#ifdef DEBUG
     Debug_printf("\nStart Block, Block Count, Bit Count");
-    
-#ifdef ESP_PLATFORM
-    TRK_bitstream *bitstream = (TRK_bitstream *) heap_caps_malloc(BITSTREAM_ALLOC_SIZE(WOZ1_TRACK_LEN), MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
-#else
-    TRK_bitstream *bitstream = (TRK_bitstream *) malloc(BITSTREAM_ALLOC_SIZE(WOZ1_TRACK_LEN));
+    for (int i=0; i<MAX_TRACKS; i++)
+        Debug_printf("\n%d, %d, %lu", trks[i].start_block, trks[i].block_count, trks[i].bit_count);
 #endif
-    uint16_t bytes_used;
-    uint16_t bit_count;
-    uint8_t data[WOZ1_TRACK_LEN];
+    return false;
+}
 
-    for (int i = 0; i < MAX_TRACKS; i++)
-    {
+TRK_bitstream *MediaTypeWOZ::load_track(uint8_t idx, size_t *alloc_size)
+{
+    TRK_bitstream *bitstream;
 
+    switch (woz_version)
+    {
+    case WOZ1:
+    {
         // woz1 track data organized as:
         // Offset  Size        Name              Usage
         // +0      6646 bytes  Bitstream         The bitstream data padded out to 6646 bytes
@@ -188,93 +191,118 @@ bool MediaTypeWOZ::woz1_read_tracks()
         // +6652   uint8       Splice Nibble     Nibble value to use for splice (write hint).
         // +6653   uint8       Splice Bit Count  Bit count of splice nibble (write hint).
         // +6654   uint16      Reserved for future use.
-
-        fnio::fread(data, 1, WOZ1_TRACK_LEN, _media_fileh);
-        fnio::fread(&bytes_used, sizeof(bytes_used), 1, _media_fileh);
-        fnio::fread(&bit_count, sizeof(bit_count), 1, _media_fileh);
-        if (bit_count > 0)
+        *alloc_size = BITSTREAM_ALLOC_SIZE(WOZ1_TRACK_LEN);
+#ifdef ESP_PLATFORM
+        bitstream = (TRK_bitstream *) heap_caps_malloc(*alloc_size, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+#else
+        bitstream = (TRK_bitstream *) malloc(*alloc_size);
+#endif
+        if (bitstream == nullptr)
+        {
+            Debug_printf("\nNo RAM allocated!");
+            return nullptr;
+        }
+        uint16_t bytes_used = 0;
+        uint16_t bit_count = 0;
+        if (fnio::fseek(_media_fileh, 256 + idx * (WOZ1_TRACK_LEN + 10), SEEK_SET) != 0 ||
+            fnio::fread(bitstream->data, 1, WOZ1_TRACK_LEN, _media_fileh) != WOZ1_TRACK_LEN ||
+            fnio::fread(&bytes_used, sizeof(bytes_used), 1, _media_fileh) != 1 ||
+            fnio::fread(&bit_count, sizeof(bit_count), 1, _media_fileh) != 1 ||
+            bit_count == 0 || bytes_used > WOZ1_TRACK_LEN)
         {
+            Debug_printf("\nTrack %d is blank!", idx);
+            free(bitstream);
+            return nullptr;
+        }
+        memset(bitstream->data + bytes_used, 0, WOZ1_TRACK_LEN - bytes_used);
+        bitstream->len_bytes = bytes_used;
+        bitstream->len_bits = bit_count;
+        bitstream->len_blocks = (bitstream->len_bytes + 511) / 512;
+        break;
+    }
+    case WOZ2:
+    {
+        if (trks[idx].bit_count == 0)
+        {
+            Debug_printf("\nTrack %d is blank!", idx);
+            return nullptr;
+        }
+        size_t s = std::max(trks[idx].block_count * 512, WOZ1_TRACK_LEN);
+        *alloc_size = BITSTREAM_ALLOC_SIZE(s);
 #ifdef ESP_PLATFORM
-            TRK_bitstream *bitstream = (TRK_bitstream *) heap_caps_malloc(BITSTREAM_ALLOC_SIZE(WOZ1_TRACK_LEN), MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+        bitstream = (TRK_bitstream *) heap_caps_malloc(*alloc_size, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
 #else
-            TRK_bitstream *bitstream = (TRK_bitstream *) malloc(BITSTREAM_ALLOC_SIZE(WOZ1_TRACK_LEN));
+        bitstream = (TRK_bitstream *) malloc(*alloc_size);
 #endif
-            if (bitstream != nullptr)
-            {
-                memset(bitstream, 0, BITSTREAM_ALLOC_SIZE(WOZ1_TRACK_LEN));
-                bitstream->len_bytes = bytes_used;
-                bitstream->len_bits = bit_count;
-                bitstream->len_blocks = (bitstream->len_bytes + 511) / 512;
-                trk_data[i] = bitstream;
-                Debug_printf("\nStoring %d bytes of track %d into location %lx", bytes_used, i, trk_data[i]);
-                memcpy(bitstream->data, data, bytes_used);
-            }
-            else
-            {
-                Debug_printf("\nNo RAM allocated!");
-                return true;
-            }
+        if (bitstream == nullptr)
+        {
+            Debug_printf("\nNo RAM allocated!");
+            return nullptr;
         }
-        else
+        size_t len = trks[idx].block_count * 512;
+        if (fnio::fseek(_media_fileh, trks[idx].start_block * 512, SEEK_SET) != 0 ||
+            fnio::fread(bitstream->data, 1, len, _media_fileh) != len)
         {
-            trk_data[i] = nullptr;
-            Debug_printf("\nTrack %d is blank!",i);
+            Debug_printf("\nError reading track %d", idx);
+            free(bitstream);
+            return nullptr;
         }
-        fnio::fread(bitstream, 1, 6, _media_fileh); // read through rest of bytes in track
+        memset(bitstream->data + len, 0, s - len);
+        bitstream->len_blocks = trks[idx].block_count;
+        bitstream->len_bytes = s;
+        bitstream->len_bits = trks[idx].bit_count;
+        break;
     }
-    free(bitstream);
-    return false;
+    default:
+        return nullptr;
+    }
+
+    return bitstream;
 }
 
-struct WOZ2_TRK_t
+bool MediaTypeWOZ::prepare_tracks(int t)
 {
-    uint16_t start_block;
-    uint16_t block_count;
-    uint32_t bit_count;
-};
-
-bool MediaTypeWOZ::woz2_read_tracks()
-{    // depend upon little endian-ness
-    WOZ2_TRK_t trks[MAX_TRACKS];
-
+    uint8_t idx = tmap[t];
+    if (idx != 0xff)
+        trk_cache.load(idx);
 
-    fnio::fseek(_media_fileh, 256, SEEK_SET);
-    fnio::fread(trks, sizeof(WOZ2_TRK_t), MAX_TRACKS, _media_fileh);
-#ifdef DEBUG
-    Debug_printf("\nStart Block, Block Count, Bit Count");
-    for (int i=0; i<MAX_TRACKS; i++)
-        Debug_printf("\n%d, %d, %lu", trks[i].start_block, trks[i].block_count, trks[i].bit_count);
-#endif
-    // read WOZ tracks into RAM
-    for (int i=0; i<MAX_TRACKS; i++)
+    // Get the tracks the head is likely to step on next
+    for (int n = 1; n <= WOZ_TRACK_PREFETCH; n++)
     {
-        size_t s = std::max(trks[i].block_count * 512, WOZ1_TRACK_LEN);
-        if (s != 0)
+        for (int q = t - n; q <= t + n; q += 2 * n)
         {
-#ifdef ESP_PLATFORM
-            TRK_bitstream *bitstream = (TRK_bitstream *) heap_caps_malloc(BITSTREAM_ALLOC_SIZE(s), MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
-#else
-            TRK_bitstream *bitstream = (TRK_bitstream *) malloc(BITSTREAM_ALLOC_SIZE(s));
-#endif
-            if (bitstream != nullptr)
-            {
-                Debug_printf("\nReading %d bytes of track %d into location %lx", s, i, trk_data[i]);
-                fnio::fseek(_media_fileh, trks[i].start_block * 512, SEEK_SET);
-                fnio::fread(bitstream->data, 1, s, _media_fileh);
-                bitstream->len_blocks = trks[i].block_count;
-                bitstream->len_bytes = s;
-                bitstream->len_bits = trks[i].bit_count;
-                trk_data[i] = bitstream;
-                Debug_printf("\n%d, %d, %lu", trks[i].start_block, trks[i].block_count, trks[i].bit_count);
-            }
-            else
-            {
-                Debug_printf("\nNo RAM allocated!");
-                return true;
-            }
+            if (q < 0 || q >= MAX_TRACKS || tmap[q] == 0xff || tmap[q] == idx)
+                continue;
+            trk_cache.load(tmap[q], idx);
         }
     }
-    return false;
+    if (idx == 0xff)
+        return false;
+
+    // Requested track stays most recently used
+    trk_cache.touch(idx);
+    return trk_cache.take_miss(idx);
+}
+
+TRK_bitstream * IRAM_ATTR MediaTypeWOZ::get_track(int t)
+{
+    uint8_t idx = tmap[t];
+    if (idx == 0xff)
+        return nullptr;
+    TRK_bitstream *bitstream = (TRK_bitstream *)trk_cache.get(idx);
+    if (bitstream == nullptr)
+        trk_cache.note_miss(idx);
+    return bitstream;
+}
+
+void IRAM_ATTR MediaTypeWOZ::lock_tracks()
+{
+    trk_cache.lock();
+}
+
+void IRAM_ATTR MediaTypeWOZ::unlock_tracks()
+{
+    trk_cache.unlock();
 }
 
 #endif // BUILD_APPLE
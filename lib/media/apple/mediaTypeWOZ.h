@@ -4,6 +4,7 @@
 #include <stdio.h>
 
 #include "mediaType.h"
+#include "../trackCache.h"
 
 #define MAX_TRACKS 160
 #define WOZ1_TRACK_LEN 6646
@@ -19,20 +20,42 @@ struct TRK_bitstream
 
 #define BITSTREAM_ALLOC_SIZE(x) (sizeof(TRK_bitstream) + x)
 
+// Bytes of track bitstreams kept in memory per drive, tracks are loaded on first use
+#ifdef ESP_PLATFORM
+#define WOZ_TRACK_CACHE_BUDGET (96 * 1024)
+#else
+#define WOZ_TRACK_CACHE_BUDGET (1024 * 1024)
+#endif
+
+// Quarter tracks on each side of the requested one which are loaded along with it
+#define WOZ_TRACK_PREFETCH 4
+
+struct WOZ2_TRK_t
+{
+    uint16_t start_block;
+    uint16_t block_count;
+    uint32_t bit_count;
+};
+
 class MediaTypeWOZ : public MediaType
 {
 private:
     char woz_version;
+    WOZ2_TRK_t trks[MAX_TRACKS];
 
     bool wozX_check_header();
     bool wozX_read_info();
     bool wozX_read_tmap();
-    bool woz1_read_tracks();
-    bool woz2_read_tracks();
+    bool woz2_read_trks();
 
 protected:
     uint8_t tmap[MAX_TRACKS];
-    TRK_bitstream *trk_data[MAX_TRACKS];
+    // Bitstreams by TRKS entry, filled by prepare_tracks()
+    TrackCache trk_cache{WOZ_TRACK_CACHE_BUDGET,
+                         [this](uint8_t idx, size_t *size) { return (void *)load_track(idx, size); }};
+
+    // Read bitstream of TRKS entry idx, nullptr for blank track or on error
+    virtual TRK_bitstream *load_track(uint8_t idx, size_t *alloc_size);
 
 public:
     virtual bool read(uint32_t blockNum, uint16_t *count, uint8_t* buffer) override { return false; };
@@ -47,9 +70,20 @@ public:
     virtual bool status() override {return (_media_fileh != nullptr);}
 
     uint8_t trackmap(uint8_t t) { return tmap[t]; };
-    TRK_bitstream *get_track(int t) { return trk_data[tmap[t]]; };
+    // Read the tracks around quarter track t into memory, task context only.
+    // True if get_track() found track t missing before, so it needs copying again
+    bool prepare_tracks(int t);
+    // Bitstream for quarter track t, nullptr if there is none or it isn't in
+    // memory yet. Doesn't touch the file, so it can run in the ISR. The
+    // bitstream stays valid until unlock_tracks()
+    TRK_bitstream *get_track(int t);
+    void lock_tracks();
+    void unlock_tracks();
+    void set_track_cache_budget(size_t bytes) { trk_cache.set_budget(bytes); };
     uint8_t optimal_bit_timing;
     // static bool create(FILE *f, uint32_t numBlock);
+
+    virtual ~MediaTypeWOZ() { unmount(); };
 };
 
 
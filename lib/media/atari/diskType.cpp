@@ -3,9 +3,14 @@
 #include "diskType.h"
 
 #include <string.h>
+#include <stdlib.h>
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#endif
 
 #include "../../include/debug.h"
 
+#include "fnSystem.h"
 #include "utils.h"
 
 
@@ -134,8 +139,137 @@ void MediaType::dump_percom_block()
 #endif
 }
 
+void MediaType::set_writeback(bool enabled)
+{
+    if (!enabled)
+        flush();
+    _writeback_enabled = enabled;
+}
+
+bool MediaType::writeback_store(uint16_t sectornum, uint32_t offset, uint16_t size)
+{
+    if (_writeback_data == nullptr)
+    {
+        // sector slots followed by buffer for joining runs in flush()
+        size_t alloc_size = DISK_WRITEBACK_SECTORS * DISK_SECTORBUF_SIZE + DISK_WRITEBACK_RUN_SIZE;
+#ifdef ESP_PLATFORM
+        _writeback_data = (uint8_t *)heap_caps_malloc(alloc_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#else
+        _writeback_data = (uint8_t *)malloc(alloc_size);
+#endif
+        if (_writeback_data == nullptr)
+        {
+            Debug_println("MediaType::writeback_store failed to allocate cache, writing through");
+            _writeback_enabled = false;
+            return true;
+        }
+    }
+
+    auto it = _writeback_sectors.find(sectornum);
+    if (it == _writeback_sectors.end())
+    {
+        // Make room, slots are handed out in order so a flush frees all of them
+        if (_writeback_sectors.size() >= DISK_WRITEBACK_SECTORS && flush())
+            return true;
+        uint16_t slot = _writeback_sectors.size();
+        it = _writeback_sectors.emplace(sectornum, WritebackSector{offset, size, slot}).first;
+    }
+
+    memcpy(_writeback_data + it->second.slot * DISK_SECTORBUF_SIZE, _disk_sectorbuff, size);
+    _writeback_last_write = fnSystem.millis();
+    return false;
+}
+
+bool MediaType::writeback_load(uint16_t sectornum, uint16_t size)
+{
+    auto it = _writeback_sectors.find(sectornum);
+    if (it == _writeback_sectors.end())
+        return false;
+
+    memcpy(_disk_sectorbuff, _writeback_data + it->second.slot * DISK_SECTORBUF_SIZE, size);
+    return true;
+}
+
+/*
+ Cached sectors are written in sector order, sectors adjacent in the image
+ file are joined into one fseek() and fwrite() followed by a single fflush().
+*/
+bool MediaType::flush()
+{
+    if (_writeback_sectors.empty())
+        return false;
+
+    if (_disk_fileh == nullptr)
+    {
+        _writeback_sectors.clear();
+        return true;
+    }
+
+    uint8_t *run = _writeback_data + DISK_WRITEBACK_SECTORS * DISK_SECTORBUF_SIZE;
+    uint32_t run_offset = 0;
+    size_t run_len = 0;
+    int writes = 0;
+    bool err = false;
+
+    auto write_run = [&]() {
+        if (run_len == 0)
+            return;
+        if (fnio::fseek(_disk_fileh, run_offset, SEEK_SET) != 0 ||
+            fnio::fwrite(run, 1, run_len, _disk_fileh) != run_len)
+        {
+            Debug_printf("MediaType::flush error writing %u bytes at %lu\r\n", (unsigned)run_len, (unsigned long)run_offset);
+            err = true;
+        }
+        writes++;
+        run_len = 0;
+    };
+
+    for (auto &entry : _writeback_sectors)
+    {
+        const WritebackSector &sector = entry.second;
+        if (run_len > 0 && (sector.offset != run_offset + run_len || run_len + sector.size > DISK_WRITEBACK_RUN_SIZE))
+            write_run();
+        if (run_len == 0)
+            run_offset = sector.offset;
+        memcpy(run + run_len, _writeback_data + sector.slot * DISK_SECTORBUF_SIZE, sector.size);
+        run_len += sector.size;
+    }
+    write_run();
+
+    if (fnio::fflush(_disk_fileh) != 0)
+        err = true;
+
+    Debug_printf("MediaType::flush %u sectors in %d writes%s\r\n", (unsigned)_writeback_sectors.size(), writes, err ? ", failed" : "");
+
+    // file position moved
+    _disk_last_sector = INVALID_SECTOR_VALUE;
+
+    // On error keep the sectors, reads still see them and next flush retries
+    if (err)
+        _writeback_last_write = fnSystem.millis();
+    else
+        _writeback_sectors.clear();
+    _writeback_failed = err;
+    return err;
+}
+
+void MediaType::flush_idle()
+{
+    if (!_writeback_sectors.empty() && fnSystem.millis() - _writeback_last_write >= DISK_WRITEBACK_IDLE_MS)
+        flush();
+}
+
 void MediaType::unmount()
 {
+    flush();
+    _writeback_sectors.clear();
+    _writeback_failed = false;
+    if (_writeback_data != nullptr)
+    {
+        free(_writeback_data);
+        _writeback_data = nullptr;
+    }
+
     if (_disk_fileh != nullptr)
     {
         fnio::fclose(_disk_fileh);
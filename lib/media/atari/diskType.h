@@ -2,6 +2,7 @@
 #define _MEDIATYPE_
 
 #include <stdint.h>
+#include <map>
 #include "fnio.h"
 #include "fujiHost.h"
 
@@ -13,6 +14,13 @@
 #define DISK_BYTES_PER_SECTOR_DOUBLE 256
 #define DISK_BYTES_PER_SECTOR_DOUBLE_DOUBLE 512
 
+// Write-back sector cache: sector writes are collected and written to the
+// image in contiguous runs when the drive is idle, unmounted or shut down.
+// Off unless enabled with disk_writeback in the [General] config section.
+#define DISK_WRITEBACK_SECTORS 64 // dirty sectors held before forced flush
+#define DISK_WRITEBACK_IDLE_MS 1000 // flush after no write for this long
+#define DISK_WRITEBACK_RUN_SIZE 4096 // max bytes written by one fwrite()
+
 #define DISK_CTRL_STATUS_CLEAR 0x00
 #define DISK_CTRL_STATUS_BUSY 0x01
 #define DISK_CTRL_STATUS_DATA_PENDING 0x02
@@ -53,7 +61,25 @@ protected:
     bool _disk_readonly = true;
     uint16_t _high_score_sector = 0; /* High score sector to allow write. 1-65535 */
     uint8_t _high_score_num_sectors = 0;
-    
+
+    // Write-back sector cache
+    struct WritebackSector
+    {
+        uint32_t offset; // position in image file
+        uint16_t size;
+        uint16_t slot; // index into _writeback_data
+    };
+    bool _writeback_enabled = false;
+    bool _writeback_failed = false; // last flush failed, sectors still cached
+    std::map<uint16_t, WritebackSector> _writeback_sectors; // sorted by sector number
+    uint8_t *_writeback_data = nullptr;
+    uint64_t _writeback_last_write = 0;
+
+    // Keep _disk_sectorbuff as new content of sector, returns TRUE if an error condition occurred
+    bool writeback_store(uint16_t sectornum, uint32_t offset, uint16_t size);
+    // Fill _disk_sectorbuff from cache, returns TRUE if sector was cached
+    bool writeback_load(uint16_t sectornum, uint16_t size);
+
 public:
     struct
     {
@@ -93,6 +119,12 @@ public:
     // Returns TRUE if an error condition occurred
     virtual bool write(uint16_t sectornum, bool verify);
 
+    // Write cached sectors to the image, returns TRUE if an error condition occurred
+    bool flush();
+    // Flush if the drive was not written to for DISK_WRITEBACK_IDLE_MS
+    void flush_idle();
+    void set_writeback(bool enabled);
+
     // Always returns 128 for the first 3 sectors, otherwise _sectorSize
     virtual uint16_t sector_size(uint16_t sectornum);
     
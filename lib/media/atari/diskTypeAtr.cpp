@@ -69,6 +69,13 @@ bool MediaTypeATR::read(uint16_t sectornum, uint16_t *readcount)
 
     memset(_disk_sectorbuff, 0, sizeof(_disk_sectorbuff));
 
+    // Sector written but not flushed yet
+    if (writeback_load(sectornum, sectorSize))
+    {
+        *readcount = sectorSize;
+        return false;
+    }
+
     bool err = false;
     // Perform a seek if we're not reading the sector after the last one we read
     if (sectornum != _disk_last_sector + 1)
@@ -129,6 +136,19 @@ bool MediaTypeATR::write(uint16_t sectornum, bool verify)
     uint16_t sectorSize = sector_size(sectornum);
     uint32_t offset = _sector_to_offset(sectornum);
 
+    // High score writes go through their own file handle, everything else can be deferred
+    if (_writeback_enabled && _high_score_sector == 0)
+    {
+        // Background flush failed, retry so the Atari gets the error
+        if (_writeback_failed && flush())
+            return true;
+        if (!writeback_store(sectornum, offset, sectorSize))
+            return false;
+        if (_writeback_enabled)
+            return true;
+        // cache couldn't be allocated, write through
+    }
+
     _disk_last_sector = INVALID_SECTOR_VALUE;
 
     // Perform a seek if we're writing to the sector after the last one
@@ -181,6 +201,9 @@ void MediaTypeATR::status(uint8_t statusbuff[4])
     if (_percomBlock.num_sides == 1)
         statusbuff[0] |= DISK_DRIVE_STATUS_DOUBLE_SIDED;
 
+    // Cached sectors couldn't be written to the image
+    if (_writeback_failed)
+        statusbuff[0] |= DISK_DRIVE_STATUS_PUT_FAILED;
 
 
     statusbuff[1] = ~_disk_controller_status; // Negate the controller status
@@ -29,13 +29,7 @@ void MediaTypeMOOF::unmount()
 {
     MediaType::unmount();
 #ifdef CACHE_IMAGE
-    for (int i = 0; i < MAX_TRACKS; i++)
-    {
-        if (trk_ptrs[i] != nullptr)
-            free(trk_ptrs[i]);
-            
-        trk_ptrs[i] = nullptr;
-    }
+    trk_cache.clear();
 #else
     free(trk_buffer);
     trk_buffer = nullptr;
@@ -158,11 +152,60 @@ bool MediaTypeMOOF::moof_read_tmap()
     return false;
 }
 
+#ifdef CACHE_IMAGE
+uint8_t *MediaTypeMOOF::load_track(uint8_t idx, size_t *size)
+{
+    size_t s = trks[idx].block_count * 512;
+    if (s == 0)
+        return nullptr;
+    *size = s;
+
+    uint8_t *data = (uint8_t *)heap_caps_malloc(s, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+    if (data == nullptr)
+    {
+        Debug_printf("\nNo RAM allocated!");
+        return nullptr;
+    }
+    Debug_printf("\nReading %d bytes of track %d into location %lx", s, idx, data);
+    if (fseek(_media_fileh, trks[idx].start_block * 512, SEEK_SET) != 0 ||
+        fread(data, 1, s, _media_fileh) != s)
+    {
+        Debug_printf("\nError reading track %d", idx);
+        free(data);
+        return nullptr;
+    }
+    return data;
+}
+#endif
+
 uint8_t *MediaTypeMOOF::get_track(int t)
 {
 
 #ifdef CACHE_IMAGE
-    return trk_ptrs[tmap[t]];
+    uint8_t idx = tmap[t];
+    if (idx == 0xff)
+        return nullptr;
+
+    uint8_t *data = (uint8_t *)trk_cache.load(idx);
+
+    // Get both sides of the cylinders the head is likely to step on next
+    int cyl = t / MAX_SIDES;
+    for (int c = cyl - MOOF_TRACK_PREFETCH; c <= cyl + MOOF_TRACK_PREFETCH; c++)
+    {
+        if (c < 0 || c >= MAX_CYLINDERS)
+            continue;
+        for (int side = 0; side < MAX_SIDES; side++)
+        {
+            uint8_t i = tmap[c * MAX_SIDES + side];
+            if (i == 0xff || i == idx)
+                continue;
+            trk_cache.load(i, idx);
+        }
+    }
+    // Requested track stays most recently used
+    trk_cache.touch(idx);
+
+    return data;
 #else
     size_t s = trks[t].block_count * 512;
     Debug_printf("\nReading %d bytes of track %d", s, t);
@@ -185,28 +228,8 @@ bool MediaTypeMOOF::moof_read_tracks()
 #endif
 
 #ifdef CACHE_IMAGE
-    // read MOOF tracks into RAM
-    for (int i = 0; i < MAX_TRACKS; i++)
-    {
-        trk_ptrs[i] = nullptr;
-        size_t s = trks[i].block_count * 512;
-        if (s != 0)
-        {
-            trk_ptrs[i] = (uint8_t *)heap_caps_malloc(s, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
-            if (trk_ptrs[i] != nullptr)
-            {
-                Debug_printf("\nReading %d bytes of track %d into location %lx", s, i, trk_ptrs[i]);
-                fseek(_media_fileh, trks[i].start_block * 512, SEEK_SET);
-                fread(trk_ptrs[i], 1, s, _media_fileh);
-                Debug_printf("\n%d, %d, %lu", trks[i].start_block, trks[i].block_count, trks[i].bit_count);
-            }
-            else
-            {
-                Debug_printf("\nNo RAM allocated!");
-                return true;
-            }
-        }
-    }
+    // track data is read when the head gets there
+    trk_cache.clear();
 #else
     size_t s = num_blocks * 512;
     if (s != 0)
@@ -3,6 +3,7 @@
 //  https://applesaucefdc.com/moof-reference/
 
 #include "mediaType.h"
+#include "../trackCache.h"
 #include <stdio.h>
 
 #define MAX_CYLINDERS 80
@@ -11,6 +12,12 @@
 
 #define CACHE_IMAGE
 
+// Bytes of track data kept in memory per drive, tracks are loaded on first use
+#define MOOF_TRACK_CACHE_BUDGET (128 * 1024)
+
+// Cylinders on each side of the requested one which are loaded along with it
+#define MOOF_TRACK_PREFETCH 2
+
 struct TRK_t
 {
     uint16_t start_block;
@@ -36,11 +43,16 @@ private:
     bool moof_read_tmap();
     bool moof_read_tracks();
 
+#ifdef CACHE_IMAGE
+    uint8_t *load_track(uint8_t idx, size_t *size);
+#endif
+
 protected:
     uint8_t tmap[MAX_TRACKS];
     TRK_t trks[MAX_TRACKS];
 #ifdef CACHE_IMAGE
-    uint8_t *trk_ptrs[MAX_TRACKS] = {};
+    TrackCache trk_cache{MOOF_TRACK_CACHE_BUDGET,
+                         [this](uint8_t idx, size_t *size) { return (void *)load_track(idx, size); }};
 #else
     uint8_t *trk_buffer;
 #endif
@@ -60,7 +72,11 @@ public:
     virtual bool status() override { return (_media_fileh != nullptr); }
 
     uint8_t trackmap(uint8_t t) { return tmap[t]; };
+    // Track data for track t, stays valid until the next call
     uint8_t *get_track(int t);
+#ifdef CACHE_IMAGE
+    void set_track_cache_budget(size_t bytes) { trk_cache.set_budget(bytes); };
+#endif
     int track_len(int t) { return trks[tmap[t]].block_count * 512; };
     int num_bits(int t) { return trks[tmap[t]].bit_count; };
     uint8_t optimal_bit_timing;
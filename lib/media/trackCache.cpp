@@ -0,0 +1,116 @@
+#if defined(BUILD_APPLE) || defined(BUILD_MAC)
+
+#include "trackCache.h"
+
+#include <stdlib.h>
+
+#include "compat_esp.h" // empty IRAM_ATTR macro for FujiNet-PC
+
+void IRAM_ATTR TrackCache::lock()
+{
+#ifdef ESP_PLATFORM
+    portENTER_CRITICAL_SAFE(&_mux);
+#endif
+}
+
+void IRAM_ATTR TrackCache::unlock()
+{
+#ifdef ESP_PLATFORM
+    portEXIT_CRITICAL_SAFE(&_mux);
+#endif
+}
+
+void * IRAM_ATTR TrackCache::get(uint8_t idx)
+{
+    if (idx >= TRACK_CACHE_SLOTS || _data[idx] == nullptr)
+        return nullptr;
+    _used[idx] = ++_use_counter;
+    return _data[idx];
+}
+
+void IRAM_ATTR TrackCache::note_miss(uint8_t idx)
+{
+    if (idx < TRACK_CACHE_SLOTS && !_blank[idx])
+        _missed.store(idx);
+}
+
+bool TrackCache::take_miss(uint8_t idx)
+{
+    if (idx >= TRACK_CACHE_SLOTS || _data[idx] == nullptr)
+        return false;
+    // Only clear a miss of idx, one the ISR noted since stays
+    int missed = idx;
+    return _missed.compare_exchange_strong(missed, -1);
+}
+
+void TrackCache::touch(uint8_t idx)
+{
+    lock();
+    _used[idx] = ++_use_counter;
+    unlock();
+}
+
+void TrackCache::_evict(uint8_t idx)
+{
+    // Take the buffer away from the ISR before freeing it
+    lock();
+    void *data = _data[idx];
+    _data[idx] = nullptr;
+    unlock();
+
+    free(data);
+    _bytes -= _size[idx];
+    _size[idx] = 0;
+}
+
+void *TrackCache::load(uint8_t idx, int keep)
+{
+    if (idx >= TRACK_CACHE_SLOTS)
+        return nullptr;
+    touch(idx);
+    if (_data[idx] != nullptr || _blank[idx])
+        return _data[idx];
+
+    size_t size = 0;
+    void *data = _loader(idx, &size);
+    if (data == nullptr)
+    {
+        _blank[idx] = true;
+        return nullptr;
+    }
+
+    while (_bytes + size > _budget)
+    {
+        int lru = -1;
+        for (int i = 0; i < TRACK_CACHE_SLOTS; i++)
+        {
+            if (_data[i] == nullptr || i == idx || i == keep)
+                continue;
+            if (lru < 0 || _used[i] < _used[lru])
+                lru = i;
+        }
+        if (lru < 0)
+            break;
+        _evict(lru);
+    }
+
+    _size[idx] = size;
+    _bytes += size;
+    lock();
+    _data[idx] = data;
+    unlock();
+    return data;
+}
+
+void TrackCache::clear()
+{
+    for (int i = 0; i < TRACK_CACHE_SLOTS; i++)
+    {
+        if (_data[i] != nullptr)
+            _evict(i);
+        _blank[i] = false;
+    }
+    _missed.store(-1);
+}
+
+#endif // BUILD_APPLE || BUILD_MAC
@@ -0,0 +1,72 @@
+#ifndef _TRACK_CACHE_
+#define _TRACK_CACHE_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#endif
+
+// Tracks a cache can hold, covers the 160 TMAP entries of WOZ and MOOF
+#define TRACK_CACHE_SLOTS 160
+
+/*
+ * Floppy image track buffers kept in memory, least recently used ones are
+ * dropped to stay within a byte budget. Used by the WOZ and MOOF media types.
+ *
+ * Only load() reads the image, allocates and frees, so it must run in task
+ * context. lock()/get()/unlock() may be used from the drive ISR: the buffer
+ * returned by get() can't be evicted until unlock(). The ISR reports tracks
+ * it needed but didn't find with note_miss(), so the task can copy them in
+ * once they are loaded.
+ */
+class TrackCache
+{
+public:
+    // Reads track idx into a malloc'd buffer and sets *size, nullptr for blank track or on error
+    using loader_t = std::function<void *(uint8_t idx, size_t *size)>;
+
+    TrackCache(size_t budget, loader_t loader) : _budget(budget), _loader(loader) {};
+    ~TrackCache() { clear(); };
+
+    void lock();
+    void unlock();
+    // Resident buffer of track idx or nullptr, call with the cache locked
+    void *get(uint8_t idx);
+    void note_miss(uint8_t idx);
+    // True once if track idx was missed and has been loaded since
+    bool take_miss(uint8_t idx);
+
+    // Make sure track idx is resident, dropping least recently used tracks
+    // other than idx and keep
+    void *load(uint8_t idx, int keep = -1);
+    // Mark track idx as just used
+    void touch(uint8_t idx);
+    void clear();
+
+    void set_budget(size_t bytes) { _budget = bytes; };
+
+private:
+    size_t _budget;
+    loader_t _loader;
+
+    void *_data[TRACK_CACHE_SLOTS] = {};
+    size_t _size[TRACK_CACHE_SLOTS] = {};
+    bool _blank[TRACK_CACHE_SLOTS] = {}; // loader returned nothing, don't retry
+    uint32_t _used[TRACK_CACHE_SLOTS] = {};
+    uint32_t _use_counter = 0;
+    size_t _bytes = 0;
+    std::atomic<int> _missed{-1}; // set by the ISR, cleared by the task
+
+#ifdef ESP_PLATFORM
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+    void _evict(uint8_t idx);
+};
+
+#endif // _TRACK_CACHE_
@@ -0,0 +1,315 @@
+/**
+ * Bus independent AT command mode of the FujiNet modem.
+ */
+
+#include "modemCommand.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "fnSystem.h"
+#include "utils.h"
+
+#include "../../include/atascii.h"
+#include "../../include/debug.h"
+
+/* Some of these are ignored; to see their meanings,
+ * review `modemCommand.h`'s _at_cmds enums. */
+static const char *at_cmds[_at_cmds::AT_ENUMCOUNT] =
+    {
+        "AT",
+        "ATNET0",
+        "ATNET1",
+        "ATA",
+        "ATIP",
+        "AT?",
+        "ATH",
+        "+++ATH",
+        "ATDT",
+        "ATDP",
+        "ATDI",
+        "ATWIFILIST",
+        "ATWIFICONNECT",
+        "ATGET",
+        "ATPORT",
+        "ATV0",
+        "ATV1",
+        "AT&F",
+        "ATS0=0",
+        "ATS0=1",
+        "ATS2=43",
+        "ATS5=8",
+        "ATS6=2",
+        "ATS7=30",
+        "ATS12=20",
+        "ATE0",
+        "ATE1",
+        "ATM0",
+        "ATM1",
+        "ATX1",
+        "AT&C1",
+        "AT&D2",
+        "AT&W",
+        "ATH2",
+        "+++ATZ",
+        "ATS2=128 X1 M0",
+        "AT+SNIFF",
+        "AT-SNIFF",
+        "AT+TERM=VT52",
+        "AT+TERM=VT100",
+        "AT+TERM=ANSI",
+        "AT+TERM=DUMB",
+        "ATCPM",
+        "ATPBLIST",
+        "ATPBCLEAR",
+        "ATPB",
+        "ATO"};
+
+ModemCommand::ModemCommand(ModemBus *bus, bool atascii_keys)
+    : _bus(bus), _atascii_keys(atascii_keys)
+{
+}
+
+void ModemCommand::_write(const char *s)
+{
+    _bus->modem_bus_write((const uint8_t *)s, strlen(s));
+}
+
+void ModemCommand::_write(uint8_t c)
+{
+    _bus->modem_bus_write(&c, 1);
+}
+
+void ModemCommand::_eol()
+{
+    if (atascii == true)
+    {
+        _write((uint8_t)ATASCII_EOL);
+    }
+    else
+    {
+        _write((uint8_t)ASCII_CR);
+        _write((uint8_t)ASCII_LF);
+    }
+}
+
+bool ModemCommand::input(uint8_t chr)
+{
+    // Return, enter, new line, carriage return.. anything goes to end the command
+    if (chr == ASCII_LF || chr == ASCII_CR || (_atascii_keys && chr == ATASCII_EOL))
+    {
+        // flip which EOL to display based on last CR or EOL received.
+        atascii = chr == ATASCII_EOL;
+        return true;
+    }
+
+    // Backspace or delete deletes previous character
+    if (chr == ASCII_BACKSPACE || chr == ASCII_DELETE)
+    {
+        if (!line.empty())
+        {
+            line.pop_back();
+            // We don't assume that backspace is destructive
+            // Clear with a space
+            if (echo == true)
+            {
+                _write((uint8_t)ASCII_BACKSPACE);
+                _write((uint8_t)' ');
+                _write((uint8_t)ASCII_BACKSPACE);
+            }
+        }
+    }
+    else if (_atascii_keys && chr == ATASCII_BACKSPACE)
+    {
+        if (!line.empty())
+        {
+            line.pop_back();
+            if (echo == true)
+                _write(chr);
+        }
+    }
+    // Take into account arrow key movement and clear screen
+    else if (chr == ATASCII_CLEAR_SCREEN ||
+             (chr >= ATASCII_CURSOR_UP && chr <= ATASCII_CURSOR_RIGHT))
+    {
+        if (echo == true)
+            _write(chr);
+    }
+    else
+    {
+        if (line.length() < MAX_CMD_LENGTH)
+            line += chr;
+        if (echo == true)
+            _write(chr);
+    }
+    return false;
+}
+
+int ModemCommand::parse()
+{
+    util_string_trim(line);
+    if (line.empty())
+        return -1;
+
+    std::string upperCaseCmd = line;
+    util_string_toupper(upperCaseCmd);
+
+    if (echo == true)
+        println();
+
+    Debug_printf("AT Cmd: %s\n", upperCaseCmd.c_str());
+
+    // Replace EOL with CR
+    size_t eol1 = upperCaseCmd.find(ATASCII_EOL);
+    if (eol1 != std::string::npos)
+        upperCaseCmd[eol1] = ASCII_CR;
+
+    // Just AT
+    if (upperCaseCmd.compare("AT") == 0)
+        return AT_AT;
+
+    // Make sure we skip the plain AT command when matching
+    int cmd_match;
+    for (cmd_match = _at_cmds::AT_AT + 1; cmd_match < _at_cmds::AT_ENUMCOUNT; cmd_match++)
+        if (upperCaseCmd.compare(0, strlen(at_cmds[cmd_match]), at_cmds[cmd_match]) == 0)
+            break;
+    return cmd_match;
+}
+
+void ModemCommand::dial_address(std::string *host, std::string *port) const
+{
+    // ("ATDT" length 4)
+    size_t portIndex = line.find(':');
+    if (portIndex != std::string::npos)
+    {
+        *host = line.substr(4, portIndex - 4);
+        *port = line.substr(portIndex + 1);
+    }
+    else
+    {
+        *host = line.substr(4);
+        *port = "23"; // Telnet default
+    }
+
+    util_string_trim(*host); // allow spaces or no spaces after AT command
+}
+
+void ModemCommand::println()
+{
+    if (output == false)
+        return;
+
+    _eol();
+    _bus->modem_bus_flush();
+}
+
+void ModemCommand::println(const char *s, bool addEol)
+{
+    if (output == false)
+        return;
+
+    _write(s);
+    if (addEol)
+        _eol();
+    _bus->modem_bus_flush();
+}
+
+void ModemCommand::println(int i, bool addEol)
+{
+    char buf[12];
+    snprintf(buf, sizeof(buf), "%d", i);
+    println(buf, addEol);
+}
+
+/**
+ * Numeric codes are for machine reading, so they ignore the
+ * ATASCII EOL and command output setting.
+ */
+void ModemCommand::result(int code)
+{
+    if (numeric == true)
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%d\r\n", code);
+        _write(buf);
+        _bus->modem_bus_flush();
+        return;
+    }
+
+    switch (code)
+    {
+    case RESULT_CODE_OK:
+        println("OK");
+        break;
+    case RESULT_CODE_RING:
+        println("RING");
+        break;
+    case RESULT_CODE_NO_CARRIER:
+        println("NO CARRIER");
+        break;
+    case RESULT_CODE_ERROR:
+        println("ERROR");
+        break;
+    case RESULT_CODE_BUSY:
+        println("BUSY");
+        break;
+    case RESULT_CODE_NO_ANSWER:
+        println("NO ANSWER");
+        break;
+    default:
+        println("CONNECT");
+        break;
+    }
+}
+
+void ModemCommand::result_connect(unsigned int baud)
+{
+    if (numeric == false)
+    {
+        println("CONNECT ", false);
+        println((int)baud);
+        return;
+    }
+
+    switch (baud)
+    {
+    case 1200:
+        result(RESULT_CODE_CONNECT_1200);
+        break;
+    case 2400:
+        result(RESULT_CODE_CONNECT_2400);
+        break;
+    case 4800:
+        result(RESULT_CODE_CONNECT_4800);
+        break;
+    case 9600:
+        result(RESULT_CODE_CONNECT_9600);
+        break;
+    case 19200:
+        result(RESULT_CODE_CONNECT_19200);
+        break;
+    default:
+        result(RESULT_CODE_CONNECT);
+        break;
+    }
+}
+
+void ModemCommand::escape_scan(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        if (data[i] != '+')
+            _plus_count = 0;
+        else if (++_plus_count >= 3)
+            _plus_time = fnSystem.millis();
+    }
+}
+
+bool ModemCommand::escape_due()
+{
+    if (_plus_count < 3 || fnSystem.millis() - _plus_time <= MODEM_ESCAPE_GUARD_MS)
+        return false;
+
+    _plus_count = 0;
+    return true;
+}
@@ -0,0 +1,139 @@
+/**
+ * Bus independent AT command mode of the FujiNet modem.
+ * Collects the command line typed by the host, matches it against the
+ * AT command table and writes messages and result codes the way the
+ * host asked for them (ATE, ATV). In connected mode it watches the
+ * host's data for the "+++" escape.
+ */
+
+#ifndef MODEM_COMMAND_H
+#define MODEM_COMMAND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "modemCore.h"
+
+#define MAX_CMD_LENGTH 256 // Maximum length for AT command
+
+// Silence needed after "+++" before the modem goes back to command mode
+#define MODEM_ESCAPE_GUARD_MS 1000
+
+#define RESULT_CODE_OK              0
+#define RESULT_CODE_CONNECT         1
+#define RESULT_CODE_RING            2
+#define RESULT_CODE_NO_CARRIER      3
+#define RESULT_CODE_ERROR           4
+#define RESULT_CODE_CONNECT_1200    5
+#define RESULT_CODE_BUSY            7
+#define RESULT_CODE_NO_ANSWER       8
+#define RESULT_CODE_CONNECT_2400    10
+#define RESULT_CODE_CONNECT_9600    13
+#define RESULT_CODE_CONNECT_4800    18
+#define RESULT_CODE_CONNECT_19200   85
+
+/* The actual strings expected for these can be
+ * found in `modemCommand.cpp`'s at_cmds[] array. */
+enum _at_cmds
+{
+    AT_AT = 0,
+    AT_NET0,
+    AT_NET1,
+    AT_A,
+    AT_IP,
+    AT_HELP,
+    AT_H,
+    AT_H1,
+    AT_DT,
+    AT_DP,
+    AT_DI,
+    AT_WIFILIST,
+    AT_WIFICONNECT,
+    AT_GET,
+    AT_PORT,
+    AT_V0,
+    AT_V1,
+    AT_ANDF_ignored,
+    AT_S0E0,
+    AT_S0E1,
+    AT_S2E43_ignored,
+    AT_S5E8_ignored,
+    AT_S6E2_ignored,
+    AT_S7E30_ignored,
+    AT_S12E20_ignored,
+    AT_E0,
+    AT_E1,
+    AT_M0_ignored,
+    AT_M1_ignored,
+    AT_X1_ignored,
+    AT_AC1_ignored,
+    AT_AD2_ignored,
+    AT_AW_ignored,
+    AT_OFFHOOK,
+    AT_ZPPP_ignored,
+    AT_BBSX_ignored,
+    AT_SNIFF,
+    AT_UNSNIFF,
+    AT_TERMVT52,
+    AT_TERMVT100,
+    AT_TERMDUMB,
+    AT_TERMANSI,
+    AT_CPM,
+    AT_PHONEBOOKLIST,
+    AT_PHONEBOOKCLR,
+    AT_PHONEBOOK,
+    AT_O,
+    AT_ENUMCOUNT};
+
+class ModemCommand
+{
+private:
+    ModemBus *_bus;
+    bool _atascii_keys;
+    int _plus_count = 0;
+    uint64_t _plus_time = 0;
+
+    void _write(const char *s);
+    void _write(uint8_t c);
+    void _eol();
+
+public:
+    std::string line;      // Command line typed by the host, then the command being run
+    bool echo = true;      // Echo the host's typing (ATE1)
+    bool numeric = false;  // Numeric result codes (ATV0)
+    bool output = true;    // Show command output at all
+    bool atascii = false;  // Last command ended with an ATASCII EOL, answer with one
+
+    // With atascii_keys the ATASCII EOL and backspace keys edit the line
+    ModemCommand(ModemBus *bus, bool atascii_keys = true);
+
+    // Command mode: takes one byte typed by the host into line, echoing it.
+    // Returns true when the line is ended and can be parse()d.
+    bool input(uint8_t chr);
+
+    // Trims line and looks it up in the AT command table. Returns the
+    // _at_cmds entry, AT_ENUMCOUNT if it isn't a command or -1 if the line
+    // is empty.
+    int parse();
+
+    // Host and port of an ATDT/ATDP/ATDI line, port 23 if none is given
+    void dial_address(std::string *host, std::string *port) const;
+
+    void println();
+    void println(const char *s, bool addEol = true);
+    void println(const std::string &s, bool addEol = true) { println(s.c_str(), addEol); }
+    void println(int i, bool addEol = true);
+
+    // The result code as a number with ATV0, else as text
+    void result(int code);
+    void result_connect(unsigned int baud);
+
+    // Connected mode: host data on its way to the network
+    void escape_scan(const uint8_t *data, size_t len);
+    // True once, when "+++" was followed by the guard time without more data
+    bool escape_due();
+    void escape_reset() { _plus_count = 0; }
+};
+
+#endif // MODEM_COMMAND_H
@@ -0,0 +1,136 @@
+/**
+ * Bus independent data path of the FujiNet modem.
+ */
+
+#include "modemCore.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "compat_inet.h"
+#include "fnSystem.h"
+
+#include "../../include/debug.h"
+
+void ModemRingBuffer::resize(size_t size)
+{
+    _buf.resize(size);
+    _buf.shrink_to_fit();
+    clear();
+}
+
+size_t ModemRingBuffer::put(const uint8_t *data, size_t len)
+{
+    len = std::min(len, space());
+    size_t tail = (_head + _count) % _buf.size();
+    size_t first = std::min(len, _buf.size() - tail);
+    memcpy(&_buf[tail], data, first);
+    memcpy(&_buf[0], data + first, len - first);
+    _count += len;
+    return len;
+}
+
+const uint8_t *ModemRingBuffer::peek(size_t *len) const
+{
+    *len = std::min(_count, _buf.size() - _head);
+    return _count ? &_buf[_head] : nullptr;
+}
+
+void ModemRingBuffer::consume(size_t len)
+{
+    len = std::min(len, _count);
+    _head = (_head + len) % _buf.size();
+    _count -= len;
+    if (_count == 0)
+        _head = 0;
+}
+
+ModemCore::ModemCore(ModemBus *bus) : _bus(bus)
+{
+    set_baud(300);
+}
+
+void ModemCore::set_baud(unsigned int baud)
+{
+    if (baud == 0)
+        baud = 300;
+    _baud = baud;
+
+    size_t size = (size_t)baud / 10 * MODEM_RX_BUFFER_MS / 1000;
+    _rx.resize(std::max<size_t>(MODEM_RX_BUFFER_MIN, std::min<size_t>(size, MODEM_RX_BUFFER_MAX)));
+    reset();
+
+    Debug_printf("ModemCore: %u baud, %u byte receive buffer\r\n", _baud, (unsigned)_rx.size());
+}
+
+void ModemCore::reset()
+{
+    _rx.clear();
+    _credit_bits = _part_bit = 0;
+    _last_us = fnSystem.micros();
+}
+
+size_t ModemCore::rx_put(const uint8_t *data, size_t len)
+{
+    size_t n = _rx.put(data, len);
+    if (n < len)
+        Debug_printf("ModemCore: receive buffer full, dropped %u bytes\r\n", (unsigned)(len - n));
+    return n;
+}
+
+size_t ModemCore::service_rx()
+{
+    // An idle line doesn't save up time for later
+    uint64_t now = fnSystem.micros();
+    if (_rx.used() == 0)
+    {
+        _credit_bits = _part_bit = 0;
+        _last_us = now;
+        return 0;
+    }
+
+    // 10 bits per byte on the wire, no more than one burst when called late
+    uint32_t burst_bits = std::max<uint32_t>(MODEM_PACE_BURST_MIN * 10, _baud * MODEM_PACE_BURST_MS / 1000);
+    uint64_t elapsed = (now - _last_us) * _baud + _part_bit;
+    _last_us = now;
+    _part_bit = (uint32_t)(elapsed % 1000000);
+    _credit_bits = (uint32_t)std::min<uint64_t>(_credit_bits + elapsed / 1000000, burst_bits);
+
+    size_t sent = 0;
+    while (_rx.used() > 0 && _credit_bits >= 10)
+    {
+        size_t len;
+        const uint8_t *data = _rx.peek(&len);
+        len = std::min<size_t>(len, _credit_bits / 10);
+        size_t n = _bus->modem_bus_write(data, len);
+        _rx.consume(n);
+        _credit_bits -= n * 10;
+        sent += n;
+        if (n < len)
+            break;
+    }
+
+    if (sent > 0)
+        _bus->modem_bus_flush();
+    return sent;
+}
+
+size_t ModemCore::read_host(uint8_t *buf, size_t len)
+{
+    size_t avail = _bus->modem_bus_available();
+    if (avail == 0)
+        return 0;
+    return _bus->modem_bus_read(buf, std::min(avail, len));
+}
+
+bool ModemCore::net_writable(int fd)
+{
+    if (fd < 0)
+        return false;
+
+    fd_set fdset;
+    FD_ZERO(&fdset);
+    FD_SET(fd, &fdset);
+    struct timeval tv = {0, 0};
+    return select(fd + 1, nullptr, &fdset, nullptr, &tv) > 0;
+}
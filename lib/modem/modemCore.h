@@ -0,0 +1,137 @@
+/**
+ * Bus independent data path of the FujiNet modem.
+ * Buffers data from the network for the host and hands it to the
+ * bus no faster than the emulated baud rate.
+ */
+
+#ifndef MODEM_CORE_H
+#define MODEM_CORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <vector>
+
+// Network data buffered for the host, as time at the current baud rate
+#define MODEM_RX_BUFFER_MS 500
+#define MODEM_RX_BUFFER_MIN 256
+#define MODEM_RX_BUFFER_MAX 8192
+
+// Most data handed to the bus at once, as time at the current baud rate
+#define MODEM_PACE_BURST_MS 10
+#define MODEM_PACE_BURST_MIN 16
+
+/**
+ * Implemented by each bus target to move modem data to and from the host
+ */
+class ModemBus
+{
+public:
+    virtual ~ModemBus() {}
+
+    // Bytes sent by the host which are waiting to be read
+    virtual size_t modem_bus_available() = 0;
+    virtual size_t modem_bus_read(uint8_t *buf, size_t len) = 0;
+    virtual size_t modem_bus_write(const uint8_t *buf, size_t len) = 0;
+    virtual void modem_bus_flush() {}
+};
+
+/**
+ * ModemBus over a UART style port with available(), readBytes(), write()
+ * and flush(), e.g. UARTManager or SioCom
+ */
+template <class Port>
+class ModemPortBus : public ModemBus
+{
+private:
+    Port *_fixed = nullptr;
+    Port *const *_port;
+
+public:
+    // Port pointer owned by the bus which may be set after the modem is created
+    ModemPortBus(Port *const *port) : _port(port) {}
+    ModemPortBus(Port &port) : _fixed(&port), _port(&_fixed) {}
+    ModemPortBus(const ModemPortBus &) = delete;
+    ModemPortBus &operator=(const ModemPortBus &) = delete;
+
+    size_t modem_bus_available() override
+    {
+        int avail = (*_port)->available();
+        return avail < 0 ? 0 : (size_t)avail;
+    }
+
+    size_t modem_bus_read(uint8_t *buf, size_t len) override
+    {
+        return (*_port)->readBytes(buf, len);
+    }
+
+    size_t modem_bus_write(const uint8_t *buf, size_t len) override
+    {
+        auto written = (*_port)->write(buf, len);
+        return (ssize_t)written < 0 ? 0 : (size_t)written;
+    }
+
+    void modem_bus_flush() override
+    {
+        (*_port)->flush();
+    }
+};
+
+class ModemRingBuffer
+{
+private:
+    std::vector<uint8_t> _buf;
+    size_t _head = 0;
+    size_t _count = 0;
+
+public:
+    // Drops buffered data
+    void resize(size_t size);
+    void clear() { _head = _count = 0; }
+
+    size_t size() const { return _buf.size(); }
+    size_t used() const { return _count; }
+    size_t space() const { return _buf.size() - _count; }
+
+    size_t put(const uint8_t *data, size_t len);
+    // Contiguous run of buffered data at the read position
+    const uint8_t *peek(size_t *len) const;
+    void consume(size_t len);
+};
+
+class ModemCore
+{
+private:
+    ModemBus *_bus;
+    ModemRingBuffer _rx;
+    unsigned int _baud = 0;
+    uint64_t _last_us = 0;
+    uint32_t _credit_bits = 0;
+    uint32_t _part_bit = 0; // millionths of a bit earned but not yet credited
+
+public:
+    ModemCore(ModemBus *bus);
+
+    // Sizes the buffer for the new rate, drops buffered data
+    void set_baud(unsigned int baud);
+    unsigned int baud() const { return _baud; }
+
+    // Network to host
+    size_t rx_space() const { return _rx.space(); }
+    size_t rx_pending() const { return _rx.used(); }
+    size_t rx_put(const uint8_t *data, size_t len);
+    // Send buffered data to the host as fast as the baud rate allows, returns bytes sent
+    size_t service_rx();
+
+    // Host to network, returns bytes read from the host
+    size_t read_host(uint8_t *buf, size_t len);
+
+    // True if the socket can take more data without blocking. Host data is
+    // only read when it can, so a slow peer holds back the host through the
+    // bus instead of stalling the bus loop in a blocking write.
+    static bool net_writable(int fd);
+
+    void reset();
+};
+
+#endif // MODEM_CORE_H
@@ -13,6 +13,7 @@
 
 #include "status_error_codes.h"
 #include "utils.h"
+#include "fnDirListCache.h"
 
 #include <cstring>
 #include <memory>
@@ -68,6 +69,10 @@ bool NetworkProtocolFS::open_file()
     if (opened_url->path.empty())
         return true;
 
+    // Host slots on this server may have the directory listed
+    if (is_write_mode())
+        fnDirListCache.invalidate_server(opened_url->host.c_str());
+
     return open_file_handle();
 }
 
@@ -178,7 +183,18 @@ bool NetworkProtocolFS::close()
 
 bool NetworkProtocolFS::close_file()
 {
-    return close_file_handle();
+    bool err = close_file_handle();
+
+    // Size and time of the written file are known now, drop listings made while it was open
+    if (is_write_mode())
+        fnDirListCache.invalidate_server(opened_url->host.c_str());
+
+    return err;
+}
+
+bool NetworkProtocolFS::is_write_mode()
+{
+    return aux1_open == PROTOCOL_OPEN_WRITE || aux1_open == PROTOCOL_OPEN_APPEND || aux1_open == PROTOCOL_OPEN_READWRITE;
 }
 
 bool NetworkProtocolFS::close_dir()
@@ -427,26 +443,36 @@ bool NetworkProtocolFS::perform_idempotent_80(PeoplesUrlParser *url, cmdFrame_t
 #ifdef VERBOSE_PROTOCOL
     Debug_printf("NetworkProtocolFS::perform_idempotent_80, url: %s cmd: 0x%02X\r\n", url->url.c_str(), cmdFrame->comnd);
 #endif
+    bool err;
     switch (cmdFrame->comnd)
     {
     case FUJI_CMD_RENAME:
-        return rename(url, cmdFrame);
+        err = rename(url, cmdFrame);
+        break;
     case FUJI_CMD_DELETE:
-        return del(url, cmdFrame);
+        err = del(url, cmdFrame);
+        break;
     case FUJI_CMD_LOCK:
         return lock(url, cmdFrame);
     case FUJI_CMD_UNLOCK:
         return unlock(url, cmdFrame);
     case FUJI_CMD_MKDIR:
-        return mkdir(url, cmdFrame);
+        err = mkdir(url, cmdFrame);
+        break;
     case FUJI_CMD_RMDIR:
-        return rmdir(url, cmdFrame);
+        err = rmdir(url, cmdFrame);
+        break;
     default:
 #ifdef VERBOSE_PROTOCOL
         Debug_printf("Uncaught idempotent command: 0x%02X\r\n", cmdFrame->comnd);
 #endif
         return true;
     }
+
+    // Directory changed behind the back of host slots, drop their cached listings of this server
+    fnDirListCache.invalidate_server(url->host.c_str());
+
+    return err;
 }
 
 bool NetworkProtocolFS::rename(PeoplesUrlParser *url, cmdFrame_t *cmdFrame)
@@ -274,6 +274,12 @@ protected:
      */
     virtual bool close_file();
 
+    /**
+     * @brief Was the file opened for writing?
+     * @return TRUE if opened to write, append or read/write.
+     */
+    bool is_write_mode();
+
     /**
      * @brief close file handle
      * @return FALSE if success, true if error
@@ -81,8 +81,8 @@ void atari1027::pdf_handle_char(uint16_t c, uint8_t aux1, uint8_t aux2)
                 default:
                     break;
                 }
-                fputc(d1, _file);
-                fprintf(_file, ")600("); // |^ -< -> !v
+                pdf_putc(d1);
+                pdf_printf(")600("); // |^ -< -> !v
                 valid = true;
             }
             else
@@ -102,9 +102,9 @@ void atari1027::pdf_handle_char(uint16_t c, uint8_t aux1, uint8_t aux2)
                 }
             if (valid)
             {
-                fputc(d, _file);
+                pdf_putc(d);
                 if (uscoreFlag)
-                    fprintf(_file, ")600(_"); // close text string, backspace, start new text string, write _
+                    pdf_printf(")600(_"); // close text string, backspace, start new text string, write _
 
                 pdf_X += charWidth; // update x position
             }
@@ -114,11 +114,11 @@ void atari1027::pdf_handle_char(uint16_t c, uint8_t aux1, uint8_t aux2)
             if (c == 123 || c == 125 || c == 127)
                 c = ' ';
             if (c == '\\' || c == '(' || c == ')')
-                fputc('\\', _file);
-            fputc(c, _file);
+                pdf_putc('\\');
+            pdf_putc(c);
 
             if (uscoreFlag)
-                fprintf(_file, ")600(_"); // close text string, backspace, start new text string, write _
+                pdf_printf(")600(_"); // close text string, backspace, start new text string, write _
 
             pdf_X += charWidth; // update x position
         }
@@ -55,25 +55,25 @@ void atari822::pdf_handle_char(uint16_t c, uint8_t aux1, uint8_t aux2)
         textMode = false;
         if (!BOLflag)
             pdf_end_line();   // close out string array
-        fprintf(_file, "ET\r\n"); // close out text object
+        pdf_printf("ET\r\n"); // close out text object
     }
 
     if (!textMode && BOLflag)
     {
-        fprintf(_file, "q\n %g 0 0 %g %g %g cm\r\n", printWidth, lineHeight / 10.0, leftMargin, pdf_Y);
-        fprintf(_file, "BI\n /W 240\n /H 1\n /CS /G\n /BPC 1\n /D [1 0]\n /F /AHx\nID\r\n");
+        pdf_printf("q\n %g 0 0 %g %g %g cm\r\n", printWidth, lineHeight / 10.0, leftMargin, pdf_Y);
+        pdf_printf("BI\n /W 240\n /H 1\n /CS /G\n /BPC 1\n /D [1 0]\n /F /AHx\nID\r\n");
         BOLflag = false;
     }
     if (!textMode)
     {
         if (gfxNumber < 30)
-            fprintf(_file, " %02X", c);
+            pdf_printf(" %02X", c);
 
         gfxNumber++;
 
         if (gfxNumber == 40)
         {
-            fprintf(_file, "\n >\nEI\nQ\r\n");
+            pdf_printf("\n >\nEI\nQ\r\n");
             pdf_Y -= lineHeight / 10.0;
             BOLflag = true;
             gfxNumber = 0;
@@ -92,8 +92,8 @@ void atari822::pdf_handle_char(uint16_t c, uint8_t aux1, uint8_t aux2)
     if (textMode && c > 31 && c < 127)
     {
         if (c == '\\' || c == '(' || c == ')')
-            fwrite("\\", 1, 1, _file);
-        fwrite(&c, 1, 1, _file);
+            pdf_putc('\\');
+        pdf_putc(c);
 
         pdf_X += charWidth; // update x position
     }
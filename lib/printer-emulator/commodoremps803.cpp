@@ -34,7 +34,7 @@ void commodoremps803::pdf_clear_modes()
 
 void commodoremps803::mps_set_font(uint8_t F)
 {
-    fprintf(_file, ")]TJ /F%u 12 Tf 100 Tz [(", F);
+    pdf_printf(")]TJ /F%u 12 Tf 100 Tz [(", F);
     switch (F)
     {
     case 1:
@@ -84,11 +84,11 @@ void commodoremps803::mps_print_bitmap(uint8_t c)
     // e.g., [(0)100(1)100(4)100(50)]TJ
     // lead with '0' to enter a space
     // then shift back with 100 and print each pin
-    fprintf(_file, " ");
+    pdf_printf(" ");
     for (unsigned i = 0; i < 8; i++)
     {
         if ((c >> i) & 0x01)
-            fprintf(_file, ")100(%u", i + 1);
+            pdf_printf(")100(%u", i + 1);
     }
 }
 
@@ -197,7 +197,7 @@ Specify Dot Address     CHRS(27);CHR$(16);CHR$(nH)CHR$(nL)
                         if (fontNumber != 1)
                             mps_set_font(1);
                         for (int i = 0; i < n - col; i++)
-                            fputc(' ', _file);
+                            pdf_putc(' ');
                         if (fontNumber != 1)
                             mps_set_font(fontNumber);
                     }
@@ -242,7 +242,7 @@ Specify Dot Address     CHRS(27);CHR$(16);CHR$(nH)CHR$(nL)
                     {
                         mps_set_font(5);
                         for (int i = 0; i < n - col; i++)
-                            fputc(' ', _file);
+                            pdf_putc(' ');
                         mps_set_font(fontNumber);
                     }
                     reset_cmd();
@@ -286,7 +286,7 @@ Specify Dot Address     CHRS(27);CHR$(16);CHR$(nH)CHR$(nL)
     case 10:
         // Line Feed               CHR$(10)
         // DO A CR without reseting modes:
-        fprintf(_file, ")]TJ\r\n"); // close the line
+        pdf_printf(")]TJ\r\n"); // close the line
         pdf_X = 0; // CR
         BOLflag = true;
         pdf_new_line();
@@ -321,8 +321,8 @@ Specify Dot Address     CHRS(27);CHR$(16);CHR$(nH)CHR$(nL)
             mps_update_font();
             // handle rendering pdf char's that need esc'ing: "\", ")", "("
             if (c == ('\\') || c == '(' || c == ')')
-                fwrite("\\", 1, 1, _file);
-            fwrite(&c, 1, 1, _file);
+                pdf_putc('\\');
+            pdf_putc(c);
             pdf_X += charWidth; // update x position
         }
         break;
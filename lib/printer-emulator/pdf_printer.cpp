@@ -1,44 +1,130 @@
 #include "pdf_printer.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdarg>
+#include <cstring>
+#include <map>
+#include <vector>
+
 #include "../../include/debug.h"
 
 #include "fsFlash.h"
 
 #include "utils.h"
 
+size_t pdfPrinter::pdf_tell()
+{
+    if (_out_len == 0)
+        _out_base = ftell(_file);
+    return _out_base + _out_len;
+}
+
+void pdfPrinter::pdf_flush()
+{
+    if (_out_len == 0)
+        return;
+    fwrite(_out_buf, 1, _out_len, _file);
+    _out_base += _out_len;
+    _out_len = 0;
+}
+
+void pdfPrinter::pdf_write(const void *data, size_t len)
+{
+    const char *p = (const char *)data;
+    if (_out_len == 0)
+        _out_base = ftell(_file);
+
+    while (len > 0)
+    {
+        if (_out_len == PDF_OUT_BUFFER)
+            pdf_flush();
+        size_t n = std::min(len, (size_t)PDF_OUT_BUFFER - _out_len);
+        memcpy(&_out_buf[_out_len], p, n);
+        _out_len += n;
+        p += n;
+        len -= n;
+    }
+}
+
+void pdfPrinter::pdf_printf(const char *fmt, ...)
+{
+    if (_out_len == 0)
+        _out_base = ftell(_file);
+
+    // Format straight into the buffer when it fits
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(&_out_buf[_out_len], PDF_OUT_BUFFER - _out_len, fmt, args);
+    va_end(args);
+    if (n < 0)
+        return;
+    if ((size_t)n < PDF_OUT_BUFFER - _out_len)
+    {
+        _out_len += n;
+        return;
+    }
+
+    std::vector<char> tmp(n + 1);
+    va_start(args, fmt);
+    vsnprintf(tmp.data(), tmp.size(), fmt, args);
+    va_end(args);
+    pdf_write(tmp.data(), n);
+}
+
+void pdfPrinter::pdf_copy_file(FILE *f, size_t len)
+{
+    // Read straight into the output buffer
+    if (_out_len == 0)
+        _out_base = ftell(_file);
+
+    while (len > 0)
+    {
+        if (_out_len == PDF_OUT_BUFFER)
+            pdf_flush();
+        size_t n = fread(&_out_buf[_out_len], 1, std::min(len, (size_t)PDF_OUT_BUFFER - _out_len), f);
+        if (n == 0)
+            break;
+        _out_len += n;
+        len -= n;
+    }
+}
+
 void pdfPrinter::pdf_header()
 {
     Debug_println("pdf header");
     pdf_Y = 0;
     pdf_X = 0;
     pdf_pageCounter = 0;
-    fprintf(_file, "%%PDF-1.4\n");
+    _out_len = 0;
+    pdf_printf("%%PDF-1.4\n");
     // first object: catalog of pages
     pdf_objCtr = 1;
-    objLocations[pdf_objCtr] = ftell(_file);
-    fprintf(_file, "1 0 obj\n<</Type /Catalog /Pages 2 0 R>>\nendobj\n");
+    objLocations[pdf_objCtr] = pdf_tell();
+    pdf_printf("1 0 obj\n<</Type /Catalog /Pages 2 0 R>>\nendobj\n");
     // object 2 0 R is printed by pdf_page_resource() before xref
     // object 3 0 R is printed at pdf_font_resource() before xref
     pdf_objCtr = 3; // set up counter for pdf_add_font()
+    pdf_flush();
 }
 
 void pdfPrinter::pdf_page_resource()
 {
-    objLocations[2] = ftell(_file); // hard code page catalog as object #2
-    fprintf(_file, "2 0 obj\n<</Type /Pages /Kids [ ");
+    objLocations[2] = pdf_tell(); // hard code page catalog as object #2
+    pdf_printf("2 0 obj\n<</Type /Pages /Kids [ ");
     for (int i = 0; i < pdf_pageCounter; i++)
     {
-        fprintf(_file, "%d 0 R ", pageObjects[i]);
+        pdf_printf("%d 0 R ", pageObjects[i]);
     }
-    fprintf(_file, "] /Count %d>>\nendobj\n", pdf_pageCounter);
+    pdf_printf("] /Count %d>>\nendobj\n", pdf_pageCounter);
 }
 
 void pdfPrinter::pdf_font_resource()
 {
     int fntCtr = 0;
-    objLocations[3] = ftell(_file);
+    objLocations[3] = pdf_tell();
     // font catalog
-    fprintf(_file, "3 0 obj\n<</Font <<");
+    pdf_printf("3 0 obj\n<</Font <<");
     for (int i = 0; i < MAXFONTS; i++)
     {
         if (fontUsed[i])
@@ -48,127 +134,108 @@ void pdfPrinter::pdf_font_resource()
             //  font descriptor
             //  font widths
             //  font file
-            fprintf(_file, "/F%d %d 0 R ", i + 1, pdf_objCtr + 1 + fntCtr * 4); /// F1 4 0 R /F2 8 0 R>>>>\nendobj\n
+            pdf_printf("/F%d %d 0 R ", i + 1, pdf_objCtr + 1 + fntCtr * 4); /// F1 4 0 R /F2 8 0 R>>>>\nendobj\n
             fntCtr++;
         }
     }
-    fprintf(_file, ">>>>\nendobj\n");
+    pdf_printf(">>>>\nendobj\n");
+}
+
+/*
+ Each font file in flash is an object template: the LUT lists, for every font, the offsets
+ of the seven %d placeholders after the first one at offset 0 (the last entry is the file
+ size). The text between placeholders is copied in blocks and the object numbers patched in.
+ A font takes 4 objects: dictionary, descriptor, widths and font file.
+*/
+struct pdf_font_token
+{
+    uint8_t obj; // object within the font, 1-4
+    bool def;    // object definition rather than a reference
+};
+
+static const pdf_font_token pdf_font_tokens[7] = {
+    {1, true}, {2, false}, {4, false}, {2, true}, {3, false}, {3, true}, {4, true}};
+
+// Parsed LUT files by printer shortname, they don't change while running
+static std::map<std::string, std::vector<std::array<size_t, 7>>> pdf_font_luts;
+
+static const std::vector<std::array<size_t, 7>> &pdf_font_lut(const std::string &shortname)
+{
+    auto it = pdf_font_luts.find(shortname);
+    if (it != pdf_font_luts.end())
+        return it->second;
+
+    std::vector<std::array<size_t, 7>> &lut = pdf_font_luts[shortname];
+
+    char fname[30]; // filename: /f/shortname/LUT
+    snprintf(fname, sizeof(fname), "/f/%s/LUT", shortname.c_str());
+    FILE *f = fsFlash.file_open(fname);
+    if (f == nullptr)
+    {
+        Debug_printf("Can't open font LUT %s\r\n", fname);
+        return lut;
+    }
+
+    int maxFonts = util_parseInt(f);
+    for (int i = 0; i < maxFonts; i++)
+    {
+        std::array<size_t, 7> fontObjPos;
+        for (int j = 0; j < 7; j++)
+            fontObjPos[j] = util_parseInt(f);
+        lut.push_back(fontObjPos);
+    }
+    fclose(f);
+    return lut;
 }
 
 void pdfPrinter::pdf_add_fonts() // pdfFont_t *fonts[],
 {
     Debug_print("pdf add fonts: ");
 
-    // OPEN LUT FILE
-    char fname[30]; // filename: /f/shortname/Fi
-    snprintf(fname, sizeof(fname), "/f/%s/LUT", shortname.c_str());
-    FILE *lut = fsFlash.file_open(fname);
-    int maxFonts = util_parseInt(lut);
+    const std::vector<std::array<size_t, 7>> &lut = pdf_font_lut(shortname);
 
     // font dictionary
-    for (int i = 0; i < maxFonts; i++)
+    for (int i = 0; i < (int)lut.size(); i++)
     {
         Debug_printf("font %d - ", i + 1);
-        // READ LINE IN LUT FILE
-        size_t fontObjPos[7];
-        for (int j = 0; j < 7; j++)
-            fontObjPos[j] = util_parseInt(lut);
+        if (!fontUsed[i])
+        {
+            Debug_print("unused; ");
+            continue;
+        }
 
-        // assign fontObjPos[] matrix
-        if (fontUsed[i])
+        char fname[30];                                                        // filename: /f/shortname/Fi
+        snprintf(fname, sizeof(fname), "/f/%s/F%d", shortname.c_str(), i + 1); // e.g. /f/a820/F2
+        FILE *fff = fsFlash.file_open(fname);                                  // Font File File - fff
+        if (fff == nullptr)
         {
-            size_t fp = 0;
-            char fname[30];                                        // filename: /f/shortname/Fi
-            snprintf(fname, sizeof(fname), "/f/%s/F%d", shortname.c_str(), i + 1); // e.g. /f/a820/F2
-            FILE *fff = fsFlash.file_open(fname);                 // Font File File - fff
-
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            pdf_objCtr++; // = 6;
-            objLocations[pdf_objCtr] = ftell(_file);
-            fprintf(_file, "%d", pdf_objCtr); // 6
-            while (fp < fontObjPos[0])
-            {
-                fputc(fgetc(fff), _file);
-                fp++;
-            }
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            fprintf(_file, "%d", pdf_objCtr + 1); // 7
-            while (fp < fontObjPos[1])
-            {
-                fputc(fgetc(fff), _file);
-                fp++;
-            }
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            fprintf(_file, "%d", pdf_objCtr + 3); // 9
-            while (fp < fontObjPos[2])
-            {
-                fputc(fgetc(fff), _file);
-                fp++;
-            }
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            pdf_objCtr++; // = 7;
-            objLocations[pdf_objCtr] = ftell(_file);
-            fprintf(_file, "%d", pdf_objCtr); // 7
-            while (fp < fontObjPos[3])
-            {
-                fputc(fgetc(fff), _file);
-                fp++;
-            }
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            fprintf(_file, "%d", pdf_objCtr + 1); // 8
-            while (fp < fontObjPos[4])
-            {
-                fputc(fgetc(fff), _file);
-                fp++;
-            }
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            pdf_objCtr++; // = 8;
-            objLocations[pdf_objCtr] = ftell(_file);
-            fprintf(_file, "%d", pdf_objCtr); // 8
-            while (fp < fontObjPos[5])
-            {
-                fputc(fgetc(fff), _file);
-                fp++;
-            }
-            fgetc(fff); // '%'
-            fp++;
-            fgetc(fff); // 'd'
-            fp++;
-            pdf_objCtr++; // = 9;
-            objLocations[pdf_objCtr] = ftell(_file);
-            fprintf(_file, "%d", pdf_objCtr); // 9
-            // insert rest of file
-            while (fp < fontObjPos[6]) //(fff.available())
+            Debug_printf("can't open %s; ", fname);
+            continue;
+        }
+
+        int base = pdf_objCtr;
+        size_t fp = 0;
+        for (int j = 0; j < 7; j++)
+        {
+            char placeholder[2]; // "%d"
+            fp += fread(placeholder, 1, sizeof(placeholder), fff);
+
+            const pdf_font_token &t = pdf_font_tokens[j];
+            if (t.def)
+                objLocations[base + t.obj] = pdf_tell();
+            pdf_printf("%d", base + t.obj);
+
+            if (lut[i][j] > fp)
             {
-                fputc(fgetc(fff), _file);
-                fp++;
+                pdf_copy_file(fff, lut[i][j] - fp);
+                fp = lut[i][j];
             }
-            fclose(fff);
-            fputc('\n', _file); // make sure there's a seperator
         }
-        else
-            Debug_print("unused; ");
+        pdf_objCtr = base + 4;
+        fclose(fff);
+        pdf_putc('\n'); // make sure there's a seperator
     }
 
-    fclose(lut);
     Debug_println("done.");
 }
 
@@ -177,18 +244,18 @@ void pdfPrinter::pdf_new_page()
     Debug_println("pdf new page");
     pdf_objCtr++;
     pageObjects[pdf_pageCounter] = pdf_objCtr;
-    objLocations[pdf_objCtr] = ftell(_file);
-    fprintf(_file, "%d 0 obj\n<</Type /Page /Parent 2 0 R /Resources 3 0 R /MediaBox [0 0 %g %g] /Contents [ ", pdf_objCtr, pageWidth, pageHeight);
+    objLocations[pdf_objCtr] = pdf_tell();
+    pdf_printf("%d 0 obj\n<</Type /Page /Parent 2 0 R /Resources 3 0 R /MediaBox [0 0 %g %g] /Contents [ ", pdf_objCtr, pageWidth, pageHeight);
     pdf_objCtr++; // increment for the contents stream object
-    fprintf(_file, "%d 0 R ", pdf_objCtr);
-    fprintf(_file, "]>>\nendobj\n");
+    pdf_printf("%d 0 R ", pdf_objCtr);
+    pdf_printf("]>>\nendobj\n");
 
     // open content stream
-    objLocations[pdf_objCtr] = ftell(_file);
-    fprintf(_file, "%d 0 obj\n<</Length ", pdf_objCtr);
-    idx_stream_length = ftell(_file);
-    fprintf(_file, "0000000000 >>\nstream\n");
-    idx_stream_start = ftell(_file);
+    objLocations[pdf_objCtr] = pdf_tell();
+    pdf_printf("%d 0 obj\n<</Length ", pdf_objCtr);
+    idx_stream_length = pdf_tell();
+    pdf_printf("0000000000 >>\nstream\n");
+    idx_stream_start = pdf_tell();
 
     // open new text object
     pdf_begin_text(pageHeight - topMargin);
@@ -198,10 +265,10 @@ void pdfPrinter::pdf_begin_text(double Y)
 {
     Debug_println("pdf begin text");
     // open new text object
-    fprintf(_file, "BT\n");
+    pdf_printf("BT\n");
     TOPflag = false;
-    fprintf(_file, "/F%u %g Tf %d Tz\n", fontNumber, fontSize, fontHorizScale);
-    fprintf(_file, "%g %g Td\n", leftMargin, Y);
+    pdf_printf("/F%u %g Tf %d Tz\n", fontNumber, fontSize, fontHorizScale);
+    pdf_printf("%g %g Td\n", leftMargin, Y);
     pdf_Y = Y; // reset print roller to top of page
     pdf_X = 0; // set carriage to LHS
     BOLflag = true;
@@ -213,11 +280,11 @@ void pdfPrinter::pdf_new_line()
 
     // position new line and start text string array
     if (pdf_dY != 0)
-        fprintf(_file, "0 Ts ");
+        pdf_printf("0 Ts ");
 #if !defined(BUILD_APPLE) && !defined(BUILD_RC2014)
     pdf_dY -= lineHeight;
 #endif
-    fprintf(_file, "0 %g Td [(", pdf_dY);
+    pdf_printf("0 %g Td [(", pdf_dY);
     pdf_Y += pdf_dY; // line feed
     pdf_dY = 0;
     // pdf_X = 0;              // CR over in end line()
@@ -227,7 +294,7 @@ void pdfPrinter::pdf_new_line()
 void pdfPrinter::pdf_end_line()
 {
     Debug_println("pdf end line");
-    fprintf(_file, ")]TJ\n"); // close the line
+    pdf_printf(")]TJ\n"); // close the line
     // pdf_Y -= lineHeight; // line feed - moved to new line()
     pdf_X = 0; // CR
     BOLflag = true;
@@ -237,7 +304,7 @@ void pdfPrinter::pdf_end_line()
 
 void pdfPrinter::pdf_set_rise()
 {
-    fprintf(_file, ")]TJ %g Ts [(", pdf_dY);
+    pdf_printf(")]TJ %g Ts [(", pdf_dY);
 }
 
 void pdfPrinter::pdf_end_page()
@@ -246,15 +313,25 @@ void pdfPrinter::pdf_end_page()
     // close text object & stream
     if (!BOLflag)
         pdf_end_line();
-    fprintf(_file, "ET\n");
-    idx_stream_stop = ftell(_file);
-    fprintf(_file, "endstream\nendobj\n");
-    size_t idx_temp = ftell(_file);
-    fflush(_file);
-    fseek(_file, idx_stream_length, SEEK_SET);
-    fprintf(_file, "%10u", (unsigned)(idx_stream_stop - idx_stream_start));
-    fflush(_file);
-    fseek(_file, idx_temp, SEEK_SET);
+    pdf_printf("ET\n");
+    idx_stream_stop = pdf_tell();
+    pdf_printf("endstream\nendobj\n");
+
+    // fill in the stream length, in the buffer if it's still there
+    char len[11];
+    snprintf(len, sizeof(len), "%10u", (unsigned)(idx_stream_stop - idx_stream_start));
+    if (_out_len > 0 && idx_stream_length >= _out_base)
+        memcpy(&_out_buf[idx_stream_length - _out_base], len, 10);
+    else
+    {
+        pdf_flush();
+        size_t idx_temp = ftell(_file);
+        fseek(_file, idx_stream_length, SEEK_SET);
+        fwrite(len, 1, 10, _file);
+        fseek(_file, idx_temp, SEEK_SET);
+    }
+    // lines stay buffered across process() calls until the page is done
+    pdf_flush();
     // set counters
     pdf_pageCounter++;
     TOPflag = true;
@@ -263,19 +340,19 @@ void pdfPrinter::pdf_end_page()
 void pdfPrinter::pdf_xref()
 {
     Debug_println("pdf xref");
-    size_t xref = ftell(_file);
+    size_t xref = pdf_tell();
     pdf_objCtr++;
-    fprintf(_file, "xref\n");
-    fprintf(_file, "0 %d\n", pdf_objCtr);
-    fprintf(_file, "0000000000 65535 f\n");
+    pdf_printf("xref\n");
+    pdf_printf("0 %d\n", pdf_objCtr);
+    pdf_printf("0000000000 65535 f\n");
     for (int i = 1; i < pdf_objCtr; i++)
     {
-        fprintf(_file, "%010u 00000 n\n", (unsigned)objLocations[i]);
+        pdf_printf("%010u 00000 n\n", (unsigned)objLocations[i]);
     }
-    fprintf(_file, "trailer <</Size %d/Root 1 0 R>>\n", pdf_objCtr);
-    fprintf(_file, "startxref\n");
-    fprintf(_file, "%u\n", (unsigned)xref);
-    fprintf(_file, "%%%%EOF\n");
+    pdf_printf("trailer <</Size %d/Root 1 0 R>>\n", pdf_objCtr);
+    pdf_printf("startxref\n");
+    pdf_printf("%u\n", (unsigned)xref);
+    pdf_printf("%%%%EOF\n");
 }
 
 bool pdfPrinter::process_buffer(uint8_t n, uint8_t aux1, uint8_t aux2)
@@ -421,6 +498,7 @@ void pdfPrinter::pre_close_file()
     pdf_add_fonts();
     pdf_page_resource();
     pdf_xref();
+    pdf_flush();
 
     // printer_emu::pageEject();
 }
@@ -13,6 +13,9 @@
 
 #define MAXFONTS 33 // maximum number of fonts can use
 
+// PDF output is collected in memory and written to the file in blocks of this size
+#define PDF_OUT_BUFFER 4096
+
 enum class colorMode_t
 {
     off = 0,
@@ -52,6 +55,18 @@ protected:
     size_t objLocations[256]; // reference table storage
     int pdf_objCtr = 0;       // count the objects
 
+    // buffered output, everything written to the PDF goes through these
+    char _out_buf[PDF_OUT_BUFFER];
+    size_t _out_len = 0;        // bytes waiting in _out_buf
+    size_t _out_base = 0;       // file offset of _out_buf[0]
+
+    void pdf_printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    void pdf_write(const void *data, size_t len);
+    void pdf_putc(char c) { pdf_write(&c, 1); }
+    void pdf_copy_file(FILE *f, size_t len);
+    size_t pdf_tell();
+    void pdf_flush();
+
     void pdf_header();
     void pdf_add_fonts(); // pdfFont_t *fonts[],
     void pdf_new_page();
@@ -1,12 +1,12 @@
 #include "png_printer.h"
 
+#include <cstring>
+
 #include "../../include/debug.h"
 
 
 // rewrite of TinyPngOut https://www.nayuki.io/page/tiny-png-output
 
-#define DEFLATE_MAX_BLOCK_SIZE 0xFFFF
-
 void pngPrinter::uint32_to_array(uint32_t src, uint8_t dest[4])
 {
     dest[0] = (uint8_t)((src >> 24) & 0xff);
@@ -15,17 +15,25 @@ void pngPrinter::uint32_to_array(uint32_t src, uint8_t dest[4])
     dest[3] = (uint8_t)(src & 0xff);
 }
 
-uint32_t pngPrinter::update_adler32(uint32_t adler, uint8_t data)
+uint32_t pngPrinter::update_adler32(uint32_t adler, const uint8_t *buf, size_t len)
 {
     // https://gist.github.com/kornelski/710db9d30a64db0807c5bfbdbdecf85e
-    unsigned s1 = adler & 0xffff;
-    unsigned s2 = (adler >> 16) & 0xffff;
+    // 5552 is the most bytes that can be summed before s2 may overflow 32 bits
+    uint32_t s1 = adler & 0xffff;
+    uint32_t s2 = (adler >> 16) & 0xffff;
 
-    s1 += data;
-    s1 %= 65521;
-
-    s2 += s1;
-    s2 %= 65521;
+    while (len > 0)
+    {
+        size_t n = len < 5552 ? len : 5552;
+        len -= n;
+        while (n--)
+        {
+            s1 += *buf++;
+            s2 += s1;
+        }
+        s1 %= 65521;
+        s2 %= 65521;
+    }
 
     return (s2 << 16) | s1;
 }
@@ -219,139 +227,193 @@ void pngPrinter::png_data()
     significance and can occur at any point in the compressed datastream
 */
     Debug_println("Starting PNG Image Data...");
+    img_pos = 0;
+    Ypos = 0;
+    adler_value = 1;
+    bit_buf = 0;
+    bit_count = 0;
+    last_byte = -1;
+    idat_len = 0;
+    memset(prev_line, 0, sizeof(prev_line));
+
+    // Deflate-compressed datastreams within PNG are stored in the “zlib” format
+    // https://tools.ietf.org/html/rfc1950#page-4
+    Debug_println("Writing ZLIB header.");
+    // Compression method/flags code: 1 byte (For PNG compression method 0, the zlib compression method/flags code must specify method code 8 (“deflate” compression))
+    // 256 byte window is plenty, the encoder only refers back to the previous byte
+    idat_buf[idat_len++] = 0x08; // ZLIB "Deflate" compression scheme
+    //  Additional flags/check bits: 1 byte (must be such that method + flags, when viewed as a 16-bit unsigned integer stored in MSB order (CMF*256 + FLG), is a multiple of 31.)
+    idat_buf[idat_len++] = 0x1D; // precompute so that 0x081D is divisible by 31 [ (0x800 / 31 + 1) * 31 - 0x800 ]
+
+    // https://tools.ietf.org/html/rfc1951#section-3.2.6
+    // The whole image is a single final block compressed with the fixed Huffman codes
+    deflate_bits(1, 1); // BFINAL
+    deflate_bits(1, 2); // BTYPE 01
+}
+
+void pngPrinter::idat_flush()
+{
+    if (idat_len == 0)
+        return;
+
+    // Each IDAT chunk holds whatever compressed data has built up, chunk boundaries have no meaning
     uint8_t data[] = {
-        // IDAT chunk
-        0x00, 0x00, 0x00, 0x00, // 0-3      size placeholder
+        0x00, 0x00, 0x00, 0x00, // 0-3      size
         'I', 'D', 'A', 'T',     // 4-7      IDAT
     };
-    crc_value = rc_crc32(0, &data[4], 4); // begin CRC calculation
+    uint8_t ccc[] = {0, 0, 0, 0};
 
-    // Compute data size
-    // imgSize = (width + 1) * height; // +1 per line for filter 0's
-    uint32_t numBlocks = imgSize / DEFLATE_MAX_BLOCK_SIZE;
-    if (imgSize % DEFLATE_MAX_BLOCK_SIZE != 0)
-        numBlocks++; // Round up
-
-    dataSize += numBlocks * 5; // 5 bytes per DEFLATE uncompressed block header
-    dataSize += 2;             // 2 bytes for zlib header
-    dataSize += 4;             // 4 bytes for zlib Adler-32 checksum
-    dataSize += imgSize;       // plus the image data
-
-    uint32_to_array(dataSize, &data[0]); // store the computed size
+    uint32_to_array(idat_len, &data[0]);
+    crc_value = rc_crc32(0, &data[4], 4);
+    crc_value = rc_crc32(crc_value, idat_buf, idat_len);
+    uint32_to_array(crc_value, &ccc[0]);
 
-    fwrite(data, 1, 8, _file); // write out the IDAT header
+    fwrite(data, 1, 8, _file);
+    fwrite(idat_buf, 1, idat_len, _file);
+    fwrite(ccc, 1, 4, _file);
+    idat_len = 0;
 }
 
-void pngPrinter::png_add_data(uint8_t *buf, uint32_t n)
+void pngPrinter::deflate_bits(uint32_t bits, uint8_t n)
 {
-    uint8_t c = 0;
-    // Deflate-compressed datastreams within PNG are stored in the “zlib” format
-    // https://tools.ietf.org/html/rfc1950#page-4
+    // DEFLATE packs values starting at the least significant bit of each byte
+    bit_buf |= bits << bit_count;
+    bit_count += n;
+    while (bit_count >= 8)
+    {
+        if (idat_len == PNG_IDAT_CHUNK_SIZE)
+            idat_flush();
+        idat_buf[idat_len++] = (uint8_t)bit_buf;
+        bit_buf >>= 8;
+        bit_count -= 8;
+    }
+}
 
-    if (img_pos == 0)
+void pngPrinter::deflate_code(uint16_t code, uint8_t n)
+{
+    // Huffman codes are packed starting with their most significant bit
+    uint16_t rev = 0;
+    for (uint8_t i = 0; i < n; i++)
     {
-        Debug_println("Writing ZLIB header.");
-        // write out a ZLIB header
-        // Compression method/flags code: 1 byte (For PNG compression method 0, the zlib compression method/flags code must specify method code 8 (“deflate” compression))
-        c = 0x08; // ZLIB "Deflate" compression scheme
-        crc_value = rc_crc32(crc_value, c);
-        fputc(c, _file);
-        //  Additional flags/check bits: 1 byte (must be such that method + flags, when viewed as a 16-bit unsigned integer stored in MSB order (CMF*256 + FLG), is a multiple of 31.)
-        c = 0x1D; // precompute so that 0x081D is divisible by 31 [ (0x800 / 31 + 1) * 31 - 0x800 ]
-        crc_value = rc_crc32(crc_value, c);
-        fputc(c, _file);
-
-        //printf("new image\r\n");
+        rev = (rev << 1) | (code & 1);
+        code >>= 1;
     }
+    deflate_bits(rev, n);
+}
 
-    uint32_t idx = 0;
-    while (idx < n)
+void pngPrinter::deflate_literal(uint16_t lit)
+{
+    // https://tools.ietf.org/html/rfc1951#section-3.2.6
+    if (lit < 144)
+        deflate_code(0x30 + lit, 8);
+    else if (lit < 256)
+        deflate_code(0x190 + lit - 144, 9);
+    else if (lit < 280)
+        deflate_code(lit - 256, 7);
+    else
+        deflate_code(0xC0 + lit - 280, 8);
+}
+
+void pngPrinter::deflate_run(uint16_t len)
+{
+    // Repeat the previous byte len (3-258) times: a length code followed by distance 1
+    static const uint16_t len_base[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const uint8_t len_extra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+    int i = sizeof(len_base) / sizeof(len_base[0]) - 1;
+    while (len_base[i] > len)
+        i--;
+
+    deflate_literal(257 + i);
+    if (len_extra[i] > 0)
+        deflate_bits(len - len_base[i], len_extra[i]);
+    deflate_code(0, 5); // distance code 0 is distance 1
+}
+
+void pngPrinter::deflate_line(const uint8_t *buf, uint16_t n)
+{
+    uint16_t i = 0;
+    while (i < n)
     {
-        // at beginning of block?
-        if (blk_pos == 0)
+        uint8_t c = buf[i];
+        if (c == last_byte)
         {
-            blkSize = DEFLATE_MAX_BLOCK_SIZE;
-            uint8_t c = 0;
-            if (imgSize - img_pos <= (uint32_t)blkSize)
+            uint16_t run = 1;
+            while (i + run < n && run < 258 && buf[i + run] == c)
+                run++;
+            if (run >= 3)
             {
-                c = 1; // final block
-                blkSize = (uint16_t)(imgSize - img_pos);
+                deflate_run(run);
+                i += run;
+                continue;
             }
-
-            Debug_println("Writing ZLIB block header.");
-            // write out block header
-            crc_value = rc_crc32(crc_value, c);
-            fputc(c, _file);
-
-            // write out block size
-            c = (uint8_t)(blkSize >> 0);
-            crc_value = rc_crc32(crc_value, c);
-            fputc(c, _file);
-            c = (uint8_t)(blkSize >> 8);
-            crc_value = rc_crc32(crc_value, c);
-            fputc(c, _file);
-            c = (uint8_t)((blkSize >> 0) ^ 0xFF);
-            crc_value = rc_crc32(crc_value, c);
-            fputc(c, _file);
-            c = (uint8_t)((blkSize >> 8) ^ 0xFF);
-            crc_value = rc_crc32(crc_value, c);
-            fputc(c, _file);
-
-            //printf("new block\r\n");
         }
+        deflate_literal(c);
+        last_byte = c;
+        i++;
+    }
+}
+
+void pngPrinter::png_add_line(const uint8_t *line)
+{
+    if (Ypos >= height)
+        return;
 
-        //at beginning of a line?
-        if (Xpos == 0)
+    /*
+        https://www.w3.org/TR/PNG-Filters.html
+        Printouts are mostly blank paper and lines repeated by rep_code, so pick
+        whichever of filter None or Up leaves more bytes equal to their neighbour
+        for deflate_line() to collapse into runs.
+    */
+    uint16_t runs_none = 0;
+    uint16_t runs_up = 0;
+    uint8_t prev_none = 0;
+    uint8_t prev_up = 0;
+    for (uint16_t x = 0; x < width; x++)
+    {
+        uint8_t up = line[x] - prev_line[x];
+        if (x > 0)
         {
-            Debug_printf("Starting PNG line %d ... ",Ypos);
-            c = 0;
-            crc_value = rc_crc32(crc_value, c);
-            adler_value = update_adler32(adler_value, c);
-            fputc(c, _file);
-            //printf("\nnew line %d ", c);
-
-            img_pos++;
-            blk_pos++;
+            runs_none += (line[x] == prev_none);
+            runs_up += (up == prev_up);
         }
+        prev_none = line[x];
+        prev_up = up;
+    }
 
-        // put byte from buffer
-        c = buf[idx];
-        crc_value = rc_crc32(crc_value, c);
-        adler_value = update_adler32(adler_value, c);
-        fputc(c, _file);
-        //printf("%d ", c);
+    if (Ypos > 0 && runs_up > runs_none)
+    {
+        filt_line[0] = 2; // Up
+        for (uint16_t x = 0; x < width; x++)
+            filt_line[x + 1] = line[x] - prev_line[x];
+    }
+    else
+    {
+        filt_line[0] = 0; // None
+        memcpy(&filt_line[1], line, width);
+    }
+    memcpy(prev_line, line, width);
 
-        Xpos++;
-        idx++;
-        img_pos++;
-        blk_pos++;
-
-        // check for end of's
-        if (Xpos == width)
-        {
-            Debug_println("Finished PNG line.");
-            Xpos = 0;
-            Ypos++;
-        }
-        if (blk_pos == blkSize)
-        {
-            Debug_println("End of ZLIB block.");
-            blk_pos = 0;
-        }
-    };
+    adler_value = update_adler32(adler_value, filt_line, width + 1);
+    deflate_line(filt_line, width + 1);
+    img_pos += width + 1;
+    Ypos++;
 
     if (img_pos == imgSize)
     {
         Debug_println("Writing ZLIB Adler checksum and PNG data CRC.");
-        uint8_t data[] = {
-            0, 0, 0, 0, // Adler32 Check value: 4 bytes
-            0, 0, 0, 0  // CRC32: 4 bytes
-        };
+        deflate_literal(256);     // end of block
+        deflate_bits(0, 7);       // pad out the last byte
+        bit_count = 0;
+        bit_buf = 0;
+
+        uint8_t data[] = {0, 0, 0, 0}; // Adler32 Check value: 4 bytes
         uint32_to_array(adler_value, &data[0]);
         for (int i = 0; i < 4; i++)
-            crc_value = rc_crc32(crc_value, data[i]); // crc_value = rc_crc32(crc_value, data[0],4); ?????????
-        uint32_to_array(crc_value, &data[4]);
-        fwrite(data, 1, 8, _file);
+            deflate_bits(data[i], 8);
+        idat_flush();
         png_end();
     }
 }
@@ -405,7 +467,7 @@ bool pngPrinter::process_buffer(uint8_t n, uint8_t aux1, uint8_t aux2)
             while (rep_code-- > 0)
             {
                 Debug_printf("Adding line %d\r\n", rep_code);
-                png_add_data(&line_buffer[0], 320);
+                png_add_line(&line_buffer[0]);
             }
             BOLflag = true;
             line_index = 0;
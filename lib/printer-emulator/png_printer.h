@@ -5,7 +5,8 @@
 
 #include "printer_emulator.h"
 
-#define DEFLATE_MAX_BLOCK_SIZE 0xFFFF
+// Compressed image data is written out in IDAT chunks of up to this size
+#define PNG_IDAT_CHUNK_SIZE 2048
 
 class pngPrinter : public printer_emu
 {
@@ -16,14 +17,20 @@ protected:
 
     const uint32_t imgSize = (width + 1) * height; // size of image including BOL filter p's for IDAT chunk
     uint32_t img_pos = 0;                    // serial position within image data including BOL filter p's
-    uint16_t Xpos = 0;                       // current position within image line
     uint16_t Ypos = 0;                       // current image line number
-    uint32_t dataSize = 0;                   // size of data for IDAT chunk
-    uint16_t blkSize = 0;                    // size of zlib block
-    uint16_t blk_pos = 0;                    // serial position within zlib block
     uint32_t crc_value = 0;                  // running crc32 value
     uint32_t adler_value = 1;                // running checksum (initilize to 1 https://en.wikipedia.org/wiki/Adler-32)
 
+    // streaming DEFLATE state, one fixed Huffman block for the whole image
+    uint32_t bit_buf = 0;                    // bits not yet written to idat_buf, LSB first
+    uint8_t bit_count = 0;
+    int16_t last_byte = -1;                  // previous uncompressed byte for run matches, -1 at start
+    uint16_t idat_len = 0;
+    uint8_t idat_buf[PNG_IDAT_CHUNK_SIZE];
+
+    uint8_t prev_line[320];                  // unfiltered previous line for the Up filter
+    uint8_t filt_line[321];                  // filter type byte + filtered line
+
     uint8_t line_buffer[320];
 
     bool BOLflag = true;
@@ -31,7 +38,7 @@ protected:
     uint8_t rep_code = 0;
 
     void uint32_to_array(uint32_t src, uint8_t dest[4]);
-    uint32_t update_adler32(uint32_t adler, uint8_t data);
+    uint32_t update_adler32(uint32_t adler, const uint8_t *buf, size_t len);
     uint32_t rc_crc32(uint32_t crc, const uint8_t *buf, size_t len);
     uint32_t rc_crc32(uint32_t crc, uint8_t c) { return rc_crc32(crc, &c, 1); }
 
@@ -39,9 +46,16 @@ protected:
     void png_header();
     void png_palette();
     void png_data();
-    void png_add_data(uint8_t *buf, uint32_t n);
+    void png_add_line(const uint8_t *line);
     void png_end();
 
+    void deflate_bits(uint32_t bits, uint8_t n);
+    void deflate_code(uint16_t code, uint8_t n);
+    void deflate_literal(uint16_t lit);
+    void deflate_run(uint16_t len);
+    void deflate_line(const uint8_t *buf, uint16_t n);
+    void idat_flush();
+
     virtual void post_new_file() override;
     virtual void pre_close_file() override;
     virtual bool process_buffer(uint8_t linelen, uint8_t aux1, uint8_t aux2) override;
@@ -0,0 +1,268 @@
+/**
+ * Open file cache and BDOS record reads/writes for the #FujiNet abstraction
+ *
+ * Included by abstraction_fujinet.h after globals.h, uses its full_path()
+ */
+
+#ifndef ABSTRACTION_CACHE_H
+#define ABSTRACTION_CACHE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "compat_string.h"
+
+#include "../../include/debug.h"
+
+#include "fnFsSD.h"
+
+/* Open file cache */
+/*===============================================================================*/
+// Host files stay open between BDOS calls, each with a buffer of adjacent records.
+// disk.h and cpm.h call _sys_cache_close() on BDOS close and _sys_cache_closeall()
+// on disk reset and warm boot when SYS_FILE_CACHE is defined.
+#define SYS_FILE_CACHE
+#define CACHE_FILES 4
+#define CACHE_RECORDS 16 // records per buffer
+#define CACHE_BUFSZ (CACHE_RECORDS * BlkSZ)
+
+typedef struct
+{
+	char name[128];		// host file name, empty if slot is unused
+	FILE *f;
+	bool writable;		// f opened for update, read only files stay "r"
+	long size;			// file size including buffered writes
+	long bufpos;		// file offset of buf, multiple of CACHE_BUFSZ
+	uint16_t buflen;	// valid bytes in buf
+	uint16_t dirtylo;	// buf[dirtylo..dirtyhi) not written to file yet
+	uint16_t dirtyhi;
+	uint32_t lastuse;
+	uint8_t buf[CACHE_BUFSZ];
+} CPM_CACHEDFILE;
+
+CPM_CACHEDFILE *cacheFiles = nullptr;
+uint32_t cacheUse = 0;
+
+bool _sys_cache_writeback(CPM_CACHEDFILE *c)
+{
+	bool ok = true;
+	if (c->dirtyhi > c->dirtylo)
+	{
+		ok = fseek(c->f, c->bufpos + c->dirtylo, SEEK_SET) == 0 &&
+			 fwrite(c->buf + c->dirtylo, 1, c->dirtyhi - c->dirtylo, c->f) == (size_t)(c->dirtyhi - c->dirtylo);
+		if (!ok)
+			Debug_printf("CP/M cache write error %s: %d\n", c->name, errno);
+		c->dirtylo = c->dirtyhi = 0;
+	}
+	return ok;
+}
+
+bool _sys_cache_release(CPM_CACHEDFILE *c)
+{
+	if (c->name[0] == 0)
+		return true;
+	bool ok = _sys_cache_writeback(c);
+	fclose(c->f);
+	c->f = nullptr;
+	c->name[0] = 0;
+	return ok;
+}
+
+CPM_CACHEDFILE *_sys_cache_find(uint8_t *fn)
+{
+	if (cacheFiles == nullptr)
+		return nullptr;
+	for (int i = 0; i < CACHE_FILES; i++)
+		if (cacheFiles[i].name[0] != 0 && strcmp(cacheFiles[i].name, (char *)fn) == 0)
+			return &cacheFiles[i];
+	return nullptr;
+}
+
+// Returns open cached file, opening it if needed, create allows creating a missing file
+CPM_CACHEDFILE *_sys_cache_open(uint8_t *fn, bool create)
+{
+	CPM_CACHEDFILE *c = _sys_cache_find(fn);
+	if (c == nullptr)
+	{
+		if (cacheFiles == nullptr)
+		{
+			cacheFiles = (CPM_CACHEDFILE *)calloc(CACHE_FILES, sizeof(CPM_CACHEDFILE));
+			if (cacheFiles == nullptr)
+				return nullptr;
+		}
+		// take free or least recently used slot
+		c = &cacheFiles[0];
+		for (int i = 0; i < CACHE_FILES && c->name[0] != 0; i++)
+			if (cacheFiles[i].name[0] == 0 || cacheFiles[i].lastuse < c->lastuse)
+				c = &cacheFiles[i];
+		_sys_cache_release(c);
+
+		// open for reading, _sys_cache_write() reopens for update
+		bool writable = false;
+		FILE *f = fnSDFAT.file_open(full_path((char *)fn), "r");
+		if (f == nullptr && create)
+		{
+			f = fnSDFAT.file_open(full_path((char *)fn), "w+");
+			writable = true;
+		}
+		if (f == nullptr)
+			return nullptr;
+
+		strlcpy(c->name, (char *)fn, sizeof(c->name));
+		c->f = f;
+		c->writable = writable;
+		fseek(f, 0L, SEEK_END);
+		c->size = ftell(f);
+		c->bufpos = -1;
+		c->buflen = 0;
+		c->dirtylo = c->dirtyhi = 0;
+	}
+	c->lastuse = ++cacheUse;
+	return c;
+}
+
+// Reopen file for update before its first write, fails for read only files
+bool _sys_cache_writable(CPM_CACHEDFILE *c)
+{
+	if (c->writable)
+		return true;
+	FILE *f = fnSDFAT.file_open(full_path(c->name), "r+");
+	if (f == nullptr)
+	{
+		Debug_printf("CP/M cache can't write %s: %d\n", c->name, errno);
+		return false;
+	}
+	fclose(c->f);
+	c->f = f;
+	c->writable = true;
+	return true;
+}
+
+// Make the buffer hold the records around fpos
+bool _sys_cache_load(CPM_CACHEDFILE *c, long fpos)
+{
+	long bufpos = fpos - (fpos % CACHE_BUFSZ);
+	if (bufpos == c->bufpos)
+		return true;
+	if (!_sys_cache_writeback(c))
+		return false;
+	c->bufpos = bufpos;
+	c->buflen = 0;
+	if (bufpos < c->size && fseek(c->f, bufpos, SEEK_SET) == 0)
+		c->buflen = fread(c->buf, 1, CACHE_BUFSZ, c->f);
+	return true;
+}
+
+// Write buffered records of file, keep it open
+bool _sys_cache_flush(uint8_t *fn)
+{
+	CPM_CACHEDFILE *c = _sys_cache_find(fn);
+	return c == nullptr || _sys_cache_writeback(c);
+}
+
+// BDOS close, returns false if buffered records couldn't be written
+bool _sys_cache_close(uint8_t *fn)
+{
+	CPM_CACHEDFILE *c = _sys_cache_find(fn);
+	return c == nullptr || _sys_cache_release(c);
+}
+
+void _sys_cache_closeall()
+{
+	if (cacheFiles == nullptr)
+		return;
+	for (int i = 0; i < CACHE_FILES; i++)
+		_sys_cache_release(&cacheFiles[i]);
+}
+
+// Read record at fpos to DMA address, returns false if there is no full record
+bool _sys_cache_read(CPM_CACHEDFILE *c, long fpos)
+{
+	if (!_sys_cache_load(c, fpos))
+		return false;
+	long offset = fpos - c->bufpos;
+	if (offset + BlkSZ > c->buflen)
+		return false;
+	memcpy(_RamSysAddr(dmaAddr), c->buf + offset, BlkSZ);
+	return true;
+}
+
+// Write record from DMA address at fpos, gaps up to fpos are filled with zeros
+bool _sys_cache_write(CPM_CACHEDFILE *c, long fpos)
+{
+	if (!_sys_cache_writable(c) || !_sys_cache_load(c, fpos))
+		return false;
+	uint16_t offset = fpos - c->bufpos;
+	uint16_t lo = offset;
+	if (offset > c->buflen)
+	{
+		memset(c->buf + c->buflen, 0, offset - c->buflen);
+		lo = c->buflen;
+	}
+	memcpy(c->buf + offset, _RamSysAddr(dmaAddr), BlkSZ);
+	if (c->buflen < offset + BlkSZ)
+		c->buflen = offset + BlkSZ;
+	if (c->dirtyhi == c->dirtylo)
+	{
+		c->dirtylo = lo;
+		c->dirtyhi = offset + BlkSZ;
+	}
+	else
+	{
+		if (lo < c->dirtylo)
+			c->dirtylo = lo;
+		if (offset + BlkSZ > c->dirtyhi)
+			c->dirtyhi = offset + BlkSZ;
+	}
+	if (c->size < fpos + BlkSZ)
+		c->size = fpos + BlkSZ;
+	return true;
+}
+
+uint8_t _sys_readseq(uint8_t *fn, long fpos)
+{
+	CPM_CACHEDFILE *c = _sys_cache_open(fn, false);
+	if (c == nullptr)
+		return 0x10;
+	return _sys_cache_read(c, fpos) ? 0x00 : 0x01; // 0x01 = EOF
+}
+
+uint8_t _sys_writeseq(uint8_t *fn, long fpos)
+{
+	CPM_CACHEDFILE *c = _sys_cache_open(fn, true);
+	if (c == nullptr)
+		return 0x10;
+	return _sys_cache_write(c, fpos) ? 0x00 : 0xff;
+}
+
+uint8_t _sys_readrand(uint8_t *fn, long fpos)
+{
+	long extSize;
+
+	CPM_CACHEDFILE *c = _sys_cache_open(fn, false);
+	if (c == nullptr)
+		return 0x10;
+	if (_sys_cache_read(c, fpos))
+		return 0x00;
+	if (fpos >= 65536L * BlkSZ)
+		return 0x06; // seek past 8MB (largest file size in CP/M)
+
+	// round file size up to next full logical extent
+	extSize = ExtSZ * ((c->size / ExtSZ) + ((c->size % ExtSZ) ? 1 : 0));
+	if (fpos < extSize)
+		return 0x01; // reading unwritten data
+	else
+		return 0x04; // seek to unwritten extent
+}
+
+uint8_t _sys_writerand(uint8_t *fn, long fpos)
+{
+	if (fpos >= 65536L * BlkSZ)
+		return 0x06;
+	CPM_CACHEDFILE *c = _sys_cache_open(fn, true);
+	if (c == nullptr)
+		return 0x10;
+	return _sys_cache_write(c, fpos) ? 0x00 : 0xff;
+}
+
+#endif // ABSTRACTION_CACHE_H
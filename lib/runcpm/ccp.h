@@ -623,6 +623,9 @@ uint8 _ccp_ext(void) {
         SP = BDOSjmppage;								// Sets the stack to the top of the TPA
         
         Z80run();										// Starts Z80 simulation
+#ifdef SYS_FILE_CACHE
+        _sys_cache_closeall();							// Program ended, write and close its files
+#endif
         
         error = FALSE;
     }
@@ -450,11 +450,17 @@ void _Bios(void) {
 
 	switch (ch) {
 		case 0x00: {
+#ifdef SYS_FILE_CACHE
+			_sys_cache_closeall();
+#endif
 			Status = 1; // 0 - BOOT - Ends RunCPM
 			break;
 		}
 
 		case 0x03: {
+#ifdef SYS_FILE_CACHE
+			_sys_cache_closeall();
+#endif
 			Status = 2; // 1 - WBOOT - Back to CCP
 			break;
 		}
@@ -977,6 +983,9 @@ void _Bdos(void) {
 		   C = 13 (0Dh) : Reset disk system
 		 */
 		case DRV_ALLRESET: {
+#ifdef SYS_FILE_CACHE
+			_sys_cache_closeall();
+#endif
 			roVector = 0;       // Make all drives R/W
 			loginVector = 0;
 			dmaAddr = 0x0080;
@@ -1191,6 +1200,9 @@ void _Bdos(void) {
 		   C = 37 (25h) : Reset drive
 		 */
 		case DRV_RESET: {
+#ifdef SYS_FILE_CACHE
+			_sys_cache_closeall();
+#endif
 			roVector = roVector & ~DE;
 			break;
 		}
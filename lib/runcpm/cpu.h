@@ -1136,9 +1136,10 @@ static uint16 GET_WORD(uint32 a) {
 	return GET_BYTE(a) | (GET_BYTE(a + 1) << 8);
 }
 
+/* Word at 0xffff wraps around to 0x0000 like on the real CPU */
 static void PUT_WORD(uint32 Addr, uint32 Value) {
-	_RamWrite(Addr, Value);
-	_RamWrite(++Addr, Value >> 8);
+	_RamWrite(Addr & ADDRMASK, Value);
+	_RamWrite((Addr + 1) & ADDRMASK, Value >> 8);
 }
 
 #define RAM_MM(a)   GET_BYTE(a--)
@@ -1459,6 +1460,20 @@ void Z80debug(void) {
 }
 #endif
 
+/* With GCC each instruction jumps straight to the handler of the next one
+   (threaded dispatch) instead of going back through the loop test and the
+   switch bounds check, and every handler gets its own indirect jump for the
+   branch predictor. The debugger hooks live at the top of the loop, so the
+   debug builds keep the plain switch. */
+#if defined(__GNUC__) && !defined(DEBUG) && !defined(iDEBUG)
+#define Z80_THREADED
+#define Z80_OP(n)	case n: op_##n
+#define Z80_NEXT	do { if (Status) goto end_decode; PCX = PC; INCR(1); goto *opcodes[RAM_PP(PC)]; } while (0)
+#else
+#define Z80_OP(n)	case n
+#define Z80_NEXT	break
+#endif
+
 static inline void Z80run(void) {
 	uint32 temp = 0;
 	uint32 acu = 0;
@@ -1466,6 +1481,42 @@ static inline void Z80run(void) {
 	uint32 cbits = 0;
 	uint32 op = 0;
 	uint32 adr = 0;
+#ifdef Z80_THREADED
+	static const void *const opcodes[256] = {
+		&&op_0x00, &&op_0x01, &&op_0x02, &&op_0x03, &&op_0x04, &&op_0x05, &&op_0x06, &&op_0x07,
+		&&op_0x08, &&op_0x09, &&op_0x0a, &&op_0x0b, &&op_0x0c, &&op_0x0d, &&op_0x0e, &&op_0x0f,
+		&&op_0x10, &&op_0x11, &&op_0x12, &&op_0x13, &&op_0x14, &&op_0x15, &&op_0x16, &&op_0x17,
+		&&op_0x18, &&op_0x19, &&op_0x1a, &&op_0x1b, &&op_0x1c, &&op_0x1d, &&op_0x1e, &&op_0x1f,
+		&&op_0x20, &&op_0x21, &&op_0x22, &&op_0x23, &&op_0x24, &&op_0x25, &&op_0x26, &&op_0x27,
+		&&op_0x28, &&op_0x29, &&op_0x2a, &&op_0x2b, &&op_0x2c, &&op_0x2d, &&op_0x2e, &&op_0x2f,
+		&&op_0x30, &&op_0x31, &&op_0x32, &&op_0x33, &&op_0x34, &&op_0x35, &&op_0x36, &&op_0x37,
+		&&op_0x38, &&op_0x39, &&op_0x3a, &&op_0x3b, &&op_0x3c, &&op_0x3d, &&op_0x3e, &&op_0x3f,
+		&&op_0x40, &&op_0x41, &&op_0x42, &&op_0x43, &&op_0x44, &&op_0x45, &&op_0x46, &&op_0x47,
+		&&op_0x48, &&op_0x49, &&op_0x4a, &&op_0x4b, &&op_0x4c, &&op_0x4d, &&op_0x4e, &&op_0x4f,
+		&&op_0x50, &&op_0x51, &&op_0x52, &&op_0x53, &&op_0x54, &&op_0x55, &&op_0x56, &&op_0x57,
+		&&op_0x58, &&op_0x59, &&op_0x5a, &&op_0x5b, &&op_0x5c, &&op_0x5d, &&op_0x5e, &&op_0x5f,
+		&&op_0x60, &&op_0x61, &&op_0x62, &&op_0x63, &&op_0x64, &&op_0x65, &&op_0x66, &&op_0x67,
+		&&op_0x68, &&op_0x69, &&op_0x6a, &&op_0x6b, &&op_0x6c, &&op_0x6d, &&op_0x6e, &&op_0x6f,
+		&&op_0x70, &&op_0x71, &&op_0x72, &&op_0x73, &&op_0x74, &&op_0x75, &&op_0x76, &&op_0x77,
+		&&op_0x78, &&op_0x79, &&op_0x7a, &&op_0x7b, &&op_0x7c, &&op_0x7d, &&op_0x7e, &&op_0x7f,
+		&&op_0x80, &&op_0x81, &&op_0x82, &&op_0x83, &&op_0x84, &&op_0x85, &&op_0x86, &&op_0x87,
+		&&op_0x88, &&op_0x89, &&op_0x8a, &&op_0x8b, &&op_0x8c, &&op_0x8d, &&op_0x8e, &&op_0x8f,
+		&&op_0x90, &&op_0x91, &&op_0x92, &&op_0x93, &&op_0x94, &&op_0x95, &&op_0x96, &&op_0x97,
+		&&op_0x98, &&op_0x99, &&op_0x9a, &&op_0x9b, &&op_0x9c, &&op_0x9d, &&op_0x9e, &&op_0x9f,
+		&&op_0xa0, &&op_0xa1, &&op_0xa2, &&op_0xa3, &&op_0xa4, &&op_0xa5, &&op_0xa6, &&op_0xa7,
+		&&op_0xa8, &&op_0xa9, &&op_0xaa, &&op_0xab, &&op_0xac, &&op_0xad, &&op_0xae, &&op_0xaf,
+		&&op_0xb0, &&op_0xb1, &&op_0xb2, &&op_0xb3, &&op_0xb4, &&op_0xb5, &&op_0xb6, &&op_0xb7,
+		&&op_0xb8, &&op_0xb9, &&op_0xba, &&op_0xbb, &&op_0xbc, &&op_0xbd, &&op_0xbe, &&op_0xbf,
+		&&op_0xc0, &&op_0xc1, &&op_0xc2, &&op_0xc3, &&op_0xc4, &&op_0xc5, &&op_0xc6, &&op_0xc7,
+		&&op_0xc8, &&op_0xc9, &&op_0xca, &&op_0xcb, &&op_0xcc, &&op_0xcd, &&op_0xce, &&op_0xcf,
+		&&op_0xd0, &&op_0xd1, &&op_0xd2, &&op_0xd3, &&op_0xd4, &&op_0xd5, &&op_0xd6, &&op_0xd7,
+		&&op_0xd8, &&op_0xd9, &&op_0xda, &&op_0xdb, &&op_0xdc, &&op_0xdd, &&op_0xde, &&op_0xdf,
+		&&op_0xe0, &&op_0xe1, &&op_0xe2, &&op_0xe3, &&op_0xe4, &&op_0xe5, &&op_0xe6, &&op_0xe7,
+		&&op_0xe8, &&op_0xe9, &&op_0xea, &&op_0xeb, &&op_0xec, &&op_0xed, &&op_0xee, &&op_0xef,
+		&&op_0xf0, &&op_0xf1, &&op_0xf2, &&op_0xf3, &&op_0xf4, &&op_0xf5, &&op_0xf6, &&op_0xf7,
+		&&op_0xf8, &&op_0xf9, &&op_0xfa, &&op_0xfb, &&op_0xfc, &&op_0xfd, &&op_0xfe, &&op_0xff
+	};
+#endif
 
 	/* main instruction fetch/decode loop */
 	while (!Status) {	/* loop until Status != 0 */
@@ -1509,205 +1560,205 @@ static inline void Z80run(void) {
 
 		switch (RAM_PP(PC)) {
 
-		case 0x00:      /* NOP */
-			break;
+		Z80_OP(0x00):      /* NOP */
+			Z80_NEXT;
 
-		case 0x01:      /* LD BC,nnnn */
+		Z80_OP(0x01):      /* LD BC,nnnn */
 			BC = GET_WORD(PC);
 			PC += 2;
-			break;
+			Z80_NEXT;
 
-		case 0x02:      /* LD (BC),A */
+		Z80_OP(0x02):      /* LD (BC),A */
 			PUT_BYTE(BC, HIGH_REGISTER(AF));
-			break;
+			Z80_NEXT;
 
-		case 0x03:      /* INC BC */
+		Z80_OP(0x03):      /* INC BC */
 			++BC;
-			break;
+			Z80_NEXT;
 
-		case 0x04:      /* INC B */
+		Z80_OP(0x04):      /* INC B */
 			BC += 0x100;
 			temp = HIGH_REGISTER(BC);
 			AF = (AF & ~0xfe) | incTable[temp] | SET_PV2(0x80); /* SET_PV2 uses temp */
-			break;
+			Z80_NEXT;
 
-		case 0x05:      /* DEC B */
+		Z80_OP(0x05):      /* DEC B */
 			BC -= 0x100;
 			temp = HIGH_REGISTER(BC);
 			AF = (AF & ~0xfe) | decTable[temp] | SET_PV2(0x7f); /* SET_PV2 uses temp */
-			break;
+			Z80_NEXT;
 
-		case 0x06:      /* LD B,nn */
+		Z80_OP(0x06):      /* LD B,nn */
 			SET_HIGH_REGISTER(BC, RAM_PP(PC));
-			break;
+			Z80_NEXT;
 
-		case 0x07:      /* RLCA */
+		Z80_OP(0x07):      /* RLCA */
 			AF = ((AF >> 7) & 0x0128) | ((AF << 1) & ~0x1ff) |
 				(AF & 0xc4) | ((AF >> 15) & 1);
-			break;
+			Z80_NEXT;
 
-		case 0x08:      /* EX AF,AF' */
+		Z80_OP(0x08):      /* EX AF,AF' */
 			temp = AF;
 			AF = AF1;
 			AF1 = temp;
-			break;
+			Z80_NEXT;
 
-		case 0x09:      /* ADD HL,BC */
+		Z80_OP(0x09):      /* ADD HL,BC */
 			HL &= ADDRMASK;
 			BC &= ADDRMASK;
 			sum = HL + BC;
 			AF = (AF & ~0x3b) | ((sum >> 8) & 0x28) | cbitsTable[(HL ^ BC ^ sum) >> 8];
 			HL = sum;
-			break;
+			Z80_NEXT;
 
-		case 0x0a:      /* LD A,(BC) */
+		Z80_OP(0x0a):      /* LD A,(BC) */
 			SET_HIGH_REGISTER(AF, GET_BYTE(BC));
-			break;
+			Z80_NEXT;
 
-		case 0x0b:      /* DEC BC */
+		Z80_OP(0x0b):      /* DEC BC */
 			--BC;
-			break;
+			Z80_NEXT;
 
-		case 0x0c:      /* INC C */
+		Z80_OP(0x0c):      /* INC C */
 			temp = LOW_REGISTER(BC) + 1;
 			SET_LOW_REGISTER(BC, temp);
 			AF = (AF & ~0xfe) | incTable[temp] | SET_PV2(0x80);
-			break;
+			Z80_NEXT;
 
-		case 0x0d:      /* DEC C */
+		Z80_OP(0x0d):      /* DEC C */
 			temp = LOW_REGISTER(BC) - 1;
 			SET_LOW_REGISTER(BC, temp);
 			AF = (AF & ~0xfe) | decTable[temp & 0xff] | SET_PV2(0x7f);
-			break;
+			Z80_NEXT;
 
-		case 0x0e:      /* LD C,nn */
+		Z80_OP(0x0e):      /* LD C,nn */
 			SET_LOW_REGISTER(BC, RAM_PP(PC));
-			break;
+			Z80_NEXT;
 
-		case 0x0f:      /* RRCA */
+		Z80_OP(0x0f):      /* RRCA */
 			AF = (AF & 0xc4) | rrcaTable[HIGH_REGISTER(AF)];
-			break;
+			Z80_NEXT;
 
-		case 0x10:      /* DJNZ dd */
+		Z80_OP(0x10):      /* DJNZ dd */
 			if ((BC -= 0x100) & 0xff00)
 				PC += (int8)GET_BYTE(PC) + 1;
 			else
 				++PC;
-			break;
+			Z80_NEXT;
 
-		case 0x11:      /* LD DE,nnnn */
+		Z80_OP(0x11):      /* LD DE,nnnn */
 			DE = GET_WORD(PC);
 			PC += 2;
-			break;
+			Z80_NEXT;
 
-		case 0x12:      /* LD (DE),A */
+		Z80_OP(0x12):      /* LD (DE),A */
 			PUT_BYTE(DE, HIGH_REGISTER(AF));
-			break;
+			Z80_NEXT;
 
-		case 0x13:      /* INC DE */
+		Z80_OP(0x13):      /* INC DE */
 			++DE;
-			break;
+			Z80_NEXT;
 
-		case 0x14:      /* INC D */
+		Z80_OP(0x14):      /* INC D */
 			DE += 0x100;
 			temp = HIGH_REGISTER(DE);
 			AF = (AF & ~0xfe) | incTable[temp] | SET_PV2(0x80); /* SET_PV2 uses temp */
-			break;
+			Z80_NEXT;
 
-		case 0x15:      /* DEC D */
+		Z80_OP(0x15):      /* DEC D */
 			DE -= 0x100;
 			temp = HIGH_REGISTER(DE);
 			AF = (AF & ~0xfe) | decTable[temp] | SET_PV2(0x7f); /* SET_PV2 uses temp */
-			break;
+			Z80_NEXT;
 
-		case 0x16:      /* LD D,nn */
+		Z80_OP(0x16):      /* LD D,nn */
 			SET_HIGH_REGISTER(DE, RAM_PP(PC));
-			break;
+			Z80_NEXT;
 
-		case 0x17:      /* RLA */
+		Z80_OP(0x17):      /* RLA */
 			AF = ((AF << 8) & 0x0100) | ((AF >> 7) & 0x28) | ((AF << 1) & ~0x01ff) |
 				(AF & 0xc4) | ((AF >> 15) & 1);
-			break;
+			Z80_NEXT;
 
-		case 0x18:      /* JR dd */
+		Z80_OP(0x18):      /* JR dd */
 			PC += (int8)GET_BYTE(PC) + 1;
-			break;
+			Z80_NEXT;
 
-		case 0x19:      /* ADD HL,DE */
+		Z80_OP(0x19):      /* ADD HL,DE */
 			HL &= ADDRMASK;
 			DE &= ADDRMASK;
 			sum = HL + DE;
 			AF = (AF & ~0x3b) | ((sum >> 8) & 0x28) | cbitsTable[(HL ^ DE ^ sum) >> 8];
 			HL = sum;
-			break;
+			Z80_NEXT;
 
-		case 0x1a:      /* LD A,(DE) */
+		Z80_OP(0x1a):      /* LD A,(DE) */
 			SET_HIGH_REGISTER(AF, GET_BYTE(DE));
-			break;
+			Z80_NEXT;
 
-		case 0x1b:      /* DEC DE */
+		Z80_OP(0x1b):      /* DEC DE */
 			--DE;
-			break;
+			Z80_NEXT;
 
-		case 0x1c:      /* INC E */
+		Z80_OP(0x1c):      /* INC E */
 			temp = LOW_REGISTER(DE) + 1;
 			SET_LOW_REGISTER(DE, temp);
 			AF = (AF & ~0xfe) | incTable[temp] | SET_PV2(0x80);
-			break;
+			Z80_NEXT;
 
-		case 0x1d:      /* DEC E */
+		Z80_OP(0x1d):      /* DEC E */
 			temp = LOW_REGISTER(DE) - 1;
 			SET_LOW_REGISTER(DE, temp);
 			AF = (AF & ~0xfe) | decTable[temp & 0xff] | SET_PV2(0x7f);
-			break;
+			Z80_NEXT;
 
-		case 0x1e:      /* LD E,nn */
+		Z80_OP(0x1e):      /* LD E,nn */
 			SET_LOW_REGISTER(DE, RAM_PP(PC));
-			break;
+			Z80_NEXT;
 
-		case 0x1f:      /* RRA */
+		Z80_OP(0x1f):      /* RRA */
 			AF = ((AF & 1) << 15) | (AF & 0xc4) | rraTable[HIGH_REGISTER(AF)];
-			break;
+			Z80_NEXT;
 
-		case 0x20:      /* JR NZ,dd */
+		Z80_OP(0x20):      /* JR NZ,dd */
 			if (TSTFLAG(Z))
 				++PC;
 			else
 				PC += (int8)GET_BYTE(PC) + 1;
-			break;
+			Z80_NEXT;
 
-		case 0x21:      /* LD HL,nnnn */
+		Z80_OP(0x21):      /* LD HL,nnnn */
 			HL = GET_WORD(PC);
 			PC += 2;
-			break;
+			Z80_NEXT;
 
-		case 0x22:      /* LD (nnnn),HL */
+		Z80_OP(0x22):      /* LD (nnnn),HL */
 			temp = GET_WORD(PC);
 			PUT_WORD(temp, HL);
 			PC += 2;
-			break;
+			Z80_NEXT;
 
-		case 0x23:      /* INC HL */
+		Z80_OP(0x23):      /* INC HL */
 			++HL;
-			break;
+			Z80_NEXT;
 
-		case 0x24:      /* INC H */
+		Z80_OP(0x24):      /* INC H */
 			HL += 0x100;
 			temp = HIGH_REGISTER(HL);
 			AF = (AF & ~0xfe) | incTable[temp] | SET_PV2(0x80); /* SET_PV2 uses temp */
-			break;
+			Z80_NEXT;
 
-		case 0x25:      /* DEC H */
+		Z80_OP(0x25):      /* DEC H */
 			HL -= 0x100;
 			temp = HIGH_REGISTER(HL);
 			AF = (AF & ~0xfe) | decTable[temp] | SET_PV2(0x7f); /* SET_PV2 uses temp */
-			break;
+			Z80_NEXT;
 
-		case 0x26:      /* LD H,nn */
+		Z80_OP(0x26):      /* LD H,nn */
 			SET_HIGH_REGISTER(HL, RAM_PP(PC));
-			break;
+			Z80_NEXT;
 
-		case 0x27:      /* DAA */
+		Z80_OP(0x27):      /* DAA */
 			acu = HIGH_REGISTER(AF);
 			temp = LOW_DIGIT(acu);
 			cbits = TSTFLAG(C);
@@ -1730,350 +1781,350 @@ static inline void Z80run(void) {
 					acu += 0x60;   /* adjust high digit */
 			}
 			AF = (AF & 0x12) | rrdrldTable[acu & 0xff] | ((acu >> 8) & 1) | cbits;
-			break;
+			Z80_NEXT;
 
-		case 0x28:      /* JR Z,dd */
+		Z80_OP(0x28):      /* JR Z,dd */
 			if (TSTFLAG(Z))
 				PC += (int8)GET_BYTE(PC) + 1;
 			else
 				++PC;
-			break;
+			Z80_NEXT;
 
-		case 0x29:      /* ADD HL,HL */
+		Z80_OP(0x29):      /* ADD HL,HL */
 			HL &= ADDRMASK;
 			sum = HL + HL;
 			AF = (AF & ~0x3b) | cbitsDup16Table[sum >> 8];
 			HL = sum;
-			break;
+			Z80_NEXT;
 
-		case 0x2a:      /* LD HL,(nnnn) */
+		Z80_OP(0x2a):      /* LD HL,(nnnn) */
 			temp = GET_WORD(PC);
 			HL = GET_WORD(temp);
 			PC += 2;
-			break;
+			Z80_NEXT;
 
-		case 0x2b:      /* DEC HL */
+		Z80_OP(0x2b):      /* DEC HL */
 			--HL;
-			break;
+			Z80_NEXT;
 
-		case 0x2c:      /* INC L */
+		Z80_OP(0x2c):      /* INC L */
 			temp = LOW_REGISTER(HL) + 1;
 			SET_LOW_REGISTER(HL, temp);
 			AF = (AF & ~0xfe) | incTable[temp] | SET_PV2(0x80);
-			break;
+			Z80_NEXT;
 
-		case 0x2d:      /* DEC L */
+		Z80_OP(0x2d):      /* DEC L */
 			temp = LOW_REGISTER(HL) - 1;
 			SET_LOW_REGISTER(HL, temp);
 			AF = (AF & ~0xfe) | decTable[temp & 0xff] | SET_PV2(0x7f);
-			break;
+			Z80_NEXT;
 
-		case 0x2e:      /* LD L,nn */
+		Z80_OP(0x2e):      /* LD L,nn */
 			SET_LOW_REGISTER(HL, RAM_PP(PC));
-			break;
+			Z80_NEXT;
 
-		case 0x2f:      /* CPL */
+		Z80_OP(0x2f):      /* CPL */
 			AF = (~AF & ~0xff) | (AF & 0xc5) | ((~AF >> 8) & 0x28) | 0x12;
-			break;
+			Z80_NEXT;
 
-		case 0x30:      /* JR NC,dd */
+		Z80_OP(0x30):      /* JR NC,dd */
 			if (TSTFLAG(C))
 				++PC;
 			else
 				PC += (int8)GET_BYTE(PC) + 1;
-			break;
+			Z80_NEXT;
 
-		case 0x31:      /* LD SP,nnnn */
+		Z80_OP(0x31):      /* LD SP,nnnn */
 			SP = GET_WORD(PC);
 			PC += 2;
-			break;
+			Z80_NEXT;
 
-		case 0x32:      /* LD (nnnn),A */
+		Z80_OP(0x32):      /* LD (nnnn),A */
 			temp = GET_WORD(PC);
 			PUT_BYTE(temp, HIGH_REGISTER(AF));
 			PC += 2;
-			break;
+			Z80_NEXT;
 
-		case 0x33:      /* INC SP */
+		Z80_OP(0x33):      /* INC SP */
 			++SP;
-			break;
+			Z80_NEXT;
 
-		case 0x34:      /* INC (HL) */
+		Z80_OP(0x34):      /* INC (HL) */
 			temp = GET_BYTE(HL) + 1;
 			PUT_BYTE(HL, temp);
 			AF = (AF & ~0xfe) | incTable[temp] | SET_PV2(0x80);
-			break;
+			Z80_NEXT;
 
-		case 0x35:      /* DEC (HL) */
+		Z80_OP(0x35):      /* DEC (HL) */
 			temp = GET_BYTE(HL) - 1;
 			PUT_BYTE(HL, temp);
 			AF = (AF & ~0xfe) | decTable[temp & 0xff] | SET_PV2(0x7f);
-			break;
+			Z80_NEXT;
 
-		case 0x36:      /* LD (HL),nn */
+		Z80_OP(0x36):      /* LD (HL),nn */
 			PUT_BYTE(HL, RAM_PP(PC));
-			break;
+			Z80_NEXT;
 
-		case 0x37:      /* SCF */
+		Z80_OP(0x37):      /* SCF */
 			AF = (AF & ~0x3b) | ((AF >> 8) & 0x28) | 1;
-			break;
+			Z80_NEXT;
 
-		case 0x38:      /* JR C,dd */
+		Z80_OP(0x38):      /* JR C,dd */
 			if (TSTFLAG(C))
 				PC += (int8)GET_BYTE(PC) + 1;
 			else
 				++PC;
-			break;
+			Z80_NEXT;
 
-		case 0x39:      /* ADD HL,SP */
+		Z80_OP(0x39):      /* ADD HL,SP */
 			HL &= ADDRMASK;
 			SP &= ADDRMASK;
 			sum = HL + SP;
 			AF = (AF & ~0x3b) | ((sum >> 8) & 0x28) | cbitsTable[(HL ^ SP ^ sum) >> 8];
 			HL = sum;
-			break;
+			Z80_NEXT;
 
-		case 0x3a:      /* LD A,(nnnn) */
+		Z80_OP(0x3a):      /* LD A,(nnnn) */
 			temp = GET_WORD(PC);
 			SET_HIGH_REGISTER(AF, GET_BYTE(temp));
 			PC += 2;
-			break;
+			Z80_NEXT;
 
-		case 0x3b:      /* DEC SP */
+		Z80_OP(0x3b):      /* DEC SP */
 			--SP;
-			break;
+			Z80_NEXT;
 
-		case 0x3c:      /* INC A */
+		Z80_OP(0x3c):      /* INC A */
 			AF += 0x100;
 			temp = HIGH_REGISTER(AF);
 			AF = (AF & ~0xfe) | incTable[temp] | SET_PV2(0x80); /* SET_PV2 uses temp */
-			break;
+			Z80_NEXT;
 
-		case 0x3d:      /* DEC A */
+		Z80_OP(0x3d):      /* DEC A */
 			AF -= 0x100;
 			temp = HIGH_REGISTER(AF);
 			AF = (AF & ~0xfe) | decTable[temp] | SET_PV2(0x7f); /* SET_PV2 uses temp */
-			break;
+			Z80_NEXT;
 
-		case 0x3e:      /* LD A,nn */
+		Z80_OP(0x3e):      /* LD A,nn */
 			SET_HIGH_REGISTER(AF, RAM_PP(PC));
-			break;
+			Z80_NEXT;
 
-		case 0x3f:      /* CCF */
+		Z80_OP(0x3f):      /* CCF */
 			AF = (AF & ~0x3b) | ((AF >> 8) & 0x28) | ((AF & 1) << 4) | (~AF & 1);
-			break;
+			Z80_NEXT;
 
-		case 0x40:      /* LD B,B */
-			break;
+		Z80_OP(0x40):      /* LD B,B */
+			Z80_NEXT;
 
-		case 0x41:      /* LD B,C */
+		Z80_OP(0x41):      /* LD B,C */
 			BC = (BC & 0xff) | ((BC & 0xff) << 8);
-			break;
+			Z80_NEXT;
 
-		case 0x42:      /* LD B,D */
+		Z80_OP(0x42):      /* LD B,D */
 			BC = (BC & 0xff) | (DE & ~0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x43:      /* LD B,E */
+		Z80_OP(0x43):      /* LD B,E */
 			BC = (BC & 0xff) | ((DE & 0xff) << 8);
-			break;
+			Z80_NEXT;
 
-		case 0x44:      /* LD B,H */
+		Z80_OP(0x44):      /* LD B,H */
 			BC = (BC & 0xff) | (HL & ~0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x45:      /* LD B,L */
+		Z80_OP(0x45):      /* LD B,L */
 			BC = (BC & 0xff) | ((HL & 0xff) << 8);
-			break;
+			Z80_NEXT;
 
-		case 0x46:      /* LD B,(HL) */
+		Z80_OP(0x46):      /* LD B,(HL) */
 			SET_HIGH_REGISTER(BC, GET_BYTE(HL));
-			break;
+			Z80_NEXT;
 
-		case 0x47:      /* LD B,A */
+		Z80_OP(0x47):      /* LD B,A */
 			BC = (BC & 0xff) | (AF & ~0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x48:      /* LD C,B */
+		Z80_OP(0x48):      /* LD C,B */
 			BC = (BC & ~0xff) | ((BC >> 8) & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x49:      /* LD C,C */
-			break;
+		Z80_OP(0x49):      /* LD C,C */
+			Z80_NEXT;
 
-		case 0x4a:      /* LD C,D */
+		Z80_OP(0x4a):      /* LD C,D */
 			BC = (BC & ~0xff) | ((DE >> 8) & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x4b:      /* LD C,E */
+		Z80_OP(0x4b):      /* LD C,E */
 			BC = (BC & ~0xff) | (DE & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x4c:      /* LD C,H */
+		Z80_OP(0x4c):      /* LD C,H */
 			BC = (BC & ~0xff) | ((HL >> 8) & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x4d:      /* LD C,L */
+		Z80_OP(0x4d):      /* LD C,L */
 			BC = (BC & ~0xff) | (HL & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x4e:      /* LD C,(HL) */
+		Z80_OP(0x4e):      /* LD C,(HL) */
 			SET_LOW_REGISTER(BC, GET_BYTE(HL));
-			break;
+			Z80_NEXT;
 
-		case 0x4f:      /* LD C,A */
+		Z80_OP(0x4f):      /* LD C,A */
 			BC = (BC & ~0xff) | ((AF >> 8) & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x50:      /* LD D,B */
+		Z80_OP(0x50):      /* LD D,B */
 			DE = (DE & 0xff) | (BC & ~0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x51:      /* LD D,C */
+		Z80_OP(0x51):      /* LD D,C */
 			DE = (DE & 0xff) | ((BC & 0xff) << 8);
-			break;
+			Z80_NEXT;
 
-		case 0x52:      /* LD D,D */
-			break;
+		Z80_OP(0x52):      /* LD D,D */
+			Z80_NEXT;
 
-		case 0x53:      /* LD D,E */
+		Z80_OP(0x53):      /* LD D,E */
 			DE = (DE & 0xff) | ((DE & 0xff) << 8);
-			break;
+			Z80_NEXT;
 
-		case 0x54:      /* LD D,H */
+		Z80_OP(0x54):      /* LD D,H */
 			DE = (DE & 0xff) | (HL & ~0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x55:      /* LD D,L */
+		Z80_OP(0x55):      /* LD D,L */
 			DE = (DE & 0xff) | ((HL & 0xff) << 8);
-			break;
+			Z80_NEXT;
 
-		case 0x56:      /* LD D,(HL) */
+		Z80_OP(0x56):      /* LD D,(HL) */
 			SET_HIGH_REGISTER(DE, GET_BYTE(HL));
-			break;
+			Z80_NEXT;
 
-		case 0x57:      /* LD D,A */
+		Z80_OP(0x57):      /* LD D,A */
 			DE = (DE & 0xff) | (AF & ~0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x58:      /* LD E,B */
+		Z80_OP(0x58):      /* LD E,B */
 			DE = (DE & ~0xff) | ((BC >> 8) & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x59:      /* LD E,C */
+		Z80_OP(0x59):      /* LD E,C */
 			DE = (DE & ~0xff) | (BC & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x5a:      /* LD E,D */
+		Z80_OP(0x5a):      /* LD E,D */
 			DE = (DE & ~0xff) | ((DE >> 8) & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x5b:      /* LD E,E */
-			break;
+		Z80_OP(0x5b):      /* LD E,E */
+			Z80_NEXT;
 
-		case 0x5c:      /* LD E,H */
+		Z80_OP(0x5c):      /* LD E,H */
 			DE = (DE & ~0xff) | ((HL >> 8) & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x5d:      /* LD E,L */
+		Z80_OP(0x5d):      /* LD E,L */
 			DE = (DE & ~0xff) | (HL & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x5e:      /* LD E,(HL) */
+		Z80_OP(0x5e):      /* LD E,(HL) */
 			SET_LOW_REGISTER(DE, GET_BYTE(HL));
-			break;
+			Z80_NEXT;
 
-		case 0x5f:      /* LD E,A */
+		Z80_OP(0x5f):      /* LD E,A */
 			DE = (DE & ~0xff) | ((AF >> 8) & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x60:      /* LD H,B */
+		Z80_OP(0x60):      /* LD H,B */
 			HL = (HL & 0xff) | (BC & ~0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x61:      /* LD H,C */
+		Z80_OP(0x61):      /* LD H,C */
 			HL = (HL & 0xff) | ((BC & 0xff) << 8);
-			break;
+			Z80_NEXT;
 
-		case 0x62:      /* LD H,D */
+		Z80_OP(0x62):      /* LD H,D */
 			HL = (HL & 0xff) | (DE & ~0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x63:      /* LD H,E */
+		Z80_OP(0x63):      /* LD H,E */
 			HL = (HL & 0xff) | ((DE & 0xff) << 8);
-			break;
+			Z80_NEXT;
 
-		case 0x64:      /* LD H,H */
-			break;
+		Z80_OP(0x64):      /* LD H,H */
+			Z80_NEXT;
 
-		case 0x65:      /* LD H,L */
+		Z80_OP(0x65):      /* LD H,L */
 			HL = (HL & 0xff) | ((HL & 0xff) << 8);
-			break;
+			Z80_NEXT;
 
-		case 0x66:      /* LD H,(HL) */
+		Z80_OP(0x66):      /* LD H,(HL) */
 			SET_HIGH_REGISTER(HL, GET_BYTE(HL));
-			break;
+			Z80_NEXT;
 
-		case 0x67:      /* LD H,A */
+		Z80_OP(0x67):      /* LD H,A */
 			HL = (HL & 0xff) | (AF & ~0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x68:      /* LD L,B */
+		Z80_OP(0x68):      /* LD L,B */
 			HL = (HL & ~0xff) | ((BC >> 8) & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x69:      /* LD L,C */
+		Z80_OP(0x69):      /* LD L,C */
 			HL = (HL & ~0xff) | (BC & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x6a:      /* LD L,D */
+		Z80_OP(0x6a):      /* LD L,D */
 			HL = (HL & ~0xff) | ((DE >> 8) & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x6b:      /* LD L,E */
+		Z80_OP(0x6b):      /* LD L,E */
 			HL = (HL & ~0xff) | (DE & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x6c:      /* LD L,H */
+		Z80_OP(0x6c):      /* LD L,H */
 			HL = (HL & ~0xff) | ((HL >> 8) & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x6d:      /* LD L,L */
-			break;
+		Z80_OP(0x6d):      /* LD L,L */
+			Z80_NEXT;
 
-		case 0x6e:      /* LD L,(HL) */
+		Z80_OP(0x6e):      /* LD L,(HL) */
 			SET_LOW_REGISTER(HL, GET_BYTE(HL));
-			break;
+			Z80_NEXT;
 
-		case 0x6f:      /* LD L,A */
+		Z80_OP(0x6f):      /* LD L,A */
 			HL = (HL & ~0xff) | ((AF >> 8) & 0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x70:      /* LD (HL),B */
+		Z80_OP(0x70):      /* LD (HL),B */
 			PUT_BYTE(HL, HIGH_REGISTER(BC));
-			break;
+			Z80_NEXT;
 
-		case 0x71:      /* LD (HL),C */
+		Z80_OP(0x71):      /* LD (HL),C */
 			PUT_BYTE(HL, LOW_REGISTER(BC));
-			break;
+			Z80_NEXT;
 
-		case 0x72:      /* LD (HL),D */
+		Z80_OP(0x72):      /* LD (HL),D */
 			PUT_BYTE(HL, HIGH_REGISTER(DE));
-			break;
+			Z80_NEXT;
 
-		case 0x73:      /* LD (HL),E */
+		Z80_OP(0x73):      /* LD (HL),E */
 			PUT_BYTE(HL, LOW_REGISTER(DE));
-			break;
+			Z80_NEXT;
 
-		case 0x74:      /* LD (HL),H */
+		Z80_OP(0x74):      /* LD (HL),H */
 			PUT_BYTE(HL, HIGH_REGISTER(HL));
-			break;
+			Z80_NEXT;
 
-		case 0x75:      /* LD (HL),L */
+		Z80_OP(0x75):      /* LD (HL),L */
 			PUT_BYTE(HL, LOW_REGISTER(HL));
-			break;
+			Z80_NEXT;
 
-		case 0x76:      /* HALT */
+		Z80_OP(0x76):      /* HALT */
 #ifdef DEBUG
 			_puts("\r\n::CPU HALTED::");	// A halt is a good indicator of broken code
 			_puts("Press any key...");
@@ -2081,383 +2132,383 @@ static inline void Z80run(void) {
 #endif
 			--PC;
 			goto end_decode;
-			break;
+			Z80_NEXT;
 
-		case 0x77:      /* LD (HL),A */
+		Z80_OP(0x77):      /* LD (HL),A */
 			PUT_BYTE(HL, HIGH_REGISTER(AF));
-			break;
+			Z80_NEXT;
 
-		case 0x78:      /* LD A,B */
+		Z80_OP(0x78):      /* LD A,B */
 			AF = (AF & 0xff) | (BC & ~0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x79:      /* LD A,C */
+		Z80_OP(0x79):      /* LD A,C */
 			AF = (AF & 0xff) | ((BC & 0xff) << 8);
-			break;
+			Z80_NEXT;
 
-		case 0x7a:      /* LD A,D */
+		Z80_OP(0x7a):      /* LD A,D */
 			AF = (AF & 0xff) | (DE & ~0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x7b:      /* LD A,E */
+		Z80_OP(0x7b):      /* LD A,E */
 			AF = (AF & 0xff) | ((DE & 0xff) << 8);
-			break;
+			Z80_NEXT;
 
-		case 0x7c:      /* LD A,H */
+		Z80_OP(0x7c):      /* LD A,H */
 			AF = (AF & 0xff) | (HL & ~0xff);
-			break;
+			Z80_NEXT;
 
-		case 0x7d:      /* LD A,L */
+		Z80_OP(0x7d):      /* LD A,L */
 			AF = (AF & 0xff) | ((HL & 0xff) << 8);
-			break;
+			Z80_NEXT;
 
-		case 0x7e:      /* LD A,(HL) */
+		Z80_OP(0x7e):      /* LD A,(HL) */
 			SET_HIGH_REGISTER(AF, GET_BYTE(HL));
-			break;
+			Z80_NEXT;
 
-		case 0x7f:      /* LD A,A */
-			break;
+		Z80_OP(0x7f):      /* LD A,A */
+			Z80_NEXT;
 
-		case 0x80:      /* ADD A,B */
+		Z80_OP(0x80):      /* ADD A,B */
 			temp = HIGH_REGISTER(BC);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp;
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x81:      /* ADD A,C */
+		Z80_OP(0x81):      /* ADD A,C */
 			temp = LOW_REGISTER(BC);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp;
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x82:      /* ADD A,D */
+		Z80_OP(0x82):      /* ADD A,D */
 			temp = HIGH_REGISTER(DE);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp;
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x83:      /* ADD A,E */
+		Z80_OP(0x83):      /* ADD A,E */
 			temp = LOW_REGISTER(DE);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp;
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x84:      /* ADD A,H */
+		Z80_OP(0x84):      /* ADD A,H */
 			temp = HIGH_REGISTER(HL);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp;
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x85:      /* ADD A,L */
+		Z80_OP(0x85):      /* ADD A,L */
 			temp = LOW_REGISTER(HL);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp;
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x86:      /* ADD A,(HL) */
+		Z80_OP(0x86):      /* ADD A,(HL) */
 			temp = GET_BYTE(HL);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp;
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x87:      /* ADD A,A */
+		Z80_OP(0x87):      /* ADD A,A */
 			cbits = 2 * HIGH_REGISTER(AF);
 			AF = cbitsDup8Table[cbits] | (SET_PVS(cbits));
-			break;
+			Z80_NEXT;
 
-		case 0x88:      /* ADC A,B */
+		Z80_OP(0x88):      /* ADC A,B */
 			temp = HIGH_REGISTER(BC);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp + TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x89:      /* ADC A,C */
+		Z80_OP(0x89):      /* ADC A,C */
 			temp = LOW_REGISTER(BC);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp + TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x8a:      /* ADC A,D */
+		Z80_OP(0x8a):      /* ADC A,D */
 			temp = HIGH_REGISTER(DE);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp + TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x8b:      /* ADC A,E */
+		Z80_OP(0x8b):      /* ADC A,E */
 			temp = LOW_REGISTER(DE);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp + TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x8c:      /* ADC A,H */
+		Z80_OP(0x8c):      /* ADC A,H */
 			temp = HIGH_REGISTER(HL);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp + TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x8d:      /* ADC A,L */
+		Z80_OP(0x8d):      /* ADC A,L */
 			temp = LOW_REGISTER(HL);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp + TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x8e:      /* ADC A,(HL) */
+		Z80_OP(0x8e):      /* ADC A,(HL) */
 			temp = GET_BYTE(HL);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp + TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x8f:      /* ADC A,A */
+		Z80_OP(0x8f):      /* ADC A,A */
 			cbits = 2 * HIGH_REGISTER(AF) + TSTFLAG(C);
 			AF = cbitsDup8Table[cbits] | (SET_PVS(cbits));
-			break;
+			Z80_NEXT;
 
-		case 0x90:      /* SUB B */
+		Z80_OP(0x90):      /* SUB B */
 			temp = HIGH_REGISTER(BC);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp;
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x91:      /* SUB C */
+		Z80_OP(0x91):      /* SUB C */
 			temp = LOW_REGISTER(BC);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp;
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x92:      /* SUB D */
+		Z80_OP(0x92):      /* SUB D */
 			temp = HIGH_REGISTER(DE);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp;
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x93:      /* SUB E */
+		Z80_OP(0x93):      /* SUB E */
 			temp = LOW_REGISTER(DE);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp;
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x94:      /* SUB H */
+		Z80_OP(0x94):      /* SUB H */
 			temp = HIGH_REGISTER(HL);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp;
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x95:      /* SUB L */
+		Z80_OP(0x95):      /* SUB L */
 			temp = LOW_REGISTER(HL);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp;
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x96:      /* SUB (HL) */
+		Z80_OP(0x96):      /* SUB (HL) */
 			temp = GET_BYTE(HL);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp;
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x97:      /* SUB A */
+		Z80_OP(0x97):      /* SUB A */
 			AF = 0x42;
-			break;
+			Z80_NEXT;
 
-		case 0x98:      /* SBC A,B */
+		Z80_OP(0x98):      /* SBC A,B */
 			temp = HIGH_REGISTER(BC);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp - TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x99:      /* SBC A,C */
+		Z80_OP(0x99):      /* SBC A,C */
 			temp = LOW_REGISTER(BC);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp - TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x9a:      /* SBC A,D */
+		Z80_OP(0x9a):      /* SBC A,D */
 			temp = HIGH_REGISTER(DE);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp - TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x9b:      /* SBC A,E */
+		Z80_OP(0x9b):      /* SBC A,E */
 			temp = LOW_REGISTER(DE);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp - TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x9c:      /* SBC A,H */
+		Z80_OP(0x9c):      /* SBC A,H */
 			temp = HIGH_REGISTER(HL);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp - TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x9d:      /* SBC A,L */
+		Z80_OP(0x9d):      /* SBC A,L */
 			temp = LOW_REGISTER(HL);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp - TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x9e:      /* SBC A,(HL) */
+		Z80_OP(0x9e):      /* SBC A,(HL) */
 			temp = GET_BYTE(HL);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp - TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0x9f:      /* SBC A,A */
+		Z80_OP(0x9f):      /* SBC A,A */
 			cbits = -TSTFLAG(C);
 			AF = subTable[cbits & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PVS(cbits));
-			break;
+			Z80_NEXT;
 
-		case 0xa0:      /* AND B */
+		Z80_OP(0xa0):      /* AND B */
 			AF = andTable[((AF & BC) >> 8) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xa1:      /* AND C */
+		Z80_OP(0xa1):      /* AND C */
 			AF = andTable[((AF >> 8)& BC) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xa2:      /* AND D */
+		Z80_OP(0xa2):      /* AND D */
 			AF = andTable[((AF & DE) >> 8) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xa3:      /* AND E */
+		Z80_OP(0xa3):      /* AND E */
 			AF = andTable[((AF >> 8)& DE) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xa4:      /* AND H */
+		Z80_OP(0xa4):      /* AND H */
 			AF = andTable[((AF & HL) >> 8) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xa5:      /* AND L */
+		Z80_OP(0xa5):      /* AND L */
 			AF = andTable[((AF >> 8)& HL) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xa6:      /* AND (HL) */
+		Z80_OP(0xa6):      /* AND (HL) */
 			AF = andTable[((AF >> 8)& GET_BYTE(HL)) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xa7:      /* AND A */
+		Z80_OP(0xa7):      /* AND A */
 			AF = andTable[(AF >> 8) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xa8:      /* XOR B */
+		Z80_OP(0xa8):      /* XOR B */
 			AF = xororTable[((AF ^ BC) >> 8) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xa9:      /* XOR C */
+		Z80_OP(0xa9):      /* XOR C */
 			AF = xororTable[((AF >> 8) ^ BC) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xaa:      /* XOR D */
+		Z80_OP(0xaa):      /* XOR D */
 			AF = xororTable[((AF ^ DE) >> 8) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xab:      /* XOR E */
+		Z80_OP(0xab):      /* XOR E */
 			AF = xororTable[((AF >> 8) ^ DE) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xac:      /* XOR H */
+		Z80_OP(0xac):      /* XOR H */
 			AF = xororTable[((AF ^ HL) >> 8) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xad:      /* XOR L */
+		Z80_OP(0xad):      /* XOR L */
 			AF = xororTable[((AF >> 8) ^ HL) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xae:      /* XOR (HL) */
+		Z80_OP(0xae):      /* XOR (HL) */
 			AF = xororTable[((AF >> 8) ^ GET_BYTE(HL)) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xaf:      /* XOR A */
+		Z80_OP(0xaf):      /* XOR A */
 			AF = 0x44;
-			break;
+			Z80_NEXT;
 
-		case 0xb0:      /* OR B */
+		Z80_OP(0xb0):      /* OR B */
 			AF = xororTable[((AF | BC) >> 8) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xb1:      /* OR C */
+		Z80_OP(0xb1):      /* OR C */
 			AF = xororTable[((AF >> 8) | BC) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xb2:      /* OR D */
+		Z80_OP(0xb2):      /* OR D */
 			AF = xororTable[((AF | DE) >> 8) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xb3:      /* OR E */
+		Z80_OP(0xb3):      /* OR E */
 			AF = xororTable[((AF >> 8) | DE) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xb4:      /* OR H */
+		Z80_OP(0xb4):      /* OR H */
 			AF = xororTable[((AF | HL) >> 8) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xb5:      /* OR L */
+		Z80_OP(0xb5):      /* OR L */
 			AF = xororTable[((AF >> 8) | HL) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xb6:      /* OR (HL) */
+		Z80_OP(0xb6):      /* OR (HL) */
 			AF = xororTable[((AF >> 8) | GET_BYTE(HL)) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xb7:      /* OR A */
+		Z80_OP(0xb7):      /* OR A */
 			AF = xororTable[(AF >> 8) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xb8:      /* CP B */
+		Z80_OP(0xb8):      /* CP B */
 			temp = HIGH_REGISTER(BC);
 			AF = (AF & ~0x28) | (temp & 0x28);
 			acu = HIGH_REGISTER(AF);
@@ -2465,9 +2516,9 @@ static inline void Z80run(void) {
 			cbits = acu ^ temp ^ sum;
 			AF = (AF & ~0xff) | cpTable[sum & 0xff] | (temp & 0x28) |
 				(SET_PV) | cbits2Table[cbits & 0x1ff];
-			break;
+			Z80_NEXT;
 
-		case 0xb9:      /* CP C */
+		Z80_OP(0xb9):      /* CP C */
 			temp = LOW_REGISTER(BC);
 			AF = (AF & ~0x28) | (temp & 0x28);
 			acu = HIGH_REGISTER(AF);
@@ -2475,9 +2526,9 @@ static inline void Z80run(void) {
 			cbits = acu ^ temp ^ sum;
 			AF = (AF & ~0xff) | cpTable[sum & 0xff] | (temp & 0x28) |
 				(SET_PV) | cbits2Table[cbits & 0x1ff];
-			break;
+			Z80_NEXT;
 
-		case 0xba:      /* CP D */
+		Z80_OP(0xba):      /* CP D */
 			temp = HIGH_REGISTER(DE);
 			AF = (AF & ~0x28) | (temp & 0x28);
 			acu = HIGH_REGISTER(AF);
@@ -2485,9 +2536,9 @@ static inline void Z80run(void) {
 			cbits = acu ^ temp ^ sum;
 			AF = (AF & ~0xff) | cpTable[sum & 0xff] | (temp & 0x28) |
 				(SET_PV) | cbits2Table[cbits & 0x1ff];
-			break;
+			Z80_NEXT;
 
-		case 0xbb:      /* CP E */
+		Z80_OP(0xbb):      /* CP E */
 			temp = LOW_REGISTER(DE);
 			AF = (AF & ~0x28) | (temp & 0x28);
 			acu = HIGH_REGISTER(AF);
@@ -2495,9 +2546,9 @@ static inline void Z80run(void) {
 			cbits = acu ^ temp ^ sum;
 			AF = (AF & ~0xff) | cpTable[sum & 0xff] | (temp & 0x28) |
 				(SET_PV) | cbits2Table[cbits & 0x1ff];
-			break;
+			Z80_NEXT;
 
-		case 0xbc:      /* CP H */
+		Z80_OP(0xbc):      /* CP H */
 			temp = HIGH_REGISTER(HL);
 			AF = (AF & ~0x28) | (temp & 0x28);
 			acu = HIGH_REGISTER(AF);
@@ -2505,9 +2556,9 @@ static inline void Z80run(void) {
 			cbits = acu ^ temp ^ sum;
 			AF = (AF & ~0xff) | cpTable[sum & 0xff] | (temp & 0x28) |
 				(SET_PV) | cbits2Table[cbits & 0x1ff];
-			break;
+			Z80_NEXT;
 
-		case 0xbd:      /* CP L */
+		Z80_OP(0xbd):      /* CP L */
 			temp = LOW_REGISTER(HL);
 			AF = (AF & ~0x28) | (temp & 0x28);
 			acu = HIGH_REGISTER(AF);
@@ -2515,9 +2566,9 @@ static inline void Z80run(void) {
 			cbits = acu ^ temp ^ sum;
 			AF = (AF & ~0xff) | cpTable[sum & 0xff] | (temp & 0x28) |
 				(SET_PV) | cbits2Table[cbits & 0x1ff];
-			break;
+			Z80_NEXT;
 
-		case 0xbe:      /* CP (HL) */
+		Z80_OP(0xbe):      /* CP (HL) */
 			temp = GET_BYTE(HL);
 			AF = (AF & ~0x28) | (temp & 0x28);
 			acu = HIGH_REGISTER(AF);
@@ -2525,64 +2576,64 @@ static inline void Z80run(void) {
 			cbits = acu ^ temp ^ sum;
 			AF = (AF & ~0xff) | cpTable[sum & 0xff] | (temp & 0x28) |
 				(SET_PV) | cbits2Table[cbits & 0x1ff];
-			break;
+			Z80_NEXT;
 
-		case 0xbf:      /* CP A */
+		Z80_OP(0xbf):      /* CP A */
 			SET_LOW_REGISTER(AF, (HIGH_REGISTER(AF) & 0x28) | 0x42);
-			break;
+			Z80_NEXT;
 
-		case 0xc0:      /* RET NZ */
+		Z80_OP(0xc0):      /* RET NZ */
 			if (!(TSTFLAG(Z)))
 				POP(PC);
-			break;
+			Z80_NEXT;
 
-		case 0xc1:      /* POP BC */
+		Z80_OP(0xc1):      /* POP BC */
 			POP(BC);
-			break;
+			Z80_NEXT;
 
-		case 0xc2:      /* JP NZ,nnnn */
+		Z80_OP(0xc2):      /* JP NZ,nnnn */
 			JPC(!TSTFLAG(Z));
-			break;
+			Z80_NEXT;
 
-		case 0xc3:      /* JP nnnn */
+		Z80_OP(0xc3):      /* JP nnnn */
 			JPC(1);
-			break;
+			Z80_NEXT;
 
-		case 0xc4:      /* CALL NZ,nnnn */
+		Z80_OP(0xc4):      /* CALL NZ,nnnn */
 			CALLC(!TSTFLAG(Z));
-			break;
+			Z80_NEXT;
 
-		case 0xc5:      /* PUSH BC */
+		Z80_OP(0xc5):      /* PUSH BC */
 			PUSH(BC);
-			break;
+			Z80_NEXT;
 
-		case 0xc6:      /* ADD A,nn */
+		Z80_OP(0xc6):      /* ADD A,nn */
 			temp = RAM_PP(PC);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp;
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0xc7:      /* RST 0 */
+		Z80_OP(0xc7):      /* RST 0 */
 			PUSH(PC);
 			PC = 0;
-			break;
+			Z80_NEXT;
 
-		case 0xc8:      /* RET Z */
+		Z80_OP(0xc8):      /* RET Z */
 			if (TSTFLAG(Z))
 				POP(PC);
-			break;
+			Z80_NEXT;
 
-		case 0xc9:      /* RET */
+		Z80_OP(0xc9):      /* RET */
 			POP(PC);
-			break;
+			Z80_NEXT;
 
-		case 0xca:      /* JP Z,nnnn */
+		Z80_OP(0xca):      /* JP Z,nnnn */
 			JPC(TSTFLAG(Z));
-			break;
+			Z80_NEXT;
 
-		case 0xcb:      /* CB prefix */
+		Z80_OP(0xcb):      /* CB prefix */
 			INCR(1); /* Add one M1 cycle to refresh counter */
 			adr = HL;
 			switch ((op = GET_BYTE(PC)) & 7) {
@@ -2727,73 +2778,73 @@ static inline void Z80run(void) {
 				SET_HIGH_REGISTER(AF, temp);
 				break;
 			}
-			break;
+			Z80_NEXT;
 
-		case 0xcc:      /* CALL Z,nnnn */
+		Z80_OP(0xcc):      /* CALL Z,nnnn */
 			CALLC(TSTFLAG(Z));
-			break;
+			Z80_NEXT;
 
-		case 0xcd:      /* CALL nnnn */
+		Z80_OP(0xcd):      /* CALL nnnn */
 			CALLC(1);
-			break;
+			Z80_NEXT;
 
-		case 0xce:      /* ADC A,nn */
+		Z80_OP(0xce):      /* ADC A,nn */
 			temp = RAM_PP(PC);
 			acu = HIGH_REGISTER(AF);
 			sum = acu + temp + TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = addTable[sum] | cbitsTable[cbits] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0xcf:      /* RST 8 */
+		Z80_OP(0xcf):      /* RST 8 */
 			PUSH(PC);
 			PC = 8;
-			break;
+			Z80_NEXT;
 
-		case 0xd0:      /* RET NC */
+		Z80_OP(0xd0):      /* RET NC */
 			if (!(TSTFLAG(C)))
 				POP(PC);
-			break;
+			Z80_NEXT;
 
-		case 0xd1:      /* POP DE */
+		Z80_OP(0xd1):      /* POP DE */
 			POP(DE);
-			break;
+			Z80_NEXT;
 
-		case 0xd2:      /* JP NC,nnnn */
+		Z80_OP(0xd2):      /* JP NC,nnnn */
 			JPC(!TSTFLAG(C));
-			break;
+			Z80_NEXT;
 
-		case 0xd3:      /* OUT (nn),A */
+		Z80_OP(0xd3):      /* OUT (nn),A */
 			cpu_out(RAM_PP(PC), HIGH_REGISTER(AF));
-			break;
+			Z80_NEXT;
 
-		case 0xd4:      /* CALL NC,nnnn */
+		Z80_OP(0xd4):      /* CALL NC,nnnn */
 			CALLC(!TSTFLAG(C));
-			break;
+			Z80_NEXT;
 
-		case 0xd5:      /* PUSH DE */
+		Z80_OP(0xd5):      /* PUSH DE */
 			PUSH(DE);
-			break;
+			Z80_NEXT;
 
-		case 0xd6:      /* SUB nn */
+		Z80_OP(0xd6):      /* SUB nn */
 			temp = RAM_PP(PC);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp;
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0xd7:      /* RST 10H */
+		Z80_OP(0xd7):      /* RST 10H */
 			PUSH(PC);
 			PC = 0x10;
-			break;
+			Z80_NEXT;
 
-		case 0xd8:      /* RET C */
+		Z80_OP(0xd8):      /* RET C */
 			if (TSTFLAG(C))
 				POP(PC);
-			break;
+			Z80_NEXT;
 
-		case 0xd9:      /* EXX */
+		Z80_OP(0xd9):      /* EXX */
 			temp = BC;
 			BC = BC1;
 			BC1 = temp;
@@ -2803,21 +2854,21 @@ static inline void Z80run(void) {
 			temp = HL;
 			HL = HL1;
 			HL1 = temp;
-			break;
+			Z80_NEXT;
 
-		case 0xda:      /* JP C,nnnn */
+		Z80_OP(0xda):      /* JP C,nnnn */
 			JPC(TSTFLAG(C));
-			break;
+			Z80_NEXT;
 
-		case 0xdb:      /* IN A,(nn) */
+		Z80_OP(0xdb):      /* IN A,(nn) */
 			SET_HIGH_REGISTER(AF, cpu_in(RAM_PP(PC)));
-			break;
+			Z80_NEXT;
 
-		case 0xdc:      /* CALL C,nnnn */
+		Z80_OP(0xdc):      /* CALL C,nnnn */
 			CALLC(TSTFLAG(C));
-			break;
+			Z80_NEXT;
 
-		case 0xdd:      /* DD prefix */
+		Z80_OP(0xdd):      /* DD prefix */
 			INCR(1); /* Add one M1 cycle to refresh counter */
 			switch (RAM_PP(PC)) {
 
@@ -3410,81 +3461,81 @@ static inline void Z80run(void) {
 			default:                /* ignore DD */
 				--PC;
 			}
-			break;
+			Z80_NEXT;
 
-		case 0xde:          /* SBC A,nn */
+		Z80_OP(0xde):          /* SBC A,nn */
 			temp = RAM_PP(PC);
 			acu = HIGH_REGISTER(AF);
 			sum = acu - temp - TSTFLAG(C);
 			cbits = acu ^ temp ^ sum;
 			AF = subTable[sum & 0xff] | cbitsTable[cbits & 0x1ff] | (SET_PV);
-			break;
+			Z80_NEXT;
 
-		case 0xdf:      /* RST 18H */
+		Z80_OP(0xdf):      /* RST 18H */
 			PUSH(PC);
 			PC = 0x18;
-			break;
+			Z80_NEXT;
 
-		case 0xe0:      /* RET PO */
+		Z80_OP(0xe0):      /* RET PO */
 			if (!(TSTFLAG(P)))
 				POP(PC);
-			break;
+			Z80_NEXT;
 
-		case 0xe1:      /* POP HL */
+		Z80_OP(0xe1):      /* POP HL */
 			POP(HL);
-			break;
+			Z80_NEXT;
 
-		case 0xe2:      /* JP PO,nnnn */
+		Z80_OP(0xe2):      /* JP PO,nnnn */
 			JPC(!TSTFLAG(P));
-			break;
+			Z80_NEXT;
 
-		case 0xe3:      /* EX (SP),HL */
+		Z80_OP(0xe3):      /* EX (SP),HL */
 			temp = HL;
 			POP(HL);
 			PUSH(temp);
-			break;
+			Z80_NEXT;
 
-		case 0xe4:      /* CALL PO,nnnn */
+		Z80_OP(0xe4):      /* CALL PO,nnnn */
 			CALLC(!TSTFLAG(P));
-			break;
+			Z80_NEXT;
 
-		case 0xe5:      /* PUSH HL */
+		Z80_OP(0xe5):      /* PUSH HL */
 			PUSH(HL);
-			break;
+			Z80_NEXT;
 
-		case 0xe6:      /* AND nn */
+		Z80_OP(0xe6):      /* AND nn */
 			AF = andTable[((AF >> 8)& RAM_PP(PC)) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xe7:      /* RST 20H */
+		Z80_OP(0xe7):      /* RST 20H */
 			PUSH(PC);
 			PC = 0x20;
-			break;
+			Z80_NEXT;
 
-		case 0xe8:      /* RET PE */
+		Z80_OP(0xe8):      /* RET PE */
 			if (TSTFLAG(P))
 				POP(PC);
-			break;
+			Z80_NEXT;
 
-		case 0xe9:      /* JP (HL) */
+		Z80_OP(0xe9):      /* JP (HL) */
 			PC = HL;
-			break;
+			Z80_NEXT;
 
-		case 0xea:      /* JP PE,nnnn */
+		Z80_OP(0xea):      /* JP PE,nnnn */
 			JPC(TSTFLAG(P));
-			break;
+			Z80_NEXT;
 
-		case 0xeb:      /* EX DE,HL */
+		Z80_OP(0xeb):      /* EX DE,HL */
 			temp = HL;
 			HL = DE;
 			DE = temp;
-			break;
+			Z80_NEXT;
 
-		case 0xec:      /* CALL PE,nnnn */
+		Z80_OP(0xec):      /* CALL PE,nnnn */
 			CALLC(TSTFLAG(P));
-			break;
+			Z80_NEXT;
 
-		case 0xed:      /* ED prefix */
+		Z80_OP(0xed):      /* ED prefix */
 			INCR(1); /* Add one M1 cycle to refresh counter */
 			switch (RAM_PP(PC)) {
 
@@ -4000,73 +4051,73 @@ static inline void Z80run(void) {
 			default:    /* ignore ED and following byte */
 				break;
 			}
-			break;
+			Z80_NEXT;
 
-		case 0xee:      /* XOR nn */
+		Z80_OP(0xee):      /* XOR nn */
 			AF = xororTable[((AF >> 8) ^ RAM_PP(PC)) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xef:      /* RST 28H */
+		Z80_OP(0xef):      /* RST 28H */
 			PUSH(PC);
 			PC = 0x28;
-			break;
+			Z80_NEXT;
 
-		case 0xf0:      /* RET P */
+		Z80_OP(0xf0):      /* RET P */
 			if (!(TSTFLAG(S)))
 				POP(PC);
-			break;
+			Z80_NEXT;
 
-		case 0xf1:      /* POP AF */
+		Z80_OP(0xf1):      /* POP AF */
 			POP(AF);
-			break;
+			Z80_NEXT;
 
-		case 0xf2:      /* JP P,nnnn */
+		Z80_OP(0xf2):      /* JP P,nnnn */
 			JPC(!TSTFLAG(S));
-			break;
+			Z80_NEXT;
 
-		case 0xf3:      /* DI */
+		Z80_OP(0xf3):      /* DI */
 			IFF = 0;
-			break;
+			Z80_NEXT;
 
-		case 0xf4:      /* CALL P,nnnn */
+		Z80_OP(0xf4):      /* CALL P,nnnn */
 			CALLC(!TSTFLAG(S));
-			break;
+			Z80_NEXT;
 
-		case 0xf5:      /* PUSH AF */
+		Z80_OP(0xf5):      /* PUSH AF */
 			PUSH(AF);
-			break;
+			Z80_NEXT;
 
-		case 0xf6:      /* OR nn */
+		Z80_OP(0xf6):      /* OR nn */
 			AF = xororTable[((AF >> 8) | RAM_PP(PC)) & 0xff];
-			break;
+			Z80_NEXT;
 
-		case 0xf7:      /* RST 30H */
+		Z80_OP(0xf7):      /* RST 30H */
 			PUSH(PC);
 			PC = 0x30;
-			break;
+			Z80_NEXT;
 
-		case 0xf8:      /* RET M */
+		Z80_OP(0xf8):      /* RET M */
 			if (TSTFLAG(S))
 				POP(PC);
-			break;
+			Z80_NEXT;
 
-		case 0xf9:      /* LD SP,HL */
+		Z80_OP(0xf9):      /* LD SP,HL */
 			SP = HL;
-			break;
+			Z80_NEXT;
 
-		case 0xfa:      /* JP M,nnnn */
+		Z80_OP(0xfa):      /* JP M,nnnn */
 			JPC(TSTFLAG(S));
-			break;
+			Z80_NEXT;
 
-		case 0xfb:      /* EI */
+		Z80_OP(0xfb):      /* EI */
 			IFF = 3;
-			break;
+			Z80_NEXT;
 
-		case 0xfc:      /* CALL M,nnnn */
+		Z80_OP(0xfc):      /* CALL M,nnnn */
 			CALLC(TSTFLAG(S));
-			break;
+			Z80_NEXT;
 
-		case 0xfd:      /* FD prefix */
+		Z80_OP(0xfd):      /* FD prefix */
 			INCR(1); /* Add one M1 cycle to refresh counter */
 			switch (RAM_PP(PC)) {
 
@@ -4659,9 +4710,9 @@ static inline void Z80run(void) {
 			default:            /* ignore FD */
 				--PC;
 			}
-			break;
+			Z80_NEXT;
 
-		case 0xfe:      /* CP nn */
+		Z80_OP(0xfe):      /* CP nn */
 			temp = RAM_PP(PC);
 			AF = (AF & ~0x28) | (temp & 0x28);
 			acu = HIGH_REGISTER(AF);
@@ -4669,11 +4720,12 @@ static inline void Z80run(void) {
 			cbits = acu ^ temp ^ sum;
 			AF = (AF & ~0xff) | cpTable[sum & 0xff] | (temp & 0x28) |
 				(SET_PV) | cbits2Table[cbits & 0x1ff];
-			break;
+			Z80_NEXT;
 
-		case 0xff:      /* RST 38H */
+		Z80_OP(0xff):      /* RST 38H */
 			PUSH(PC);
 			PC = 0x38;
+			Z80_NEXT;
 		}
 	}
 end_decode:
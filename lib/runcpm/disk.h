@@ -310,6 +310,11 @@ uint8 _CloseFile(uint16 fcbaddr) {
 	uint8 result = 0xff;
 
 	if (!_SelectDisk(F->dr)) {
+#ifdef SYS_FILE_CACHE
+		_FCBtoHostname(fcbaddr, &filename[0]);
+		if (!_sys_cache_close(&filename[0]))	// write buffered records
+			return(result);
+#endif
 		if (!(F->s2 & 0x80)) {					// if file is modified
 			if (!RW) {
 				_FCBtoHostname(fcbaddr, &filename[0]);
@@ -48,6 +48,9 @@ unsigned char trans(unsigned char mem39212, unsigned char mem39213);
 // contains the final soundbuffer
 extern int bufferpos;
 extern char *buffer;
+extern int buffermask;
+void EmitOutput(int end, int all);
+#define BUFFER(i) buffer[(i) & buffermask]
 
 //timetable for more accurate c64 simulation
 int timetable[5][5] =
@@ -69,8 +72,9 @@ void Output8BitAry(int index, unsigned char ary[5])
     for (k = 0; k < 5; k++)
     {
         // printf("%d %d\r\n", bufferpos,k);
-        buffer[bufferpos / 50 + k] = ary[k];
+        BUFFER(bufferpos / 50 + k) = ary[k];
     }
+    EmitOutput(bufferpos / 50, 0);
 }
 void Output8Bit(int index, unsigned char A)
 {
@@ -976,15 +980,16 @@ void Render()
                 X = 26;
                 // mem[54296] = X;
                 bufferpos += 150;
-                buffer[bufferpos / 50] = (X & 15) * 16;
+                BUFFER(bufferpos / 50) = (X & 15) * 16;
             }
             else
             {
                 //mem[54296] = 6;
                 X = 6;
                 bufferpos += 150;
-                buffer[bufferpos / 50] = (X & 15) * 16;
+                BUFFER(bufferpos / 50) = (X & 15) * 16;
             }
+            EmitOutput(bufferpos / 50, 0);
 
             for (X = wait2; X > 0; X--)
                 ; //wait
@@ -48,6 +48,13 @@ unsigned char phonemeLengthOutput[60]; //tab47416
 // contains the final soundbuffer
 int bufferpos = 0;
 char *buffer = NULL;
+// buffer is a ring of buffermask + 1 bytes when streaming, all bits set otherwise
+int buffermask = -1;
+
+// when set, samples are handed over in chunks while rendering
+static SAMOutputFn output = NULL;
+static void *output_user = NULL;
+static int emitted = 0; // samples handed to output
 
 void SetInput(char *_input)
 {
@@ -69,6 +76,33 @@ void DisableSingmode() { singmode = 0; }
 char *GetBuffer() { return buffer; }
 int GetBufferLength() { return bufferpos; }
 void FreeBuffer() { if (buffer) {free(buffer); buffer = NULL;} }
+void SetOutput(SAMOutputFn fn, void *user)
+{
+    output = fn;
+    output_user = user;
+}
+
+// Hand samples before end to the output, they are not written anymore.
+// Waits for a full chunk unless all is set.
+void EmitOutput(int end, int all)
+{
+    if (output == NULL || buffer == NULL)
+        return;
+    if (!all && end - emitted < SAM_STREAM_CHUNK)
+        return;
+
+    while (emitted < end)
+    {
+        int start = emitted & buffermask;
+        int len = end - emitted;
+        if (len > SAM_STREAM_BUFFER - start)
+            len = SAM_STREAM_BUFFER - start;
+        output((unsigned char *)&buffer[start], len, output_user);
+        // ring positions are reused, start them from silence like a fresh buffer
+        memset(&buffer[start], 0, len);
+        emitted += len;
+    }
+}
 
 void Init();
 int Parser1();
@@ -100,14 +134,26 @@ void Init()
     SetMouthThroat(mouth, throat);
 
     bufferpos = 0;
-    // TODO, check for free the memory, 10 seconds of output should be more than enough
-    //buffer = (char*)ps_malloc(22050 * 5);
-    // switch to ESP-IDF equivalent
+    emitted = 0;
+    if (output != NULL)
+    {
+        // only the samples still being written are kept
+        buffermask = SAM_STREAM_BUFFER - 1;
+        buffer = (char *)calloc(SAM_STREAM_BUFFER, 1);
+    }
+    else
+    {
+        buffermask = -1;
+        // TODO, check for free the memory, 10 seconds of output should be more than enough
+        //buffer = (char*)ps_malloc(22050 * 5);
+        // switch to ESP-IDF equivalent
+        // zeroed like the streaming ring, the renderer does not write every sample
 #ifdef ESP_PLATFORM
-    buffer = (char *)heap_caps_malloc(22050 * 10, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        buffer = (char *)heap_caps_calloc(22050 * 10, 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
 #else
-    buffer = (char *)malloc(22050 * 10);
+        buffer = (char *)calloc(22050 * 10, 1);
 #endif
+    }
     /*
     Due to a technical limitation, the maximum statically allocated DRAM usage is 160KB. 
     The remaining 160KB (for a total of 320KB of DRAM) can only be allocated at runtime as heap.
@@ -193,6 +239,7 @@ int SAMMain()
     }
 
     PrepareOutput();
+    EmitOutput(bufferpos / 50, 1);
 
     return 1;
 }
@@ -15,11 +15,20 @@ extern "C"
     void DisableSingmode();
     void EnableDebug();
 
+// Ring buffer used while streaming and the amount of samples handed over at once
+#define SAM_STREAM_BUFFER 2048
+#define SAM_STREAM_CHUNK 512
+
+    // Receives count 8 bit unsigned samples at 22050 Hz while SAMMain() renders
+    typedef void (*SAMOutputFn)(const unsigned char *samples, int count, void *user);
+
     int SAMMain();
 
     char *GetBuffer();
     int GetBufferLength();
     void FreeBuffer();
+    // Stream samples to fn instead of rendering everything into the buffer, NULL to go back
+    void SetOutput(SAMOutputFn fn, void *user);
     
     //char input[]={"/HAALAOAO MAYN NAAMAEAE IHSTT SAEBAASTTIHAAN \x9b\x9b\0"};
     //unsigned char input[]={"/HAALAOAO \x9b\0"};
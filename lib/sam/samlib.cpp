@@ -13,6 +13,9 @@
   #define MA_NO_ENCODING
   #include "miniaudio.c"
   #include "compat_string.h"
+  #include <algorithm>
+  #include <condition_variable>
+  #include <mutex>
 #endif
 
 #include "fnSystem.h"
@@ -217,17 +220,10 @@ void OutputSound()
 #else //Not def USESDL
 
 #ifdef ESP_PLATFORM
-void OutputSound()
-{
 #ifndef CONFIG_IDF_TARGET_ESP32S3
-    int n = GetBufferLength() / 50;
-    char *s = GetBuffer();
-
-    //fnSystem.dac_output_enable(SystemManager::dac_channel_t::DAC_CHANNEL_1);
-    //fnSystem.dac_output_voltage(SystemManager::dac_channel_t::DAC_CHANNEL_1, 100);
-
-    dac_output_enable(DAC_CHANNEL_1);
-
+// Plays each chunk as SAM renders it
+static void dac_output(const unsigned char *s, int n, void *user)
+{
     for (int i = 0; i < n; i++)
     {
         //dacWrite(DAC1, s[i]);
@@ -236,6 +232,36 @@ void OutputSound()
         //delayMicroseconds(40);
         fnSystem.delay_microseconds(40);
     }
+}
+#else
+struct i2s_outputs
+{
+    i2s_chan_handle_t pdm = nullptr;
+    i2s_chan_handle_t std = nullptr;
+};
+
+// Queues each chunk as SAM renders it, writes block while the DMA buffers are full
+static void i2s_output(const unsigned char *s, int n, void *user)
+{
+    i2s_outputs *out = (i2s_outputs *)user;
+    SendI2S(out->pdm, (char *)s, n);
+    if (out->std != nullptr)
+        SendI2S(out->std, (char *)s, n);
+}
+#endif
+
+int OutputSound()
+{
+    int result;
+#ifndef CONFIG_IDF_TARGET_ESP32S3
+    //fnSystem.dac_output_enable(SystemManager::dac_channel_t::DAC_CHANNEL_1);
+    //fnSystem.dac_output_voltage(SystemManager::dac_channel_t::DAC_CHANNEL_1, 100);
+
+    dac_output_enable(DAC_CHANNEL_1);
+
+    SetOutput(dac_output, NULL);
+    result = SAMMain();
+    SetOutput(NULL, NULL);
 
     //fnSystem.dac_output_disable(SystemManager::dac_channel_t::DAC_CHANNEL_1);
     dac_output_disable(DAC_CHANNEL_1);
@@ -243,8 +269,7 @@ void OutputSound()
 #else //Defined CONFIG_IDF_TARGET_ESP32S3
 //SampleRate = 22050
 //8 Bits
-    int n = GetBufferLength() / 50;
-    char *s = GetBuffer();
+    i2s_outputs out;
     //PDMOutput *audioOutput = NULL;
 
 
@@ -307,13 +332,7 @@ void OutputSound()
 
         i2s_channel_init_pdm_tx_mode(tx_handle, &pdm_tx_cfg);
         i2s_channel_enable(tx_handle);
-
-        SendI2S (tx_handle, s, n);
-
-        /* Have to stop the channel before deleting it */
-        i2s_channel_disable(tx_handle);
-        /* If the handle is not needed any more, delete it to release the channel resources */
-        i2s_del_channel(tx_handle);
+        out.pdm = tx_handle;
         
 //#ifdef ESP32S3_I2S_OUT
 //    }
@@ -354,76 +373,113 @@ void OutputSound()
 
         /* Before write data, start the tx channel first */
         i2s_channel_enable(tx_handle);
-
-        //i2s_channel_write(tx_handle, src_buf, bytes_to_write, bytes_written, ticks_to_wait);
-        //i2s_channel_write(tx_handle, s, n, &bytes_written, 1000 / portTICK_PERIOD_MS);
-        SendI2S (tx_handle, s, n);
-
-        /* Have to stop the channel before deleting it */
-        i2s_channel_disable(tx_handle);
-        /* If the handle is not needed any more, delete it to release the channel resources */
-        i2s_del_channel(tx_handle);
+        out.std = tx_handle;
 
 // /I2S_STD
 
     }
 #endif    //ESP32S3_I2S_OUT
 
+    SetOutput(i2s_output, &out);
+    result = SAMMain();
+    SetOutput(NULL, NULL);
+
+    /* Have to stop the channels before deleting them, that also releases their resources */
+    i2s_channel_disable(out.pdm);
+    i2s_del_channel(out.pdm);
+    if (out.std != nullptr)
+    {
+        i2s_channel_disable(out.std);
+        i2s_del_channel(out.std);
+    }
+
 #endif //CONFIG_IDF_TARGET_ESP32S3
+    return result;
 }
 
 // end of ESP_PLATFORM
 #else
 // !ESP_PLATFORM
 
-static int pos = 0;
-void data_callback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount)
+// Chunks rendered by SAM wait here for the audio device
+struct sam_stream
 {
-    int bufferpos = GetBufferLength() / 50;
-    char *buffer = GetBuffer();
-    int i;
-    bool *done_ptr = static_cast<bool *>(pDevice->pUserData);
-    if (pos >= bufferpos)
+    std::mutex mutex;
+    std::condition_variable cv;
+    unsigned char ring[SAM_STREAM_BUFFER];
+    size_t head = 0;
+    size_t count = 0;
+    bool finished = false; // all samples are in the ring
+    bool done = false;     // and played
+};
+
+static void stream_output(const unsigned char *s, int n, void *user)
+{
+    sam_stream *st = (sam_stream *)user;
+    std::unique_lock<std::mutex> lock(st->mutex);
+    while (n > 0)
     {
-        *done_ptr = true;
-        return;
+        st->cv.wait(lock, [st] { return st->count < sizeof(st->ring); });
+        size_t tail = (st->head + st->count) % sizeof(st->ring);
+        size_t len = std::min({(size_t)n, sizeof(st->ring) - st->count, sizeof(st->ring) - tail});
+        memcpy(&st->ring[tail], s, len);
+        st->count += len;
+        s += len;
+        n -= len;
     }
-    if ((bufferpos - pos) < frameCount)
-        frameCount = (bufferpos - pos);
-    for (i = 0; i < frameCount; i++)
+}
+
+void data_callback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount)
+{
+    sam_stream *st = static_cast<sam_stream *>(pDevice->pUserData);
+    std::lock_guard<std::mutex> lock(st->mutex);
+    unsigned char *out = (unsigned char *)pOutput;
+    // output is silence already if SAM falls behind
+    while (frameCount > 0 && st->count > 0)
     {
-        ((char *)pOutput)[i] = buffer[pos];
-        pos++;
+        size_t len = std::min({(size_t)frameCount, st->count, sizeof(st->ring) - st->head});
+        memcpy(out, &st->ring[st->head], len);
+        st->head = (st->head + len) % sizeof(st->ring);
+        st->count -= len;
+        out += len;
+        frameCount -= len;
     }
+    if (st->finished && st->count == 0)
+        st->done = true;
+    st->cv.notify_all();
 }
 
-void OutputSound()
+int OutputSound()
 {
-    pos = 0;
-    bool done = false;
+    sam_stream st;
     ma_device_config config  = ma_device_config_init(ma_device_type_playback);
     config.playback.format   = ma_format_u8;    // Set to ma_format_unknown to use the device's native format.
     config.playback.channels = 1;               // Set to 0 to use the device's native channel count.
     config.sampleRate        = sample_rate;     // Set to 0 to use the device's native sample rate.
     config.dataCallback      = data_callback;   // This function will be called when miniaudio needs more data.
-    config.pUserData         = &done;           // Can be accessed from the device object (device.pUserData).
+    config.pUserData         = &st;             // Can be accessed from the device object (device.pUserData).
 
     ma_device device;
     if (ma_device_init(NULL, &config, &device) != MA_SUCCESS) {
-        return;  // Failed to initialize the device.
+        return SAMMain();  // Failed to initialize the device.
     }
 
     ma_device_start(&device);     // The device is sleeping by default so you'll need to start it manually.
 
-    // Do something here.
-    while (!done) {
-        fnSystem.delay(100);
+    SetOutput(stream_output, &st);
+    int result = SAMMain();
+    SetOutput(NULL, NULL);
+
+    {
+        std::unique_lock<std::mutex> lock(st.mutex);
+        st.finished = true;
+        st.cv.wait(lock, [&st] { return st.done; });
     }
 
     ma_device_uninit(&device);
+    return result;
 }
 
-    // end of !ESP_PLATFORM
 #endif
 
 #endif //USESDL
@@ -568,11 +624,13 @@ int sam(int argc, char **argv)
 
     // printf("right before SAMMain");
 
+#ifdef USESDL
     if (!SAMMain()) // buffer is allocated in SAMMain, used by OutputSound and WriteWav
     {
         PrintUsage();
         return 1;
     }
+#endif
     // printf("right after SAMMain");
 
 // apc: any use of WriteWav on fujinet-pc?
@@ -582,7 +640,16 @@ int sam(int argc, char **argv)
 //         WriteWav(wavfilename, GetBuffer(), GetBufferLength() / 50);
 //     else
 // #endif // ESP_PLATFORM
+#ifdef USESDL
         OutputSound();
+#else
+    // renders while playing
+    if (!OutputSound())
+    {
+        PrintUsage();
+        return 1;
+    }
+#endif
 
     FreeBuffer();
     return 0;
@@ -30,7 +30,8 @@ void PrintUsage();
 void MixAudio(void *unused, Uint8 *stream, int len);
 void OutputSound();
 #else
-void OutputSound();
+// Renders the utterance with SAMMain() while playing it, returns its result
+int OutputSound();
 #endif
 
 int sam(int argc, char **argv);
@@ -1,14 +1,273 @@
 #include "fnDNS.h"
 
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+#ifdef ESP_PLATFORM
+#include "lwip/dns.h"
+#endif
+
+#include "fnSystem.h"
+
 #include "../../include/debug.h"
 
 
-// Return a single IP4 address given a hostname
-in_addr_t get_ip4_addr_by_name(const char *hostname)
+/*
+ Resolved names are cached for the TTL of their address record, at most DNS_MAX_TTL
+ seconds, and failures for DNS_NEGATIVE_TTL. gethostbyname() doesn't report the TTL,
+ so the address record is asked for with a query sent to the DNS server directly.
+ Names without a dot (search domains) or in .local, and names the server doesn't
+ answer for, go to the system resolver and are cached for DNS_CACHE_TTL.
+
+ A name being resolved stays in the cache marked pending, concurrent lookups of the
+ same name wait for that result instead of asking the resolver again. Asynchronous
+ lookups queue the pending entry for the resolver thread, which resolves one name
+ after the other.
+*/
+struct dns_entry
+{
+    std::string name;
+    in_addr_t addr = IPADDR_NONE;
+    uint64_t expires = 0;
+    uint64_t used = 0;
+    bool pending = false;
+    bool queued = false; // pending, waiting for the resolver thread
+};
+
+static std::mutex dns_mutex;
+static std::condition_variable dns_cv;
+// Never destroyed, the resolver thread may still wait on it when the program exits
+static std::condition_variable &dns_queue_cv = *new std::condition_variable;
+static bool dns_thread_started = false;
+static dns_entry dns_cache[DNS_CACHE_SIZE];
+static fnDnsStats dns_stats;
+static in_addr_t dns_server = IPADDR_NONE;
+static uint16_t dns_server_port = 53;
+static uint32_t dns_max_ttl = DNS_MAX_TTL;
+static uint32_t dns_negative_ttl = DNS_NEGATIVE_TTL;
+
+#define DNS_PACKET_SIZE 512
+#define DNS_HEADER_SIZE 12
+#define DNS_TYPE_A 1
+#define DNS_TYPE_CNAME 5
+#define DNS_CLASS_IN 1
+#define DNS_RCODE_NXDOMAIN 3
+
+enum dns_answer
+{
+    DNS_ANSWER_ADDR,
+    DNS_ANSWER_NONE, // the name has no address
+    DNS_ANSWER_ERROR
+};
+
+// Query for the A record of hostname, 0 if the name can't be encoded
+static size_t dns_make_query(uint8_t *p, uint16_t id, const char *hostname)
+{
+    memset(p, 0, DNS_HEADER_SIZE);
+    p[0] = id >> 8;
+    p[1] = id & 0xff;
+    p[2] = 0x01; // recursion desired
+    p[5] = 1;    // one question
+
+    size_t pos = DNS_HEADER_SIZE;
+    const char *label = hostname;
+    while (*label != '\0')
+    {
+        const char *dot = strchr(label, '.');
+        size_t len = dot != nullptr ? dot - label : strlen(label);
+        if (len == 0 || len > 63 || pos + len + 6 > DNS_PACKET_SIZE)
+            return 0;
+        p[pos++] = len;
+        memcpy(p + pos, label, len);
+        pos += len;
+        label += len;
+        if (*label == '.')
+            label++;
+    }
+    p[pos++] = 0;
+    p[pos++] = 0;
+    p[pos++] = DNS_TYPE_A;
+    p[pos++] = 0;
+    p[pos++] = DNS_CLASS_IN;
+    return pos;
+}
+
+// Bytes of the (compressed) name at pos, 0 if it runs past len
+static size_t dns_skip_name(const uint8_t *p, size_t len, size_t pos)
+{
+    size_t start = pos;
+    while (pos < len)
+    {
+        if (p[pos] == 0)
+            return pos + 1 - start;
+        if ((p[pos] & 0xc0) == 0xc0)
+            return pos + 2 <= len ? pos + 2 - start : 0;
+        pos += p[pos] + 1;
+    }
+    return 0;
+}
+
+// First address record of the response and the lowest TTL on the way to it,
+// CNAME records included
+static dns_answer dns_parse(const uint8_t *p, size_t len, in_addr_t *addr, uint32_t *ttl)
+{
+    uint8_t rcode = p[3] & 0x0f;
+    if (rcode == DNS_RCODE_NXDOMAIN)
+        return DNS_ANSWER_NONE;
+    if (rcode != 0)
+        return DNS_ANSWER_ERROR;
+
+    uint16_t questions = p[4] << 8 | p[5];
+    uint16_t answers = p[6] << 8 | p[7];
+    size_t pos = DNS_HEADER_SIZE;
+    for (int i = 0; i < questions; i++)
+    {
+        size_t n = dns_skip_name(p, len, pos);
+        if (n == 0 || pos + n + 4 > len)
+            return DNS_ANSWER_ERROR;
+        pos += n + 4;
+    }
+
+    uint32_t lowest = UINT32_MAX;
+    for (int i = 0; i < answers; i++)
+    {
+        size_t n = dns_skip_name(p, len, pos);
+        if (n == 0 || pos + n + 10 > len)
+            return DNS_ANSWER_ERROR;
+        pos += n;
+        uint16_t type = p[pos] << 8 | p[pos + 1];
+        uint16_t rclass = p[pos + 2] << 8 | p[pos + 3];
+        uint32_t rttl = (uint32_t)p[pos + 4] << 24 | p[pos + 5] << 16 | p[pos + 6] << 8 | p[pos + 7];
+        uint16_t rdlength = p[pos + 8] << 8 | p[pos + 9];
+        pos += 10;
+        if (pos + rdlength > len)
+            return DNS_ANSWER_ERROR;
+        if (rttl & 0x80000000) // RFC 2181: treat as zero
+            rttl = 0;
+
+        if (rclass == DNS_CLASS_IN && (type == DNS_TYPE_A || type == DNS_TYPE_CNAME))
+            lowest = std::min(lowest, rttl);
+        if (rclass == DNS_CLASS_IN && type == DNS_TYPE_A && rdlength == 4)
+        {
+            memcpy(addr, p + pos, 4);
+            *ttl = lowest;
+            return DNS_ANSWER_ADDR;
+        }
+        pos += rdlength;
+    }
+    return DNS_ANSWER_NONE;
+}
+
+// Ask server for the address of hostname, retrying once if it doesn't answer
+static dns_answer dns_query(in_addr_t server, uint16_t port, const char *hostname, in_addr_t *addr, uint32_t *ttl)
+{
+    uint8_t *query = new uint8_t[2 * DNS_PACKET_SIZE];
+    uint8_t *response = query + DNS_PACKET_SIZE;
+    uint16_t id = std::random_device()();
+    size_t query_len = dns_make_query(query, id, hostname);
+
+    int fd = query_len > 0 ? socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP) : -1;
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = server;
+    sa.sin_port = htons(port);
+    // connected, so only the server's datagrams are received
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+    {
+        closesocket(fd);
+        fd = -1;
+    }
+
+    dns_answer result = DNS_ANSWER_ERROR;
+    for (int tries = 0; fd >= 0 && tries < DNS_QUERY_TRIES && result == DNS_ANSWER_ERROR; tries++)
+    {
+        if (send(fd, (const char *)query, query_len, 0) < 0)
+            break;
+        uint64_t deadline = fnSystem.millis() + DNS_QUERY_TIMEOUT;
+        while (result == DNS_ANSWER_ERROR)
+        {
+            int64_t wait = (int64_t)(deadline - fnSystem.millis());
+            if (wait <= 0)
+                break;
+            fd_set fds;
+            FD_ZERO(&fds);
+            FD_SET(fd, &fds);
+            struct timeval tv;
+            tv.tv_sec = wait / 1000;
+            tv.tv_usec = (wait % 1000) * 1000;
+            if (select(fd + 1, &fds, nullptr, nullptr, &tv) <= 0)
+                break;
+            int len = recv(fd, (char *)response, DNS_PACKET_SIZE, 0);
+            if (len < 0)
+                break;
+            // answers to earlier tries or someone else's query are skipped
+            if (len < DNS_HEADER_SIZE || response[0] != query[0] || response[1] != query[1] || !(response[2] & 0x80))
+                continue;
+            result = dns_parse(response, len, addr, ttl);
+            if (result == DNS_ANSWER_ERROR)
+                break;
+        }
+    }
+
+    if (fd >= 0)
+        closesocket(fd);
+    delete[] query;
+    return result;
+}
+
+// Server to ask directly, IPADDR_NONE to use the system resolver
+static in_addr_t dns_query_server(uint16_t *port)
+{
+    std::lock_guard<std::mutex> lock(dns_mutex);
+    *port = dns_server_port;
+    if (dns_server != IPADDR_NONE)
+        return dns_server;
+#ifdef ESP_PLATFORM
+    const ip_addr_t *server = dns_getserver(0);
+    if (server != nullptr && IP_IS_V4(server) && !ip_addr_isany(server))
+    {
+        *port = 53;
+        return ip4_addr_get_u32(ip_2_ip4(server));
+    }
+#endif
+    return IPADDR_NONE;
+}
+
+// Address of hostname and seconds it may be cached
+static in_addr_t dns_resolve(const char *hostname, uint32_t *ttl)
 {
     in_addr_t result = IPADDR_NONE;
 
     Debug_printf("Resolving hostname \"%s\"\r\n", hostname);
+
+    uint16_t port;
+    in_addr_t server = dns_query_server(&port);
+    size_t len = strlen(hostname);
+    bool local = len > 6 && strcmp(hostname + len - 6, ".local") == 0;
+    if (server != IPADDR_NONE && strchr(hostname, '.') != nullptr && !local)
+    {
+        switch (dns_query(server, port, hostname, &result, ttl))
+        {
+        case DNS_ANSWER_ADDR:
+            Debug_printf("Resolved to address %s, TTL %u\r\n", compat_inet_ntoa(result), (unsigned)*ttl);
+            return result;
+        case DNS_ANSWER_NONE:
+            Debug_println("Name has no address");
+            return IPADDR_NONE;
+        default:
+            Debug_println("No answer from DNS server, asking the system resolver");
+            break;
+        }
+    }
+
+    *ttl = DNS_CACHE_TTL;
     struct hostent *info = gethostbyname(hostname);
 
     if(info == nullptr)
@@ -24,4 +283,224 @@ in_addr_t get_ip4_addr_by_name(const char *hostname)
         }
     }
     return result;
-}
\ No newline at end of file
+}
+
+static std::string dns_key(const char *hostname)
+{
+    std::string name(hostname);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+    return name;
+}
+
+// Must be called with dns_mutex held
+static dns_entry *dns_find(const std::string &name)
+{
+    for (auto &e : dns_cache)
+        if (!e.name.empty() && e.name == name)
+            return &e;
+    return nullptr;
+}
+
+// Must be called with dns_mutex held. Marks the entry of name pending, reusing e
+// (the expired entry of name) if there is one, else the least recently used entry.
+// nullptr if every entry is being resolved, the answer isn't cached then.
+static dns_entry *dns_start(const std::string &name, dns_entry *e)
+{
+    dns_entry *slot = e;
+    if (slot == nullptr)
+    {
+        for (auto &c : dns_cache)
+        {
+            if (c.pending)
+                continue;
+            if (slot == nullptr || c.used < slot->used)
+                slot = &c;
+        }
+    }
+    if (slot != nullptr)
+    {
+        slot->name = name;
+        slot->addr = IPADDR_NONE;
+        slot->expires = 0;
+        slot->used = fnSystem.millis();
+        slot->pending = true;
+        slot->queued = false;
+    }
+    dns_stats.misses++;
+    return slot;
+}
+
+// Store the answer in the entry returned by dns_start() and wake up the waiters.
+// Pending entries are never reused or flushed, so e still belongs to the name.
+static void dns_finish(dns_entry *e, in_addr_t addr, uint32_t ttl)
+{
+    std::lock_guard<std::mutex> lock(dns_mutex);
+    if (addr == IPADDR_NONE)
+        dns_stats.failures++;
+
+    if (e != nullptr)
+    {
+        ttl = addr == IPADDR_NONE ? dns_negative_ttl : std::min(ttl, dns_max_ttl);
+        // At least a second, so an asynchronous lookup polling for it sees the answer
+        ttl = std::max(ttl, 1U);
+        e->addr = addr;
+        e->expires = fnSystem.millis() + ttl * 1000ULL;
+        e->pending = false;
+    }
+    dns_cv.notify_all();
+}
+
+// Must be called with dns_mutex held, true if e holds a usable answer
+static bool dns_cached(dns_entry *e)
+{
+    if (e == nullptr || e->pending || e->expires <= (uint64_t)fnSystem.millis())
+        return false;
+
+    e->used = fnSystem.millis();
+    if (e->addr == IPADDR_NONE)
+        dns_stats.negative_hits++;
+    else
+        dns_stats.hits++;
+    return true;
+}
+
+// Resolves the entries queued by get_ip4_addr_by_name_async(), one at a time
+static void dns_resolver_thread()
+{
+    std::unique_lock<std::mutex> lock(dns_mutex);
+    while (true)
+    {
+        dns_entry *e = nullptr;
+        dns_queue_cv.wait(lock, [&e] {
+            for (auto &c : dns_cache)
+            {
+                if (c.queued)
+                {
+                    e = &c;
+                    return true;
+                }
+            }
+            return false;
+        });
+        e->queued = false;
+        std::string name = e->name;
+        lock.unlock();
+
+        uint32_t ttl;
+        in_addr_t addr = dns_resolve(name.c_str(), &ttl);
+        dns_finish(e, addr, ttl);
+        lock.lock();
+    }
+}
+
+in_addr_t get_ip4_addr_by_name(const char *hostname)
+{
+    if (hostname == nullptr || hostname[0] == '\0')
+        return IPADDR_NONE;
+
+    // Dotted quads need no resolver
+    in_addr_t numeric = inet_addr(hostname);
+    if (numeric != IPADDR_NONE)
+        return numeric;
+
+    std::string name = dns_key(hostname);
+    std::unique_lock<std::mutex> lock(dns_mutex);
+    dns_stats.lookups++;
+
+    dns_entry *e = dns_find(name);
+    dns_entry *slot;
+    if (e != nullptr && e->queued)
+    {
+        // Resolve it here instead of waiting for the resolver thread to get to it
+        e->queued = false;
+        slot = e;
+    }
+    else if (e != nullptr && e->pending)
+    {
+        dns_stats.shared++;
+        dns_cv.wait(lock, [e] { return !e->pending; });
+        return e->addr;
+    }
+    else if (dns_cached(e))
+        return e->addr;
+    else
+        slot = dns_start(name, e);
+    lock.unlock();
+
+    uint32_t ttl;
+    in_addr_t addr = dns_resolve(hostname, &ttl);
+    dns_finish(slot, addr, ttl);
+    return addr;
+}
+
+dns_status get_ip4_addr_by_name_async(const char *hostname, in_addr_t *addr)
+{
+    if (hostname == nullptr || hostname[0] == '\0')
+        return DNS_FAILED;
+
+    in_addr_t numeric = inet_addr(hostname);
+    if (numeric != IPADDR_NONE)
+    {
+        *addr = numeric;
+        return DNS_RESOLVED;
+    }
+
+    std::string name = dns_key(hostname);
+    std::lock_guard<std::mutex> lock(dns_mutex);
+
+    dns_entry *e = dns_find(name);
+    if (e != nullptr && e->pending)
+        return DNS_PENDING;
+
+    dns_stats.lookups++;
+    if (dns_cached(e))
+    {
+        *addr = e->addr;
+        return e->addr == IPADDR_NONE ? DNS_FAILED : DNS_RESOLVED;
+    }
+
+    // With every entry being resolved there's nowhere to keep the answer, one
+    // of them is done soon, try again then
+    dns_entry *slot = dns_start(name, e);
+    if (slot == nullptr)
+        return DNS_PENDING;
+
+    slot->queued = true;
+    if (!dns_thread_started)
+    {
+        std::thread(dns_resolver_thread).detach();
+        dns_thread_started = true;
+    }
+    dns_queue_cv.notify_one();
+    return DNS_PENDING;
+}
+
+void dns_set_server(in_addr_t server, uint16_t port)
+{
+    std::lock_guard<std::mutex> lock(dns_mutex);
+    dns_server = server;
+    dns_server_port = port;
+}
+
+void dns_set_ttl(uint32_t max_ttl, uint32_t negative_ttl)
+{
+    std::lock_guard<std::mutex> lock(dns_mutex);
+    dns_max_ttl = max_ttl;
+    dns_negative_ttl = negative_ttl;
+}
+
+void dns_cache_flush()
+{
+    std::lock_guard<std::mutex> lock(dns_mutex);
+    for (auto &e : dns_cache)
+    {
+        if (!e.pending)
+            e = dns_entry();
+    }
+}
+
+fnDnsStats dns_cache_stats()
+{
+    std::lock_guard<std::mutex> lock(dns_mutex);
+    return dns_stats;
+}
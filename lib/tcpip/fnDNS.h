@@ -1,8 +1,56 @@
 #ifndef _FN_DNS_
 #define _FN_DNS_
 
+#include <cstdint>
+
 #include "compat_inet.h"
 
+// Number of host names remembered by the resolver cache
+#define DNS_CACHE_SIZE 16
+// Seconds a resolved address is reused when the record TTL isn't known (system resolver)
+#define DNS_CACHE_TTL 300
+// Longest record TTL honoured, so a changed address is picked up within this many seconds
+#define DNS_MAX_TTL 3600
+// Seconds a failed lookup is remembered, so unreachable hosts don't stall every retry
+#define DNS_NEGATIVE_TTL 30
+// Milliseconds to wait for the DNS server to answer a query, and number of tries
+#define DNS_QUERY_TIMEOUT 2000
+#define DNS_QUERY_TRIES 2
+
+enum dns_status
+{
+    DNS_RESOLVED,
+    DNS_PENDING,
+    DNS_FAILED
+};
+
+struct fnDnsStats
+{
+    uint32_t lookups = 0;
+    uint32_t hits = 0;
+    uint32_t negative_hits = 0; // Lookups answered by a remembered failure
+    uint32_t misses = 0;        // Lookups that went to the resolver
+    uint32_t shared = 0;        // Lookups that waited for a resolve already in progress
+    uint32_t failures = 0;
+};
+
+// Return a single IP4 address given a hostname, IPADDR_NONE if it can't be resolved.
+// Blocks until the name is resolved unless it is cached.
 in_addr_t get_ip4_addr_by_name(const char *hostname);
 
+// Same without blocking, for bus service loops: on a cache miss the name is handed to
+// the resolver thread and DNS_PENDING returned. Call again until the result is
+// DNS_RESOLVED (addr is set) or DNS_FAILED.
+dns_status get_ip4_addr_by_name_async(const char *hostname, in_addr_t *addr);
+
+// Server asked directly, so answers are cached for their record TTL. Without one the
+// system resolver is used (on ESP32 the server lwIP got from DHCP is asked directly).
+void dns_set_server(in_addr_t server, uint16_t port = 53);
+// Longest positive and the negative caching time in seconds
+void dns_set_ttl(uint32_t max_ttl, uint32_t negative_ttl);
+
+// Forget all answers, e.g. when the network (and with it the DNS server) changes
+void dns_cache_flush();
+fnDnsStats dns_cache_stats();
+
 #endif // _FN_DNS_
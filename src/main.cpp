@@ -40,6 +40,7 @@ Console console;
 
 #ifndef ESP_PLATFORM
 #include "fnTaskManager.h"
+#include "mgHttpClient.h"
 #include "version.h"
 #include "build_version.h"
 #endif
@@ -565,6 +566,8 @@ void fn_service_loop(void *param)
 
         taskMgr.service();
 
+        mgHttpClient::pool_service();
+
         if (fnSystem.check_deferred_reboot())
         {
             // stop the web server first
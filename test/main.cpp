@@ -6,6 +6,11 @@
 #include <esp32/rom/ets_sys.h>
 #include "test_pass.h"
 #include "test_networkprotocol_translation.h"
+#include "test_dircache.h"
+#include "test_hash.h"
+#include "test_sam.h"
+#include "test_png.h"
+#include "test_fnjson.h"
 #include "../lib/hardware/fnSystem.h"
 
 extern "C"
@@ -24,6 +29,11 @@ void app_main()
 
     test_pass_run();
     tests_networkprotocol_translation();
+    tests_dircache();
+    tests_hash();
+    tests_sam();
+    tests_png();
+    tests_fnjson();
 
     UNITY_END();
 }
\ No newline at end of file
@@ -0,0 +1,164 @@
+/**
+ * #FujiNet Tests - Directory listing cache
+ */
+
+#include <string>
+#include "../lib/FileSystem/fnDirCache.h"
+#include "test_dircache.h"
+
+/**
+ * Test fixture, listed in server order
+ */
+static void tests_dircache_fill(DirCache &cache)
+{
+    cache.clear();
+    cache.add_entry("zork.atr", false, 92176, 300);
+    cache.add_entry("Games", true, 0, 100);
+    cache.add_entry("ballblazer.xex", false, 16384, 200);
+    cache.add_entry("apps", true, 0, 400);
+    cache.add_entry("Archon.ATR", false, 133136, 500);
+}
+
+/**
+ * Read the remaining names separated by commas
+ */
+static std::string tests_dircache_names(DirCache &cache)
+{
+    std::string names;
+    fsdir_entry *entry;
+    while ((entry = cache.read()) != nullptr)
+    {
+        if (!names.empty())
+            names += ",";
+        names += entry->filename;
+    }
+    return names;
+}
+
+/**
+ * Tests entrypoint
+ */
+void tests_dircache()
+{
+    RUN_TEST(tests_dircache_sort_name);
+    RUN_TEST(tests_dircache_sort_long_names);
+    RUN_TEST(tests_dircache_sort_descending);
+    RUN_TEST(tests_dircache_sort_date);
+    RUN_TEST(tests_dircache_filter);
+    RUN_TEST(tests_dircache_listing_order);
+    RUN_TEST(tests_dircache_tell_seek);
+}
+
+/**
+ * Test name sort, directories first, case insensitive
+ */
+void tests_dircache_sort_name()
+{
+    DirCache cache;
+    tests_dircache_fill(cache);
+    cache.apply_filter(nullptr, 0);
+    TEST_ASSERT_EQUAL_STRING("apps,Games,Archon.ATR,ballblazer.xex,zork.atr", tests_dircache_names(cache).c_str());
+}
+
+/**
+ * Test names equal in the first 8 characters
+ */
+void tests_dircache_sort_long_names()
+{
+    DirCache cache;
+    cache.add_entry("DISKNAME_B.ATR", false, 1, 1);
+    cache.add_entry("diskname_a.atr", false, 1, 1);
+    cache.add_entry("DiskName", false, 1, 1);
+    cache.add_entry("diskname_c.atr", false, 1, 1);
+    cache.apply_filter(nullptr, 0);
+    TEST_ASSERT_EQUAL_STRING("DiskName,diskname_a.atr,DISKNAME_B.ATR,diskname_c.atr", tests_dircache_names(cache).c_str());
+}
+
+/**
+ * Test descending name sort
+ */
+void tests_dircache_sort_descending()
+{
+    DirCache cache;
+    tests_dircache_fill(cache);
+    cache.apply_filter(nullptr, DIR_OPTION_DESCENDING);
+    TEST_ASSERT_EQUAL_STRING("Games,apps,zork.atr,ballblazer.xex,Archon.ATR", tests_dircache_names(cache).c_str());
+}
+
+/**
+ * Test date sort
+ */
+void tests_dircache_sort_date()
+{
+    DirCache cache;
+    tests_dircache_fill(cache);
+    // newest first
+    cache.apply_filter(nullptr, DIR_OPTION_FILEDATE);
+    TEST_ASSERT_EQUAL_STRING("apps,Games,Archon.ATR,zork.atr,ballblazer.xex", tests_dircache_names(cache).c_str());
+    cache.apply_filter(nullptr, DIR_OPTION_FILEDATE | DIR_OPTION_DESCENDING);
+    TEST_ASSERT_EQUAL_STRING("Games,apps,ballblazer.xex,zork.atr,Archon.ATR", tests_dircache_names(cache).c_str());
+}
+
+/**
+ * Test wildcard filter, directories pass unless pattern ends with /
+ */
+void tests_dircache_filter()
+{
+    DirCache cache;
+    tests_dircache_fill(cache);
+    cache.apply_filter("*.atr", 0);
+    TEST_ASSERT_EQUAL_STRING("apps,Games,Archon.ATR,zork.atr", tests_dircache_names(cache).c_str());
+
+    // same filter again only rewinds
+    cache.apply_filter("*.atr", 0);
+    TEST_ASSERT_EQUAL_STRING("apps,Games,Archon.ATR,zork.atr", tests_dircache_names(cache).c_str());
+
+    cache.apply_filter("g*/", 0);
+    TEST_ASSERT_EQUAL_STRING("", tests_dircache_names(cache).c_str());
+
+    // new entry invalidates the previous result
+    cache.add_entry("Boulder Dash.atr", false, 1, 1);
+    cache.apply_filter("*.atr", 0);
+    TEST_ASSERT_EQUAL_STRING("apps,Games,Archon.ATR,Boulder Dash.atr,zork.atr", tests_dircache_names(cache).c_str());
+}
+
+/**
+ * Test listing order after a filter
+ */
+void tests_dircache_listing_order()
+{
+    DirCache cache;
+    tests_dircache_fill(cache);
+    cache.apply_filter("*.xex", 0);
+    cache.apply_listing_order();
+    TEST_ASSERT_EQUAL_STRING("zork.atr,Games,ballblazer.xex,apps,Archon.ATR", tests_dircache_names(cache).c_str());
+    cache.apply_filter("*.xex", 0);
+    TEST_ASSERT_EQUAL_STRING("apps,Games,ballblazer.xex", tests_dircache_names(cache).c_str());
+}
+
+/**
+ * Test tell and seek
+ */
+void tests_dircache_tell_seek()
+{
+    DirCache cache;
+    TEST_ASSERT_EQUAL_UINT16(FNFS_INVALID_DIRPOS, cache.tell());
+
+    tests_dircache_fill(cache);
+    cache.apply_filter(nullptr, 0);
+    TEST_ASSERT_EQUAL_UINT16(0, cache.tell());
+    cache.read();
+    cache.read();
+    TEST_ASSERT_EQUAL_UINT16(2, cache.tell());
+
+    TEST_ASSERT_TRUE(cache.seek(4));
+    fsdir_entry *entry = cache.read();
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_STRING("zork.atr", entry->filename);
+    TEST_ASSERT_FALSE(entry->isDir);
+    TEST_ASSERT_EQUAL_UINT32(92176, entry->size);
+    TEST_ASSERT_NULL(cache.read());
+
+    TEST_ASSERT_TRUE(cache.seek(5));
+    TEST_ASSERT_FALSE(cache.seek(6));
+}
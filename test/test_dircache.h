@@ -0,0 +1,59 @@
+/**
+ * #FujiNet Tests - Directory listing cache
+ *
+ * Exercises filtering, sorting and positioning of DirCache.
+ */
+
+#ifndef TEST_DIRCACHE_H
+#define TEST_DIRCACHE_H
+
+#include <unity.h>
+
+#ifdef __cplusplus
+
+extern "C"
+{
+    /**
+     * Tests entrypoint
+     */
+    void tests_dircache();
+
+    /**
+     * Test name sort, directories first, case insensitive
+     */
+    void tests_dircache_sort_name();
+
+    /**
+     * Test names equal in the first 8 characters
+     */
+    void tests_dircache_sort_long_names();
+
+    /**
+     * Test descending name sort
+     */
+    void tests_dircache_sort_descending();
+
+    /**
+     * Test date sort
+     */
+    void tests_dircache_sort_date();
+
+    /**
+     * Test wildcard filter, directories pass unless pattern ends with /
+     */
+    void tests_dircache_filter();
+
+    /**
+     * Test listing order after a filter
+     */
+    void tests_dircache_listing_order();
+
+    /**
+     * Test tell and seek
+     */
+    void tests_dircache_tell_seek();
+}
+
+#endif /* __cplusplus */
+
+#endif /* TEST_DIRCACHE_H */
@@ -0,0 +1,139 @@
+/**
+ * #FujiNet Tests - FNJSON
+ */
+
+#include <string.h>
+#include <string>
+#include "../lib/fnjson/fnjson.h"
+#include "test_fnjson.h"
+
+/**
+ * Test fixtures
+ */
+static const char *document = "{\"name\":\"FujiNet\",\"list\":[1,2,3],\"nested\":{\"a\":\"x\",\"b\":true}}";
+static const char *name_value = "FujiNet\x9B";
+static const char *list_value = "1\x9B" "2\x9B" "3\x9B";
+
+/**
+ * Protocol serving the document, then closing
+ */
+class TestJSONProtocol : public NetworkProtocol
+{
+public:
+    TestJSONProtocol(std::string *rx_buf, std::string *tx_buf, std::string *sp_buf)
+        : NetworkProtocol(rx_buf, tx_buf, sp_buf)
+    {
+        _data = document;
+    }
+
+    bool read(unsigned short len) override
+    {
+        *receiveBuffer += _data.substr(0, len);
+        _data.erase(0, len);
+        return false;
+    }
+
+    bool status(NetworkStatus *status) override
+    {
+        status->rxBytesWaiting = _data.size();
+        status->connected = !_data.empty();
+        status->error = _data.empty() ? 136 : 1;
+        return false;
+    }
+
+private:
+    std::string _data;
+};
+
+static std::string rx_buf;
+static std::string tx_buf;
+static std::string sp_buf;
+
+/**
+ * Parse the document with ATASCII EOL line endings
+ */
+static void parse(FNJSON &json, TestJSONProtocol &protocol)
+{
+    json.setLineEnding("\x9B");
+    json.setProtocol(&protocol);
+    TEST_ASSERT_TRUE(json.parse());
+}
+
+/**
+ * Tests entrypoint
+ */
+void tests_fnjson()
+{
+    RUN_TEST(tests_fnjson_read_value_twice);
+    RUN_TEST(tests_fnjson_read_value_in_pieces);
+    RUN_TEST(tests_fnjson_new_query_rewinds);
+}
+
+/**
+ * Test the same value read twice, as a device does after resending a reply
+ */
+void tests_fnjson_read_value_twice()
+{
+    TestJSONProtocol protocol(&rx_buf, &tx_buf, &sp_buf);
+    FNJSON json;
+    parse(json, protocol);
+    json.setReadQuery("/name", 0);
+
+    for (int i = 0; i < 2; i++)
+    {
+        uint8_t buf[32];
+        int len = json.readValueLen();
+        TEST_ASSERT_EQUAL_INT(strlen(name_value), len);
+        TEST_ASSERT_FALSE(json.readValue(buf, len));
+        TEST_ASSERT_EQUAL_MEMORY(name_value, buf, len);
+    }
+}
+
+/**
+ * Test a value read in pieces with readValueNext()
+ */
+void tests_fnjson_read_value_in_pieces()
+{
+    TestJSONProtocol protocol(&rx_buf, &tx_buf, &sp_buf);
+    FNJSON json;
+    parse(json, protocol);
+    json.setReadQuery("/list", 0);
+
+    size_t len = strlen(list_value);
+    TEST_ASSERT_EQUAL_INT(len, json.json_bytes_remaining);
+
+    std::string got;
+    uint8_t buf[4];
+    while (json.readValueRemaining() > 0)
+    {
+        int n = json.readValueRemaining() < (int)sizeof(buf) ? json.readValueRemaining() : sizeof(buf);
+        TEST_ASSERT_FALSE(json.readValueNext(buf, n));
+        got.append((const char *)buf, n);
+    }
+    TEST_ASSERT_EQUAL_STRING(list_value, got.c_str());
+
+    // past the end is zero filled, the whole value is still there for readValue()
+    TEST_ASSERT_FALSE(json.readValueNext(buf, sizeof(buf)));
+    TEST_ASSERT_EACH_EQUAL_UINT8(0, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_INT(len, json.readValueLen());
+}
+
+/**
+ * Test a new query reads its value from the beginning
+ */
+void tests_fnjson_new_query_rewinds()
+{
+    TestJSONProtocol protocol(&rx_buf, &tx_buf, &sp_buf);
+    FNJSON json;
+    parse(json, protocol);
+    json.setReadQuery("/name", 0);
+
+    uint8_t buf[32];
+    TEST_ASSERT_FALSE(json.readValueNext(buf, 3));
+    TEST_ASSERT_EQUAL_INT(strlen(name_value) - 3, json.readValueRemaining());
+
+    json.setReadQuery("/name", 0);
+    TEST_ASSERT_EQUAL_INT(strlen(name_value), json.readValueRemaining());
+    TEST_ASSERT_FALSE(json.readValueNext(buf, strlen(name_value)));
+    TEST_ASSERT_EQUAL_MEMORY(name_value, buf, strlen(name_value));
+}
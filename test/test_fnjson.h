@@ -0,0 +1,40 @@
+/**
+ * #FujiNet Tests - FNJSON
+ *
+ * Parses a document served by a stand-in protocol and reads query results
+ * back the ways the bus devices do.
+ */
+
+#ifndef TEST_FNJSON_H
+#define TEST_FNJSON_H
+
+#include <unity.h>
+
+#ifdef __cplusplus
+
+extern "C"
+{
+    /**
+     * Tests entrypoint
+     */
+    void tests_fnjson();
+
+    /**
+     * Test the same value read twice, as a device does after resending a reply
+     */
+    void tests_fnjson_read_value_twice();
+
+    /**
+     * Test a value read in pieces with readValueNext()
+     */
+    void tests_fnjson_read_value_in_pieces();
+
+    /**
+     * Test a new query reads its value from the beginning
+     */
+    void tests_fnjson_new_query_rewinds();
+}
+
+#endif /* __cplusplus */
+
+#endif /* TEST_FNJSON_H */
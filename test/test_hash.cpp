@@ -0,0 +1,196 @@
+/**
+ * #FujiNet Tests - Hash
+ */
+
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "../lib/encoding/hash.h"
+#include "test_hash.h"
+
+/**
+ * Test fixtures
+ */
+static const char *abc_md5 = "900150983cd24fb0d6963f7d28e17f72";
+static const char *abc_sha1 = "a9993e364706816aba3e25717850c26c9cd0d89d";
+static const char *abc_sha256 = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+static const char *abc_sha512 = "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+                                "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f";
+static const char *million_a_sha256 = "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+
+/**
+ * Tests entrypoint
+ */
+void tests_hash()
+{
+    RUN_TEST(tests_hash_abc);
+    RUN_TEST(tests_hash_million_a_streaming);
+    RUN_TEST(tests_hash_compute_no_clear);
+    RUN_TEST(tests_hash_begin_other_algorithm);
+    RUN_TEST(tests_hash_output_hex);
+    RUN_TEST(tests_hash_chunked_equals_one_shot);
+    RUN_TEST(tests_hash_sessions);
+}
+
+/**
+ * Test "abc" with every algorithm, picked at compute
+ */
+void tests_hash_abc()
+{
+    Hash h;
+    h.add_data(std::string("abc"));
+
+    h.compute(Hash::Algorithm::MD5, false);
+    TEST_ASSERT_EQUAL_STRING(abc_md5, h.output_hex().c_str());
+    h.compute(Hash::Algorithm::SHA1, false);
+    TEST_ASSERT_EQUAL_STRING(abc_sha1, h.output_hex().c_str());
+    h.compute(Hash::Algorithm::SHA256, false);
+    TEST_ASSERT_EQUAL_STRING(abc_sha256, h.output_hex().c_str());
+    h.compute(Hash::Algorithm::SHA512, true);
+    TEST_ASSERT_EQUAL_STRING(abc_sha512, h.output_hex().c_str());
+}
+
+/**
+ * Test one million 'a' added in pieces, hashed as it arrives
+ */
+void tests_hash_million_a_streaming()
+{
+    Hash h;
+    std::vector<uint8_t> chunk(1000, 'a');
+    // data added before begin() is included
+    h.add_data(chunk);
+    TEST_ASSERT_TRUE(h.begin(Hash::Algorithm::SHA256));
+    for (int i = 1; i < 1000; i++)
+        h.add_data(chunk);
+    h.compute(Hash::Algorithm::SHA256, true);
+    TEST_ASSERT_EQUAL_STRING(million_a_sha256, h.output_hex().c_str());
+}
+
+/**
+ * Test compute without clear keeps adding to the same data
+ */
+void tests_hash_compute_no_clear()
+{
+    Hash h;
+    TEST_ASSERT_TRUE(h.begin(Hash::Algorithm::SHA1));
+    h.add_data(std::string("a"));
+    h.compute(Hash::Algorithm::SHA1, false);
+    TEST_ASSERT_EQUAL_STRING("86f7e437faa5a7fce15d1ddcb9eaeaea377667b8", h.output_hex().c_str());
+    h.add_data(std::string("bc"));
+    h.compute(Hash::Algorithm::SHA1, true);
+    TEST_ASSERT_EQUAL_STRING(abc_sha1, h.output_hex().c_str());
+
+    // cleared, next data starts over
+    h.add_data(std::string("abc"));
+    h.compute(Hash::Algorithm::MD5, true);
+    TEST_ASSERT_EQUAL_STRING(abc_md5, h.output_hex().c_str());
+}
+
+/**
+ * Test only the algorithm given to begin() can be computed
+ */
+void tests_hash_begin_other_algorithm()
+{
+    Hash h;
+    TEST_ASSERT_FALSE(h.begin(Hash::Algorithm::UNKNOWN));
+    TEST_ASSERT_TRUE(h.begin(Hash::Algorithm::MD5));
+    TEST_ASSERT_TRUE(h.begin(Hash::Algorithm::MD5));
+    TEST_ASSERT_FALSE(h.begin(Hash::Algorithm::SHA512));
+    h.add_data(std::string("abc"));
+    h.compute(Hash::Algorithm::SHA256, false);
+    TEST_ASSERT_EQUAL_UINT32(0, h.output_binary().size());
+    h.compute(Hash::Algorithm::MD5, true);
+    TEST_ASSERT_EQUAL_STRING(abc_md5, h.output_hex().c_str());
+}
+
+/**
+ * Test hex output and lengths
+ */
+void tests_hash_output_hex()
+{
+    Hash h;
+    TEST_ASSERT_EQUAL_UINT32(16, h.hash_length(Hash::Algorithm::MD5, false));
+    TEST_ASSERT_EQUAL_UINT32(128, h.hash_length(Hash::Algorithm::SHA512, true));
+    TEST_ASSERT_EQUAL_UINT32(0, h.hash_length(Hash::Algorithm::UNKNOWN, false));
+
+    h.add_data(std::string("abc"));
+    h.compute(Hash::Algorithm::SHA256, true);
+    std::vector<uint8_t> bin = h.output_binary();
+    TEST_ASSERT_EQUAL_UINT32(32, bin.size());
+    TEST_ASSERT_EQUAL_HEX8(0xba, bin[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xad, bin[31]);
+}
+
+/**
+ * Test data added in chunks of random size hashes like one chunk
+ */
+void tests_hash_chunked_equals_one_shot()
+{
+    const Hash::Algorithm algorithms[] = {Hash::Algorithm::MD5, Hash::Algorithm::SHA1,
+                                          Hash::Algorithm::SHA256, Hash::Algorithm::SHA512};
+    std::vector<uint8_t> data(100000);
+    srand(10);
+    for (uint8_t &b : data)
+        b = rand();
+
+    for (Hash::Algorithm algorithm : algorithms)
+    {
+        Hash one_shot;
+        one_shot.add_data(data);
+        one_shot.compute(algorithm, true);
+
+        // as HASH INPUT gets it, algorithm only known at compute
+        Hash chunked;
+        size_t pos = 0;
+        while (pos < data.size())
+        {
+            size_t len = 1 + rand() % 300;
+            if (len > data.size() - pos)
+                len = data.size() - pos;
+            chunked.add_data(data.data() + pos, len);
+            pos += len;
+        }
+        chunked.compute(algorithm, true);
+        TEST_ASSERT_EQUAL_STRING(one_shot.output_hex().c_str(), chunked.output_hex().c_str());
+
+        // algorithm selected half way
+        Hash selected;
+        selected.add_data(data.data(), data.size() / 2);
+        TEST_ASSERT_TRUE(selected.begin(algorithm));
+        selected.add_data(data.data() + data.size() / 2, data.size() - data.size() / 2);
+        selected.compute(algorithm, true);
+        TEST_ASSERT_EQUAL_STRING(one_shot.output_hex().c_str(), selected.output_hex().c_str());
+    }
+}
+
+/**
+ * Test named sessions hash independently
+ */
+void tests_hash_sessions()
+{
+    Hash &a = Hash::session("a");
+    Hash &b = Hash::session("b");
+    TEST_ASSERT_TRUE(&a != &b);
+    TEST_ASSERT_TRUE(&a == &Hash::session("a"));
+
+    // interleaved, each sees only its own data
+    a.add_data(std::string("a"));
+    b.add_data(std::string("ab"));
+    a.add_data(std::string("bc"));
+    hasher.add_data(std::string("x"));
+    b.add_data(std::string("c"));
+    a.compute(Hash::Algorithm::SHA256, false);
+    b.compute(Hash::Algorithm::SHA256, false);
+    TEST_ASSERT_EQUAL_STRING(abc_sha256, a.output_hex().c_str());
+    TEST_ASSERT_EQUAL_STRING(abc_sha256, b.output_hex().c_str());
+    hasher.clear();
+
+    // ended session starts over
+    Hash::end_session("a");
+    Hash &again = Hash::session("a");
+    again.add_data(std::string("abc"));
+    again.compute(Hash::Algorithm::MD5, true);
+    TEST_ASSERT_EQUAL_STRING(abc_md5, again.output_hex().c_str());
+    Hash::end_session("a");
+    Hash::end_session("b");
+}
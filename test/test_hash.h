@@ -0,0 +1,59 @@
+/**
+ * #FujiNet Tests - Hash
+ *
+ * Checks the digests against the FIPS 180 / RFC 1321 test vectors.
+ */
+
+#ifndef TEST_HASH_H
+#define TEST_HASH_H
+
+#include <unity.h>
+
+#ifdef __cplusplus
+
+extern "C"
+{
+    /**
+     * Tests entrypoint
+     */
+    void tests_hash();
+
+    /**
+     * Test "abc" with every algorithm, picked at compute
+     */
+    void tests_hash_abc();
+
+    /**
+     * Test one million 'a' added in pieces, hashed as it arrives
+     */
+    void tests_hash_million_a_streaming();
+
+    /**
+     * Test compute without clear keeps adding to the same data
+     */
+    void tests_hash_compute_no_clear();
+
+    /**
+     * Test only the algorithm given to begin() can be computed
+     */
+    void tests_hash_begin_other_algorithm();
+
+    /**
+     * Test hex output and lengths
+     */
+    void tests_hash_output_hex();
+
+    /**
+     * Test data added in chunks of random size hashes like one chunk
+     */
+    void tests_hash_chunked_equals_one_shot();
+
+    /**
+     * Test named sessions hash independently
+     */
+    void tests_hash_sessions();
+}
+
+#endif /* __cplusplus */
+
+#endif /* TEST_HASH_H */
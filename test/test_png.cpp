@@ -0,0 +1,200 @@
+/**
+ * #FujiNet Tests - PNG printer
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <esp32/rom/miniz.h>
+#include "../lib/printer-emulator/png_printer.h"
+#include "test_png.h"
+
+#define PNG_WIDTH 320
+#define PNG_HEIGHT 192
+
+// Prints into memory instead of a file
+class MemPngPrinter : public pngPrinter
+{
+public:
+    std::vector<uint8_t> print(const std::vector<uint8_t> &pixels, const std::vector<uint8_t> &reps)
+    {
+        std::vector<uint8_t> out(128 * 1024);
+        _file = fmemopen(out.data(), out.size(), "wb");
+        TEST_ASSERT_NOT_NULL(_file);
+        post_new_file();
+
+        // Each line is its rep code and 320 pixels, sent in SIO sized pieces
+        size_t y = 0;
+        for (size_t l = 0; l < reps.size(); l++)
+        {
+            std::vector<uint8_t> line(1, reps[l]);
+            line.insert(line.end(), pixels.begin() + y * PNG_WIDTH, pixels.begin() + (y + 1) * PNG_WIDTH);
+            for (size_t o = 0; o < line.size(); o += 40)
+            {
+                size_t n = line.size() - o < 40 ? line.size() - o : 40;
+                memcpy(buffer, &line[o], n);
+                process_buffer(n, 0, 0);
+            }
+            y += reps[l];
+        }
+
+        pre_close_file();
+        long len = ftell(_file);
+        fclose(_file);
+        _file = nullptr;
+        out.resize(len);
+        return out;
+    }
+};
+
+static uint32_t be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static uint32_t crc32_bitwise(const uint8_t *p, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--)
+    {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++)
+            crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+    }
+    return ~crc;
+}
+
+// Checks the chunk layout and CRCs, inflates the image data and undoes the filters
+static std::vector<uint8_t> decode(const std::vector<uint8_t> &png)
+{
+    static const uint8_t sig[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+    TEST_ASSERT_TRUE(png.size() > sizeof(sig));
+    TEST_ASSERT_EQUAL_MEMORY(sig, png.data(), sizeof(sig));
+
+    std::vector<uint8_t> zdata;
+    std::vector<std::string> chunks;
+    size_t pos = sizeof(sig);
+    while (pos + 12 <= png.size())
+    {
+        uint32_t len = be32(&png[pos]);
+        TEST_ASSERT_TRUE(pos + 12 + len <= png.size());
+        std::string type((const char *)&png[pos + 4], 4);
+        TEST_ASSERT_EQUAL_HEX32(crc32_bitwise(&png[pos + 4], len + 4), be32(&png[pos + 8 + len]));
+        if (type == "IHDR")
+        {
+            TEST_ASSERT_EQUAL(PNG_WIDTH, be32(&png[pos + 8]));
+            TEST_ASSERT_EQUAL(PNG_HEIGHT, be32(&png[pos + 12]));
+        }
+        if (type == "IDAT")
+        {
+            // IDAT chunks must follow each other
+            TEST_ASSERT_TRUE(chunks.back() == "IDAT" || chunks.back() == "PLTE");
+            zdata.insert(zdata.end(), &png[pos + 8], &png[pos + 8 + len]);
+        }
+        chunks.push_back(type);
+        pos += 12 + len;
+    }
+    TEST_ASSERT_EQUAL(png.size(), pos);
+    TEST_ASSERT_TRUE(chunks.front() == "IHDR");
+    TEST_ASSERT_TRUE(chunks.back() == "IEND");
+
+    // Zlib header and Adler-32 are checked by the decoder, its state is too big for the stack
+    std::vector<uint8_t> raw((PNG_WIDTH + 1) * PNG_HEIGHT + 1);
+    tinfl_decompressor *inflator = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+    TEST_ASSERT_NOT_NULL(inflator);
+    tinfl_init(inflator);
+    size_t in_len = zdata.size();
+    size_t out_len = raw.size();
+    tinfl_status status = tinfl_decompress(inflator, zdata.data(), &in_len, raw.data(), raw.data(), &out_len,
+                                           TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+    free(inflator);
+    TEST_ASSERT_EQUAL(TINFL_STATUS_DONE, status);
+    TEST_ASSERT_EQUAL(zdata.size(), in_len);
+    TEST_ASSERT_EQUAL((PNG_WIDTH + 1) * PNG_HEIGHT, out_len);
+
+    std::vector<uint8_t> pixels(PNG_WIDTH * PNG_HEIGHT);
+    for (int y = 0; y < PNG_HEIGHT; y++)
+    {
+        const uint8_t *line = &raw[y * (PNG_WIDTH + 1)];
+        TEST_ASSERT_TRUE(line[0] == 0 || line[0] == 2); // None or Up
+        for (int x = 0; x < PNG_WIDTH; x++)
+        {
+            uint8_t up = (line[0] == 2 && y > 0) ? pixels[(y - 1) * PNG_WIDTH + x] : 0;
+            pixels[y * PNG_WIDTH + x] = line[x + 1] + up;
+        }
+    }
+    return pixels;
+}
+
+/**
+ * Tests entrypoint
+ */
+void tests_png()
+{
+    RUN_TEST(tests_png_blank_page);
+    RUN_TEST(tests_png_text_page);
+    RUN_TEST(tests_png_noise_page);
+}
+
+/**
+ * Test a blank page comes back unchanged and compresses to a few KB
+ */
+void tests_png_blank_page()
+{
+    std::vector<uint8_t> pixels(PNG_WIDTH * PNG_HEIGHT, 15);
+    std::vector<uint8_t> reps(PNG_HEIGHT, 1);
+
+    MemPngPrinter printer;
+    std::vector<uint8_t> png = printer.print(pixels, reps);
+    TEST_ASSERT_LESS_THAN(4096, png.size());
+    std::vector<uint8_t> decoded = decode(png);
+    TEST_ASSERT_EQUAL_MEMORY(pixels.data(), decoded.data(), pixels.size());
+}
+
+/**
+ * Test a page of text-like rows repeated by the rep code comes back unchanged
+ */
+void tests_png_text_page()
+{
+    std::vector<uint8_t> pixels(PNG_WIDTH * PNG_HEIGHT);
+    std::vector<uint8_t> reps;
+    int y = 0;
+    while (y < PNG_HEIGHT)
+    {
+        uint8_t rep = 1 + (y / 3) % 4;
+        if (y + rep > PNG_HEIGHT)
+            rep = PNG_HEIGHT - y;
+        for (int r = 0; r < rep; r++)
+            for (int x = 0; x < PNG_WIDTH; x++)
+                pixels[(y + r) * PNG_WIDTH + x] = (x / 8 + y) % 7 == 0 ? 0 : 15;
+        reps.push_back(rep);
+        y += rep;
+    }
+
+    MemPngPrinter printer;
+    std::vector<uint8_t> decoded = decode(printer.print(pixels, reps));
+    TEST_ASSERT_EQUAL_MEMORY(pixels.data(), decoded.data(), pixels.size());
+}
+
+/**
+ * Test a page of noise, all literals over several IDAT chunks, comes back unchanged
+ */
+void tests_png_noise_page()
+{
+    std::vector<uint8_t> pixels(PNG_WIDTH * PNG_HEIGHT);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        pixels[i] = seed >> 16;
+    }
+    std::vector<uint8_t> reps(PNG_HEIGHT, 1);
+
+    MemPngPrinter printer;
+    std::vector<uint8_t> png = printer.print(pixels, reps);
+    TEST_ASSERT_GREATER_THAN(4 * PNG_IDAT_CHUNK_SIZE, png.size());
+    std::vector<uint8_t> decoded = decode(png);
+    TEST_ASSERT_EQUAL_MEMORY(pixels.data(), decoded.data(), pixels.size());
+}
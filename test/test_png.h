@@ -0,0 +1,40 @@
+/**
+ * #FujiNet Tests - PNG printer
+ *
+ * Prints pages with the PNG printer and decodes them again with the
+ * inflate in the ESP32 ROM.
+ */
+
+#ifndef TEST_PNG_H
+#define TEST_PNG_H
+
+#include <unity.h>
+
+#ifdef __cplusplus
+
+extern "C"
+{
+    /**
+     * Tests entrypoint
+     */
+    void tests_png();
+
+    /**
+     * Test a blank page comes back unchanged and compresses to a few KB
+     */
+    void tests_png_blank_page();
+
+    /**
+     * Test a page of text-like rows repeated by the rep code comes back unchanged
+     */
+    void tests_png_text_page();
+
+    /**
+     * Test a page of noise, all literals over several IDAT chunks, comes back unchanged
+     */
+    void tests_png_noise_page();
+}
+
+#endif /* __cplusplus */
+
+#endif /* TEST_PNG_H */
@@ -0,0 +1,117 @@
+/**
+ * #FujiNet Tests - SAM
+ */
+
+#include <string.h>
+#include <ctype.h>
+#include <vector>
+#include "../lib/sam/sam.h"
+#include "../lib/sam/reciter.h"
+#include "test_sam.h"
+
+extern char input[256];
+
+/**
+ * Test fixtures
+ */
+static const char *long_phrase = "Hello, my name is SAM. I am talking through the FujiNet.";
+static const char *short_phrase = "Ready.";
+
+struct Stream
+{
+    std::vector<unsigned char> samples;
+    std::vector<int> chunks;
+};
+
+static void stream_sink(const unsigned char *samples, int count, void *user)
+{
+    Stream *s = (Stream *)user;
+    s->samples.insert(s->samples.end(), samples, samples + count);
+    s->chunks.push_back(count);
+}
+
+static bool speak(const char *text)
+{
+    memset(input, 0, 256);
+    for (int i = 0; text[i] && i < 254; i++)
+        input[i] = toupper(text[i]);
+    strcat(input, "[");
+    if (!TextToPhonemes((unsigned char *)input))
+        return false;
+    return SAMMain() != 0;
+}
+
+// Whole utterance rendered into the full buffer
+static std::vector<unsigned char> render_batch(const char *text)
+{
+    std::vector<unsigned char> samples;
+    SetOutput(NULL, NULL);
+    if (speak(text))
+        samples.assign((unsigned char *)GetBuffer(), (unsigned char *)GetBuffer() + GetBufferLength() / 50);
+    FreeBuffer();
+    return samples;
+}
+
+static Stream render_stream(const char *text)
+{
+    Stream s;
+    SetOutput(stream_sink, &s);
+    TEST_ASSERT_TRUE(speak(text));
+    FreeBuffer();
+    SetOutput(NULL, NULL);
+    return s;
+}
+
+/**
+ * Tests entrypoint
+ */
+void tests_sam()
+{
+    RUN_TEST(tests_sam_stream_matches_batch);
+    RUN_TEST(tests_sam_stream_chunks);
+    RUN_TEST(tests_sam_stream_back_to_back);
+}
+
+/**
+ * Test an utterance several rings long streams the same samples as the batch render
+ */
+void tests_sam_stream_matches_batch()
+{
+    std::vector<unsigned char> batch = render_batch(long_phrase);
+    Stream s = render_stream(long_phrase);
+
+    TEST_ASSERT_GREATER_THAN(4 * SAM_STREAM_BUFFER, batch.size());
+    TEST_ASSERT_EQUAL(batch.size(), s.samples.size());
+    TEST_ASSERT_EQUAL_MEMORY(batch.data(), s.samples.data(), batch.size());
+}
+
+/**
+ * Test chunks stop at the end of the ring and are handed over in order
+ */
+void tests_sam_stream_chunks()
+{
+    Stream s = render_stream(long_phrase);
+
+    int pos = 0;
+    for (size_t i = 0; i < s.chunks.size(); i++)
+    {
+        int start = pos % SAM_STREAM_BUFFER;
+        TEST_ASSERT_GREATER_THAN(0, s.chunks[i]);
+        TEST_ASSERT_LESS_OR_EQUAL(SAM_STREAM_BUFFER - start, s.chunks[i]);
+        pos += s.chunks[i];
+    }
+    TEST_ASSERT_EQUAL(s.samples.size(), pos);
+}
+
+/**
+ * Test the ring starts over clean for the next utterance
+ */
+void tests_sam_stream_back_to_back()
+{
+    std::vector<unsigned char> batch = render_batch(short_phrase);
+    render_stream(long_phrase);
+    Stream s = render_stream(short_phrase);
+
+    TEST_ASSERT_EQUAL(batch.size(), s.samples.size());
+    TEST_ASSERT_EQUAL_MEMORY(batch.data(), s.samples.data(), batch.size());
+}
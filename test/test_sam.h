@@ -0,0 +1,39 @@
+/**
+ * #FujiNet Tests - SAM
+ *
+ * Checks speech streamed through the ring buffer matches the batch render.
+ */
+
+#ifndef TEST_SAM_H
+#define TEST_SAM_H
+
+#include <unity.h>
+
+#ifdef __cplusplus
+
+extern "C"
+{
+    /**
+     * Tests entrypoint
+     */
+    void tests_sam();
+
+    /**
+     * Test an utterance several rings long streams the same samples as the batch render
+     */
+    void tests_sam_stream_matches_batch();
+
+    /**
+     * Test chunks stop at the end of the ring and are handed over in order
+     */
+    void tests_sam_stream_chunks();
+
+    /**
+     * Test the ring starts over clean for the next utterance
+     */
+    void tests_sam_stream_back_to_back();
+}
+
+#endif /* __cplusplus */
+
+#endif /* TEST_SAM_H */
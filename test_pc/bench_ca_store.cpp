@@ -0,0 +1,94 @@
+/**
+ * #FujiNet host benchmark - shared CA store
+ *
+ * Sets up the CA certificates for a number of HTTPS clients the way their
+ * first TLS connection does, and compares that with every client reading
+ * and keeping its own copy of the bundle, as they did before the store was
+ * shared. Shows the time of the first load, the time for each later client
+ * and the certificate memory held by all of them. Clients that only speak
+ * plain HTTP must not load the bundle at all.
+ *
+ * Usage: bench_ca_store [clients]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "mgHttpClient.h"
+
+#if defined(__linux__)
+#define CA_BUNDLE "/etc/ssl/certs/ca-certificates.crt"
+#else
+#define CA_BUNDLE "/etc/ssl/cert.pem"
+#endif
+
+using bench_clock = std::chrono::steady_clock;
+
+static double ms_since(bench_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    int clients = argc > 1 ? atoi(argv[1]) : 8;
+    if (clients < 2)
+        clients = 2;
+
+    // Each client reads the whole bundle and keeps it
+    std::vector<mg_str> copies;
+    bench_clock::time_point start = bench_clock::now();
+    for (int i = 0; i < clients; i++)
+        copies.push_back(mg_file_read(&mg_fs_posix, CA_BUNDLE));
+    double copy_ms = ms_since(start);
+    size_t copy_bytes = 0;
+    for (mg_str &s : copies)
+    {
+        copy_bytes += s.len;
+        free((void *)s.ptr);
+    }
+    if (copy_bytes == 0)
+    {
+        fprintf(stderr, "no CA bundle at %s\n", CA_BUNDLE);
+        return 1;
+    }
+
+    int failures = 0;
+    std::vector<std::unique_ptr<mgHttpClient>> https;
+    for (int i = 0; i < clients; i++)
+        https.emplace_back(new mgHttpClient());
+    if (https[0]->ca.ptr != nullptr)
+    {
+        fprintf(stderr, "CA bundle loaded before a TLS connection needed it\n");
+        failures++;
+    }
+
+    start = bench_clock::now();
+    https[0]->load_system_certs();
+    double first_ms = ms_since(start);
+
+    start = bench_clock::now();
+    for (int i = 1; i < clients; i++)
+        https[i]->load_system_certs();
+    double later_ms = ms_since(start) / (clients - 1);
+
+    std::set<const char *> stores;
+    for (auto &c : https)
+        stores.insert(c->ca.ptr);
+    if (stores.size() != 1 || https[0]->ca.len == 0)
+    {
+        fprintf(stderr, "clients don't share one CA store\n");
+        failures++;
+    }
+
+    printf("%d clients, %s\n", clients, CA_BUNDLE);
+    printf("own copy:  %8.3f ms in all, %6zu KB held\n", copy_ms, copy_bytes / 1024);
+    printf("shared:    %8.3f ms first load, %.4f ms per later client, %6zu KB held\n",
+           first_ms, later_ms, https[0]->ca.len / 1024);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,220 @@
+/**
+ * #FujiNet host benchmark - directory listing cache
+ *
+ * Fills a DirCache with 10000 entries of a server sized directory, then
+ * filters, sorts and reads it back the way a directory listing does, by
+ * name and by date, with and without a pattern. The same work is done with
+ * the former layout, a full fsdir_entry per entry sorted by pointer, for
+ * comparison. Heap use and times of both are shown and every listing
+ * order is checked against the former one.
+ *
+ * Usage: bench_dircache [entries]
+ */
+
+#include <malloc.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "compat_string.h"
+#include "fnDirCache.h"
+#include "utils.h"
+
+#define REPEATS 20
+
+static size_t heap_now = 0;
+static size_t heap_peak = 0;
+
+void *operator new(size_t size)
+{
+    void *p = malloc(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    heap_now += malloc_usable_size(p);
+    if (heap_now > heap_peak)
+        heap_peak = heap_now;
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p != nullptr)
+        heap_now -= malloc_usable_size(p);
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+struct Entry
+{
+    std::string name;
+    bool isDir;
+    uint32_t size;
+    time_t modified_time;
+};
+
+// Former layout: one fsdir_entry per entry, filtered and sorted by pointer
+class OldDirCache
+{
+public:
+    std::vector<fsdir_entry> entries;
+    std::vector<fsdir_entry *> filtered;
+
+    void apply_filter(const char *pattern, uint16_t diropts)
+    {
+        bool have_pattern = pattern != nullptr && pattern[0] != '\0';
+        filtered.clear();
+        for (fsdir_entry &entry : entries)
+        {
+            if (have_pattern && !entry.isDir && !util_wildcard_match(entry.filename, pattern))
+                continue;
+            filtered.push_back(&entry);
+        }
+        bool descend = diropts & DIR_OPTION_DESCENDING;
+        if (diropts & DIR_OPTION_FILEDATE)
+            std::sort(filtered.begin(), filtered.end(), [descend](const fsdir_entry *l, const fsdir_entry *r) {
+                if (l->isDir != r->isDir)
+                    return l->isDir;
+                return descend ? l->modified_time < r->modified_time : l->modified_time > r->modified_time;
+            });
+        else
+            std::sort(filtered.begin(), filtered.end(), [descend](const fsdir_entry *l, const fsdir_entry *r) {
+                if (l->isDir != r->isDir)
+                    return l->isDir;
+                int c = strcasecmp(l->filename, r->filename);
+                return descend ? c > 0 : c < 0;
+            });
+    }
+};
+
+static const char *extensions[] = {".atr", ".ATR", ".xex", ".car", ".cas", ".txt"};
+
+static std::vector<Entry> make_listing(int count)
+{
+    std::mt19937 rng(6);
+    std::vector<Entry> list;
+    for (int i = 0; i < count; i++)
+    {
+        Entry e;
+        // names sharing long prefixes, so the sort key alone can't order them
+        char name[64];
+        snprintf(name, sizeof(name), "%s %c%c Collection %05d%s",
+                 (rng() & 1) ? "Games" : "games", 'A' + (int)(rng() % 26), 'a' + (int)(rng() % 26),
+                 i, extensions[rng() % 6]);
+        e.isDir = rng() % 20 == 0;
+        e.name = e.isDir ? std::string(name, strlen(name) - 4) : name;
+        e.size = e.isDir ? 0 : rng() % 1000000;
+        e.modified_time = 1000000 + i * 7 + (rng() % 7) * 1000000; // unique
+        list.push_back(e);
+    }
+    return list;
+}
+
+static double ms_since(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+struct Listing
+{
+    const char *name;
+    const char *pattern;
+    uint16_t diropts;
+};
+
+static const Listing listings[] = {
+    {"name", "", 0},
+    {"name desc", "", DIR_OPTION_DESCENDING},
+    {"date", "", DIR_OPTION_FILEDATE},
+    {"*.atr by name", "*.atr", 0},
+};
+
+int main(int argc, char *argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 10000;
+    if (count <= 0 || count > 65535)
+        count = 10000;
+    std::vector<Entry> list = make_listing(count);
+    printf("%d entries, sizeof(fsdir_entry) %zu\n", count, sizeof(fsdir_entry));
+
+    // fill
+    size_t base = heap_now;
+    heap_peak = heap_now;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    DirCache cache;
+    for (const Entry &e : list)
+        cache.add_entry(e.name.c_str(), e.isDir, e.size, e.modified_time);
+    cache.apply_filter("", 0);
+    double fill_ms = ms_since(t0);
+    size_t peak = heap_peak - base;
+
+    base = heap_now;
+    heap_peak = heap_now;
+    t0 = std::chrono::steady_clock::now();
+    OldDirCache old;
+    for (const Entry &e : list)
+    {
+        old.entries.push_back(fsdir_entry());
+        fsdir_entry &d = old.entries.back();
+        strlcpy(d.filename, e.name.c_str(), sizeof(d.filename));
+        d.isDir = e.isDir;
+        d.size = e.size;
+        d.modified_time = e.modified_time;
+    }
+    old.apply_filter("", 0);
+    double old_fill_ms = ms_since(t0);
+    size_t old_peak = heap_peak - base;
+
+    printf("%-14s %9s %9s\n", "", "DirCache", "former");
+    printf("%-14s %6zu KB %6zu KB\n", "peak heap", peak / 1024, old_peak / 1024);
+    printf("%-14s %6.2f ms %6.2f ms\n", "fill", fill_ms, old_fill_ms);
+
+    int failures = 0;
+    for (const Listing &l : listings)
+    {
+        // filter, sort and read the whole listing, new pattern each time
+        double ms = 0, old_ms = 0;
+        std::vector<std::string> names, old_names;
+        for (int r = 0; r < REPEATS; r++)
+        {
+            names.clear();
+            old_names.clear();
+            cache.apply_filter("*.none", 0);
+            t0 = std::chrono::steady_clock::now();
+            cache.apply_filter(l.pattern, l.diropts);
+            fsdir_entry *d;
+            while ((d = cache.read()) != nullptr)
+                names.push_back(d->filename);
+            ms += ms_since(t0);
+
+            t0 = std::chrono::steady_clock::now();
+            old.apply_filter(l.pattern, l.diropts);
+            for (fsdir_entry *od : old.filtered)
+                old_names.push_back(od->filename);
+            old_ms += ms_since(t0);
+        }
+        printf("%-14s %6.2f ms %6.2f ms, %zu entries\n", l.name, ms / REPEATS, old_ms / REPEATS, names.size());
+        if (names != old_names)
+        {
+            fprintf(stderr, "%s: order differs from the former layout\n", l.name);
+            failures++;
+        }
+    }
+
+    // reopening the same listing only rewinds
+    cache.apply_filter("", 0);
+    t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < REPEATS; r++)
+        cache.apply_filter("", 0);
+    printf("%-14s %6.4f ms\n", "same again", ms_since(t0) / REPEATS);
+
+    return failures ? 1 : 0;
+}
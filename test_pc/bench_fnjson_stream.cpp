@@ -0,0 +1,181 @@
+/**
+ * #FujiNet host benchmark - FNJSON incremental parsing
+ *
+ * Feeds a generated JSON document of a few megabytes in TCP segment sized
+ * chunks, the way FNJSON::parse() gets it from the network protocol. Once
+ * collected whole and handed to cJSON_Parse(), as parse() used to, once
+ * through FNJSONStream and once through FNJSONStream with a parse filter.
+ * For each the peak heap use and the time from the last chunk to the
+ * queried value being readable are shown. That time is what a client
+ * waits after the response has arrived. The trees are checked against
+ * cJSON_Parse().
+ *
+ * Usage: bench_fnjson_stream [items]
+ */
+
+#include <malloc.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include <cJSON.h>
+#include <cJSON_Utils.h>
+
+#include "fnjsonstream.h"
+
+#define CHUNK_SIZE 1460
+#define QUERY "/items/1000/title"
+
+// Heap use of everything in this process, cJSON included through its hooks
+static size_t heap_now = 0;
+static size_t heap_peak = 0;
+
+static void *counted_malloc(size_t size)
+{
+    void *p = malloc(size);
+    if (p != nullptr)
+    {
+        heap_now += malloc_usable_size(p);
+        if (heap_now > heap_peak)
+            heap_peak = heap_now;
+    }
+    return p;
+}
+
+static void counted_free(void *p)
+{
+    if (p != nullptr)
+        heap_now -= malloc_usable_size(p);
+    free(p);
+}
+
+void *operator new(size_t size)
+{
+    void *p = counted_malloc(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete(void *p, size_t) noexcept { counted_free(p); }
+
+// A news feed like document
+static std::string make_document(int items)
+{
+    std::string doc = "{\"title\":\"feed\",\"count\":" + std::to_string(items) + ",\"items\":[";
+    for (int i = 0; i < items; i++)
+    {
+        if (i > 0)
+            doc += ",";
+        doc += "{\"id\":" + std::to_string(i) +
+               ",\"title\":\"Item number " + std::to_string(i) + " \\u00e9t\\u00e9\"" +
+               ",\"score\":" + std::to_string(i * 0.25) +
+               ",\"tags\":[\"atari\",\"fujinet\",null,true]" +
+               ",\"body\":\"Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor.\"}";
+    }
+    doc += "]}";
+    return doc;
+}
+
+struct Result
+{
+    cJSON *json;
+    size_t peak;
+    double total_ms;
+    double after_last_ms;
+};
+
+// Collect the whole text, then parse it
+static Result run_buffered(const std::string &doc)
+{
+    size_t base = heap_now;
+    heap_peak = heap_now;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    std::string text;
+    for (size_t pos = 0; pos < doc.size(); pos += CHUNK_SIZE)
+        text.append(doc, pos, CHUNK_SIZE);
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+    cJSON *json = cJSON_Parse(text.c_str());
+    cJSONUtils_GetPointer(json, QUERY);
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+    Result r;
+    r.peak = heap_peak - base;
+    r.json = json;
+    r.total_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    r.after_last_ms = std::chrono::duration<double, std::milli>(t1 - last).count();
+    return r;
+}
+
+// Parse chunk by chunk as it arrives
+static Result run_stream(const std::string &doc, const std::string &filter)
+{
+    size_t base = heap_now;
+    heap_peak = heap_now;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    FNJSONStream stream;
+    stream.begin(filter);
+    for (size_t pos = 0; pos < doc.size(); pos += CHUNK_SIZE)
+        stream.feed(doc.data() + pos, std::min<size_t>(CHUNK_SIZE, doc.size() - pos));
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+    cJSON *json = stream.finish();
+    cJSONUtils_GetPointer(json, QUERY);
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+
+    Result r;
+    r.peak = heap_peak - base;
+    r.json = json;
+    r.total_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    r.after_last_ms = std::chrono::duration<double, std::milli>(t1 - last).count();
+    return r;
+}
+
+static void show(const char *name, const Result &r)
+{
+    printf("%-16s peak heap %7zu KB, %7.2f ms total, %7.3f ms after last chunk\n",
+           name, r.peak / 1024, r.total_ms, r.after_last_ms);
+}
+
+int main(int argc, char *argv[])
+{
+    int items = argc > 1 ? atoi(argv[1]) : 20000;
+    if (items <= 1000)
+        items = 1001; // QUERY must resolve
+
+    cJSON_Hooks hooks = {counted_malloc, counted_free};
+    cJSON_InitHooks(&hooks);
+
+    std::string doc = make_document(items);
+    printf("%zu byte document, %d items, %d byte chunks, query %s\n", doc.size(), items, CHUNK_SIZE, QUERY);
+
+    int failures = 0;
+    Result buffered = run_buffered(doc);
+    show("buffered", buffered);
+
+    Result stream = run_stream(doc, "");
+    show("stream", stream);
+    if (!cJSON_Compare(stream.json, buffered.json, true))
+    {
+        fprintf(stderr, "streamed tree differs from cJSON_Parse()\n");
+        failures++;
+    }
+
+    Result filtered = run_stream(doc, QUERY);
+    show("stream filtered", filtered);
+    if (!cJSON_Compare(cJSONUtils_GetPointer(filtered.json, QUERY), cJSONUtils_GetPointer(buffered.json, QUERY), true))
+    {
+        fprintf(stderr, "filtered tree doesn't hold the queried value\n");
+        failures++;
+    }
+
+    cJSON_Delete(buffered.json);
+    cJSON_Delete(stream.json);
+    cJSON_Delete(filtered.json);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+/**
+ * #FujiNet host benchmark - HTTP keep-alive connection pool
+ *
+ * Sends small GETs to a local mongoose server running in a child process,
+ * each from a new client, the way an 8-bit app polls a JSON endpoint
+ * through the N: device. With the pool off the server closes every
+ * connection, as when the client asked for Connection: close, so each
+ * request pays for a new connection. With the pool on the server keeps
+ * them open and the next client takes the parked one. Shows requests/s,
+ * p50/p99 latency and the number of connections the server accepted.
+ * Idle connections must be closed by pool_service() once they expire.
+ *
+ * Usage: bench_http_pool [requests]
+ */
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mgHttpClient.h"
+
+#define BODY "{\"temp\":21.5,\"status\":\"ok\"}"
+
+using bench_clock = std::chrono::steady_clock;
+
+// Server counters, shared with the child process
+struct server_stats
+{
+    volatile int accepted;
+    volatile int open;
+};
+
+static server_stats *stats;
+
+// Runs in the child process only
+static void server_handler(mg_connection *c, int ev, void *ev_data)
+{
+    if (ev == MG_EV_ACCEPT)
+    {
+        stats->accepted++;
+        stats->open++;
+        return;
+    }
+    if (ev == MG_EV_CLOSE && c->is_accepted)
+    {
+        stats->open--;
+        return;
+    }
+    if (ev != MG_EV_HTTP_MSG)
+        return;
+
+    mg_http_message *hm = (mg_http_message *)ev_data;
+    bool close = mg_http_match_uri(hm, "/close");
+    mg_printf(c, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %d\r\n%s\r\n%s",
+              (int)strlen(BODY), close ? "Connection: close\r\n" : "", BODY);
+    if (close)
+        c->is_draining = 1;
+    c->is_resp = 0; // response done, take the next request on this connection
+}
+
+// A new client per request, returns false on error or a wrong body
+static bool get(const std::string &url)
+{
+    mgHttpClient client;
+    if (!client.begin(url) || client.GET() != 200)
+        return false;
+
+    char buf[64];
+    int total = 0;
+    while (!client.is_transaction_done() || client.available() > 0)
+    {
+        int avail = client.available();
+        if (avail <= 0)
+            continue;
+        int n = client.read((uint8_t *)buf + total, std::min(avail, (int)sizeof(buf) - total));
+        if (n <= 0)
+            break;
+        total += n;
+    }
+    client.close();
+    return total == (int)strlen(BODY) && memcmp(buf, BODY, total) == 0;
+}
+
+// Returns the number of failed requests
+static int run(const char *name, const std::string &url, int requests)
+{
+    int accepted = stats->accepted;
+    std::vector<double> us;
+    us.reserve(requests);
+    int errors = 0;
+
+    bench_clock::time_point start = bench_clock::now();
+    for (int i = 0; i < requests; i++)
+    {
+        bench_clock::time_point t0 = bench_clock::now();
+        if (!get(url))
+            errors++;
+        us.push_back(std::chrono::duration<double, std::micro>(bench_clock::now() - t0).count());
+    }
+    double s = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+    std::sort(us.begin(), us.end());
+    printf("pool %-4s %8.0f req/s, p50 %7.0f us, p99 %7.0f us, %d connections\n", name, requests / s,
+           us[us.size() / 2], us[us.size() * 99 / 100], stats->accepted - accepted);
+    if (errors)
+        fprintf(stderr, "pool %s: %d requests failed\n", name, errors);
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    int requests = argc > 1 ? atoi(argv[1]) : 3000;
+    if (requests < 1)
+        requests = 1;
+
+    stats = (server_stats *)mmap(nullptr, sizeof(server_stats), PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (stats == MAP_FAILED)
+    {
+        fprintf(stderr, "mmap failed\n");
+        return 1;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    // Listen before forking so the client knows the port, see bench_http_stream
+    mg_mgr mgr;
+    mg_mgr_init(&mgr);
+    mg_connection *listener = mg_http_listen(&mgr, "http://127.0.0.1:0", server_handler, nullptr);
+    if (listener == nullptr)
+    {
+        fprintf(stderr, "failed to start HTTP server\n");
+        return 1;
+    }
+    int port = mg_ntohs(listener->loc.port);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        for (;;)
+            mg_mgr_poll(&mgr, 50);
+    }
+    if (pid < 0)
+    {
+        fprintf(stderr, "fork failed\n");
+        return 1;
+    }
+
+    std::string base = "http://127.0.0.1:" + std::to_string(port);
+    printf("%d GETs of a %d byte body, a new client for each\n", requests, (int)strlen(BODY));
+
+    int failures = run("off", base + "/close", requests);
+    failures += run("on", base + "/keep", requests);
+
+    // The parked connection goes once it has been idle too long
+    usleep((HTTP_CLIENT_POOL_IDLE + 200) * 1000);
+    mgHttpClient::pool_service();
+    for (int i = 0; i < 40 && stats->open > 0; i++)
+        usleep(50 * 1000);
+    if (stats->open != 0)
+    {
+        fprintf(stderr, "%d idle connections still open after %d ms\n", stats->open, HTTP_CLIENT_POOL_IDLE);
+        failures++;
+    }
+
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    return failures ? 1 : 0;
+}
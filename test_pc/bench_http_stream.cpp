@@ -0,0 +1,174 @@
+/**
+ * #FujiNet host benchmark - HTTP response body streaming
+ *
+ * Downloads a 50 MB body in 128 byte reads, the way the Atari side pulls
+ * a file through the network device, from a local mongoose server running
+ * in a child process. Once with Content-Length and once chunked in 64 KB
+ * chunks, so chunks are bigger than the client's body buffer. The data is
+ * checked against the served pattern and the client's peak RSS is shown,
+ * which must stay bounded however large the body is.
+ *
+ * Usage: bench_http_stream [megabytes]
+ */
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mgHttpClient.h"
+
+#define READ_SIZE 128
+#define CHUNK_SIZE 65536
+
+static size_t body_size = 50u * 1024 * 1024;
+
+static uint8_t pattern(size_t i)
+{
+    return (uint8_t)((i * 2654435761u) >> 13);
+}
+
+// Runs in the child process only
+static void server_handler(mg_connection *c, int ev, void *ev_data)
+{
+    if (ev != MG_EV_HTTP_MSG)
+        return;
+
+    // Built once and queued with a single mg_send(), growing the send
+    // buffer chunk by chunk would take longer than the download
+    static std::vector<uint8_t> body;
+    static std::string chunked;
+    if (body.empty())
+    {
+        body.resize(body_size);
+        for (size_t i = 0; i < body_size; i++)
+            body[i] = pattern(i);
+
+        char line[16];
+        for (size_t pos = 0; pos < body_size; pos += CHUNK_SIZE)
+        {
+            size_t len = std::min<size_t>(CHUNK_SIZE, body_size - pos);
+            snprintf(line, sizeof(line), "%zx\r\n", len);
+            chunked += line;
+            chunked.append((const char *)&body[pos], len);
+            chunked += "\r\n";
+        }
+        chunked += "0\r\n\r\n";
+    }
+
+    mg_http_message *hm = (mg_http_message *)ev_data;
+    if (mg_http_match_uri(hm, "/chunked"))
+    {
+        mg_printf(c, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
+        mg_send(c, chunked.data(), chunked.size());
+    }
+    else
+    {
+        mg_printf(c, "HTTP/1.1 200 OK\r\nContent-Length: %lu\r\n\r\n", (unsigned long)body_size);
+        mg_send(c, body.data(), body_size);
+    }
+    c->is_resp = 0; // response done, take the next request on this connection
+}
+
+// Download url, return MB/s or -1 on error/mismatch
+static double fetch(const std::string &url)
+{
+    mgHttpClient client;
+    if (!client.begin(url))
+    {
+        fprintf(stderr, "begin failed\n");
+        return -1;
+    }
+
+    int status = client.GET();
+    if (status != 200)
+    {
+        fprintf(stderr, "GET %s returned %d\n", url.c_str(), status);
+        return -1;
+    }
+
+    uint8_t buf[READ_SIZE];
+    size_t total = 0;
+    bool ok = true;
+    auto t0 = std::chrono::steady_clock::now();
+    while (!client.is_transaction_done() || client.available() > 0)
+    {
+        int avail = client.available();
+        if (avail <= 0)
+            continue;
+        int n = client.read(buf, std::min(avail, READ_SIZE));
+        if (n <= 0)
+            break;
+        for (int i = 0; i < n; i++)
+            ok &= buf[i] == pattern(total + i);
+        total += n;
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    client.close();
+
+    if (!ok || total != body_size)
+    {
+        fprintf(stderr, "%s: got %zu of %zu bytes%s\n", url.c_str(), total, body_size, ok ? "" : ", data wrong");
+        return -1;
+    }
+    return total / s / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+        body_size = (size_t)atoi(argv[1]) * 1024 * 1024;
+
+    // Listen before forking so the client knows the port. The manager is
+    // left to the child from then on, freeing it here would also take the
+    // listener out of the epoll set both processes share.
+    mg_mgr mgr;
+    mg_mgr_init(&mgr);
+    mg_connection *listener = mg_http_listen(&mgr, "http://127.0.0.1:0", server_handler, nullptr);
+    if (listener == nullptr)
+    {
+        fprintf(stderr, "failed to start HTTP server\n");
+        return 1;
+    }
+    int port = mg_ntohs(listener->loc.port);
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        for (;;)
+            mg_mgr_poll(&mgr, 50);
+    }
+    if (pid < 0)
+    {
+        fprintf(stderr, "fork failed\n");
+        return 1;
+    }
+
+    printf("%zu byte body in %d byte reads, body buffer %d bytes\n", body_size, READ_SIZE, HTTP_CLIENT_BODY_BUFFER);
+
+    int failures = 0;
+    const char *paths[] = {"/plain", "/chunked"};
+    for (const char *path : paths)
+    {
+        double mbs = fetch("http://127.0.0.1:" + std::to_string(port) + path);
+        if (mbs < 0)
+        {
+            failures++;
+            continue;
+        }
+        rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        printf("%-9s %8.1f MB/s, peak RSS %ld KB\n", path, mbs, ru.ru_maxrss);
+    }
+
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    return failures ? 1 : 0;
+}
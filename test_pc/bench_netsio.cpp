@@ -0,0 +1,220 @@
+/**
+ * #FujiNet host benchmark - NetSIO responses to the computer
+ *
+ * Sends SIO sector responses (status byte, 128 byte data frame, checksum)
+ * to a local NetSIO hub stand-in over UDP. The hub gives one message of
+ * flow control credit back a fixed time after each message, like an
+ * emulator taking the data from its receive queue. The responses are sent
+ * once with three writes, as bus_to_computer() used to, and once with
+ * writev(). Datagrams per response and time per response are shown and the
+ * bytes the hub got are checked against what was sent.
+ *
+ * Usage: bench_netsio [latency_us]
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "fnWiFi.h"
+#include "netsio.h"
+#include "netsio_proto.h"
+
+#define RESPONSES 200
+#define FRAME_SIZE 128
+
+// Answers pings and alive requests, collects data and hands out credit
+class NetSioHubStandIn
+{
+public:
+    int latency_us = 1000;
+    std::atomic<int> datagrams{0};
+    std::vector<uint8_t> received;
+    std::mutex received_mutex;
+    int port = 0;
+
+    bool start()
+    {
+        _sock = socket(AF_INET, SOCK_DGRAM, 0);
+        if (_sock < 0)
+            return false;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(_sock, (sockaddr *)&addr, sizeof(addr)) < 0)
+            return false;
+        socklen_t len = sizeof(addr);
+        getsockname(_sock, (sockaddr *)&addr, &len);
+        port = ntohs(addr.sin_port);
+        timeval tv{0, 100000};
+        setsockopt(_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        _thread = std::thread([this] { _loop(); });
+        return true;
+    }
+
+    ~NetSioHubStandIn()
+    {
+        _stop = true;
+        if (_thread.joinable())
+            _thread.join();
+        if (_sock >= 0)
+            close(_sock);
+    }
+
+private:
+    int _sock = -1;
+    std::thread _thread;
+    std::atomic<bool> _stop{false};
+
+    void _take(const uint8_t *data, int len)
+    {
+        datagrams++;
+        std::lock_guard<std::mutex> lock(received_mutex);
+        received.insert(received.end(), data, data + len);
+    }
+
+    void _loop()
+    {
+        uint8_t buf[600];
+        sockaddr_in peer{};
+        while (!_stop)
+        {
+            socklen_t len = sizeof(peer);
+            int n = recvfrom(_sock, buf, sizeof(buf), 0, (sockaddr *)&peer, &len);
+            if (n <= 0)
+                continue;
+
+            uint8_t reply[2];
+            int reply_len = 0;
+            switch (buf[0])
+            {
+            case NETSIO_PING_REQUEST:
+                reply[0] = NETSIO_PING_RESPONSE;
+                reply_len = 1;
+                break;
+            case NETSIO_ALIVE_REQUEST:
+                reply[0] = NETSIO_ALIVE_RESPONSE;
+                reply_len = 1;
+                break;
+            case NETSIO_DEVICE_CONNECT:
+                // room for one message at a time
+                reply[0] = NETSIO_CREDIT_UPDATE;
+                reply[1] = 1;
+                reply_len = 2;
+                break;
+            case NETSIO_DATA_BYTE:
+            case NETSIO_DATA_BLOCK:
+                _take(buf + 1, buf[0] == NETSIO_DATA_BYTE ? 1 : n - 1);
+                std::this_thread::sleep_for(std::chrono::microseconds(latency_us));
+                reply[0] = NETSIO_CREDIT_UPDATE;
+                reply[1] = 1;
+                reply_len = 2;
+                break;
+            default:
+                break;
+            }
+            if (reply_len > 0)
+                sendto(_sock, reply, reply_len, 0, (sockaddr *)&peer, len);
+        }
+    }
+};
+
+static NetSioHubStandIn hub;
+
+static uint8_t checksum(const uint8_t *buf, int len)
+{
+    unsigned sum = 0;
+    for (int i = 0; i < len; i++)
+        sum = ((sum + buf[i]) >> 8) + ((sum + buf[i]) & 0xff);
+    return sum;
+}
+
+// Send the responses, return us per response or -1 if the hub got other data
+static double send_responses(NetSioPort &port, bool gather, double *datagrams)
+{
+    std::vector<uint8_t> expected;
+    {
+        std::lock_guard<std::mutex> lock(hub.received_mutex);
+        hub.received.clear();
+    }
+    hub.datagrams = 0;
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < RESPONSES; r++)
+    {
+        uint8_t frame[FRAME_SIZE];
+        for (int i = 0; i < FRAME_SIZE; i++)
+            frame[i] = r + i;
+        uint8_t status = 'C';
+        uint8_t ck = checksum(frame, FRAME_SIZE);
+
+        if (gather)
+        {
+            SioIoVec iov[] = {{&status, 1}, {frame, FRAME_SIZE}, {&ck, 1}};
+            port.writev(iov, 3);
+        }
+        else
+        {
+            port.write(status);
+            port.write(frame, FRAME_SIZE);
+            port.write(ck);
+        }
+        expected.push_back(status);
+        expected.insert(expected.end(), frame, frame + FRAME_SIZE);
+        expected.push_back(ck);
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+
+    // last message is still with the hub
+    std::this_thread::sleep_for(std::chrono::microseconds(hub.latency_us + 50000));
+    *datagrams = (double)hub.datagrams / RESPONSES;
+    std::lock_guard<std::mutex> lock(hub.received_mutex);
+    return hub.received == expected ? us / RESPONSES : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+        hub.latency_us = atoi(argv[1]);
+    if (!hub.start())
+    {
+        fprintf(stderr, "failed to start NetSIO hub stand-in\n");
+        return 1;
+    }
+
+    fnWiFi.connect("bench", "");
+    NetSioPort port;
+    port.set_host("127.0.0.1", hub.port);
+    port.begin(SIOPORT_DEFAULT_BAUD);
+    port.poll(100); // take the credit given on connect
+
+    printf("%d responses of %d bytes + status + checksum, credit back after %d us\n",
+           RESPONSES, FRAME_SIZE, hub.latency_us);
+
+    int failures = 0;
+    const char *names[] = {"three writes", "writev"};
+    for (int gather = 0; gather < 2; gather++)
+    {
+        double datagrams;
+        double us = send_responses(port, gather, &datagrams);
+        if (us < 0)
+        {
+            fprintf(stderr, "%s: hub got wrong data\n", names[gather]);
+            failures++;
+            continue;
+        }
+        printf("%-13s %4.1f datagrams, %8.1f us per response\n", names[gather], datagrams, us);
+    }
+
+    port.end();
+    return failures ? 1 : 0;
+}
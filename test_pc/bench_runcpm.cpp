@@ -0,0 +1,248 @@
+/**
+ * #FujiNet host benchmark - RunCPM Z80 interpreter
+ *
+ * Runs a checksum loop (CALL/RET, 8 and 16 bit loads, ALU ops, conditional
+ * relative jumps) on the emulated Z80 and reports the speed as the clock
+ * of a real Z80 needing the same number of T-states. The checksum the
+ * program leaves in DE is checked against the one computed here.
+ *
+ * Then copies a file record by record the way PIP does, BDOS sequential
+ * reads of the source and writes of the destination, once through the
+ * open file cache and once opening, seeking and closing the host file for
+ * every record as the abstraction used to. The copies are checked against
+ * the source, which is made read only first.
+ *
+ * Usage: bench_runcpm [passes] [copy_kb]
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../lib/runcpm/globals.h"
+
+static char full_filename[128];
+
+static char *full_path(char *fn)
+{
+    snprintf(full_filename, sizeof(full_filename), "/CPM/%s", fn);
+    return full_filename;
+}
+
+#include "../lib/runcpm/abstraction_cache.h"
+
+// Only the BIOS call (OUT 0FFh) does anything, it ends the run
+static void _HardwareOut(const uint32 Port, const uint32 Value) {}
+static uint32 _HardwareIn(const uint32 Port) { return 0xFF; }
+
+#include "../lib/runcpm/cpu.h"
+
+void _Bios(void) { Status = 1; }
+void _Bdos(void) {}
+
+#define PROGRAM_ORG 0x0100
+#define DATA_ORG 0x1000
+#define DATA_SIZE 0x0800
+#define COUNTER 0x0080
+
+static const uint8 program[] = {
+    0x31, 0x00, 0xF0, //        ld   sp,0F000h
+    0x11, 0x00, 0x00, //        ld   de,0
+    0x3E, 0x00,       //        ld   a,passes
+    0x32, 0x80, 0x00, //        ld   (COUNTER),a
+    0x21, 0x00, 0x10, // outer: ld   hl,DATA_ORG
+    0x01, 0x00, 0x08, //        ld   bc,DATA_SIZE
+    0xCD, 0x26, 0x01, // inner: call step
+    0x0B,             //        dec  bc
+    0x78,             //        ld   a,b
+    0xB1,             //        or   c
+    0x20, 0xF8,       //        jr   nz,inner
+    0x3A, 0x80, 0x00, //        ld   a,(COUNTER)
+    0x3D,             //        dec  a
+    0x32, 0x80, 0x00, //        ld   (COUNTER),a
+    0x20, 0xE9,       //        jr   nz,outer
+    0xD3, 0xFF,       //        out  (0FFh),a
+    0x76,             //        halt
+    0x00,             //        nop
+    0x7E,             // step:  ld   a,(hl)
+    0x83,             //        add  a,e
+    0x5F,             //        ld   e,a
+    0x7A,             //        ld   a,d
+    0xCE, 0x00,       //        adc  a,0
+    0x57,             //        ld   d,a
+    0x23,             //        inc  hl
+    0xC9,             //        ret
+};
+#define PASSES_OFFSET 7
+
+// T-states of one inner loop iteration: call, step, dec/ld/or, taken jr
+#define INNER_T (17 + 46 + 6 + 4 + 4 + 12)
+// ld hl, ld bc, ld a,(nn), dec a, ld (nn),a, taken jr
+#define OUTER_T (10 + 10 + 13 + 4 + 13 + 12)
+// ld sp, ld de, ld a,n, ld (nn),a, out
+#define SETUP_T (10 + 10 + 7 + 13 + 11)
+
+#define SRC_NAME "A/0/SRC.DAT"
+#define DST_NAME "A/0/DST.DAT"
+
+// Former BDOS record read and write, one host file open per record
+static uint8_t former_readseq(const char *fn, long fpos)
+{
+    FILE *f = fnSDFAT.file_open(full_path((char *)fn), "r");
+    if (f == nullptr)
+        return 0x10;
+    bool ok = fseek(f, fpos, SEEK_SET) == 0 && fread(_RamSysAddr(dmaAddr), BlkSZ, 1, f) == 1;
+    fclose(f);
+    return ok ? 0x00 : 0x01;
+}
+
+static uint8_t former_writeseq(const char *fn, long fpos)
+{
+    FILE *f = fnSDFAT.file_open(full_path((char *)fn), "r+");
+    if (f == nullptr)
+        f = fnSDFAT.file_open(full_path((char *)fn), "w+");
+    if (f == nullptr)
+        return 0x10;
+    bool ok = fseek(f, fpos, SEEK_SET) == 0 && fwrite(_RamSysAddr(dmaAddr), BlkSZ, 1, f) == 1;
+    fclose(f);
+    return ok ? 0x00 : 0xff;
+}
+
+static std::vector<char> file_data(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// PIP A:DST.DAT=A:SRC.DAT, returns ms or -1 on a BDOS error
+static double pip_copy(long records, bool cached)
+{
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (long r = 0; r < records; r++)
+    {
+        long fpos = r * BlkSZ;
+        uint8_t result = cached ? _sys_readseq((uint8_t *)SRC_NAME, fpos) : former_readseq(SRC_NAME, fpos);
+        if (result != 0x00)
+            return -1;
+        result = cached ? _sys_writeseq((uint8_t *)DST_NAME, fpos) : former_writeseq(DST_NAME, fpos);
+        if (result != 0x00)
+            return -1;
+    }
+    if (cached && (!_sys_cache_close((uint8_t *)SRC_NAME) || !_sys_cache_close((uint8_t *)DST_NAME)))
+        return -1;
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static int bench_copy(int copy_kb)
+{
+    char sd_dir[] = "/tmp/fujinet_cpmXXXXXX";
+    if (mkdtemp(sd_dir) == nullptr || !fnSDFAT.start(sd_dir))
+    {
+        fprintf(stderr, "failed to set up SD directory\n");
+        return 1;
+    }
+    std::string dir = std::string(sd_dir) + "/CPM/A/0/";
+    std::filesystem::create_directories(dir);
+
+    std::vector<char> src(copy_kb * 1024);
+    std::mt19937 rng(11);
+    for (char &b : src)
+        b = rng();
+    {
+        std::ofstream out(dir + "SRC.DAT", std::ios::binary);
+        out.write(src.data(), src.size());
+    }
+    // CP/M disks copied to an SD card often come read only
+    chmod((dir + "SRC.DAT").c_str(), 0444);
+    long records = src.size() / BlkSZ;
+
+    int failures = 0;
+    const char *names[] = {"open per record", "file cache"};
+    for (int cached = 0; cached < 2; cached++)
+    {
+        std::filesystem::remove(dir + "DST.DAT");
+        double ms = pip_copy(records, cached);
+        if (ms < 0 || file_data(dir + "DST.DAT") != src)
+        {
+            fprintf(stderr, "%s: copy failed or differs from source\n", names[cached]);
+            failures++;
+            continue;
+        }
+        printf("PIP %d KB, %-15s %8.2f ms, %7.0f KB/s\n", copy_kb, names[cached], ms, copy_kb / (ms / 1000));
+    }
+
+    // writing to the read only source must fail, unless running as root
+    if (access((dir + "SRC.DAT").c_str(), W_OK) != 0 && _sys_writeseq((uint8_t *)SRC_NAME, 0) == 0x00)
+    {
+        fprintf(stderr, "write to read only file succeeded\n");
+        failures++;
+    }
+    _sys_cache_closeall();
+
+    std::filesystem::remove_all(sd_dir);
+    return failures;
+}
+
+int main(int argc, char *argv[])
+{
+    int passes = argc > 1 ? atoi(argv[1]) : 100;
+    if (passes < 1 || passes > 255)
+    {
+        fprintf(stderr, "passes must be 1-255\n");
+        return 1;
+    }
+    int copy_kb = argc > 2 ? atoi(argv[2]) : 256;
+    if (copy_kb < 1)
+        copy_kb = 256;
+
+    RAM = (uint8 *)calloc(MEMSIZE, 1);
+    memcpy(RAM + PROGRAM_ORG, program, sizeof(program));
+    RAM[PROGRAM_ORG + PASSES_OFFSET] = passes;
+    uint32 sum = 0;
+    for (int i = 0; i < DATA_SIZE; i++)
+    {
+        RAM[DATA_ORG + i] = (uint8)((i * 2654435761u) >> 13);
+        sum += RAM[DATA_ORG + i];
+    }
+    uint16 expected = (uint16)(sum * passes);
+
+    // Both relative jumps fall through once per loop
+    double tstates = SETUP_T + (double)passes * ((double)DATA_SIZE * INNER_T - 5 + OUTER_T) - 5;
+
+    double best = 0;
+    int failures = 0;
+    for (int run = 0; run < 5; run++)
+    {
+        RAM[COUNTER] = 0;
+        Z80reset();
+        PC = PROGRAM_ORG;
+        auto t0 = std::chrono::steady_clock::now();
+        Z80run();
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if ((uint16)DE != expected || PC != PROGRAM_ORG + 0x24)
+        {
+            fprintf(stderr, "run %d: DE %04X PC %04X, expected DE %04X PC %04X\n",
+                    run, DE & 0xFFFF, PC & 0xFFFF, expected, PROGRAM_ORG + 0x24);
+            failures++;
+            continue;
+        }
+        double mhz = tstates / s / 1e6;
+        if (mhz > best)
+            best = mhz;
+    }
+
+    printf("%d passes, %.0f T-states: %.1f emulated MHz\n", passes, tstates, best);
+    failures += bench_copy(copy_kb);
+    free(RAM);
+    return failures ? 1 : 0;
+}
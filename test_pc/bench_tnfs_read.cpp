@@ -0,0 +1,129 @@
+/**
+ * #FujiNet host benchmark - TNFS sequential reads
+ *
+ * Reads a disk image sized file in Atari sector sized pieces from a local
+ * TNFS-over-TCP stand-in with a fixed response latency, once with
+ * stop-and-wait READs and once per read-ahead window. The data is checked
+ * against the served file; a final pass makes the stand-in answer two READs
+ * out of order and checks the client notices and falls back.
+ *
+ * Usage: bench_tnfs_read [latency_us]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "tnfslib.h"
+#include "tnfslibBlockCache.h"
+#include "tnfs_standin.h"
+
+#define FILE_NAME "/image.atr"
+#define FILE_SIZE (180 * 1024)
+#define SECTOR_SIZE 128
+
+static TnfsStandIn server;
+
+// Read the whole file, return ms taken or -1 on error/mismatch
+static double read_file(uint8_t window, bool swap, bool *fell_back)
+{
+    tnfsMountInfo m_info("127.0.0.1", server.port);
+    m_info.readahead_window = window;
+    if (tnfs_mount(&m_info) != TNFS_RESULT_SUCCESS)
+    {
+        fprintf(stderr, "mount failed\n");
+        return -1;
+    }
+
+    int16_t fh;
+    if (tnfs_open(&m_info, FILE_NAME, TNFS_OPENMODE_READ, 0, &fh) != TNFS_RESULT_SUCCESS)
+    {
+        fprintf(stderr, "open failed\n");
+        tnfs_umount(&m_info);
+        return -1;
+    }
+
+    const std::vector<uint8_t> &ref = server.files[FILE_NAME];
+    uint8_t buf[SECTOR_SIZE];
+    long pos = 0;
+    bool ok = true;
+    auto t0 = std::chrono::steady_clock::now();
+    while (pos < FILE_SIZE)
+    {
+        // Disturb a fill in the middle of the file
+        if (swap && pos == FILE_SIZE / 2)
+            server.swap_reads = true;
+
+        uint16_t got = 0;
+        int result = tnfs_read(&m_info, fh, buf, SECTOR_SIZE, &got);
+        if (result != TNFS_RESULT_SUCCESS || got != SECTOR_SIZE || memcmp(buf, ref.data() + pos, got) != 0)
+        {
+            fprintf(stderr, "read at %ld failed: result %d, got %u\n", pos, result, got);
+            ok = false;
+            break;
+        }
+        pos += got;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    if (fell_back != nullptr)
+        *fell_back = m_info.readahead_disabled;
+    tnfs_close(&m_info, fh);
+    tnfs_umount(&m_info);
+    return ok ? ms : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+        server.latency_us = atoi(argv[1]);
+
+    std::vector<uint8_t> &data = server.files[FILE_NAME];
+    data.resize(FILE_SIZE);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = (uint8_t)((i * 2654435761u) >> 13);
+
+    if (!server.start())
+    {
+        fprintf(stderr, "failed to start TNFS stand-in\n");
+        return 1;
+    }
+
+    // Measure the network path only
+    tnfs_block_cache.set_budget(0);
+
+    printf("%d byte file in %d byte reads, %d us response latency\n", FILE_SIZE, SECTOR_SIZE, server.latency_us);
+
+    int failures = 0;
+    double serial = 0;
+    const uint8_t windows[] = {1, 2, 4, 8};
+    for (uint8_t window : windows)
+    {
+        server.reads = 0;
+        double ms = read_file(window, false, nullptr);
+        if (ms < 0)
+        {
+            failures++;
+            continue;
+        }
+        if (window == 1)
+            serial = ms;
+        printf("window %2u: %8.1f ms, %5d READs, %.2fx\n", window, ms, server.reads.load(), serial / ms);
+    }
+
+    bool fell_back = false;
+    server.seeks = 0;
+    double ms = read_file(TNFS_READAHEAD_WINDOW, true, &fell_back);
+    if (ms < 0 || !fell_back || server.seeks == 0)
+    {
+        fprintf(stderr, "out of order READ responses were not detected\n");
+        failures++;
+    }
+    else
+    {
+        printf("out of order responses: detected, data intact, %d LSEEK\n", server.seeks.load());
+    }
+
+    return failures ? 1 : 0;
+}
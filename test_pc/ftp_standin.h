@@ -0,0 +1,272 @@
+/**
+ * #FujiNet host tests - FTP server stand-in
+ *
+ * Minimal FTP server serving files from memory over EPSV data connections,
+ * with the commands the FTP file system uses. Data is sent at a fixed rate
+ * and the server can be told to drop data connections part way, refuse
+ * REST or close idle control connections, to exercise the client's
+ * recovery paths.
+ */
+
+#ifndef FTP_STANDIN_H
+#define FTP_STANDIN_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+class FtpStandIn
+{
+public:
+    std::map<std::string, std::vector<uint8_t>> files;
+    int reply_delay_ms = 2;          // added before each control connection reply
+    int data_rate_kbs = 1000;        // data connection speed in KB/s
+    int drop_after = -1;             // close the data connection after this many bytes ...
+    std::atomic<int> drops_left{0};  // ... for this many transfers
+    int idle_close_ms = -1;          // close the control connection when idle this long
+    bool support_rest = true;
+
+    std::atomic<long> bytes_sent{0};
+    std::atomic<int> retrs{0};
+    std::atomic<int> rests{0};
+    std::atomic<int> logins{0};
+    int port = 0;
+
+    bool start()
+    {
+        _listen = _listen_any(&port, 8);
+        if (_listen < 0)
+            return false;
+        std::thread([this] { _accept_loop(); }).detach();
+        return true;
+    }
+
+private:
+    int _listen = -1;
+
+    // Listening socket on a free loopback port
+    static int _listen_any(int *port, int backlog)
+    {
+        int s = socket(AF_INET, SOCK_STREAM, 0);
+        if (s < 0)
+            return -1;
+        int one = 1;
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(s, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(s, backlog) < 0)
+        {
+            close(s);
+            return -1;
+        }
+        socklen_t len = sizeof(addr);
+        getsockname(s, (sockaddr *)&addr, &len);
+        *port = ntohs(addr.sin_port);
+        return s;
+    }
+
+    void _accept_loop()
+    {
+        while (true)
+        {
+            int s = accept(_listen, nullptr, nullptr);
+            if (s < 0)
+                return;
+            std::thread([this, s] { _session(s); }).detach();
+        }
+    }
+
+    void _reply(int sock, const std::string &msg)
+    {
+        if (reply_delay_ms > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(reply_delay_ms));
+        std::string line = msg + "\r\n";
+        send(sock, line.data(), line.size(), MSG_NOSIGNAL);
+    }
+
+    // Read one command line, false once the connection is closed or idle too long
+    bool _read_line(int sock, std::string &buf, std::string *line)
+    {
+        int ms = idle_close_ms > 0 ? idle_close_ms : 0;
+        timeval tv{ms / 1000, (ms % 1000) * 1000};
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        size_t eol;
+        while ((eol = buf.find("\r\n")) == std::string::npos)
+        {
+            char tmp[512];
+            int n = recv(sock, tmp, sizeof(tmp), 0);
+            if (n <= 0)
+                return false;
+            buf.append(tmp, n);
+        }
+        *line = buf.substr(0, eol);
+        buf.erase(0, eol + 2);
+        return true;
+    }
+
+    // Send data[start..] on the data connection, at most limit bytes if >= 0
+    bool _send_data(int data_sock, const std::vector<uint8_t> &data, long start, long limit, const std::atomic<bool> &stop)
+    {
+        long pos = start;
+        long sent = 0;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        while (pos < (long)data.size())
+        {
+            if (stop)
+                return false;
+            long n = std::min<long>(4096, data.size() - pos);
+            if (limit >= 0 && sent + n > limit)
+                n = limit - sent;
+            if (n <= 0)
+                return false;
+            int w = send(data_sock, data.data() + pos, n, MSG_NOSIGNAL);
+            if (w <= 0)
+                return false;
+            pos += w;
+            sent += w;
+            bytes_sent += w;
+            std::this_thread::sleep_until(t0 + std::chrono::microseconds(sent * 1000 / data_rate_kbs));
+        }
+        return true;
+    }
+
+    void _session(int sock)
+    {
+        int one = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        _reply(sock, "220 stand-in ready");
+
+        std::string buf;
+        std::string line;
+        int pasv = -1;
+        long rest = 0;
+        std::thread xfer;
+        std::atomic<bool> xfer_stop{false};
+        std::atomic<bool> xfer_busy{false};
+
+        while (_read_line(sock, buf, &line))
+        {
+            size_t sp = line.find(' ');
+            std::string cmd = line.substr(0, sp);
+            std::string arg = sp == std::string::npos ? "" : line.substr(sp + 1);
+            std::map<std::string, std::vector<uint8_t>>::iterator file = files.find(arg);
+
+            if (cmd == "USER")
+                _reply(sock, "331 password please");
+            else if (cmd == "PASS")
+            {
+                logins++;
+                _reply(sock, "230 logged in");
+            }
+            else if (cmd == "TYPE" || cmd == "NOOP")
+                _reply(sock, "200 ok");
+            else if (cmd == "QUIT")
+            {
+                _reply(sock, "221 bye");
+                break;
+            }
+            else if (cmd == "SIZE")
+            {
+                if (file == files.end())
+                    _reply(sock, "550 no such file");
+                else
+                    _reply(sock, "213 " + std::to_string(file->second.size()));
+            }
+            else if (cmd == "MDTM")
+            {
+                if (file == files.end())
+                    _reply(sock, "550 no such file");
+                else
+                    _reply(sock, "213 20240102030405");
+            }
+            else if (cmd == "EPSV")
+            {
+                if (pasv >= 0)
+                    close(pasv);
+                int data_port = 0;
+                pasv = _listen_any(&data_port, 1);
+                if (pasv < 0)
+                    _reply(sock, "425 can't open data connection");
+                else
+                    _reply(sock, "229 Entering Extended Passive Mode (|||" + std::to_string(data_port) + "|)");
+            }
+            else if (cmd == "REST" && support_rest)
+            {
+                rests++;
+                rest = atol(arg.c_str());
+                _reply(sock, "350 restarting at " + arg);
+            }
+            else if (cmd == "ABOR")
+            {
+                if (xfer.joinable())
+                {
+                    bool busy = xfer_busy;
+                    xfer_stop = true;
+                    xfer.join();
+                    if (busy)
+                        _reply(sock, "426 transfer aborted");
+                }
+                _reply(sock, "226 abort ok");
+            }
+            else if (cmd == "RETR")
+            {
+                long start = rest;
+                rest = 0;
+                if (file == files.end() || pasv < 0)
+                {
+                    _reply(sock, "550 no such file");
+                    continue;
+                }
+                if (xfer.joinable())
+                    xfer.join();
+                retrs++;
+                int data_sock = accept(pasv, nullptr, nullptr);
+                close(pasv);
+                pasv = -1;
+                _reply(sock, "150 opening data connection");
+
+                long limit = -1;
+                if (drops_left > 0 && drop_after >= 0)
+                {
+                    drops_left--;
+                    limit = drop_after;
+                }
+                xfer_stop = false;
+                xfer_busy = true;
+                const std::vector<uint8_t> &data = file->second;
+                xfer = std::thread([this, sock, data_sock, start, limit, &data, &xfer_stop, &xfer_busy] {
+                    bool ok = _send_data(data_sock, data, start, limit, xfer_stop);
+                    close(data_sock);
+                    xfer_busy = false;
+                    if (!xfer_stop)
+                        _reply(sock, ok ? "226 transfer complete" : "426 connection closed; transfer aborted");
+                });
+            }
+            else
+                _reply(sock, "502 not implemented");
+        }
+
+        xfer_stop = true;
+        if (xfer.joinable())
+            xfer.join();
+        if (pasv >= 0)
+            close(pasv);
+        close(sock);
+    }
+};
+
+#endif // FTP_STANDIN_H
@@ -0,0 +1,230 @@
+/**
+ * #FujiNet host test - ATR write-back sector cache
+ *
+ * Replays the sector traffic of a DOS 2.5 copy session (two files copied
+ * to an empty enhanced density disk) against an ATR image, once writing
+ * through and once with the write-back cache. Both images must end up
+ * identical, the Atari must read back its own writes before they are
+ * flushed, and the cached replay must need far fewer image writes.
+ * A last pass makes the image fail writes and checks the Atari is told.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "diskTypeAtr.h"
+#include "fnFileMem.h"
+
+#ifdef BUILD_ATARI
+
+#define NUM_SECTORS 1040 // 130 KB enhanced density
+#define SECTOR_SIZE 128
+#define VTOC_SECTOR 360
+#define VTOC2_SECTOR 1024
+#define DIR_SECTOR 361
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                 \
+    do                                                                   \
+    {                                                                    \
+        if (!(cond))                                                     \
+        {                                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, msg);     \
+            failures++;                                                  \
+        }                                                                \
+    } while (0)
+
+// Memory image counting the requests that would go to the server
+class CountingImage : public FileHandlerMem
+{
+public:
+    int writes = 0;
+    int flushes = 0;
+    bool fail_writes = false;
+
+    virtual size_t write(const void *ptr, size_t size, size_t count) override
+    {
+        writes++;
+        if (fail_writes)
+            return 0;
+        return FileHandlerMem::write(ptr, size, count);
+    }
+
+    virtual int flush() override
+    {
+        flushes++;
+        return 0;
+    }
+
+    std::vector<uint8_t> contents() { return std::vector<uint8_t>(_buffer, _buffer + _filesize); }
+};
+
+static CountingImage *blank_image()
+{
+    CountingImage *image = new CountingImage();
+    uint32_t paragraphs = NUM_SECTORS * SECTOR_SIZE / 16;
+    uint8_t header[16] = {0x96, 0x02, (uint8_t)(paragraphs & 0xFF), (uint8_t)(paragraphs >> 8), SECTOR_SIZE, 0, (uint8_t)(paragraphs >> 16)};
+    image->write(header, 1, sizeof(header));
+    std::vector<uint8_t> zero(NUM_SECTORS * SECTOR_SIZE);
+    image->write(zero.data(), 1, zero.size());
+    image->writes = 0;
+    return image;
+}
+
+// Sector content after the n-th write to it
+static void fill_sector(uint8_t *buf, uint16_t sector, int generation)
+{
+    for (int i = 0; i < SECTOR_SIZE; i++)
+        buf[i] = (uint8_t)(sector * 7 + generation * 31 + i);
+}
+
+class CopySession
+{
+public:
+    MediaTypeATR &disk;
+    std::vector<int> generation = std::vector<int>(NUM_SECTORS + 1, 0);
+    bool ok = true;
+
+    CopySession(MediaTypeATR &d) : disk(d) {}
+
+    void read(uint16_t sector)
+    {
+        uint16_t count;
+        uint8_t expected[SECTOR_SIZE] = {};
+        if (generation[sector] > 0)
+            fill_sector(expected, sector, generation[sector]);
+        if (disk.read(sector, &count) || count != SECTOR_SIZE || memcmp(disk._disk_sectorbuff, expected, SECTOR_SIZE) != 0)
+        {
+            fprintf(stderr, "read of sector %u returned wrong data\n", sector);
+            ok = false;
+        }
+    }
+
+    void write(uint16_t sector)
+    {
+        fill_sector(disk._disk_sectorbuff, sector, ++generation[sector]);
+        if (disk.write(sector, true))
+        {
+            fprintf(stderr, "write of sector %u failed\n", sector);
+            ok = false;
+        }
+    }
+
+    // COPY of a file of given length in sectors, DOS 2.5 allocates from first_sector up
+    void copy_file(uint16_t first_sector, uint16_t length)
+    {
+        // Look for the name, then open the directory entry
+        read(VTOC_SECTOR);
+        read(VTOC2_SECTOR);
+        for (uint16_t s = DIR_SECTOR; s < DIR_SECTOR + 8; s++)
+            read(s);
+        write(DIR_SECTOR);
+
+        // One sector buffer, written when full
+        for (uint16_t s = first_sector; s < first_sector + length; s++)
+        {
+            if (s == VTOC_SECTOR)
+                s = DIR_SECTOR + 8;
+            write(s);
+        }
+
+        // Close: VTOC, VTOC2 and the final directory entry
+        write(VTOC_SECTOR);
+        write(VTOC2_SECTOR);
+        read(DIR_SECTOR);
+        write(DIR_SECTOR);
+    }
+
+    // Whole disk read back, e.g. by a following DIR and COPY D2:*.* D1:
+    void verify_all()
+    {
+        for (uint16_t s = 1; s <= NUM_SECTORS; s++)
+            read(s);
+    }
+};
+
+static std::vector<uint8_t> replay(bool writeback, int *writes, int *flushes)
+{
+    CountingImage *image = blank_image();
+    MediaTypeATR disk;
+    disk.set_writeback(writeback);
+    disk.mount(image, image->contents().size());
+
+    CopySession session(disk);
+    session.copy_file(4, 60);
+    session.copy_file(64, 120);
+    session.verify_all();
+    CHECK(session.ok, "copy session replay failed");
+
+    CHECK(!disk.flush(), "flush failed");
+    std::vector<uint8_t> result = image->contents();
+    *writes = image->writes;
+    *flushes = image->flushes;
+    disk.unmount();
+    return result;
+}
+
+static void test_failed_flush()
+{
+    CountingImage *image = blank_image();
+    MediaTypeATR disk;
+    disk.set_writeback(true);
+    disk.mount(image, image->contents().size());
+
+    CopySession session(disk);
+    session.write(4);
+    session.write(5);
+
+    // Background flush fails, sectors stay readable
+    image->fail_writes = true;
+    CHECK(disk.flush(), "failed flush not reported");
+    uint8_t status[4] = {};
+    disk.status(status);
+    CHECK(status[0] & DISK_DRIVE_STATUS_PUT_FAILED, "status doesn't show the failed flush");
+    session.read(4);
+    session.read(5);
+    CHECK(session.ok, "cached sectors lost after failed flush");
+
+    // Next write gets the error
+    fill_sector(disk._disk_sectorbuff, 6, 1);
+    CHECK(disk.write(6, true), "write after failed flush succeeded");
+
+    // Server is back
+    image->fail_writes = false;
+    session.write(6);
+    CHECK(session.ok, "write after recovery failed");
+    disk.status(status);
+    CHECK(!(status[0] & DISK_DRIVE_STATUS_PUT_FAILED), "status still shows failed flush");
+    CHECK(!disk.flush(), "flush after recovery failed");
+    disk.unmount();
+}
+
+int main()
+{
+    int through_writes, through_flushes, back_writes, back_flushes;
+    std::vector<uint8_t> through = replay(false, &through_writes, &through_flushes);
+    std::vector<uint8_t> back = replay(true, &back_writes, &back_flushes);
+
+    CHECK(through == back, "write-back image differs from write-through image");
+    printf("DOS 2.5 copy session: write-through %d writes %d flushes, write-back %d writes %d flushes\n",
+           through_writes, through_flushes, back_writes, back_flushes);
+    CHECK(back_writes * 4 < through_writes, "write-back cache didn't join sector writes");
+
+    test_failed_flush();
+
+    if (failures == 0)
+        printf("OK\n");
+    return failures ? 1 : 0;
+}
+
+#else
+
+int main()
+{
+    printf("ATR images are only built for ATARI, skipped\n");
+    return 0;
+}
+
+#endif // BUILD_ATARI
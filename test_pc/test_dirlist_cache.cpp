@@ -0,0 +1,186 @@
+/**
+ * #FujiNet host test - cached remote directory listings
+ *
+ * Stores listings in a DirListCache and checks when they are served. A
+ * listing past the TTL must be dropped, unless the file system reports the
+ * same directory mtime it was listed with. Invalidating a path must drop
+ * that directory, its parent and everything below it, and nothing else,
+ * and invalidating a server must drop the listings of all its hosts. The
+ * stats are read from a second thread while the cache is busy, as the web
+ * server does.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "fnDirListCache.h"
+
+#define HOST "tnfs://server.example/"
+#define OTHER_HOST "smb://user@Server.example:445/share"
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                 \
+    do                                                                   \
+    {                                                                    \
+        if (!(cond))                                                     \
+        {                                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, msg);     \
+            failures++;                                                  \
+        }                                                                \
+    } while (0)
+
+// Only tells directory mtimes, the cache doesn't use anything else
+class MtimeFileSystem : public FileSystem
+{
+public:
+    time_t mtime = 0;
+    std::atomic<int> mtime_calls{0};
+
+    time_t dir_mtime(const char *path) override
+    {
+        mtime_calls++;
+        return mtime;
+    }
+
+    fsType type() override { return FSTYPE_COUNT; }
+    const char *typestring() override { return "MTIME"; }
+    FILE *file_open(const char *path, const char *mode) override { return nullptr; }
+    FileHandler *filehandler_open(const char *path, const char *mode) override { return nullptr; }
+    bool exists(const char *path) override { return false; }
+    bool remove(const char *path) override { return false; }
+    bool rename(const char *pathFrom, const char *pathTo) override { return false; }
+    bool is_dir(const char *path) override { return false; }
+    bool mkdir(const char *path) override { return false; }
+    bool rmdir(const char *path) override { return false; }
+    bool dir_exists(const char *path) override { return false; }
+    bool dir_open(const char *path, const char *pattern, uint16_t diroptions) override { return false; }
+    fsdir_entry_t *dir_read() override { return nullptr; }
+    void dir_close() override {}
+    uint16_t dir_tell() override { return FNFS_INVALID_DIRPOS; }
+    bool dir_seek(uint16_t position) override { return false; }
+};
+
+static void store(DirListCache &cache, const char *host, const char *path, time_t dir_mtime)
+{
+    DirCache listing;
+    listing.add_entry("game.atr", false, 92176, 100);
+    listing.add_entry("apps", true, 0, 200);
+    cache.store(host, path, "", 0, listing, dir_mtime, 50);
+}
+
+static bool cached(DirListCache &cache, const char *host, const char *path, FileSystem *fs = nullptr)
+{
+    DirCache out;
+    if (!cache.lookup(host, path, "", 0, fs, out))
+        return false;
+    fsdir_entry *entry = out.read();
+    return entry != nullptr && strcmp(entry->filename, "game.atr") == 0;
+}
+
+static void test_ttl()
+{
+    DirListCache cache;
+    cache.set_ttl(1);
+    store(cache, HOST, "/games", 0);
+    CHECK(cached(cache, HOST, "/games"), "fresh listing not served");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    CHECK(!cached(cache, HOST, "/games"), "listing served past its TTL");
+    CHECK(!cached(cache, HOST, "/games"), "expired listing not dropped");
+
+    DirListCacheStats stats = cache.get_stats();
+    CHECK(stats.lookups == 3 && stats.hits == 1 && stats.misses == 2, "stats wrong after expiry");
+}
+
+static void test_revalidate()
+{
+    DirListCache cache;
+    MtimeFileSystem fs;
+    cache.set_ttl(1);
+    fs.mtime = 1000;
+    store(cache, HOST, "/games", fs.mtime);
+
+    CHECK(cached(cache, HOST, "/games", &fs), "fresh listing not served");
+    CHECK(fs.mtime_calls == 0, "fresh listing revalidated");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    CHECK(cached(cache, HOST, "/games", &fs), "unchanged directory not revalidated");
+    CHECK(fs.mtime_calls == 1 && cache.get_stats().revalidated == 1, "directory mtime not asked once");
+
+    // revalidation restarts the TTL
+    CHECK(cached(cache, HOST, "/games", &fs) && fs.mtime_calls == 1, "revalidated listing not fresh");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    fs.mtime = 2000;
+    CHECK(!cached(cache, HOST, "/games", &fs), "changed directory served from cache");
+}
+
+static void test_invalidate()
+{
+    DirListCache cache;
+    store(cache, HOST, "/", 0);
+    store(cache, HOST, "/games", 0);
+    store(cache, HOST, "/games/arcade", 0);
+    store(cache, HOST, "/games/arcade/old", 0);
+    store(cache, HOST, "/gamesx", 0);
+    store(cache, HOST, "/apps", 0);
+    store(cache, OTHER_HOST, "/games/arcade", 0);
+
+    // a file written in /games/arcade changes it and, by its mtime, /games
+    cache.invalidate(HOST, "/games/arcade/");
+    CHECK(!cached(cache, HOST, "/games/arcade"), "invalidated directory still cached");
+    CHECK(!cached(cache, HOST, "/games"), "parent of invalidated directory still cached");
+    CHECK(!cached(cache, HOST, "/games/arcade/old"), "subdirectory of invalidated directory still cached");
+    CHECK(cached(cache, HOST, "/"), "grandparent dropped");
+    CHECK(cached(cache, HOST, "/gamesx"), "directory sharing the name prefix dropped");
+    CHECK(cached(cache, HOST, "/apps"), "unrelated directory dropped");
+    CHECK(cached(cache, OTHER_HOST, "/games/arcade"), "same path on another host dropped");
+    CHECK(cache.get_stats().invalidations == 3, "invalidation count wrong");
+
+    // a write through a network device doesn't know the host slot
+    cache.invalidate_server("SERVER.example");
+    CHECK(!cached(cache, HOST, "/") && !cached(cache, HOST, "/apps"), "listings of server kept");
+    CHECK(!cached(cache, OTHER_HOST, "/games/arcade"), "listings of other host on server kept");
+}
+
+static void test_stats_concurrent()
+{
+    DirListCache cache;
+    std::atomic<bool> stop{false};
+    std::thread reader([&] {
+        while (!stop)
+        {
+            DirListCacheStats stats = cache.get_stats();
+            if (stats.hits > stats.lookups)
+                failures++;
+        }
+    });
+
+    for (int i = 0; i < 2000; i++)
+    {
+        store(cache, HOST, "/games", 0);
+        cached(cache, HOST, "/games");
+        cache.invalidate(HOST, "/games");
+    }
+    stop = true;
+    reader.join();
+
+    DirListCacheStats stats = cache.get_stats();
+    CHECK(stats.lookups == 2000 && stats.hits == 2000 && stats.invalidations == 2000, "stats lost under concurrent reads");
+}
+
+int main()
+{
+    test_ttl();
+    test_revalidate();
+    test_invalidate();
+    test_stats_concurrent();
+
+    if (failures == 0)
+        printf("OK\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,325 @@
+/**
+ * #FujiNet host test - DNS cache with record TTLs
+ *
+ * Resolves names against a local DNS server stand-in, which answers A
+ * queries from a table with the TTL of each record, follows one CNAME and
+ * answers NXDOMAIN for anything else. Answers must be served from the
+ * cache for their record TTL and asked again after it, a CNAME's lower
+ * TTL must win, long TTLs must be cut to the maximum and failures kept for
+ * the negative TTL. Asynchronous lookups must not block while the server
+ * takes its time, and must send a single query however often they poll.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "fnDNS.h"
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                 \
+    do                                                                   \
+    {                                                                    \
+        if (!(cond))                                                     \
+        {                                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, msg);     \
+            failures++;                                                  \
+        }                                                                \
+    } while (0)
+
+struct Record
+{
+    std::string cname; // answer with a CNAME to this name first, if set
+    uint32_t cname_ttl = 0;
+    in_addr_t addr = IPADDR_NONE;
+    uint32_t ttl = 0;
+    int delay_ms = 0;
+};
+
+// Answers A queries from records, on its own thread
+class DnsServerStandIn
+{
+public:
+    int port = 0;
+
+    void set(const std::string &name, const Record &r)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _records[name] = r;
+    }
+
+    bool start()
+    {
+        _sock = socket(AF_INET, SOCK_DGRAM, 0);
+        if (_sock < 0)
+            return false;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(_sock, (sockaddr *)&addr, sizeof(addr)) < 0)
+            return false;
+        socklen_t len = sizeof(addr);
+        getsockname(_sock, (sockaddr *)&addr, &len);
+        port = ntohs(addr.sin_port);
+        timeval tv{0, 100000};
+        setsockopt(_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        _thread = std::thread([this] { _loop(); });
+        return true;
+    }
+
+    int queries(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _queries[name];
+    }
+
+    ~DnsServerStandIn()
+    {
+        _stop = true;
+        if (_thread.joinable())
+            _thread.join();
+        if (_sock >= 0)
+            close(_sock);
+    }
+
+private:
+    int _sock = -1;
+    std::thread _thread;
+    std::atomic<bool> _stop{false};
+    std::mutex _mutex;
+    std::map<std::string, Record> _records;
+    std::map<std::string, int> _queries;
+
+    static void _put16(std::string &out, uint16_t v)
+    {
+        out += (char)(v >> 8);
+        out += (char)(v & 0xff);
+    }
+
+    static void _put32(std::string &out, uint32_t v)
+    {
+        _put16(out, v >> 16);
+        _put16(out, v & 0xffff);
+    }
+
+    static std::string _encode(const std::string &name)
+    {
+        std::string out;
+        size_t start = 0;
+        while (start < name.size())
+        {
+            size_t dot = name.find('.', start);
+            if (dot == std::string::npos)
+                dot = name.size();
+            out += (char)(dot - start);
+            out += name.substr(start, dot - start);
+            start = dot + 1;
+        }
+        return out + '\0';
+    }
+
+    void _loop()
+    {
+        uint8_t buf[512];
+        sockaddr_in peer{};
+        while (!_stop)
+        {
+            socklen_t len = sizeof(peer);
+            int n = recvfrom(_sock, buf, sizeof(buf), 0, (sockaddr *)&peer, &len);
+            if (n <= 12)
+                continue;
+
+            // question name
+            std::string name;
+            int pos = 12;
+            while (pos < n && buf[pos] != 0)
+            {
+                if (!name.empty())
+                    name += '.';
+                name.append((char *)buf + pos + 1, buf[pos]);
+                pos += buf[pos] + 1;
+            }
+            pos += 5; // end of name, type, class
+            Record r;
+            bool found;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _queries[name]++;
+                auto rec = _records.find(name);
+                found = rec != _records.end();
+                if (found)
+                    r = rec->second;
+            }
+
+            std::string resp((char *)buf, 2);
+            _put16(resp, found ? 0x8180 : 0x8183); // answer or NXDOMAIN
+            _put16(resp, 1);
+            _put16(resp, !found ? 0 : r.cname.empty() ? 1 : 2);
+            _put32(resp, 0);
+            resp.append((char *)buf + 12, pos - 12);
+
+            if (found)
+            {
+                std::string owner = "\xc0\x0c"; // the question name
+                if (!r.cname.empty())
+                {
+                    std::string target = _encode(r.cname);
+                    resp += owner;
+                    _put16(resp, 5);
+                    _put16(resp, 1);
+                    _put32(resp, r.cname_ttl);
+                    _put16(resp, target.size());
+                    resp += target;
+                    owner = target;
+                }
+                resp += owner;
+                _put16(resp, 1);
+                _put16(resp, 1);
+                _put32(resp, r.ttl);
+                _put16(resp, 4);
+                resp.append((const char *)&r.addr, 4);
+                if (r.delay_ms > 0)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(r.delay_ms));
+            }
+            sendto(_sock, resp.data(), resp.size(), 0, (sockaddr *)&peer, len);
+        }
+    }
+};
+
+static DnsServerStandIn server;
+
+static void sleep_ms(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+static void add(const char *name, const char *addr, uint32_t ttl, int delay_ms = 0,
+                const char *cname = "", uint32_t cname_ttl = 0)
+{
+    Record r;
+    r.addr = inet_addr(addr);
+    r.ttl = ttl;
+    r.delay_ms = delay_ms;
+    r.cname = cname;
+    r.cname_ttl = cname_ttl;
+    server.set(name, r);
+}
+
+static void test_record_ttl()
+{
+    add("ttl.test", "10.0.0.1", 2);
+    CHECK(get_ip4_addr_by_name("ttl.test") == inet_addr("10.0.0.1"), "wrong address");
+    CHECK(get_ip4_addr_by_name("TTL.Test") == inet_addr("10.0.0.1"), "wrong cached address");
+    CHECK(server.queries("ttl.test") == 1, "answer not cached for its TTL");
+
+    sleep_ms(2100);
+    CHECK(get_ip4_addr_by_name("ttl.test") == inet_addr("10.0.0.1"), "wrong address after TTL");
+    CHECK(server.queries("ttl.test") == 2, "answer used past its TTL");
+}
+
+static void test_cname_ttl()
+{
+    add("alias.test", "10.0.0.2", 300, 0, "target.test", 1);
+    CHECK(get_ip4_addr_by_name("alias.test") == inet_addr("10.0.0.2"), "CNAME not followed");
+
+    sleep_ms(1100);
+    get_ip4_addr_by_name("alias.test");
+    CHECK(server.queries("alias.test") == 2, "answer kept past the TTL of its CNAME");
+}
+
+static void test_max_ttl()
+{
+    dns_set_ttl(1, DNS_NEGATIVE_TTL);
+    add("long.test", "10.0.0.3", 86400);
+    get_ip4_addr_by_name("long.test");
+    get_ip4_addr_by_name("long.test");
+    CHECK(server.queries("long.test") == 1, "answer with long TTL not cached");
+
+    sleep_ms(1100);
+    get_ip4_addr_by_name("long.test");
+    CHECK(server.queries("long.test") == 2, "TTL not cut to the maximum");
+    dns_set_ttl(DNS_MAX_TTL, DNS_NEGATIVE_TTL);
+}
+
+static void test_negative_ttl()
+{
+    dns_set_ttl(DNS_MAX_TTL, 1);
+    fnDnsStats before = dns_cache_stats();
+    CHECK(get_ip4_addr_by_name("missing.test") == IPADDR_NONE, "missing name resolved");
+    CHECK(get_ip4_addr_by_name("missing.test") == IPADDR_NONE, "missing name resolved from cache");
+    CHECK(server.queries("missing.test") == 1, "failure not cached");
+    CHECK(dns_cache_stats().negative_hits == before.negative_hits + 1, "negative hit not counted");
+
+    sleep_ms(1100);
+    get_ip4_addr_by_name("missing.test");
+    CHECK(server.queries("missing.test") == 2, "failure kept past the negative TTL");
+    dns_set_ttl(DNS_MAX_TTL, DNS_NEGATIVE_TTL);
+}
+
+static void test_async()
+{
+    in_addr_t addr = IPADDR_NONE;
+    CHECK(get_ip4_addr_by_name_async("192.168.1.2", &addr) == DNS_RESOLVED && addr == inet_addr("192.168.1.2"),
+          "dotted quad not resolved at once");
+
+    add("slow.test", "10.0.0.4", 300, 500);
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    dns_status status = get_ip4_addr_by_name_async("slow.test", &addr);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    CHECK(status == DNS_PENDING, "slow name not pending");
+    CHECK(ms < 100, "asynchronous lookup blocked");
+
+    int polls = 0;
+    while (status == DNS_PENDING && polls++ < 300)
+    {
+        sleep_ms(10);
+        status = get_ip4_addr_by_name_async("slow.test", &addr);
+    }
+    CHECK(status == DNS_RESOLVED && addr == inet_addr("10.0.0.4"), "asynchronous lookup not resolved");
+    CHECK(polls > 10, "resolved before the server answered");
+    CHECK(server.queries("slow.test") == 1, "polling sent more queries");
+
+    // a blocking lookup waits for the one in progress
+    add("shared.test", "10.0.0.5", 300, 300);
+    CHECK(get_ip4_addr_by_name_async("shared.test", &addr) == DNS_PENDING, "name not pending");
+    sleep_ms(50);
+    CHECK(get_ip4_addr_by_name("shared.test") == inet_addr("10.0.0.5"), "blocking lookup of pending name failed");
+    CHECK(server.queries("shared.test") == 1, "pending name asked twice");
+
+    CHECK(get_ip4_addr_by_name_async("missing2.test", &addr) == DNS_PENDING, "missing name not pending");
+    polls = 0;
+    while ((status = get_ip4_addr_by_name_async("missing2.test", &addr)) == DNS_PENDING && polls++ < 300)
+        sleep_ms(10);
+    CHECK(status == DNS_FAILED, "missing name not failed");
+}
+
+int main()
+{
+    if (!server.start())
+    {
+        fprintf(stderr, "failed to start DNS server stand-in\n");
+        return 1;
+    }
+    dns_set_server(htonl(INADDR_LOOPBACK), server.port);
+
+    test_record_ttl();
+    test_cname_ttl();
+    test_max_ttl();
+    test_negative_ttl();
+    test_async();
+
+    if (failures == 0)
+        printf("OK\n");
+    return failures ? 1 : 0;
+}
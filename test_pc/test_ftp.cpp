@@ -0,0 +1,189 @@
+/**
+ * #FujiNet host test - FTP file system recovery and on-demand reads
+ *
+ * Opens disk images on a local FTP stand-in. A small image whose data
+ * connection drops twice must be resumed with REST and arrive intact
+ * without any byte sent twice. A large image must be served block by block
+ * with REST + RETR and read back correctly at random and sequential sector
+ * offsets and across its end. After the server closes the idle control
+ * connection the next open must log in again, and a server without REST
+ * must get the large image downloaded whole, into the SD cache.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fnFileFTPRange.h"
+#include "fnFsFTP.h"
+#include "fnFsSD.h"
+#include "ftp_standin.h"
+
+#define SMALL_NAME "/small.atr"
+#define SMALL_SIZE 92176 // 720 sectors + header
+#define BIG_NAME "/big.atr"
+#define BIG_SIZE (4 * 1024 * 1024)
+#define SECTOR_SIZE 128
+#define HEADER_SIZE 16
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                 \
+    do                                                                   \
+    {                                                                    \
+        if (!(cond))                                                     \
+        {                                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, msg);     \
+            failures++;                                                  \
+        }                                                                \
+    } while (0)
+
+static FtpStandIn server;
+
+// Read len bytes at off and compare with the served file, short at its end
+static bool same(FileHandler *fh, const std::vector<uint8_t> &ref, long off, size_t len)
+{
+    std::vector<uint8_t> buf(len);
+    fh->seek(off, SEEK_SET);
+    size_t n = fh->read(buf.data(), 1, len);
+    size_t expected = off >= (long)ref.size() ? 0 : std::min(len, ref.size() - off);
+    return n == expected && memcmp(buf.data(), ref.data() + off, n) == 0;
+}
+
+static void test_resume(FileSystemFTP &fs)
+{
+    const std::vector<uint8_t> &ref = server.files[SMALL_NAME];
+    server.retrs = 0;
+    server.rests = 0;
+    server.bytes_sent = 0;
+    server.drop_after = 30000;
+    server.drops_left = 2;
+
+    FileHandler *fh = fs.filehandler_open(SMALL_NAME, "rb");
+    CHECK(fh != nullptr, "open with dropped transfers failed");
+    if (fh == nullptr)
+        return;
+    CHECK(same(fh, ref, 0, ref.size()), "resumed download data wrong");
+    fh->close();
+
+    printf("resume: %d RETR, %d REST, %ld of %zu bytes sent\n",
+           server.retrs.load(), server.rests.load(), server.bytes_sent.load(), ref.size());
+    CHECK(server.retrs == 3 && server.rests == 2, "dropped transfers not resumed with REST");
+    CHECK(server.bytes_sent == (long)ref.size(), "resumed download sent data twice");
+}
+
+static void test_on_demand(FileSystemFTP &fs, std::mt19937 &rng)
+{
+    const std::vector<uint8_t> &ref = server.files[BIG_NAME];
+    server.retrs = 0;
+    server.bytes_sent = 0;
+
+    FileHandler *fh = fs.filehandler_open(BIG_NAME, "rb");
+    CHECK(fh != nullptr && dynamic_cast<FileHandlerFTPRange *>(fh) != nullptr, "large image not opened on demand");
+    if (fh == nullptr)
+        return;
+
+    bool ok = same(fh, ref, HEADER_SIZE, SECTOR_SIZE);
+    for (int i = 0; i < 50; i++)
+    {
+        long sector = rng() % ((ref.size() - HEADER_SIZE) / SECTOR_SIZE);
+        ok &= same(fh, ref, HEADER_SIZE + sector * SECTOR_SIZE, SECTOR_SIZE);
+    }
+    for (long off = HEADER_SIZE; off < HEADER_SIZE + 720 * SECTOR_SIZE; off += SECTOR_SIZE)
+        ok &= same(fh, ref, off, SECTOR_SIZE);
+    CHECK(ok, "sector read on demand wrong");
+    CHECK(same(fh, ref, ref.size() - 100, 300), "read across end of file wrong");
+    CHECK(same(fh, ref, ref.size() + 10, 10), "read past end of file returned data");
+    fh->close();
+
+    printf("on demand: %d RETR\n", server.retrs.load());
+}
+
+static void test_relogin(FileSystemFTP &fs)
+{
+    const std::vector<uint8_t> &ref = server.files[SMALL_NAME];
+    int logins = server.logins;
+    server.idle_close_ms = 200;
+
+    // This open's control connection is the one the server drops
+    FileHandler *fh = fs.filehandler_open(SMALL_NAME, "rb");
+    if (fh != nullptr)
+        fh->close();
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+
+    fh = fs.filehandler_open(SMALL_NAME, "rb");
+    CHECK(fh != nullptr, "open after the server closed the control connection failed");
+    if (fh != nullptr)
+    {
+        CHECK(same(fh, ref, 1000, 5000), "data wrong after logging in again");
+        fh->close();
+    }
+    CHECK(server.logins == logins + 1, "didn't log in again");
+    server.idle_close_ms = -1;
+}
+
+static void test_no_rest(FileSystemFTP &fs)
+{
+    const std::vector<uint8_t> &ref = server.files[BIG_NAME];
+    server.support_rest = false;
+    server.bytes_sent = 0;
+
+    FileHandler *fh = fs.filehandler_open(BIG_NAME, "rb");
+    CHECK(fh != nullptr && dynamic_cast<FileHandlerFTPRange *>(fh) == nullptr, "large image not downloaded whole without REST");
+    if (fh != nullptr)
+    {
+        CHECK(same(fh, ref, 0, ref.size()), "whole download data wrong");
+        fh->close();
+    }
+    CHECK(server.bytes_sent == (long)ref.size(), "whole download size wrong");
+    server.support_rest = true;
+}
+
+int main()
+{
+    std::mt19937 rng(7);
+    std::vector<uint8_t> &small = server.files[SMALL_NAME];
+    std::vector<uint8_t> &big = server.files[BIG_NAME];
+    small.resize(SMALL_SIZE);
+    big.resize(BIG_SIZE);
+    for (uint8_t &b : small)
+        b = rng();
+    for (uint8_t &b : big)
+        b = rng();
+
+    // Fast enough for ctest, slow enough for the drops to land mid-transfer
+    server.data_rate_kbs = 20000;
+    if (!server.start())
+    {
+        fprintf(stderr, "failed to start FTP stand-in\n");
+        return 1;
+    }
+
+    // Downloads too big for memory go to the SD cache, a scratch directory here
+    char sd_dir[] = "/tmp/fujinet_ftpXXXXXX";
+    if (mkdtemp(sd_dir) == nullptr || !fnSDFAT.start(sd_dir))
+    {
+        fprintf(stderr, "failed to set up SD directory\n");
+        return 1;
+    }
+
+    FileSystemFTP fs;
+    std::string url = "ftp://127.0.0.1:" + std::to_string(server.port) + "/";
+    CHECK(fs.start(url.c_str()), "FTP file system didn't start");
+
+    test_resume(fs);
+    test_on_demand(fs, rng);
+    test_relogin(fs);
+    test_no_rest(fs);
+    std::filesystem::remove_all(sd_dir);
+
+    if (failures == 0)
+        printf("OK\n");
+    return failures ? 1 : 0;
+}
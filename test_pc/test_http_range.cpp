@@ -0,0 +1,243 @@
+/**
+ * #FujiNet host test - HTTP files read on demand with Range requests
+ *
+ * Opens a disk image through the HTTP file system against a local mongoose
+ * server in three modes: one honouring Range requests, one advertising
+ * "Accept-Ranges: bytes" but always answering with the whole file, and one
+ * without range support. Random, sequential and backward sector reads must
+ * return the served data in every mode. Only the honest server may be read
+ * by ranges, the one ignoring them must still be read without errors, and
+ * the one without ranges must get a single full download, into the SD cache.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fnFileHTTPRange.h"
+#include "fnFsHTTP.h"
+#include "fnFsSD.h"
+
+#define FILE_NAME "/image.atr"
+#define FILE_SIZE (2 * 1024 * 1024 + 16) // more than the block cache holds
+#define SECTOR_SIZE 128
+#define HEADER_SIZE 16
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                 \
+    do                                                                   \
+    {                                                                    \
+        if (!(cond))                                                     \
+        {                                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, msg);     \
+            failures++;                                                  \
+        }                                                                \
+    } while (0)
+
+enum RangeMode
+{
+    RANGES_HONOURED,
+    RANGES_IGNORED, // advertised, but every GET gets 200 and the whole file
+    RANGES_NONE
+};
+
+// Serves one file from memory, on its own thread
+class RangeServer
+{
+public:
+    std::vector<uint8_t> file;
+    RangeMode mode = RANGES_HONOURED;
+    std::atomic<int> gets{0};
+    std::atomic<int> full_gets{0};
+    std::atomic<long> bytes_sent{0};
+    int port = 0;
+
+    bool start()
+    {
+        mg_mgr_init(&_mgr);
+        mg_connection *c = mg_http_listen(&_mgr, "http://127.0.0.1:0", _handler, this);
+        if (c == nullptr)
+            return false;
+        port = mg_ntohs(c->loc.port);
+        _thread = std::thread([this] {
+            while (!_stop)
+                mg_mgr_poll(&_mgr, 5);
+            mg_mgr_free(&_mgr);
+        });
+        return true;
+    }
+
+    ~RangeServer()
+    {
+        _stop = true;
+        if (_thread.joinable())
+            _thread.join();
+    }
+
+private:
+    mg_mgr _mgr;
+    std::thread _thread;
+    std::atomic<bool> _stop{false};
+
+    static void _handler(mg_connection *c, int ev, void *ev_data)
+    {
+        if (ev != MG_EV_HTTP_MSG)
+            return;
+        RangeServer *self = (RangeServer *)c->fn_data;
+        mg_http_message *hm = (mg_http_message *)ev_data;
+        const std::vector<uint8_t> &file = self->file;
+        const char *accept = self->mode == RANGES_NONE ? "" : "Accept-Ranges: bytes\r\n";
+
+        if (mg_strcmp(hm->uri, mg_str(FILE_NAME)) != 0)
+        {
+            mg_http_reply(c, 404, "", "");
+            return;
+        }
+        if (mg_strcmp(hm->method, mg_str("HEAD")) == 0)
+        {
+            mg_printf(c, "HTTP/1.1 200 OK\r\n%sContent-Length: %lu\r\n\r\n", accept, (unsigned long)file.size());
+            c->is_resp = 0;
+            return;
+        }
+
+        self->gets++;
+        long start = 0, end = (long)file.size() - 1;
+        mg_str *range = mg_http_get_header(hm, "Range");
+        bool partial = range != nullptr && self->mode == RANGES_HONOURED;
+        if (partial)
+        {
+            std::string r(range->ptr, range->len);
+            start = atol(r.c_str() + r.find('=') + 1);
+            size_t dash = r.find('-');
+            if (dash + 1 < r.size())
+                end = std::min(end, atol(r.c_str() + dash + 1));
+            mg_printf(c, "HTTP/1.1 206 Partial Content\r\n%sContent-Range: bytes %ld-%ld/%lu\r\nContent-Length: %ld\r\n\r\n",
+                      accept, start, end, (unsigned long)file.size(), end - start + 1);
+        }
+        else
+        {
+            self->full_gets++;
+            mg_printf(c, "HTTP/1.1 200 OK\r\n%sContent-Length: %lu\r\n\r\n", accept, (unsigned long)file.size());
+        }
+        mg_send(c, file.data() + start, end - start + 1);
+        self->bytes_sent += end - start + 1;
+        c->is_resp = 0;
+    }
+};
+
+static RangeServer server;
+
+// Read len bytes at off and compare with the served file
+static bool same(FileHandler *fh, long off, size_t len)
+{
+    std::vector<uint8_t> buf(len);
+    if (fh->seek(off, SEEK_SET) != 0)
+        return false;
+    size_t n = fh->read(buf.data(), 1, len);
+    size_t expected = off >= (long)server.file.size() ? 0 : std::min(len, server.file.size() - off);
+    return n == expected && memcmp(buf.data(), server.file.data() + off, n) == 0;
+}
+
+// Boot-like access: header, random sectors, a sequential run, a step back and the end
+static bool read_like_a_drive(FileHandler *fh, std::mt19937 &rng)
+{
+    bool ok = same(fh, 0, HEADER_SIZE);
+    long sectors = (FILE_SIZE - HEADER_SIZE) / SECTOR_SIZE;
+    for (int i = 0; i < 40; i++)
+        ok &= same(fh, HEADER_SIZE + (long)(rng() % sectors) * SECTOR_SIZE, SECTOR_SIZE);
+    for (long s = 100; s < 400; s++)
+        ok &= same(fh, HEADER_SIZE + s * SECTOR_SIZE, SECTOR_SIZE);
+    ok &= same(fh, HEADER_SIZE + 20 * SECTOR_SIZE, SECTOR_SIZE);
+    ok &= same(fh, FILE_SIZE - 100, 300);
+    return ok;
+}
+
+static FileHandler *open_image(RangeMode mode)
+{
+    server.mode = mode;
+    server.gets = 0;
+    server.full_gets = 0;
+    server.bytes_sent = 0;
+
+    FileSystemHTTP fs;
+    std::string url = "http://127.0.0.1:" + std::to_string(server.port) + "/";
+    if (!fs.start(url.c_str()))
+        return nullptr;
+    return fs.filehandler_open(FILE_NAME, "rb");
+}
+
+static void test_ranges(std::mt19937 &rng)
+{
+    FileHandler *fh = open_image(RANGES_HONOURED);
+    CHECK(fh != nullptr && dynamic_cast<FileHandlerHTTPRange *>(fh) != nullptr, "range server not read by ranges");
+    if (fh == nullptr)
+        return;
+    CHECK(read_like_a_drive(fh, rng), "data read by ranges wrong");
+    fh->close();
+
+    printf("ranges honoured: %d GET, %ld of %d bytes sent\n", server.gets.load(), server.bytes_sent.load(), FILE_SIZE);
+    CHECK(server.full_gets == 0, "whole file requested from a range server");
+    CHECK(server.bytes_sent <= (long)server.gets * HTTP_RANGE_READAHEAD * HTTP_RANGE_BLOCK_SIZE, "range request bigger than the read-ahead");
+}
+
+static void test_ranges_ignored(std::mt19937 &rng)
+{
+    FileHandler *fh = open_image(RANGES_IGNORED);
+    CHECK(fh != nullptr, "open failed on server ignoring ranges");
+    if (fh == nullptr)
+        return;
+    CHECK(read_like_a_drive(fh, rng), "data wrong from server ignoring ranges");
+    fh->close();
+
+    printf("ranges ignored: %d GET, %ld bytes queued for a %d byte file\n", server.gets.load(), server.bytes_sent.load(), FILE_SIZE);
+}
+
+static void test_no_ranges(std::mt19937 &rng)
+{
+    FileHandler *fh = open_image(RANGES_NONE);
+    CHECK(fh != nullptr && dynamic_cast<FileHandlerHTTPRange *>(fh) == nullptr, "server without ranges not downloaded whole");
+    if (fh == nullptr)
+        return;
+    CHECK(read_like_a_drive(fh, rng), "downloaded data wrong");
+    fh->close();
+
+    printf("no ranges: %d GET, %ld of %d bytes sent\n", server.gets.load(), server.bytes_sent.load(), FILE_SIZE);
+    CHECK(server.gets == 1, "file downloaded more than once");
+}
+
+int main()
+{
+    std::mt19937 rng(3);
+    server.file.resize(FILE_SIZE);
+    for (uint8_t &b : server.file)
+        b = rng();
+    if (!server.start())
+    {
+        fprintf(stderr, "failed to start HTTP server\n");
+        return 1;
+    }
+
+    // Full downloads this big go to the SD cache, a scratch directory here
+    char sd_dir[] = "/tmp/fujinet_httpXXXXXX";
+    if (mkdtemp(sd_dir) == nullptr || !fnSDFAT.start(sd_dir))
+    {
+        fprintf(stderr, "failed to set up SD directory\n");
+        return 1;
+    }
+
+    test_ranges(rng);
+    test_ranges_ignored(rng);
+    test_no_ranges(rng);
+    std::filesystem::remove_all(sd_dir);
+
+    if (failures == 0)
+        printf("OK\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,474 @@
+/**
+ * #FujiNet host test - modem core loopback
+ *
+ * Drives the modem data path the way the SIO modem does in connected mode,
+ * against a local echo server: the host side types a block, it goes out
+ * on the socket once it is writable, comes back and is handed to the host
+ * through ModemCore. Per baud rate the data must come back intact, at the
+ * emulated rate and in bursts no bigger than the pacing allows. A last
+ * pass closes the connection with data still buffered and checks it is
+ * all delivered before the modem would report NO CARRIER.
+ *
+ * The AT command passes type commands the way a terminal program does
+ * and check ModemCommand's answers: dialing and hanging up the echo
+ * server, ATE and ATV, ERROR for an unknown command and the guard time
+ * of the "+++" escape.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fnTcpClient.h"
+#include "modemCommand.h"
+#include "modemCore.h"
+
+#define RECVBUFSIZE 1024
+#define TX_BUF_SIZE 256
+#define RUN_TIME_MS 250
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                 \
+    do                                                                   \
+    {                                                                    \
+        if (!(cond))                                                     \
+        {                                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, msg);     \
+            failures++;                                                  \
+        }                                                                \
+    } while (0)
+
+using test_clock = std::chrono::steady_clock;
+
+// Host computer on the other end of the bus
+class HostBus : public ModemBus
+{
+public:
+    std::deque<uint8_t> typed;    // waiting to be sent by the host
+    std::vector<uint8_t> received;
+    size_t first_write = 0;
+    size_t largest_write = 0;
+    test_clock::time_point first_rx, last_rx;
+
+    size_t modem_bus_available() override { return typed.size(); }
+
+    size_t modem_bus_read(uint8_t *buf, size_t len) override
+    {
+        len = std::min(len, typed.size());
+        std::copy(typed.begin(), typed.begin() + len, buf);
+        typed.erase(typed.begin(), typed.begin() + len);
+        return len;
+    }
+
+    size_t modem_bus_write(const uint8_t *buf, size_t len) override
+    {
+        if (received.empty())
+        {
+            first_rx = test_clock::now();
+            first_write = len;
+        }
+        last_rx = test_clock::now();
+        received.insert(received.end(), buf, buf + len);
+        largest_write = std::max(largest_write, len);
+        return len;
+    }
+};
+
+// Echoes one connection, or sends a block and hangs up
+class EchoServer
+{
+public:
+    int port = 0;
+
+    bool start()
+    {
+        _listen = socket(AF_INET, SOCK_STREAM, 0);
+        if (_listen < 0)
+            return false;
+        int one = 1;
+        setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(_listen, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(_listen, 1) < 0)
+            return false;
+        socklen_t len = sizeof(addr);
+        getsockname(_listen, (sockaddr *)&addr, &len);
+        port = ntohs(addr.sin_port);
+        return true;
+    }
+
+    void serve_echo()
+    {
+        _thread = std::thread([this] {
+            int s = accept(_listen, nullptr, nullptr);
+            uint8_t buf[512];
+            ssize_t n;
+            while ((n = recv(s, buf, sizeof(buf), 0)) > 0)
+                send(s, buf, n, MSG_NOSIGNAL);
+            close(s);
+        });
+    }
+
+    void serve_and_hang_up(const std::vector<uint8_t> &data)
+    {
+        _thread = std::thread([this, data] {
+            int s = accept(_listen, nullptr, nullptr);
+            send(s, data.data(), data.size(), MSG_NOSIGNAL);
+            close(s);
+        });
+    }
+
+    void join()
+    {
+        if (_thread.joinable())
+            _thread.join();
+    }
+
+    ~EchoServer()
+    {
+        join();
+        if (_listen >= 0)
+            close(_listen);
+    }
+
+private:
+    int _listen = -1;
+    std::thread _thread;
+};
+
+static std::vector<uint8_t> pattern(size_t len, unsigned seed)
+{
+    std::vector<uint8_t> data(len);
+    for (size_t i = 0; i < len; i++)
+        data[i] = (uint8_t)(((i + seed) * 2654435761u) >> 13);
+    return data;
+}
+
+// One pass of the modem's connected mode loop
+static void modem_pass(ModemCore &core, fnTcpClient &client)
+{
+    uint8_t txBuf[TX_BUF_SIZE];
+    if (ModemCore::net_writable(client.fd()))
+    {
+        size_t n = core.read_host(txBuf, sizeof(txBuf));
+        if (n > 0)
+            client.write(txBuf, n);
+    }
+
+    uint8_t buf[RECVBUFSIZE];
+    size_t room = core.rx_space();
+    int avail;
+    if (room > 0 && (avail = client.available()) > 0)
+    {
+        int n = client.read(buf, std::min({(size_t)avail, room, sizeof(buf)}));
+        if (n > 0)
+            core.rx_put(buf, n);
+    }
+
+    core.service_rx();
+}
+
+static void test_ring_buffer()
+{
+    ModemRingBuffer ring;
+    ring.resize(10);
+    std::vector<uint8_t> data = pattern(40, 1);
+    std::vector<uint8_t> out;
+
+    // Keep the write position moving around the end of the buffer
+    size_t in = 0;
+    while (out.size() < data.size())
+    {
+        in += ring.put(&data[in], std::min<size_t>(7, data.size() - in));
+        CHECK(ring.used() + ring.space() == ring.size(), "ring accounting wrong");
+
+        size_t len;
+        const uint8_t *p = ring.peek(&len);
+        len = std::min<size_t>(len, 4);
+        out.insert(out.end(), p, p + len);
+        ring.consume(len);
+    }
+    CHECK(out == data, "ring buffer data wrong across wrap-around");
+
+    CHECK(ring.put(data.data(), 20) == 10, "ring took more than its size");
+    size_t len;
+    ring.peek(&len);
+    CHECK(len == 10, "full ring not readable in one piece");
+}
+
+static void test_loopback(unsigned int baud)
+{
+    EchoServer server;
+    if (!server.start())
+    {
+        CHECK(false, "echo server failed to start");
+        return;
+    }
+    server.serve_echo();
+
+    HostBus host;
+    ModemCore core(&host);
+    core.set_baud(baud);
+
+    fnTcpClient client;
+    if (!client.connect("127.0.0.1", server.port))
+    {
+        CHECK(false, "connect to echo server failed");
+        return;
+    }
+
+    size_t total = std::max<size_t>(32, (size_t)baud / 10 * RUN_TIME_MS / 1000);
+    std::vector<uint8_t> typed = pattern(total, baud);
+    host.typed.assign(typed.begin(), typed.end());
+
+    test_clock::time_point deadline = test_clock::now() + std::chrono::milliseconds(RUN_TIME_MS * 4 + total * 10000 / baud);
+    while (host.received.size() < total && test_clock::now() < deadline)
+        modem_pass(core, client);
+    client.stop();
+
+    CHECK(host.received == typed, "echoed data wrong or incomplete");
+
+    // First burst goes out with the credit saved while idle, the rest at the baud rate
+    double s = std::chrono::duration<double>(host.last_rx - host.first_rx).count();
+    double cps = s > 0 ? (total - host.first_write) / s : 0;
+    double expected = baud / 10.0;
+    size_t burst = std::max<size_t>(MODEM_PACE_BURST_MIN, baud / 10 * MODEM_PACE_BURST_MS / 1000);
+    printf("%6u baud: %5zu bytes, %8.1f cps (%.1f expected), largest burst %zu\n",
+           baud, total, cps, expected, host.largest_write);
+    CHECK(cps > expected * 0.95 && cps < expected * 1.05, "throughput doesn't match the baud rate");
+    CHECK(host.largest_write <= burst, "burst bigger than the pacing allows");
+}
+
+static void test_hang_up()
+{
+    EchoServer server;
+    if (!server.start())
+    {
+        CHECK(false, "server failed to start");
+        return;
+    }
+    std::vector<uint8_t> data = pattern(120, 7);
+    server.serve_and_hang_up(data);
+
+    HostBus host;
+    ModemCore core(&host);
+    core.set_baud(1200);
+
+    fnTcpClient client;
+    if (!client.connect("127.0.0.1", server.port))
+    {
+        CHECK(false, "connect failed");
+        return;
+    }
+
+    // Carrier is lost while the data is still being delivered
+    bool pending_at_hang_up = false;
+    test_clock::time_point deadline = test_clock::now() + std::chrono::seconds(5);
+    while (test_clock::now() < deadline)
+    {
+        modem_pass(core, client);
+        if (!client.connected() && client.available() == 0)
+        {
+            pending_at_hang_up = core.rx_pending() > 0;
+            break;
+        }
+    }
+    CHECK(pending_at_hang_up, "nothing buffered when the peer hung up");
+
+    // NO CARRIER waits for rx_pending() to reach 0
+    while (core.rx_pending() > 0 && test_clock::now() < deadline)
+        core.service_rx();
+    CHECK(host.received == data, "data received before the hang up not delivered");
+    client.stop();
+}
+
+// Command mode of a modem with just the commands under test
+class TestModem
+{
+public:
+    HostBus host;
+    ModemCommand atCmd{&host};
+    fnTcpClient client;
+    bool cmdMode = true;
+
+    void type(const char *s)
+    {
+        for (; *s; s++)
+            if (atCmd.input((uint8_t)*s))
+                command();
+    }
+
+    // What the host has been sent since the last call
+    std::string output()
+    {
+        std::string out(host.received.begin(), host.received.end());
+        host.received.clear();
+        return out;
+    }
+
+private:
+    void command()
+    {
+        int cmd_match = atCmd.parse();
+        if (cmd_match < 0)
+            return;
+
+        std::string addr, port;
+        switch (cmd_match)
+        {
+        case AT_AT:
+            atCmd.result(RESULT_CODE_OK);
+            break;
+        case AT_DT:
+            atCmd.dial_address(&addr, &port);
+            if (client.connect(addr.c_str(), std::stoi(port)))
+            {
+                cmdMode = false;
+                atCmd.result_connect(2400);
+            }
+            else
+                atCmd.result(RESULT_CODE_NO_CARRIER);
+            break;
+        case AT_H:
+            client.stop();
+            cmdMode = true;
+            atCmd.result(RESULT_CODE_NO_CARRIER);
+            break;
+        case AT_E0:
+            atCmd.echo = false;
+            atCmd.result(RESULT_CODE_OK);
+            break;
+        case AT_E1:
+            atCmd.echo = true;
+            atCmd.result(RESULT_CODE_OK);
+            break;
+        case AT_V0:
+            atCmd.result(RESULT_CODE_OK);
+            atCmd.numeric = true;
+            break;
+        case AT_V1:
+            atCmd.println("OK");
+            atCmd.numeric = false;
+            break;
+        default:
+            atCmd.result(RESULT_CODE_ERROR);
+            break;
+        }
+
+        atCmd.line.clear();
+    }
+};
+
+static void test_at_commands()
+{
+    EchoServer server;
+    if (!server.start())
+    {
+        CHECK(false, "echo server failed to start");
+        return;
+    }
+    server.serve_echo();
+
+    TestModem modem;
+
+    modem.type("AT\r");
+    CHECK(modem.output() == "AT\r\nOK\r\n", "AT not echoed and answered with OK");
+
+    modem.type("ATFOO\r");
+    CHECK(modem.output() == "ATFOO\r\nERROR\r\n", "unknown command not answered with ERROR");
+
+    modem.type("\r");
+    CHECK(modem.output().empty(), "empty line answered");
+
+    modem.type("ATX\bE0\r");
+    CHECK(modem.output() == "ATX\b \bE0\r\nOK\r\n", "backspace not echoed or ATE0 not answered");
+    modem.type("AT\r");
+    CHECK(modem.output() == "OK\r\n", "typing echoed after ATE0");
+
+    modem.type("ATV0\r");
+    CHECK(modem.output() == "OK\r\n", "ATV0 not answered");
+    modem.type("ATBAR\r");
+    CHECK(modem.output() == "4\r\n", "ERROR not numeric after ATV0");
+
+    std::string dial = "ATDT 127.0.0.1:" + std::to_string(server.port) + "\r";
+    modem.type(dial.c_str());
+    CHECK(!modem.cmdMode && modem.client.connected(), "ATDT didn't connect");
+    CHECK(modem.output() == "10\r\n", "ATDT not answered with CONNECT 2400 as a number");
+
+    modem.type("ATV1\r");
+    modem.output();
+    modem.type("ATE1\r");
+    CHECK(modem.output() == "OK\r\n", "ATE1 not answered");
+
+    // Echo is back on for this one
+    modem.type("ATH\r");
+    CHECK(modem.cmdMode && !modem.client.connected(), "ATH didn't hang up");
+    CHECK(modem.output() == "ATH\r\nNO CARRIER\r\n", "ATH not answered with NO CARRIER");
+
+    modem.atCmd.line = "ATDT host.example";
+    std::string addr, port;
+    modem.atCmd.dial_address(&addr, &port);
+    CHECK(addr == "host.example" && port == "23", "ATDT without a port doesn't use telnet's");
+    modem.atCmd.line.clear();
+
+    server.join();
+}
+
+static void test_escape()
+{
+    HostBus host;
+    ModemCommand atCmd(&host);
+    const uint8_t plus[] = {'+', '+', '+'};
+    const uint8_t data[] = {'+', '+', '+', 'x'};
+
+    // Data right after the "+++" is not an escape
+    atCmd.escape_scan(data, sizeof(data));
+    std::this_thread::sleep_for(std::chrono::milliseconds(MODEM_ESCAPE_GUARD_MS + 100));
+    CHECK(!atCmd.escape_due(), "\"+++\" followed by data escaped");
+
+    // "+++" split over two reads, then the guard time
+    atCmd.escape_scan(plus, 2);
+    atCmd.escape_scan(plus, 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(MODEM_ESCAPE_GUARD_MS / 2));
+    CHECK(!atCmd.escape_due(), "escaped before the guard time");
+    std::this_thread::sleep_for(std::chrono::milliseconds(MODEM_ESCAPE_GUARD_MS / 2 + 100));
+    CHECK(atCmd.escape_due(), "no escape after the guard time");
+    CHECK(!atCmd.escape_due(), "escape reported twice");
+
+    atCmd.escape_scan(plus, sizeof(plus));
+    atCmd.escape_reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds(MODEM_ESCAPE_GUARD_MS + 100));
+    CHECK(!atCmd.escape_due(), "escape after escape_reset()");
+
+    CHECK(host.received.empty(), "escape scan wrote to the host");
+}
+
+int main()
+{
+    test_ring_buffer();
+
+    const unsigned int bauds[] = {300, 1200, 2400, 9600, 19200, 57600, 115200};
+    for (unsigned int baud : bauds)
+        test_loopback(baud);
+
+    test_hang_up();
+
+    test_at_commands();
+    test_escape();
+
+    if (failures == 0)
+        printf("OK\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * #FujiNet host test - PCLink directory index
+ *
+ * Fills a host directory with 5000 DOS named files and looks names up the
+ * way FOPEN does, once through the directory index and once by reading
+ * the directory and stat()ing every entry as PCLink did before. Both
+ * must find the same files, wildcards and attribute masks must match the
+ * right entries and the index must be the faster one, counting its build.
+ * The index is reused while the directory is unchanged and rebuilt once
+ * PCLink drops it after a change.
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "compat_dirent.h"
+#include "sio/pclinkDir.h"
+
+#ifdef BUILD_ATARI
+
+#define FILES 5000
+#define LOOKUPS 200
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                 \
+    do                                                                   \
+    {                                                                    \
+        if (!(cond))                                                     \
+        {                                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, msg);     \
+            failures++;                                                  \
+        }                                                                \
+    } while (0)
+
+using test_clock = std::chrono::steady_clock;
+
+static std::string dir;
+
+static void make_file(const char *name, size_t size)
+{
+    FILE *f = fopen((dir + "/" + name).c_str(), "wb");
+    if (f == nullptr)
+        return;
+    for (size_t i = 0; i < size; i++)
+        fputc('x', f);
+    fclose(f);
+}
+
+// The first host name matching an 11 character DOS mask, from the index
+static std::string index_lookup(const char *mask, uchar fatr1, off_t *size = nullptr)
+{
+    DIRINDEX *di = dir_index_get(dir.c_str());
+    if (di == nullptr)
+        return "";
+    for (const DIRINDEX_ENTRY &e : di->entries)
+        if (match_dos_names((char *)e.raw_name, (char *)mask, fatr1, e.mode) == 0)
+        {
+            if (size != nullptr)
+                *size = e.size;
+            return e.fname;
+        }
+    return "";
+}
+
+// The same lookup reading the directory and stat()ing every entry
+static std::string scan_lookup(const char *mask, uchar fatr1)
+{
+    std::string found;
+    DIR *dh = opendir(dir.c_str());
+    if (dh == nullptr)
+        return found;
+    struct dirent *dp;
+    while ((dp = readdir(dh)) != nullptr)
+    {
+        char fname[256], raw_name[12];
+        struct stat sb;
+        strcpy(fname, dp->d_name);
+        if (validate_dos_name(fname) || stat((dir + "/" + fname).c_str(), &sb) != 0)
+            continue;
+        if (!S_ISREG(sb.st_mode) && !S_ISDIR(sb.st_mode))
+            continue;
+        ugefina(fname, raw_name);
+        if (match_dos_names(raw_name, (char *)mask, fatr1, sb.st_mode) == 0)
+        {
+            found = fname;
+            break;
+        }
+    }
+    closedir(dh);
+    return found;
+}
+
+static int index_count(const char *mask, uchar fatr1)
+{
+    DIRINDEX *di = dir_index_get(dir.c_str());
+    int n = 0;
+    if (di != nullptr)
+        for (const DIRINDEX_ENTRY &e : di->entries)
+            if (match_dos_names((char *)e.raw_name, (char *)mask, fatr1, e.mode) == 0)
+                n++;
+    return n;
+}
+
+static void test_lookups()
+{
+    char name[16], mask[12];
+    int wrong = 0;
+
+    double index_ms = 0, scan_ms = 0;
+    dir_index_flush();
+    for (int pass = 0; pass < 2; pass++)
+    {
+        test_clock::time_point start = test_clock::now();
+        for (int i = 0; i < LOOKUPS; i++)
+        {
+            int n = i * (FILES / LOOKUPS) + 7;
+            snprintf(name, sizeof(name), "f%04d.dat", n);
+            ugefina(name, mask);
+            std::string found = pass == 0 ? index_lookup(mask, RA_NO_SUBDIR) : scan_lookup(mask, RA_NO_SUBDIR);
+            if (found != name)
+                wrong++;
+        }
+        double ms = std::chrono::duration<double, std::milli>(test_clock::now() - start).count();
+        (pass == 0 ? index_ms : scan_ms) = ms;
+    }
+    printf("%d lookups in %d files: index %.1f ms (with its build), readdir and stat %.1f ms\n",
+           LOOKUPS, FILES, index_ms, scan_ms);
+    CHECK(wrong == 0, "lookup found the wrong file");
+    CHECK(index_ms * 2 < scan_ms, "index not faster than rescanning the directory");
+
+    off_t size = -1;
+    CHECK(index_lookup("F0500   DAT", 0, &size) == "f0500.dat" && size == 500 % 97, "indexed size wrong");
+    CHECK(index_lookup("NOTHERE DAT", 0).empty(), "missing file found");
+    CHECK(index_count("F12?????DAT", 0) == 100, "wildcard matched the wrong number of files");
+    CHECK(index_count("???????????", RA_SUBDIR) == 1, "subdirectory mask wrong");
+    CHECK(index_count("???????????", RA_NO_SUBDIR) == FILES, "files mask wrong");
+}
+
+static void test_reuse_and_invalidate()
+{
+    DIRINDEX *di = dir_index_get(dir.c_str());
+    if (di == nullptr)
+    {
+        CHECK(false, "no index");
+        return;
+    }
+    uint64_t built = di->built;
+    // non DOS names aren't indexed
+    CHECK(di->entries.size() == FILES + 1, "index has the wrong entries");
+
+    DIRINDEX *again = dir_index_get((dir + "/").c_str());
+    CHECK(again == di && again->built == built, "index not reused for the same directory");
+
+    make_file("new.dat", 3);
+    dir_index_invalidate_parent((dir + "/new.dat").c_str());
+    di = dir_index_get(dir.c_str());
+    CHECK(di != nullptr && di->entries.size() == FILES + 2, "index not rebuilt after it was dropped");
+    CHECK(index_lookup("NEW     DAT", 0) == "new.dat", "new file not found");
+    unlink((dir + "/new.dat").c_str());
+    dir_index_invalidate(dir.c_str());
+    CHECK(index_lookup("NEW     DAT", 0).empty(), "removed file still indexed");
+}
+
+int main()
+{
+    char tmp[] = "/tmp/test_pclink_dirXXXXXX";
+    if (mkdtemp(tmp) == nullptr)
+    {
+        fprintf(stderr, "can't make a temporary directory\n");
+        return 1;
+    }
+    dir = tmp;
+
+    char name[16];
+    for (int i = 0; i < FILES; i++)
+    {
+        snprintf(name, sizeof(name), "f%04d.dat", i);
+        make_file(name, i % 97);
+    }
+    make_file("long_file_name.text", 1);
+    mkdir((dir + "/sub").c_str(), 0755);
+
+    test_lookups();
+    test_reuse_and_invalidate();
+
+    dir_index_flush();
+    for (int i = 0; i < FILES; i++)
+    {
+        snprintf(name, sizeof(name), "f%04d.dat", i);
+        unlink((dir + "/" + name).c_str());
+    }
+    unlink((dir + "/long_file_name.text").c_str());
+    rmdir((dir + "/sub").c_str());
+    rmdir(tmp);
+
+    if (failures == 0)
+        printf("OK\n");
+    return failures ? 1 : 0;
+}
+
+#else
+
+int main()
+{
+    printf("PCLink is only built for ATARI, skipped\n");
+    return 0;
+}
+
+#endif // BUILD_ATARI
@@ -0,0 +1,226 @@
+/**
+ * #FujiNet host test - PDF printer output buffering
+ *
+ * Prints a 20 page listing on the Atari 820 emulation into a file whose
+ * writes are counted, the way the SIO printer hands lines to it. The PDF
+ * must be written in buffer sized blocks, not per line: a few writes per
+ * page plus one per PDF_OUT_BUFFER of output. Object offsets, stream
+ * lengths and startxref are checked against the file, since they are now
+ * worked out from the buffer. The print has to keep well ahead of the
+ * SIO bus.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "atari_820.h"
+#include "fnFS.h"
+
+#ifdef BUILD_ATARI
+
+#define PAGES 20
+#define LINES_PER_PAGE 66
+#define SIO_CPS 1920 // 19200 baud
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                 \
+    do                                                                   \
+    {                                                                    \
+        if (!(cond))                                                     \
+        {                                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, msg);     \
+            failures++;                                                  \
+        }                                                                \
+    } while (0)
+
+// Local files, counting every write that reaches them
+class CountingFileSystem : public FileSystem
+{
+public:
+    std::string dir;
+    size_t writes = 0;
+
+    FILE *file_open(const char *path, const char *mode) override
+    {
+        FILE *f = fopen((dir + path).c_str(), mode);
+        if (f == nullptr)
+            return nullptr;
+        cookie_io_functions_t io = {_read, _write, _seek, _close};
+        _open = f;
+        FILE *counted = fopencookie(this, mode, io);
+        // unbuffered, so each fwrite() by the printer is one write
+        setvbuf(counted, nullptr, _IONBF, 0);
+        return counted;
+    }
+
+    fsType type() override { return FSTYPE_COUNT; }
+    const char *typestring() override { return "COUNTING"; }
+    FileHandler *filehandler_open(const char *path, const char *mode) override { return nullptr; }
+    bool exists(const char *path) override { return false; }
+    bool remove(const char *path) override { return false; }
+    bool rename(const char *pathFrom, const char *pathTo) override { return false; }
+    bool is_dir(const char *path) override { return false; }
+    bool mkdir(const char *path) override { return false; }
+    bool rmdir(const char *path) override { return false; }
+    bool dir_exists(const char *path) override { return false; }
+    bool dir_open(const char *path, const char *pattern, uint16_t diroptions) override { return false; }
+    fsdir_entry_t *dir_read() override { return nullptr; }
+    void dir_close() override {}
+    uint16_t dir_tell() override { return FNFS_INVALID_DIRPOS; }
+    bool dir_seek(uint16_t position) override { return false; }
+
+private:
+    FILE *_open = nullptr; // the printer has one file open at a time
+
+    static ssize_t _read(void *c, char *buf, size_t size)
+    {
+        return fread(buf, 1, size, ((CountingFileSystem *)c)->_open);
+    }
+
+    static ssize_t _write(void *c, const char *buf, size_t size)
+    {
+        CountingFileSystem *fs = (CountingFileSystem *)c;
+        fs->writes++;
+        return fwrite(buf, 1, size, fs->_open);
+    }
+
+    static int _seek(void *c, off64_t *offset, int whence)
+    {
+        FILE *f = ((CountingFileSystem *)c)->_open;
+        if (fseeko(f, *offset, whence) != 0)
+            return -1;
+        *offset = ftello(f);
+        return 0;
+    }
+
+    static int _close(void *c)
+    {
+        CountingFileSystem *fs = (CountingFileSystem *)c;
+        int r = fclose(fs->_open);
+        fs->_open = nullptr;
+        return r;
+    }
+};
+
+static std::string read_file(const std::string &path)
+{
+    std::string data;
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == nullptr)
+        return data;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.append(buf, n);
+    fclose(f);
+    return data;
+}
+
+// Offsets in the xref table and stream lengths match the file
+static void check_pdf(const std::string &pdf)
+{
+    CHECK(pdf.compare(0, 9, "%PDF-1.4\n") == 0, "PDF header missing");
+    CHECK(pdf.size() > 6 && pdf.compare(pdf.size() - 6, 6, "%%EOF\n") == 0, "PDF trailer missing");
+
+    size_t startxref = pdf.rfind("startxref\n");
+    if (startxref == std::string::npos)
+    {
+        CHECK(false, "no startxref");
+        return;
+    }
+    size_t xref = strtoul(pdf.c_str() + startxref + 10, nullptr, 10);
+    CHECK(pdf.compare(xref, 5, "xref\n") == 0, "startxref doesn't point at the xref table");
+
+    int count = 0;
+    sscanf(pdf.c_str() + xref, "xref\n0 %d\n", &count);
+    CHECK(count > 2 * PAGES, "xref table too short");
+    size_t entry = pdf.find("65535 f\n", xref) + 8;
+    int bad_objects = 0;
+    for (int i = 1; i < count; i++, entry = pdf.find('\n', entry) + 1)
+    {
+        size_t offset = strtoul(pdf.c_str() + entry, nullptr, 10);
+        std::string obj = std::to_string(i) + " 0 obj\n";
+        if (pdf.compare(offset, obj.size(), obj) != 0)
+            bad_objects++;
+    }
+    CHECK(bad_objects == 0, "xref offsets don't point at their objects");
+
+    int streams = 0, bad_lengths = 0;
+    for (size_t p = pdf.find("/Length "); p != std::string::npos; p = pdf.find("/Length ", p + 1))
+    {
+        size_t len = strtoul(pdf.c_str() + p + 8, nullptr, 10);
+        size_t start = pdf.find("stream\n", p) + 7;
+        if (pdf.compare(start + len, 10, "endstream\n") != 0)
+            bad_lengths++;
+        streams++;
+    }
+    CHECK(streams == PAGES, "wrong number of content streams");
+    CHECK(bad_lengths == 0, "stream lengths don't match the streams");
+}
+
+int main()
+{
+    char dir[] = "/tmp/test_pdf_printerXXXXXX";
+    if (mkdtemp(dir) == nullptr)
+    {
+        fprintf(stderr, "can't make a temporary directory\n");
+        return 1;
+    }
+
+    CountingFileSystem fs;
+    fs.dir = dir;
+    atari820 printer;
+    printer.initPrinter(&fs);
+
+    // A BASIC listing, one SIO printer record per line
+    size_t input = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PAGES * LINES_PER_PAGE; i++)
+    {
+        char line[64];
+        int n = snprintf(line, sizeof(line), "%d PRINT \"LINE %d (X)\";A$", i * 10, i);
+        line[n++] = (char)ATASCII_EOL;
+        memcpy(printer.provideBuffer(), line, n);
+        CHECK(printer.process(n, 'N', 0), "process() failed");
+        input += n;
+    }
+    size_t line_writes = fs.writes;
+    printer.closeOutput();
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::string pdf = read_file(std::string(dir) + "/paper");
+    check_pdf(pdf);
+
+    // Header, each page and its length patch, and full buffers on the way
+    size_t expected = 1 + 2 * PAGES + pdf.size() / PDF_OUT_BUFFER + 1;
+    printf("%d pages, %zu bytes in %zu writes (%zu allowed), %zu during the lines\n",
+           PAGES, pdf.size(), fs.writes, expected, line_writes);
+    CHECK(fs.writes <= expected, "PDF not written in buffered blocks");
+    CHECK(line_writes <= 1 + 2 * PAGES + pdf.size() / PDF_OUT_BUFFER, "lines written one at a time");
+
+    double cps = input / s;
+    printf("%.1f ms, %.0f chars/s from the host (%d on SIO), %.0f KB/s of PDF\n",
+           s * 1000, cps, SIO_CPS, pdf.size() / s / 1024);
+    CHECK(cps > SIO_CPS * 10, "printing doesn't keep ahead of the SIO bus");
+
+    remove((std::string(dir) + "/paper").c_str());
+    rmdir(dir);
+
+    if (failures == 0)
+        printf("OK\n");
+    return failures ? 1 : 0;
+}
+
+#else
+
+int main()
+{
+    printf("The Atari 820 printer is only built for ATARI, skipped\n");
+    return 0;
+}
+
+#endif // BUILD_ATARI
@@ -0,0 +1,191 @@
+/**
+ * #FujiNet host test - SMB read-ahead window
+ *
+ * Reads a disk image through FileHandlerSMB from a stand-in share that
+ * answers reads from memory, one per service of the connection, and
+ * records what was asked for. Sector reads at random positions must fetch
+ * one block each. Reading straight through an image with a 16 byte header,
+ * so sectors straddle blocks, must grow the window to SMB_READAHEAD_BLOCKS
+ * and fetch every block once. A seek starts the window over with one
+ * block. The data read is checked everywhere.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "fnFileSMB.h"
+
+#define BLOCK 4096
+#define IMAGE_SIZE (256 * BLOCK)
+#define SECTOR 128
+#define HEADER 16 // ATR header, sectors after it straddle blocks
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                 \
+    do                                                                   \
+    {                                                                    \
+        if (!(cond))                                                     \
+        {                                                                \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, msg);     \
+            failures++;                                                  \
+        }                                                                \
+    } while (0)
+
+static uint8_t pattern(size_t i)
+{
+    return (uint8_t)((i * 2654435761u) >> 13);
+}
+
+// A file on a share held in memory, reads are answered in the order they were sent
+class SmbStandIn : public FileHandlerSMB
+{
+public:
+    std::vector<uint8_t> image;
+    std::deque<ReadBlock *> sent;
+    std::vector<uint64_t> requested; // offsets of all block reads
+    size_t most_pending = 0;
+
+    SmbStandIn() : FileHandlerSMB(BLOCK, BLOCK)
+    {
+        image.resize(IMAGE_SIZE);
+        for (size_t i = 0; i < image.size(); i++)
+            image[i] = pattern(i);
+        _handle = (struct smb2fh *)this; // never handed to libsmb2
+    }
+
+    ~SmbStandIn() override { close(false); }
+
+    int close(bool destroy = true) override
+    {
+        _window_clear();
+        // blocks dropped while pending are freed as they arrive
+        while (_service(0) > 0)
+            ;
+        _handle = nullptr;
+        if (destroy)
+            delete this;
+        return 0;
+    }
+
+    int window_size() const { return _window_size; }
+
+protected:
+    int _pread_async(ReadBlock *b) override
+    {
+        sent.push_back(b);
+        requested.push_back(b->offset);
+        most_pending = std::max(most_pending, sent.size());
+        return 0;
+    }
+
+    int _service(int timeout_ms) override
+    {
+        if (sent.empty())
+            return 0;
+        ReadBlock *b = sent.front();
+        sent.pop_front();
+        size_t n = b->offset < image.size() ? std::min<size_t>(BLOCK, image.size() - b->offset) : 0;
+        memcpy(b->data, image.data() + std::min<size_t>(b->offset, image.size()), n);
+        _read_cb(nullptr, (int)n, nullptr, b);
+        return 1;
+    }
+};
+
+// Read a sector at pos the way the disk devices do, seeking first
+static bool read_sector(SmbStandIn &smb, size_t pos)
+{
+    uint8_t buf[SECTOR];
+    if (smb.seek((long)pos, SEEK_SET) != 0 || smb.read(buf, 1, SECTOR) != SECTOR)
+        return false;
+    for (size_t i = 0; i < SECTOR; i++)
+        if (buf[i] != pattern(pos + i))
+            return false;
+    return true;
+}
+
+static void test_random()
+{
+    SmbStandIn smb;
+    int reads = 300, misses = 0, bad = 0;
+    size_t last_block = SIZE_MAX;
+    uint32_t r = 12345;
+    for (int i = 0; i < reads; i++)
+    {
+        r = r * 1103515245 + 12345;
+        size_t pos = (size_t)((r >> 8) % (IMAGE_SIZE / SECTOR)) * SECTOR;
+        if (pos / BLOCK != last_block)
+            misses++;
+        last_block = pos / BLOCK;
+        if (!read_sector(smb, pos))
+            bad++;
+    }
+    printf("random: %d sector reads, %zu blocks fetched, at most %zu at once\n",
+           reads, smb.requested.size(), smb.most_pending);
+    CHECK(bad == 0, "random read returned the wrong data");
+    CHECK((int)smb.requested.size() == misses, "a random read fetched more than its block");
+    CHECK(smb.most_pending == 1, "blocks read ahead of random reads");
+}
+
+static void test_sequential()
+{
+    SmbStandIn smb;
+    int bad = 0, reads = 0;
+    size_t first_requests = 0;
+    for (size_t pos = HEADER; pos + SECTOR <= IMAGE_SIZE; pos += SECTOR, reads++)
+    {
+        if (!read_sector(smb, pos))
+            bad++;
+        if (pos == HEADER)
+            first_requests = smb.requested.size();
+    }
+    printf("sequential: %d sector reads, %zu blocks fetched, at most %zu at once\n",
+           reads, smb.requested.size(), smb.most_pending);
+    CHECK(bad == 0, "sequential read returned the wrong data");
+    CHECK(first_requests == 1, "first read fetched more than one block");
+    CHECK(smb.window_size() == SMB_READAHEAD_BLOCKS, "window didn't grow while reading on");
+    CHECK(smb.most_pending > 1, "nothing read ahead");
+
+    std::vector<uint64_t> in_image;
+    for (uint64_t offset : smb.requested)
+        if (offset < IMAGE_SIZE)
+            in_image.push_back(offset);
+    std::sort(in_image.begin(), in_image.end());
+    CHECK(in_image.size() == IMAGE_SIZE / BLOCK, "blocks fetched more than once");
+    CHECK(std::unique(in_image.begin(), in_image.end()) == in_image.end(), "block fetched twice");
+    CHECK(smb.requested.size() < IMAGE_SIZE / BLOCK + SMB_READAHEAD_BLOCKS, "too much read past the end");
+}
+
+static void test_seek_reset()
+{
+    SmbStandIn smb;
+    size_t pos;
+    for (pos = 0; pos < 8 * BLOCK; pos += SECTOR)
+        read_sector(smb, pos);
+    CHECK(smb.window_size() == SMB_READAHEAD_BLOCKS, "window didn't grow");
+
+    size_t before = smb.requested.size();
+    CHECK(read_sector(smb, 100 * BLOCK + 5 * SECTOR), "read after seek failed");
+    CHECK(smb.window_size() == 1, "seek didn't start the window over");
+    CHECK(smb.requested.size() == before + 1 && smb.requested.back() == 100 * BLOCK,
+          "seek fetched more than one block");
+
+    // Reading on from there grows it again
+    for (pos = 100 * BLOCK + 6 * SECTOR; pos < 101 * BLOCK + SECTOR; pos += SECTOR)
+        read_sector(smb, pos);
+    CHECK(smb.window_size() == 2, "window didn't grow after the seek");
+}
+
+int main()
+{
+    test_random();
+    test_sequential();
+    test_seek_reset();
+
+    if (failures == 0)
+        printf("OK\n");
+    return failures ? 1 : 0;
+}
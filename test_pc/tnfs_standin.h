@@ -0,0 +1,314 @@
+/**
+ * #FujiNet host tests - TNFS server stand-in
+ *
+ * Minimal TNFS-over-TCP server serving files from memory. Every response is
+ * held back for a configurable latency, measured from when its request
+ * arrived, so requests sent back-to-back overlap like they do on a network.
+ */
+
+#ifndef TNFS_STANDIN_H
+#define TNFS_STANDIN_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TnfsStandIn
+{
+public:
+    std::map<std::string, std::vector<uint8_t>> files;
+    int latency_us = 2000;          // delay between a request arriving and its response leaving
+    std::atomic<bool> swap_reads{false}; // serve the next two READ requests in reverse order
+
+    std::atomic<int> reads{0};
+    std::atomic<int> seeks{0};
+    int port = 0;
+
+    bool start()
+    {
+        _listen = socket(AF_INET, SOCK_STREAM, 0);
+        if (_listen < 0)
+            return false;
+        int one = 1;
+        setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(_listen, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(_listen, 4) < 0)
+            return false;
+        socklen_t len = sizeof(addr);
+        getsockname(_listen, (sockaddr *)&addr, &len);
+        port = ntohs(addr.sin_port);
+        std::thread([this] { _accept_loop(); }).detach();
+        return true;
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Response
+    {
+        clock::time_point due;
+        std::vector<uint8_t> data;
+    };
+
+    struct Session
+    {
+        int sock;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Response> queue;
+        bool closed = false;
+        std::map<uint8_t, std::pair<std::string, long>> handles; // handle -> (path, position)
+        uint8_t next_handle = 1;
+    };
+
+    int _listen = -1;
+
+    void _accept_loop()
+    {
+        while (true)
+        {
+            int s = accept(_listen, nullptr, nullptr);
+            if (s < 0)
+                return;
+            int one = 1;
+            setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            std::thread([this, s] { _session(s); }).detach();
+        }
+    }
+
+    static bool _read_exact(int s, uint8_t *buf, size_t len)
+    {
+        while (len > 0)
+        {
+            ssize_t n = recv(s, buf, len, 0);
+            if (n <= 0)
+                return false;
+            buf += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    // TNFS over TCP has no framing, so request length follows from the command
+    static bool _read_request(int s, std::vector<uint8_t> &req)
+    {
+        req.resize(4);
+        if (!_read_exact(s, req.data(), 4))
+            return false;
+        size_t fixed = 0;
+        int strings = 0;
+        switch (req[3])
+        {
+        case 0x00: fixed = 2; strings = 3; break; // MOUNT: version, path, user, password
+        case 0x01: break;                         // UMOUNT
+        case 0x21: fixed = 3; break;              // READ: handle, length
+        case 0x23: fixed = 1; break;              // CLOSE: handle
+        case 0x24: strings = 1; break;            // STAT: path
+        case 0x25: fixed = 6; break;              // LSEEK: handle, whence, offset
+        case 0x29: fixed = 4; strings = 1; break; // OPEN: flags, mode, path
+        default: return false;
+        }
+        req.resize(4 + fixed);
+        if (fixed && !_read_exact(s, req.data() + 4, fixed))
+            return false;
+        for (int i = 0; i < strings; i++)
+        {
+            uint8_t c;
+            do
+            {
+                if (!_read_exact(s, &c, 1))
+                    return false;
+                req.push_back(c);
+            } while (c != 0);
+        }
+        return true;
+    }
+
+    static void _put16(std::vector<uint8_t> &v, uint16_t x)
+    {
+        v.push_back(x & 0xFF);
+        v.push_back(x >> 8);
+    }
+
+    static void _put32(std::vector<uint8_t> &v, uint32_t x)
+    {
+        _put16(v, x & 0xFFFF);
+        _put16(v, x >> 16);
+    }
+
+    std::vector<uint8_t> _handle(Session &ss, const std::vector<uint8_t> &req)
+    {
+        std::vector<uint8_t> res(req.begin(), req.begin() + 4);
+        const char *str = (const char *)req.data() + 4;
+        switch (req[3])
+        {
+        case 0x00: // MOUNT
+            res[0] = 0x34;
+            res[1] = 0x12;
+            res.push_back(0);
+            _put16(res, 0x0102);
+            _put16(res, 100);
+            break;
+        case 0x01: // UMOUNT
+        case 0x23: // CLOSE
+            ss.handles.erase(req[4]);
+            res.push_back(0);
+            break;
+        case 0x24: // STAT
+        {
+            auto it = files.find(str);
+            if (it == files.end())
+            {
+                res.push_back(0x02); // ENOENT
+                break;
+            }
+            res.push_back(0);
+            _put16(res, 0100644);
+            _put16(res, 0);
+            _put16(res, 0);
+            _put32(res, it->second.size());
+            _put32(res, 1);
+            _put32(res, 1);
+            _put32(res, 1);
+            break;
+        }
+        case 0x29: // OPEN
+        {
+            std::string path = str + 4;
+            if (files.find(path) == files.end())
+            {
+                res.push_back(0x02);
+                break;
+            }
+            uint8_t h = ss.next_handle++;
+            ss.handles[h] = {path, 0};
+            res.push_back(0);
+            res.push_back(h);
+            break;
+        }
+        case 0x25: // LSEEK
+        {
+            seeks++;
+            auto it = ss.handles.find(req[4]);
+            if (it == ss.handles.end())
+            {
+                res.push_back(0x1F); // EBADF
+                break;
+            }
+            uint32_t off = req[6] | req[7] << 8 | req[8] << 16 | (uint32_t)req[9] << 24;
+            if (req[5] == SEEK_SET)
+                it->second.second = off;
+            else if (req[5] == SEEK_CUR)
+                it->second.second += (int32_t)off;
+            else
+                it->second.second = files[it->second.first].size() + (int32_t)off;
+            res.push_back(0);
+            break;
+        }
+        case 0x21: // READ
+        {
+            reads++;
+            auto it = ss.handles.find(req[4]);
+            if (it == ss.handles.end())
+            {
+                res.push_back(0x1F);
+                break;
+            }
+            const std::vector<uint8_t> &data = files[it->second.first];
+            long &pos = it->second.second;
+            uint16_t want = req[5] | req[6] << 8;
+            if (pos >= (long)data.size())
+            {
+                res.push_back(0x21); // EOF
+                break;
+            }
+            uint16_t n = std::min<long>(want, data.size() - pos);
+            res.push_back(0);
+            _put16(res, n);
+            res.insert(res.end(), data.begin() + pos, data.begin() + pos + n);
+            pos += n;
+            break;
+        }
+        }
+        return res;
+    }
+
+    void _sender(Session *ss)
+    {
+        std::unique_lock<std::mutex> lock(ss->mutex);
+        while (true)
+        {
+            ss->cv.wait(lock, [ss] { return ss->closed || !ss->queue.empty(); });
+            if (ss->queue.empty())
+                return;
+            Response r = std::move(ss->queue.front());
+            ss->queue.pop_front();
+            lock.unlock();
+            std::this_thread::sleep_until(r.due);
+            send(ss->sock, r.data.data(), r.data.size(), MSG_NOSIGNAL);
+            lock.lock();
+        }
+    }
+
+    void _session(int s)
+    {
+        Session ss;
+        ss.sock = s;
+        std::thread sender([this, &ss] { _sender(&ss); });
+
+        std::vector<uint8_t> req;
+        std::vector<uint8_t> held; // READ request waiting to be swapped with the next one
+        while (_read_request(s, req))
+        {
+            clock::time_point due = clock::now() + std::chrono::microseconds(latency_us);
+            std::vector<std::vector<uint8_t>> out;
+            if (req[3] == 0x21 && swap_reads && held.empty())
+            {
+                held = req;
+                continue;
+            }
+            if (!held.empty())
+            {
+                // Serve the later request first, as if the earlier one had been delayed on the way
+                out.push_back(_handle(ss, req));
+                out.push_back(_handle(ss, held));
+                held.clear();
+                swap_reads = false;
+            }
+            else
+            {
+                out.push_back(_handle(ss, req));
+            }
+            std::lock_guard<std::mutex> lock(ss.mutex);
+            for (auto &r : out)
+                ss.queue.push_back({due, std::move(r)});
+            ss.cv.notify_one();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(ss.mutex);
+            ss.closed = true;
+            ss.cv.notify_one();
+        }
+        sender.join();
+        close(s);
+    }
+};
+
+#endif // TNFS_STANDIN_H